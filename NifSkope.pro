@@ -158,7 +158,9 @@ HEADERS += \
 	src/gl/marker/furniture.h \
 	src/gl/BSMesh.h \
 	src/gl/bsshape.h \
+	src/gl/bvh.h \
 	src/gl/controllers.h \
+	src/gl/cubemapfilter.h \
 	src/gl/glcontroller.h \
 	src/gl/glmarker.h \
 	src/gl/glmesh.h \
@@ -172,6 +174,8 @@ HEADERS += \
 	src/gl/gltools.h \
 	src/gl/icontrollable.h \
 	src/gl/renderer.h \
+	src/gl/skinning.h \
+	src/gl/texconvert.h \
 	src/io/material.h \
 	src/io/MeshFile.h \
 	src/io/nifstream.h \
@@ -204,6 +208,7 @@ HEADERS += \
 	src/ui/widgets/nifeditors.h \
 	src/ui/widgets/nifview.h \
 	src/ui/widgets/refrbrowser.h \
+	src/ui/widgets/texturestats.h \
 	src/ui/widgets/uvedit.h \
 	src/ui/widgets/valueedit.h \
 	src/ui/widgets/xmlcheck.h \
@@ -218,7 +223,11 @@ HEADERS += \
 	src/glview.h \
 	src/message.h \
 	src/nifskope.h \
+	src/pathindex.h \
 	src/spellbook.h \
+	src/texturedecoder.h \
+	src/textureencoder.h \
+	src/textureinfo.h \
 	src/version.h \
 	lib/dds.h \
 	lib/dxgiformat.h \
@@ -235,7 +244,9 @@ SOURCES += \
 	src/data/nifvalue.cpp \
 	src/gl/BSMesh.cpp \
 	src/gl/bsshape.cpp \
+	src/gl/bvh.cpp \
 	src/gl/controllers.cpp \
+	src/gl/cubemapfilter.cpp \
 	src/gl/glcontroller.cpp \
 	src/gl/glmarker.cpp \
 	src/gl/glmesh.cpp \
@@ -248,6 +259,8 @@ SOURCES += \
 	src/gl/gltexloaders.cpp \
 	src/gl/gltools.cpp \
 	src/gl/renderer.cpp \
+	src/gl/skinning.cpp \
+	src/gl/texconvert.cpp \
 	src/io/materialfile.cpp \
 	src/io/MeshFile.cpp \
 	src/io/nifstream.cpp \
@@ -305,6 +318,7 @@ SOURCES += \
 	src/ui/widgets/nifeditors.cpp \
 	src/ui/widgets/nifview.cpp \
 	src/ui/widgets/refrbrowser.cpp \
+	src/ui/widgets/texturestats.cpp \
 	src/ui/widgets/uvedit.cpp \
 	src/ui/widgets/valueedit.cpp \
 	src/ui/widgets/xmlcheck.cpp \
@@ -322,7 +336,11 @@ SOURCES += \
 	src/message.cpp \
 	src/nifskope.cpp \
 	src/nifskope_ui.cpp \
+	src/pathindex.cpp \
 	src/spellbook.cpp \
+	src/texturedecoder.cpp \
+	src/textureencoder.cpp \
+	src/textureinfo.cpp \
 	src/version.cpp \
 	lib/meshlet.cpp \
 	lib/meshoptimizer/clusterizer.cpp \
@@ -12,7 +12,6 @@ varying vec4 D;
 varying mat4 reflMatrix;
 
 uniform mat4 worldMatrix;
-// FIXME: these uniforms are never set
 uniform bool isSkinned;
 uniform bool isGPUSkinned;
 uniform mat4 boneTransforms[100];
@@ -10,7 +10,6 @@ varying vec4 A;
 varying vec4 C;
 varying vec4 D;
 
-// FIXME: these uniforms are never set
 uniform bool isGPUSkinned;
 uniform mat4 boneTransforms[100];
 
@@ -12,7 +12,6 @@ out vec4 D;
 out mat4 reflMatrix;
 
 uniform mat4 worldMatrix;
-// FIXME: these uniforms are never set
 uniform bool isSkinned;
 uniform bool isGPUSkinned;
 uniform mat4 boneTransforms[100];
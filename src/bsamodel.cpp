@@ -36,22 +36,30 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QDateTime>
 #include <QStringBuilder>
 
+#include <algorithm>
+
 
 BSAModel::BSAModel( QObject * parent )
-	: QStandardItemModel( parent )
+	: QAbstractItemModel( parent )
 {
-
+	folderNodes.emplace_back();
 }
 
 void BSAModel::init()
 {
-	setColumnCount( 3 );
-	setHorizontalHeaderLabels( { "File", "Path", "Size" } );
+	clear();
 }
 
-Qt::ItemFlags BSAModel::flags( const QModelIndex & index ) const
+void BSAModel::clear()
 {
-	return QStandardItemModel::flags( index ) ^ Qt::ItemIsEditable;
+	beginResetModel();
+	fileTable.clear();
+	fileTable.shrink_to_fit();
+	pathIndex.clear();
+	rootPath.clear();
+	folderNodes.clear();
+	folderNodes.emplace_back();
+	endResetModel();
 }
 
 bool BSAModel::fillModel( const BA2File * bsa, const QString & folder )
@@ -59,67 +67,242 @@ bool BSAModel::fillModel( const BA2File * bsa, const QString & folder )
 	if ( !bsa )
 		return false;
 
-	FileScanFuncData	data;
-	data.p = this;
-	data.bsa = bsa;
-	data.path = folder.toStdString();
-	if ( !data.path.empty() && !data.path.ends_with( '/' ) )
-		data.path += '/';
-
-	// List files
-	bsa->scanFileList( &fileListScanFunction, &data );
+	beginResetModel();
+	fileTable.clear();
+	folderNodes.clear();
+	rootPath = folder.toStdString();
+	if ( !rootPath.empty() && !rootPath.ends_with( '/' ) )
+		rootPath += '/';
+
+	// List files, only the file information pointers are stored
+	bsa->scanFileList( &fileListScanFunction, this );
+	std::sort( fileTable.begin(), fileTable.end(),
+				[]( const BA2File::FileInfo * a, const BA2File::FileInfo * b ) {
+					return ( a->fileName < b->fileName );
+				} );
+
+	pathIndex.clear();
+	for ( const BA2File::FileInfo * fd : fileTable )
+		pathIndex.addPath( fd->fileName );
+	pathIndex.build( true );
+
+	FolderNode &	root = folderNodes.emplace_back();
+	root.endFile = std::uint32_t( fileTable.size() );
+	root.pathLen = std::uint32_t( rootPath.length() );
+	endResetModel();
 
 	return ( rowCount() > 0 );
 }
 
 bool BSAModel::fileListScanFunction( void * p, const BA2File::FileInfo & fd )
 {
-	FileScanFuncData & o = *( reinterpret_cast< FileScanFuncData * >( p ) );
+	BSAModel &	o = *( reinterpret_cast< BSAModel * >( p ) );
 
-	if ( fd.fileName.length() <= o.path.length() || !( o.path.empty() || fd.fileName.starts_with( o.path ) ) )
+	if ( fd.fileName.length() <= o.rootPath.length() || !( o.rootPath.empty() || fd.fileName.starts_with( o.rootPath ) ) )
 		return false;
 
-	qsizetype	bytes = qsizetype( fd.archiveType < 64 || fd.packedSize == 0 ? fd.unpackedSize : fd.packedSize );
-	QString	fileSize( (bytes > 1024) ? QString::number( bytes / 1024 ) + "KB" : QString::number( bytes ) + "B" );
+	o.fileTable.push_back( &fd );
 
-	QString	fullPath( QString::fromLatin1( fd.fileName.data(), qsizetype(fd.fileName.length()) ) );
-	qsizetype	dirNameLen = fullPath.lastIndexOf( QChar( '/' ) );
-	QString	baseName( fullPath.mid( dirNameLen + 1 ) );
-	auto	folderItem = o.p->insertFolder( fullPath, o.path.length(), dirNameLen, o.folderMap );
+	return false;
+}
 
-	auto	fileItem = new QStandardItem( baseName );
-	auto	pathItem = new QStandardItem( fullPath );
-	auto	sizeItem = new QStandardItem( fileSize );
+void BSAModel::populateFolder( FolderNode * node ) const
+{
+	if ( node->isPopulated )
+		return;
+	node->isPopulated = true;
+
+	std::uint32_t	i = node->firstFile;
+	while ( i < node->endFile ) {
+		const std::string_view &	fullPath = fileTable[i]->fileName;
+		size_t	n = fullPath.find( '/', node->pathLen );
+		if ( n == std::string_view::npos ) {
+			node->files.push_back( i );
+			i++;
+			continue;
+		}
 
-	folderItem->appendRow( { fileItem, pathItem, sizeItem } );
+		// All files with the same folder prefix are stored contiguously in the sorted table
+		std::string_view	prefix( fullPath.data(), n + 1 );
+		auto	j = std::partition_point(
+					fileTable.begin() + i, fileTable.begin() + node->endFile,
+					[&prefix]( const BA2File::FileInfo * fd ) {
+						return fd->fileName.starts_with( prefix );
+					} );
+
+		FolderNode &	folderNode = folderNodes.emplace_back();
+		folderNode.parent = node;
+		folderNode.row = int( node->folders.size() );
+		folderNode.firstFile = i;
+		folderNode.endFile = std::uint32_t( j - fileTable.begin() );
+		folderNode.pathLen = std::uint32_t( prefix.length() );
+		node->folders.push_back( &folderNode );
+		i = folderNode.endFile;
+	}
+}
 
-	return false;
+BSAModel::FolderNode * BSAModel::getFolder( const QModelIndex & index ) const
+{
+	if ( !index.isValid() )
+		return &( folderNodes.front() );
+
+	FolderNode *	parentNode = reinterpret_cast< FolderNode * >( index.internalPointer() );
+	if ( size_t( index.row() ) < parentNode->folders.size() )
+		return parentNode->folders[index.row()];
+	return nullptr;
+}
+
+const BA2File::FileInfo * BSAModel::getFile( const QModelIndex & index ) const
+{
+	if ( !index.isValid() )
+		return nullptr;
+
+	FolderNode *	parentNode = reinterpret_cast< FolderNode * >( index.internalPointer() );
+	size_t	n = size_t( index.row() ) - parentNode->folders.size();
+	if ( n < parentNode->files.size() )
+		return fileTable[parentNode->files[n]];
+	return nullptr;
+}
+
+bool BSAModel::getFileRange( const QModelIndex & index, std::uint32_t & firstFile, std::uint32_t & endFile ) const
+{
+	if ( !index.isValid() )
+		return false;
+
+	const FolderNode *	folderNode = getFolder( index );
+	if ( folderNode ) {
+		firstFile = folderNode->firstFile;
+		endFile = folderNode->endFile;
+		return true;
+	}
+
+	const FolderNode *	parentNode = reinterpret_cast< const FolderNode * >( index.internalPointer() );
+	size_t	n = size_t( index.row() ) - parentNode->folders.size();
+	if ( n >= parentNode->files.size() )
+		return false;
+	firstFile = parentNode->files[n];
+	endFile = firstFile + 1;
+	return true;
+}
+
+QModelIndex BSAModel::index( int row, int column, const QModelIndex & parent ) const
+{
+	if ( row < 0 || column < 0 || column >= NumColumns || parent.column() > 0 )
+		return QModelIndex();
+
+	FolderNode *	node = getFolder( parent );
+	if ( !node )
+		return QModelIndex();
+	populateFolder( node );
+	if ( row >= node->childCount() )
+		return QModelIndex();
+
+	return createIndex( row, column, node );
+}
+
+QModelIndex BSAModel::parent( const QModelIndex & index ) const
+{
+	if ( !index.isValid() )
+		return QModelIndex();
+
+	FolderNode *	parentNode = reinterpret_cast< FolderNode * >( index.internalPointer() );
+	if ( !parentNode->parent )
+		return QModelIndex();
+
+	return createIndex( parentNode->row, 0, parentNode->parent );
+}
+
+int BSAModel::rowCount( const QModelIndex & parent ) const
+{
+	if ( parent.column() > 0 )
+		return 0;
+
+	FolderNode *	node = getFolder( parent );
+	if ( !node )
+		return 0;
+	populateFolder( node );
+
+	return node->childCount();
+}
+
+int BSAModel::columnCount( [[maybe_unused]] const QModelIndex & parent ) const
+{
+	return NumColumns;
 }
 
-QStandardItem * BSAModel::insertFolder( const QString & path, qsizetype pos1, qsizetype pos2, QHash< QString, QStandardItem * > & folderMap )
+bool BSAModel::hasChildren( const QModelIndex & parent ) const
 {
-	if ( pos2 <= pos1 )
-		return invisibleRootItem();
+	if ( parent.column() > 0 )
+		return false;
 
-	QString	key( path.left( pos2 ) );
-	for ( auto i = folderMap.find( key ); i != folderMap.end(); )
-		return i.value();
+	// Folders are never empty, there is no need to populate them here
+	FolderNode *	node = getFolder( parent );
+	return ( node && node->endFile > node->firstFile );
+}
 
-	qsizetype	i1 = path.lastIndexOf( QChar('/'), pos2 - 1 );
-	QStandardItem *	parent;
-	// Recurse through folders
-	if ( i1 > pos1 )
-		parent = insertFolder( path, pos1, i1, folderMap );
-	else
-		parent = invisibleRootItem();
-	QStandardItem *	folderItem = new QStandardItem( path.mid( i1 + 1, pos2 - ( i1 + 1 ) ) );
-	auto pathDummy = new QStandardItem();
-	auto sizeDummy = new QStandardItem();
+QVariant BSAModel::data( const QModelIndex & index, int role ) const
+{
+	if ( !index.isValid() || !( role == Qt::DisplayRole || role == Qt::EditRole ) )
+		return QVariant();
+
+	const FolderNode *	folderNode = getFolder( index );
+	if ( folderNode ) {
+		if ( index.column() != NameCol )
+			return QString();
+		const std::string_view &	fullPath = fileTable[folderNode->firstFile]->fileName;
+		size_t	n = folderNode->parent->pathLen;
+		return QString::fromLatin1( fullPath.data() + n, qsizetype( folderNode->pathLen - n ) - 1 );
+	}
 
-	parent->appendRow( { folderItem, pathDummy, sizeDummy } );
-	folderMap.insert( key, folderItem );
+	const BA2File::FileInfo *	fd = getFile( index );
+	if ( !fd )
+		return QVariant();
 
-	return folderItem;
+	switch ( index.column() ) {
+	case NameCol:
+		{
+			size_t	n = fd->fileName.rfind( '/' ) + 1;
+			return QString::fromLatin1( fd->fileName.data() + n, qsizetype( fd->fileName.length() - n ) );
+		}
+	case PathCol:
+		return QString::fromLatin1( fd->fileName.data(), qsizetype( fd->fileName.length() ) );
+	case SizeCol:
+		{
+			qsizetype	bytes = qsizetype( fd->archiveType < 64 || fd->packedSize == 0 ? fd->unpackedSize : fd->packedSize );
+			return ( (bytes > 1024) ? QString::number( bytes / 1024 ) + "KB" : QString::number( bytes ) + "B" );
+		}
+	default:
+		break;
+	}
+
+	return QVariant();
+}
+
+QVariant BSAModel::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+	if ( orientation != Qt::Horizontal || role != Qt::DisplayRole )
+		return QVariant();
+
+	switch ( section ) {
+	case NameCol:
+		return tr( "File" );
+	case PathCol:
+		return tr( "Path" );
+	case SizeCol:
+		return tr( "Size" );
+	default:
+		break;
+	}
+
+	return QVariant();
+}
+
+Qt::ItemFlags BSAModel::flags( const QModelIndex & index ) const
+{
+	if ( !index.isValid() )
+		return Qt::NoItemFlags;
+
+	return ( Qt::ItemIsSelectable | Qt::ItemIsEnabled );
 }
 
 
@@ -134,46 +317,115 @@ void BSAProxyModel::setFiletypes( QStringList types )
 	filetypes = types;
 }
 
+void BSAProxyModel::setSourceModel( QAbstractItemModel * newSourceModel )
+{
+	if ( sourceModel() )
+		disconnect( sourceModel(), &QAbstractItemModel::modelReset, this, &BSAProxyModel::updateNameFilter );
+
+	matchCounts.clear();
+	QSortFilterProxyModel::setSourceModel( newSourceModel );
+
+	if ( newSourceModel )
+		connect( newSourceModel, &QAbstractItemModel::modelReset, this, &BSAProxyModel::updateNameFilter );
+	updateNameFilter();
+}
+
+void BSAProxyModel::setNameFilter( const QString & pattern )
+{
+	nameFilter = pattern;
+
+	updateNameFilter();
+}
+
 void BSAProxyModel::setFilterByNameOnly( bool nameOnly )
 {
 	filterByNameOnly = nameOnly;
 
-	setFilterRegularExpression( filterRegularExpression() );
+	updateNameFilter();
 }
 
 void BSAProxyModel::resetFilter()
 {
-	setFilterRegularExpression( QRegularExpression() );
+	nameFilter.clear();
+
+	updateNameFilter();
 }
 
-bool BSAProxyModel::filterAcceptsRow( int sourceRow, const QModelIndex & sourceParent ) const
+void BSAProxyModel::updateNameFilter()
 {
-	if ( !filterRegularExpression().pattern().isEmpty() ) {
-
-		QModelIndex sourceIndex0 = sourceModel()->index( sourceRow, 0, sourceParent );
-		QModelIndex sourceIndex1 = sourceModel()->index( sourceRow, 1, sourceParent );
-		if ( sourceIndex0.isValid() ) {
-			// If children match, parent matches
-			int c = sourceModel()->rowCount( sourceIndex0 );
-			for ( int i = 0; i < c; ++i ) {
-				if ( filterAcceptsRow( i, sourceIndex0 ) )
-					return true;
+	matchCounts.clear();
+
+	const BSAModel *	bsaModel = qobject_cast< const BSAModel * >( sourceModel() );
+	if ( bsaModel && !nameFilter.isEmpty() ) {
+		const FilePathIndex &	pathIndex = bsaModel->getPathIndex();
+		std::vector< std::uint32_t >	matches;
+		pathIndex.find( matches, nameFilter.toStdString(), filterByNameOnly );
+
+		std::vector< std::string >	types;
+		for ( const auto & f : filetypes )
+			types.push_back( FilePathIndex::normalizePattern( f.toStdString() ) );
+
+		// Prefix sums of matching files, a folder matches if any of the files in its range does
+		matchCounts.resize( pathIndex.size() + 1, 0 );
+		size_t	n = 0;
+		std::uint32_t	cnt = 0;
+		for ( std::uint32_t i : matches ) {
+			if ( !types.empty() ) {
+				const std::string_view &	fullPath = pathIndex[i];
+				bool	typeMatch = false;
+				for ( const auto & t : types )
+					typeMatch = typeMatch || fullPath.ends_with( t );
+				if ( !typeMatch )
+					continue;
 			}
+			for ( ; n <= i; n++ )
+				matchCounts[n] = cnt;
+			cnt++;
+		}
+		for ( ; n < matchCounts.size(); n++ )
+			matchCounts[n] = cnt;
+	}
 
-			QString key0 = sourceModel()->data( sourceIndex0, filterRole() ).toString();
-			QString key1 = sourceModel()->data( sourceIndex1, filterRole() ).toString();
+	invalidateFilter();
+}
 
-			bool typeMatch = true;
-			if ( filetypes.count() ) {
-				typeMatch = false;
-				for ( auto f : filetypes ) {
-					typeMatch |= key1.endsWith( f, Qt::CaseInsensitive );
-				}
+QModelIndexList BSAProxyModel::matchingFolders( std::uint32_t maxFiles ) const
+{
+	QModelIndexList	folders;
+	const BSAModel *	bsaModel = qobject_cast< const BSAModel * >( sourceModel() );
+	if ( !bsaModel || matchCounts.empty() )
+		return folders;
+
+	// breadth first, the rows of a folder are only queried (and the folder populated) if it is expanded
+	QModelIndexList	parents = { QModelIndex() };
+	for ( qsizetype i = 0; i < parents.size(); i++ ) {
+		QModelIndex	parent = parents.at( i );
+		for ( int row = 0; row < rowCount( parent ); row++ ) {
+			QModelIndex	index = this->index( row, 0, parent );
+			QModelIndex	sourceIndex = mapToSource( index );
+			std::uint32_t	firstFile, endFile;
+			if ( !bsaModel->hasChildren( sourceIndex ) || !bsaModel->getFileRange( sourceIndex, firstFile, endFile )
+				|| size_t( endFile ) >= matchCounts.size() ) {
+				continue;
 			}
+			if ( ( matchCounts[endFile] - matchCounts[firstFile] ) > maxFiles )
+				continue;
+			folders.append( index );
+			parents.append( index );
+		}
+	}
 
-			bool stringMatch = (filterByNameOnly) ? key0.contains( filterRegularExpression() ) : key1.contains( filterRegularExpression() );
+	return folders;
+}
 
-			return typeMatch && stringMatch;
+bool BSAProxyModel::filterAcceptsRow( int sourceRow, const QModelIndex & sourceParent ) const
+{
+	if ( !matchCounts.empty() ) {
+		const BSAModel *	bsaModel = qobject_cast< const BSAModel * >( sourceModel() );
+		std::uint32_t	firstFile, endFile;
+		if ( bsaModel && bsaModel->getFileRange( bsaModel->index( sourceRow, 0, sourceParent ), firstFile, endFile )
+			&& size_t( endFile ) < matchCounts.size() ) {
+			return ( matchCounts[endFile] > matchCounts[firstFile] );
 		}
 	}
 
@@ -185,17 +437,14 @@ bool BSAProxyModel::lessThan( const QModelIndex & left, const QModelIndex & righ
 	QString leftString = sourceModel()->data( left ).toString();
 	QString rightString = sourceModel()->data( right ).toString();
 
-	QModelIndex leftChild;
-	if ( left.model() )
-		leftChild = left.model()->index( 0, 0, left );
-	QModelIndex rightChild;
-	if ( right.model() )
-		rightChild = right.model()->index( 0, 0, right );
+	// Sort folders before files, without populating the folders
+	bool leftIsFolder = sourceModel()->hasChildren( left );
+	bool rightIsFolder = sourceModel()->hasChildren( right );
 
-	if ( !leftChild.isValid() && rightChild.isValid() )
+	if ( !leftIsFolder && rightIsFolder )
 		return false;
 
-	if ( leftChild.isValid() && !rightChild.isValid() )
+	if ( leftIsFolder && !rightIsFolder )
 		return true;
 
 	return leftString < rightString;
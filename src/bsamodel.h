@@ -34,31 +34,88 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define BSAMODEL_H
 
 #include "libfo76utils/src/ba2file.hpp"
+#include "pathindex.h"
 
-#include <QStandardItemModel>
+#include <QAbstractItemModel>
 #include <QSortFilterProxyModel>
-#include <QHash>
 
-class BSAModel : public QStandardItemModel
+#include <deque>
+#include <vector>
+
+//! Archive browser model, backed directly by the file table of a BA2File
+/*!
+ * The file table is copied only as a sorted array of pointers to the archive's file information.
+ * Folder nodes are created on demand when their children are first queried (typically on expanding
+ * the folder in a view), and file names and sizes are formatted only when displayed.
+ */
+class BSAModel : public QAbstractItemModel
 {
 	Q_OBJECT
 
 public:
 	BSAModel( QObject * parent = nullptr );
 
-	void init();
+	enum
+	{
+		NameCol = 0,
+		PathCol = 1,
+		SizeCol = 2,
+		NumColumns = 3
+	};
 
+	void init();
+	void clear();
+
+	QModelIndex index( int row, int column, const QModelIndex & parent = QModelIndex() ) const override;
+	QModelIndex parent( const QModelIndex & index ) const override;
+	int rowCount( const QModelIndex & parent = QModelIndex() ) const override;
+	int columnCount( const QModelIndex & parent = QModelIndex() ) const override;
+	bool hasChildren( const QModelIndex & parent = QModelIndex() ) const override;
+	QVariant data( const QModelIndex & index, int role = Qt::DisplayRole ) const override;
+	QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const override;
 	Qt::ItemFlags flags( const QModelIndex & index ) const override;
+
 	bool fillModel( const BA2File * bsa, const QString & folder );
+
+	//! Index of the full paths of all files in the model, in the same order as the file table
+	inline const FilePathIndex & getPathIndex() const
+	{
+		return pathIndex;
+	}
+	//! Get the range of file table indices under a folder, or the index of a single file as a range of length 1
+	bool getFileRange( const QModelIndex & index, std::uint32_t & firstFile, std::uint32_t & endFile ) const;
+
 protected:
-	struct FileScanFuncData {
-		BSAModel * p;
-		const BA2File * bsa;
-		std::string path;
-		QHash< QString, QStandardItem * > folderMap;
+	struct FolderNode {
+		FolderNode *	parent = nullptr;
+		// row of this folder in the parent folder
+		int	row = 0;
+		// range of files in the sorted file table that are under this folder
+		std::uint32_t	firstFile = 0;
+		std::uint32_t	endFile = 0;
+		// length of the full path of the folder, including the trailing '/'
+		std::uint32_t	pathLen = 0;
+		bool	isPopulated = false;
+		// child folders are listed first, followed by the files (as indices into fileTable)
+		std::vector< FolderNode * >	folders;
+		std::vector< std::uint32_t >	files;
+		inline int childCount() const
+		{
+			return int( folders.size() + files.size() );
+		}
 	};
+
 	static bool fileListScanFunction( void * p, const BA2File::FileInfo & fd );
-	QStandardItem * insertFolder( const QString & path, qsizetype pos1, qsizetype pos2, QHash< QString, QStandardItem * > & folderMap );
+	void populateFolder( FolderNode * node ) const;
+	FolderNode * getFolder( const QModelIndex & index ) const;
+	const BA2File::FileInfo * getFile( const QModelIndex & index ) const;
+
+	// files under the root folder, sorted by full path
+	std::vector< const BA2File::FileInfo * >	fileTable;
+	FilePathIndex	pathIndex;
+	std::string	rootPath;
+	// node 0 is the root folder
+	mutable std::deque< FolderNode >	folderNodes;
 };
 
 
@@ -71,18 +128,33 @@ public:
 
 	void setFiletypes( QStringList types );
 
+	void setSourceModel( QAbstractItemModel * sourceModel ) override;
+
+	//! Filter files by wildcard pattern, using the path index of the source model
+	void setNameFilter( const QString & pattern );
 	void resetFilter();
 
+	//! Returns the folders that contain at most 'maxFiles' files matching the name filter, parents first.
+	// Only these are expanded by the view, so that a filter matching most of a large archive does not
+	// populate all of its folders.
+	QModelIndexList matchingFolders( std::uint32_t maxFiles ) const;
+
 public slots:
 	void setFilterByNameOnly( bool nameOnly );
 
+protected slots:
+	void updateNameFilter();
+
 protected:
-	bool filterAcceptsRow( int sourceRow, const QModelIndex & sourceParent ) const;
-	bool lessThan( const QModelIndex & left, const QModelIndex & right ) const;
+	bool filterAcceptsRow( int sourceRow, const QModelIndex & sourceParent ) const override;
+	bool lessThan( const QModelIndex & left, const QModelIndex & right ) const override;
 
 private:
 	QStringList filetypes;
 	bool filterByNameOnly = false;
+	QString nameFilter;
+	// number of matching files before each index of the source model file table, empty if there is no filter
+	std::vector< std::uint32_t > matchCounts;
 };
 
 #endif
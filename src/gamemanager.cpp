@@ -5,14 +5,21 @@
 #include "material.hpp"
 #include "message.h"
 #include "model/nifmodel.h"
+#include "pathindex.h"
 
 #include <QSettings>
 #include <QCoreApplication>
 #include <QProgressDialog>
+#include <QDateTime>
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QMap>
 #include <QMessageBox>
 #include <QStringBuilder>
+#include <QTimer>
+
+#include <mutex>
 
 namespace Game
 {
@@ -74,6 +81,10 @@ static const ResourceListMap FOLDERS = {
 };
 
 std::uint64_t	GameManager::material_db_prv_id = 0;
+std::atomic< std::uint64_t >	GameManager::resource_generation = 1;
+std::shared_mutex	GameManager::archive_mutex;
+std::unordered_map< const BA2File *, std::uint64_t >	GameManager::archive_generations;
+QStringList	GameManager::missing_files_pending;
 GameManager::GameResources	GameManager::archives[NUM_GAMES];
 std::unordered_map< const NifModel *, GameManager::GameResources * >	GameManager::nifResourceMap;
 QString	GameManager::gamePaths[NUM_GAMES];
@@ -166,17 +177,32 @@ GameManager::GameResources::~GameResources()
 {
 	if ( sfMaterials && !( parent && sfMaterials == parent->sfMaterials ) )
 		delete sfMaterials;
-	if ( ba2File )
+	if ( fileIndex )
+		delete fileIndex;
+	if ( ba2File ) {
+		std::unique_lock< std::shared_mutex >	lock( GameManager::archive_mutex );
+		GameManager::archive_generations.erase( ba2File );
 		delete ba2File;
+		GameManager::resource_generation++;
+	}
 }
 
 void GameManager::GameResources::init_archives()
 {
 	if ( sfMaterialDB_ID )
 		close_materials();
+	if ( fileIndex ) {
+		delete fileIndex;
+		fileIndex = nullptr;
+	}
+	looseFiles.clear();
+	archiveSources.clear();
 	if ( ba2File ) {
+		std::unique_lock< std::shared_mutex >	lock( GameManager::archive_mutex );
+		GameManager::archive_generations.erase( ba2File );
 		delete ba2File;
 		ba2File = nullptr;
+		GameManager::resource_generation++;
 	}
 
 	if ( parent && !parent->ba2File )
@@ -190,14 +216,20 @@ void GameManager::GameResources::init_archives()
 	}
 	if ( tmp.isEmpty() )
 		return;
-	ba2File = new BA2File();
+	BA2File *	p = new BA2File();
 	for ( const auto & i : tmp ) {
 		try {
-			ba2File->loadArchivePath( i.toStdString().c_str(), archiveFilterFuncTable[game] );
+			p->loadArchivePath( i.toStdString().c_str(), archiveFilterFuncTable[game] );
 		} catch ( FO76UtilsError & e ) {
 			QMessageBox::critical( nullptr, "NifSkope error", QString("Error opening resource path '%1': %2").arg(i).arg(e.what()) );
 		}
+		while ( size_t( archiveSources.size() ) < p->getArchiveFileCnt() )
+			archiveSources.append( i );
 	}
+	std::unique_lock< std::shared_mutex >	lock( GameManager::archive_mutex );
+	ba2File = p;
+	archivesLoadTime = QDateTime::currentMSecsSinceEpoch();
+	GameManager::archive_generations[p] = ++GameManager::resource_generation;
 }
 
 static bool archiveScanFunctionMat( [[maybe_unused]] void * p, const BA2File::FileInfo & fd )
@@ -246,9 +278,18 @@ void GameManager::GameResources::close_archives()
 {
 	if ( sfMaterialDB_ID )
 		close_materials();
+	if ( fileIndex ) {
+		delete fileIndex;
+		fileIndex = nullptr;
+	}
+	looseFiles.clear();
+	archiveSources.clear();
 	if ( ba2File ) {
+		std::unique_lock< std::shared_mutex >	lock( GameManager::archive_mutex );
+		GameManager::archive_generations.erase( ba2File );
 		delete ba2File;
 		ba2File = nullptr;
+		GameManager::resource_generation++;
 	}
 }
 
@@ -266,14 +307,40 @@ void GameManager::GameResources::close_materials()
 	sfMaterialDB_ID = 0;
 }
 
+bool GameManager::GameResources::is_missing_file( const std::string_view & fullPath )
+{
+	if ( missingFilesGeneration != GameManager::resource_generation ) [[unlikely]] {
+		missingFiles.clear();
+		missingFilesGeneration = GameManager::resource_generation;
+		return false;
+	}
+	return missingFiles.contains( fullPath );
+}
+
+void GameManager::GameResources::add_missing_file( const std::string_view & fullPath )
+{
+	if ( missingFilesGeneration != GameManager::resource_generation ) {
+		missingFiles.clear();
+		missingFilesGeneration = GameManager::resource_generation;
+	}
+	missingFiles.emplace( fullPath );
+}
+
 QString GameManager::GameResources::find_file( const std::string_view & fullPath )
 {
 	if ( !ba2File && !dataPaths.isEmpty() )
 		init_archives();
+	if ( is_missing_file( fullPath ) )
+		return QString();
 	if ( ba2File && ba2File->findFile( fullPath ) )
 		return QString::fromUtf8( fullPath.data(), qsizetype(fullPath.length()) );
-	if ( parent )
-		return parent->find_file( fullPath );
+	if ( parent ) {
+		QString	s( parent->find_file( fullPath ) );
+		if ( s.isEmpty() )
+			add_missing_file( fullPath );
+		return s;
+	}
+	add_missing_file( fullPath );
 	return QString();
 }
 
@@ -284,64 +351,291 @@ static unsigned char * byteArrayAllocFunc( void * bufPtr, size_t nBytes )
 	return reinterpret_cast< unsigned char * >( p->data() );
 }
 
-bool GameManager::GameResources::get_file( QByteArray & data, const std::string_view & fullPath )
+GameManager::FileData::FileData()
+{
+}
+
+GameManager::FileData::~FileData()
+{
+}
+
+void GameManager::FileData::clear()
+{
+	mappedFile.reset();
+	buf.clear();
+	dataPtr = nullptr;
+	dataSize = 0;
+}
+
+bool GameManager::FileData::mapFile( const QString & fileName, qsizetype expectedSize, qint64 expectedTime )
+{
+	clear();
+	if ( expectedSize < 1 )
+		return false;
+	auto	f = std::make_unique< QFile >( fileName );
+	if ( !f->open( QIODevice::ReadOnly ) || f->size() != expectedSize
+		|| f->fileTime( QFileDevice::FileModificationTime ).toMSecsSinceEpoch() != expectedTime ) {
+		return false;
+	}
+#ifdef Q_OS_WIN
+	// a mapped file cannot be written or deleted on Windows, so that loose files being edited in other
+	// applications would remain locked for as long as NifSkope uses the data
+	buf = f->readAll();
+	if ( buf.size() != expectedSize ) {
+		buf.clear();
+		return false;
+	}
+	setBuffer();
+	return true;
+#else
+	uchar *	p = f->map( 0, expectedSize );
+	if ( !p )
+		return false;
+	// the file remains open while it is mapped
+	mappedFile = std::move( f );
+	dataPtr = reinterpret_cast< const char * >( p );
+	dataSize = expectedSize;
+	return true;
+#endif
+}
+
+void GameManager::FileData::setBuffer()
+{
+	dataPtr = buf.constData();
+	dataSize = buf.size();
+}
+
+bool GameManager::GameResources::find_loose_file(
+	QString & diskPath, qsizetype & fileSize, qint64 & modTime,
+	const std::string_view & fullPath, size_t archiveFile, std::uint64_t unpackedSize )
+{
+	fileSize = -1;
+	modTime = -1;
+	auto	i = looseFiles.find( fullPath );
+	if ( i == looseFiles.end() ) {
+		// BA2File overrides loose files with later data paths, archiveFile is the index of the one it has used
+		QString	s;
+		if ( archiveFile < size_t( archiveSources.size() ) ) {
+			const QString &	d = archiveSources.at( qsizetype( archiveFile ) );
+			QString	p( QString::fromUtf8( fullPath.data(), qsizetype(fullPath.length()) ) );
+			qsizetype	n = p.indexOf( QChar('/') );
+			// data paths can be either the Data folder, or a top level folder like Data/Textures
+			s = d + QChar('/') + p;
+			if ( !QFileInfo( s ).isFile() && n > 0 && QFileInfo( d ).fileName().compare( p.left( n ), Qt::CaseInsensitive ) == 0 )
+				s = d + p.mid( n );
+			if ( !QFileInfo( s ).isFile() )
+				s.clear();
+		}
+		i = looseFiles.emplace( std::string( fullPath ), LooseFile{ s, -1 } ).first;
+	}
+	diskPath = i->second.diskPath;
+	if ( diskPath.isEmpty() )
+		return false;
+	QFileInfo	f( diskPath );
+	if ( !f.exists() )
+		return true;
+	fileSize = qsizetype( f.size() );
+	modTime = f.lastModified().toMSecsSinceEpoch();
+	bool	isChanged = ( fileSize != qsizetype( unpackedSize ) );
+	if ( i->second.modTime < 0 ) {
+		// first lookup: the file has changed if it is newer than the archives
+		i->second.modTime = modTime;
+		isChanged = isChanged || ( modTime > archivesLoadTime );
+	} else {
+		isChanged = isChanged || ( modTime != i->second.modTime );
+	}
+	return isChanged;
+}
+
+void GameManager::FileRef::clear()
+{
+	fullPath.clear();
+	ba2File = nullptr;
+	diskPath.clear();
+	diskSize = -1;
+	diskTime = -1;
+	generation = 0;
+	source.clear();
+	packedSize = 0;
+	unpackedSize = 0;
+}
+
+bool GameManager::GameResources::find_file_ref( FileRef & ref, const std::string_view & fullPath, bool reloadIfChanged )
 {
+	ref.clear();
 	if ( !ba2File && !dataPaths.isEmpty() )
 		init_archives();
+	if ( is_missing_file( fullPath ) )
+		return false;
 	const BA2File::FileInfo *	fd = nullptr;
 	if ( ba2File )
 		fd = ba2File->findFile( fullPath );
 	if ( !fd ) {
-		if ( parent )
-			return parent->get_file( data, fullPath );
-		qWarning() << "File '" << QLatin1String( fullPath.data(), qsizetype(fullPath.length()) ) << "' not found in archives";
-		data.resize( 0 );
+		if ( parent ) {
+			if ( parent->find_file_ref( ref, fullPath, reloadIfChanged ) )
+				return true;
+			add_missing_file( fullPath );
+			return false;
+		}
+		// the file is reported only on the first failed lookup until the cache is invalidated
+		if ( missing_files_pending.isEmpty() )
+			QTimer::singleShot( 0, &GameManager::report_missing_files );
+		missing_files_pending.append( QString::fromUtf8( fullPath.data(), qsizetype(fullPath.length()) ) );
+		add_missing_file( fullPath );
 		return false;
 	}
-	try {
-		ba2File->extractFile( &data, &byteArrayAllocFunc, *fd );
-	} catch ( FO76UtilsError & e ) {
-		if ( std::string_view(e.what()).starts_with( "BA2File: unexpected change to size of loose file" ) ) {
+
+	if ( fd->archiveType >= 64 ) {
+		// loose file: check if it has changed since the archives were loaded
+		QString	diskPath;
+		qsizetype	fileSize;
+		qint64	modTime;
+		if ( find_loose_file( diskPath, fileSize, modTime, fullPath, fd->archiveFile, fd->unpackedSize ) && reloadIfChanged ) {
 			close_archives();
-			return get_file( data, fullPath );
+			return find_file_ref( ref, fullPath, false );
 		}
-		QMessageBox::critical( nullptr, "NifSkope error", QString("Error loading resource file '%1': %2").arg( QLatin1String( fullPath.data(), qsizetype(fullPath.length()) ) ).arg( e.what() ) );
-		data.resize( 0 );
+		if ( !diskPath.isEmpty() ) {
+			ref.diskPath = diskPath;
+			ref.diskSize = fileSize;
+			ref.diskTime = modTime;
+			ref.source = diskPath;
+		}
+	} else if ( fd->archiveFile < size_t( archiveSources.size() ) ) {
+		ref.source = archiveSources.at( qsizetype( fd->archiveFile ) );
+	}
+	ref.fullPath = fullPath;
+	ref.ba2File = ba2File;
+	{
+		std::shared_lock< std::shared_mutex >	lock( GameManager::archive_mutex );
+		auto	i = GameManager::archive_generations.find( ba2File );
+		ref.generation = ( i != GameManager::archive_generations.end() ? i->second : 0 );
+	}
+	ref.unpackedSize = fd->unpackedSize;
+	ref.packedSize = ( fd->archiveType < 64 && fd->packedSize ? fd->packedSize : fd->unpackedSize );
+	return true;
+}
+
+bool GameManager::read_file( FileData & data, const FileRef & ref, std::string * errorMessage )
+{
+	data.clear();
+	if ( !ref.ba2File ) [[unlikely]]
+		return false;
+	if ( !ref.diskPath.isEmpty() && data.mapFile( ref.diskPath, ref.diskSize, ref.diskTime ) )
+		return true;
+
+	// the archives cannot be closed while the file is being extracted
+	std::shared_lock< std::shared_mutex >	lock( archive_mutex );
+	// other resource sets being opened or closed do not affect the archives the file was found in
+	auto	i = archive_generations.find( ref.ba2File );
+	if ( i == archive_generations.end() || i->second != ref.generation )
+		return false;
+	const BA2File::FileInfo *	fd = ref.ba2File->findFile( ref.fullPath );
+	if ( !fd ) [[unlikely]]
+		return false;
+	try {
+		ref.ba2File->extractFile( &(data.buf), &byteArrayAllocFunc, *fd );
+	} catch ( FO76UtilsError & e ) {
+		if ( errorMessage )
+			*errorMessage = e.what();
+		data.clear();
 		return false;
 	}
+	data.setBuffer();
 	return true;
 }
 
-struct list_files_scan_function_data {
-	std::set< std::string_view > * fileSet;
-	bool (*filterFunc)( void * p, const std::string_view & fileName );
-	void * filterFuncData;
-};
+bool GameManager::is_valid_file_ref( const FileRef & ref )
+{
+	if ( !ref.ba2File )
+		return false;
+	std::shared_lock< std::shared_mutex >	lock( archive_mutex );
+	auto	i = archive_generations.find( ref.ba2File );
+	return ( i != archive_generations.end() && i->second == ref.generation );
+}
+
+bool GameManager::GameResources::get_file( FileData & data, const std::string_view & fullPath, bool reloadIfChanged )
+{
+	data.clear();
+	FileRef	ref;
+	if ( !find_file_ref( ref, fullPath, reloadIfChanged ) )
+		return false;
 
-static bool list_files_scan_function( void * p, const BA2File::FileInfo & fd )
+	std::string	errorMessage;
+	if ( GameManager::read_file( data, ref, &errorMessage ) )
+		return true;
+	if ( errorMessage.empty() )
+		return false;
+	if ( reloadIfChanged && std::string_view( errorMessage ).starts_with( "BA2File: unexpected change to size of loose file" ) ) {
+		close_archives();
+		return get_file( data, fullPath, false );
+	}
+	QMessageBox::critical( nullptr, "NifSkope error", QString("Error loading resource file '%1': %2").arg( QLatin1String( fullPath.data(), qsizetype(fullPath.length()) ) ).arg( QString::fromStdString( errorMessage ) ) );
+	return false;
+}
+
+bool GameManager::GameResources::get_file( QByteArray & data, const std::string_view & fullPath )
 {
-	list_files_scan_function_data & o = *( reinterpret_cast< list_files_scan_function_data * >( p ) );
-	if ( !o.filterFunc || o.filterFunc( o.filterFuncData, fd.fileName ) )
-		o.fileSet->insert( fd.fileName );
+	FileData	tmp;
+	if ( !get_file( tmp, fullPath ) ) {
+		data.resize( 0 );
+		return false;
+	}
+	if ( tmp.isMapped() )
+		data = QByteArray( tmp.data(), tmp.size() );
+	else
+		data = std::move( tmp.buf );
+	return true;
+}
+
+static bool file_index_scan_function( void * p, const BA2File::FileInfo & fd )
+{
+	reinterpret_cast< FilePathIndex * >( p )->addPath( fd.fileName );
 	return false;
 }
 
+const FilePathIndex & GameManager::GameResources::get_file_index()
+{
+	// make sure that archives are loaded
+	if ( !( ba2File || fileIndex ) )
+		init_archives();
+	if ( !fileIndex ) {
+		fileIndex = new FilePathIndex();
+		if ( ba2File && ba2File->size() > 0 )
+			ba2File->scanFileList( &file_index_scan_function, fileIndex );
+		// substring searches are rare on the full archive filesystem, only the sorted tables are created
+		fileIndex->build( false, false );
+	}
+	return *fileIndex;
+}
+
 void GameManager::GameResources::list_files(
-	std::set< std::string_view > & fileSet,
+	std::vector< std::string_view > & fileList, const std::string_view & prefix,
+	std::initializer_list< std::string_view > extensions,
 	bool (*fileListFilterFunc)( void * p, const std::string_view & fileName ), void * fileListFilterFuncData )
 {
 	if ( parent )
-		parent->list_files( fileSet, fileListFilterFunc, fileListFilterFuncData );
-	// make sure that archives are loaded
-	if ( !ba2File )
-		init_archives();
-	if ( !( ba2File && ba2File->size() > 0 ) )
+		parent->list_files( fileList, prefix, extensions, fileListFilterFunc, fileListFilterFuncData );
+
+	const FilePathIndex &	index = get_file_index();
+	std::vector< std::uint32_t >	tmp;
+	if ( extensions.size() < 1 ) {
+		index.findFiles( tmp, prefix, std::string_view() );
+	} else {
+		for ( const auto & e : extensions )
+			index.findFiles( tmp, prefix, e );
+	}
+	if ( tmp.empty() )
 		return;
-	list_files_scan_function_data	tmp;
-	tmp.fileSet = &fileSet;
-	tmp.filterFunc = fileListFilterFunc;
-	tmp.filterFuncData = fileListFilterFuncData;
-	ba2File->scanFileList( &list_files_scan_function, &tmp );
+
+	size_t	n = fileList.size();
+	for ( std::uint32_t i : tmp ) {
+		if ( !fileListFilterFunc || fileListFilterFunc( fileListFilterFuncData, index[i] ) )
+			fileList.push_back( index[i] );
+	}
+	if ( n > 0 || extensions.size() > 1 ) {
+		std::sort( fileList.begin(), fileList.end() );
+		fileList.erase( std::unique( fileList.begin(), fileList.end() ), fileList.end() );
+	}
 }
 
 GameManager::GameManager()
@@ -623,6 +917,31 @@ bool GameManager::get_file(
 	return archives[game].get_file( data, fullPath );
 }
 
+bool GameManager::get_file( FileData & data, const GameMode game, const std::string_view & fullPath )
+{
+	if ( !( game >= OTHER && game < NUM_GAMES ) ) {
+		data.clear();
+		return false;
+	}
+	return archives[game].get_file( data, fullPath );
+}
+
+bool GameManager::get_file(
+	FileData & data, const GameMode game, const QString & path, const char * archiveFolder, const char * extension )
+{
+	std::string	fullPath( get_full_path(path, archiveFolder, extension) );
+	return archives[game].get_file( data, fullPath );
+}
+
+bool GameManager::find_file_ref( FileRef & ref, const GameMode game, const std::string_view & fullPath )
+{
+	if ( !( game >= OTHER && game < NUM_GAMES ) ) {
+		ref.clear();
+		return false;
+	}
+	return archives[game].find_file_ref( ref, fullPath );
+}
+
 CE2MaterialDB * GameManager::materials( const GameMode game )
 {
 	if ( game != STARFIELD )
@@ -658,13 +977,23 @@ void GameManager::close_resources( bool nifResourcesFirst )
 	}
 }
 
+void GameManager::report_missing_files()
+{
+	if ( missing_files_pending.isEmpty() )
+		return;
+	missing_files_pending.removeDuplicates();
+	qWarning() << missing_files_pending.size() << "file(s) not found in archives:" << missing_files_pending.join( ", " );
+	missing_files_pending.clear();
+}
+
 void GameManager::list_files(
-	std::set< std::string_view > & fileSet, const GameMode game,
+	std::vector< std::string_view > & fileList, const GameMode game,
+	const std::string_view & prefix, std::initializer_list< std::string_view > extensions,
 	bool (*fileListFilterFunc)( void * p, const std::string_view & fileName ), void * fileListFilterFuncData )
 {
 	if ( !( game >= OTHER && game < NUM_GAMES ) )
 		return;
-	archives[game].list_files( fileSet, fileListFilterFunc, fileListFilterFuncData );
+	archives[game].list_files( fileList, prefix, extensions, fileListFilterFunc, fileListFilterFuncData );
 }
 
 QStringList GameManager::get_archive_list( const QString & dataPath )
@@ -810,6 +1139,7 @@ void GameManager::clear()
 		gameStatus[i] = true;
 	}
 	otherGamesFallback = false;
+	resource_generation++;
 }
 
 void GameManager::insert_game( const GameMode game, const QString & path )
@@ -823,6 +1153,7 @@ void GameManager::insert_folders( const GameMode game, const QStringList & list
 	if ( !( game >= OTHER && game < NUM_GAMES ) )
 		return;
 	archives[game].dataPaths.clear();
+	resource_generation++;
 	for ( const auto & i : list ) {
 		if ( !i.isEmpty() )
 			archives[game].dataPaths.append( i );
@@ -831,8 +1162,10 @@ void GameManager::insert_folders( const GameMode game, const QStringList & list
 
 void GameManager::insert_status( const GameMode game, bool status )
 {
-	if ( game >= OTHER && game < NUM_GAMES )
+	if ( game >= OTHER && game < NUM_GAMES ) {
 		gameStatus[game] = status;
+		resource_generation++;
+	}
 }
 
 } // end namespace Game
@@ -3,14 +3,25 @@
 
 #include "libfo76utils/src/common.hpp"
 
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <shared_mutex>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <QByteArray>
 #include <QString>
 #include <QStringList>
 
+class QFile;
 class QProgressDialog;
 class NifModel;
 class BA2File;
 class CE2MaterialDB;
+class FilePathIndex;
 
 namespace Game
 {
@@ -89,16 +100,96 @@ public:
 	//! Game enabled status in the GameManager
 	static bool status( const GameMode game );
 
+	struct StringViewHash
+	{
+		using is_transparent = void;
+		inline size_t operator()( const std::string_view & s ) const
+		{
+			return std::hash< std::string_view >()( s );
+		}
+	};
+
+	struct GameResources;
+
+	//! Resource file that has been located on the main thread, for reading it later, possibly on a worker thread,
+	// with read_file(). Reading fails if the archives it was found in have been closed or reloaded in the meantime.
+	struct FileRef
+	{
+		std::string	fullPath;
+		const BA2File *	ba2File = nullptr;
+		// disk path, size and modification time of the file if it is a loose file that can be read directly
+		QString	diskPath;
+		qsizetype	diskSize = -1;
+		qint64	diskTime = -1;
+		// generation of ba2File when the file was found, see archive_generations
+		std::uint64_t	generation = 0;
+		// archive or data path the file was found in, for diagnostics
+		QString	source;
+		// size of the file in the archive (compressed) and after extraction
+		std::uint64_t	packedSize = 0;
+		std::uint64_t	unpackedSize = 0;
+		void clear();
+	};
+
+	//! Read-only resource file data. Loose files are accessed through a read-only memory mapping of the file
+	// (read to a buffer on Windows, where mapping would lock the file), archived files are extracted to a buffer.
+	class FileData
+	{
+	public:
+		FileData();
+		~FileData();
+		FileData( const FileData & ) = delete;
+		FileData & operator=( const FileData & ) = delete;
+
+		void clear();
+		inline const char * data() const
+		{
+			return dataPtr;
+		}
+		inline qsizetype size() const
+		{
+			return dataSize;
+		}
+		inline bool isEmpty() const
+		{
+			return ( dataSize < 1 );
+		}
+		inline bool isMapped() const
+		{
+			return bool( mappedFile );
+		}
+		//! Returns a byte array that refers to the data without copying it. It remains valid while this object
+		// exists and is not cleared or reused. Modifying the byte array makes a copy of the data.
+		inline QByteArray byteArray() const
+		{
+			return QByteArray::fromRawData( dataPtr, dataSize );
+		}
+
+	protected:
+		friend class GameManager;
+		friend struct GameResources;
+		QByteArray	buf;
+		std::unique_ptr< QFile >	mappedFile;
+		const char *	dataPtr = nullptr;
+		qsizetype	dataSize = 0;
+		bool mapFile( const QString & fileName, qsizetype expectedSize, qint64 expectedTime );
+		void setBuffer();
+	};
+
 	struct GameResources
 	{
 		GameMode	game = OTHER;
 		std::int32_t	refCnt = 0;
 		BA2File *	ba2File = nullptr;
+		// sorted table of the paths in ba2File, created on first use
+		FilePathIndex *	fileIndex = nullptr;
 		CE2MaterialDB *	sfMaterials = nullptr;
 		std::uint64_t	sfMaterialDB_ID = 0;
 		GameResources *	parent = nullptr;
 		// list of data paths, empty for archived NIFs
 		QStringList	dataPaths;
+		// data path that each archive of ba2File was loaded from, indexed by BA2File::FileInfo::archiveFile
+		QStringList	archiveSources;
 		~GameResources();
 		void init_archives();
 		CE2MaterialDB * init_materials();
@@ -106,8 +197,36 @@ public:
 		void close_materials();
 		QString find_file( const std::string_view & fullPath );
 		bool get_file( QByteArray & data, const std::string_view & fullPath );
+		// if 'reloadIfChanged' is true and the file has been modified since the archives were loaded,
+		// then the archives are reloaded before reading the file
+		bool get_file( FileData & data, const std::string_view & fullPath, bool reloadIfChanged = true );
+		//! Find a file for reading it with read_file(), the return value is false if the file is not found
+		bool find_file_ref( FileRef & ref, const std::string_view & fullPath, bool reloadIfChanged = true );
+		// time when ba2File was loaded, in milliseconds since the epoch
+		qint64	archivesLoadTime = 0;
+		struct LooseFile
+		{
+			// empty if the path could not be resolved
+			QString	diskPath;
+			// modification time at the first lookup, loose files modified later are reloaded
+			qint64	modTime = -1;
+		};
+		// disk paths of loose files that have been looked up
+		std::unordered_map< std::string, LooseFile, StringViewHash, std::equal_to<> >	looseFiles;
+		// Find the disk path of a loose file in the data path BA2File has loaded it from. The return value is
+		// true if the file has been modified since the archives were loaded.
+		bool find_loose_file( QString & diskPath, qsizetype & fileSize, qint64 & modTime,
+								const std::string_view & fullPath, size_t archiveFile, std::uint64_t unpackedSize );
+		// Negative lookup cache: full paths of files that were not found in this resource set or its
+		// parents. It is cleared when any resource set is opened or closed, or the resource settings change.
+		std::unordered_set< std::string, StringViewHash, std::equal_to<> >	missingFiles;
+		std::uint64_t	missingFilesGeneration = 0;
+		bool is_missing_file( const std::string_view & fullPath );
+		void add_missing_file( const std::string_view & fullPath );
+		const FilePathIndex & get_file_index();
 		void list_files(
-			std::set< std::string_view > & fileSet,
+			std::vector< std::string_view > & fileList, const std::string_view & prefix,
+			std::initializer_list< std::string_view > extensions,
 			bool (*fileListFilterFunc)( void * p, const std::string_view & fileName ), void * fileListFilterFuncData );
 	};
 
@@ -124,9 +243,21 @@ public:
 		const GameMode game, const QString & path, const char * archiveFolder, const char * extension );
 	//! Find and load resource file to 'data'. The return value is true on success.
 	static bool get_file( QByteArray & data, const GameMode game, const std::string_view & fullPath );
+	static bool get_file( FileData & data, const GameMode game, const std::string_view & fullPath );
 	static bool get_file(
 		QByteArray & data, const GameMode game,
 		const QString & path, const char * archiveFolder, const char * extension );
+	static bool get_file(
+		FileData & data, const GameMode game,
+		const QString & path, const char * archiveFolder, const char * extension );
+	static bool find_file_ref( FileRef & ref, const GameMode game, const std::string_view & fullPath );
+	//! Read a file previously found with find_file_ref(). Unlike the other functions, this can be called from any
+	// thread. The return value is false if the archives have changed since the file was found, or on error, in which
+	// case the error message is stored in 'errorMessage' if it is not nullptr.
+	static bool read_file( FileData & data, const FileRef & ref, std::string * errorMessage = nullptr );
+	//! Returns false if the archives 'ref' was found in have been closed or reloaded, and the file needs to be
+	// looked up again with find_file_ref(). This can be called from any thread.
+	static bool is_valid_file_ref( const FileRef & ref );
 	//! Return pointer to Starfield material database, loading it first if necessary.
 	// On error, nullptr is returned.
 	static CE2MaterialDB * materials( const GameMode game );
@@ -136,10 +267,16 @@ public:
 	//! Close all currently opened resource archives, files and materials. If 'nifResourcesFirst' is true,
 	// then only the resources associated with loose NIF files are closed, if there are any.
 	static void close_resources( bool nifResourcesFirst = false );
-	//! List resource files available for 'game' on the archive filesystem, as a set of null-terminated strings.
-	// The file list can be optionally filtered by a function that returns false if the file should be excluded.
+	//! Print a single warning with all resource files that were not found since the last report.
+	// This is called automatically from the event loop after any new missing files are found.
+	static void report_missing_files();
+	//! List resource files available for 'game' on the archive filesystem that begin with 'prefix' and have any of
+	// the file name extensions in 'extensions' (all files if the list is empty). The paths are stored in 'fileList'
+	// as a sorted vector of null-terminated strings. The query uses the persistent path table of the resource set,
+	// and the result can be optionally filtered by a function that returns false if the file should be excluded.
 	static void list_files(
-		std::set< std::string_view > & fileSet, const GameMode game,
+		std::vector< std::string_view > & fileList, const GameMode game,
+		const std::string_view & prefix, std::initializer_list< std::string_view > extensions = {},
 		bool (*fileListFilterFunc)( void * p, const std::string_view & fileName ) = nullptr,
 		void * fileListFilterFuncData = nullptr );
 
@@ -186,6 +323,15 @@ private:
 	// resources associated with loose NIF files
 	static std::unordered_map< const NifModel *, GameResources * >	nifResourceMap;
 	static std::uint64_t	material_db_prv_id;
+	// incremented whenever archives are opened or closed, or the resource settings change,
+	// invalidating the negative lookup caches of all resource sets
+	static std::atomic< std::uint64_t >	resource_generation;
+	// locked exclusively while BA2File objects are created or deleted, and shared by read_file()
+	static std::shared_mutex	archive_mutex;
+	// BA2File objects that currently exist, with the value of resource_generation when each was created,
+	// so that a pointer reused by a new object is not mistaken for the old one (protected by archive_mutex)
+	static std::unordered_map< const BA2File *, std::uint64_t >	archive_generations;
+	static QStringList	missing_files_pending;
 	static QString	gamePaths[NUM_GAMES];
 	static bool	gameStatus[NUM_GAMES];
 	static bool	otherGamesFallback;
@@ -257,6 +403,7 @@ void GameManager::update_status( const QString & game, bool status )
 void GameManager::update_other_games_fallback( bool status )
 {
 	otherGamesFallback = status;
+	resource_generation++;
 }
 
 } // end namespace Game
@@ -22,11 +22,13 @@ void BSMesh::transformShapes()
 	if ( isHidden() )
 		return;
 #endif
+
+	updateViewBounds();
 }
 
 void BSMesh::drawShapes( NodeList * secondPass )
 {
-	if ( isHidden() || ( !scene->hasOption(Scene::ShowMarkers) && name.contains("EditorMarker") ) )
+	if ( isHidden() || ( !scene->hasOption(Scene::ShowMarkers) && name.contains("EditorMarker") ) || isCulled() )
 		return;
 
 	// Draw translucent meshes in second pass
@@ -35,10 +37,15 @@ void BSMesh::drawShapes( NodeList * secondPass )
 		return;
 	}
 
+	// Opaque meshes are drawn later, sorted by shader program and material
+	if ( secondPass && scene->queueShape(this) )
+		return;
+
 	auto nif = NifModel::fromIndex(iBlock);
 	if ( lodLevel != scene->lodLevel ) {
 		lodLevel = scene->lodLevel;
 		updateData(nif);
+		markBuffersChanged();
 	}
 
 	glPushMatrix();
@@ -51,27 +58,21 @@ void BSMesh::drawShapes( NodeList * secondPass )
 		glPolygonOffset(1.0f, 2.0f);
 
 
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(3, GL_FLOAT, 0, transVerts.constData());
+	setVertexArray(VertexBuffer, GL_VERTEX_ARRAY, 3, transVerts);
 
 	if ( !Node::SELECTING ) [[likely]] {
 		glEnable(GL_FRAMEBUFFER_SRGB);
 		shader = scene->renderer->setupProgram(this, shader);
 
-		if ( transNorms.count() ) {
-			glEnableClientState(GL_NORMAL_ARRAY);
-			glNormalPointer(GL_FLOAT, 0, transNorms.constData());
-		}
+		if ( transNorms.count() )
+			setVertexArray(NormalBuffer, GL_NORMAL_ARRAY, 3, transNorms);
 
-		if ( transColors.count() && scene->hasOption(Scene::DoVertexColors) ) {
-			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, 0, transColors.constData());
-		} else {
+		if ( transColors.count() && scene->hasOption(Scene::DoVertexColors) )
+			setVertexArray(ColorBuffer, GL_COLOR_ARRAY, 4, transColors);
+		else
 			glColor(Color3(1.0f, 1.0f, 1.0f));
-		}
 
-		if ( sortedTriangles.count() )
-			glDrawElements(GL_TRIANGLES, sortedTriangles.count() * 3, GL_UNSIGNED_SHORT, sortedTriangles.constData());
+		drawTriangles(sortedTriangles);
 
 		scene->renderer->stopProgram();
 
@@ -87,8 +88,8 @@ void BSMesh::drawShapes( NodeList * secondPass )
 			glColor4f( 0, 0, 0, 1 );
 		}
 
-		if ( sortedTriangles.count() && !( drawInSecondPass && scene->isSelModeVertex() ) )
-			glDrawElements(GL_TRIANGLES, sortedTriangles.count() * 3, GL_UNSIGNED_SHORT, sortedTriangles.constData());
+		if ( !( drawInSecondPass && scene->isSelModeVertex() ) )
+			drawTriangles(sortedTriangles);
 	}
 
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -565,8 +566,8 @@ void BSMesh::updateData(const NifModel* nif)
 		weightsUNORM = mesh->weights;
 		gpuLODs = mesh->lods;
 
-		boundSphere = BoundSphere(transVerts);
-		boundSphere.applyInv(viewTrans());
+		// boundSphere is in local space, it is calculated again from transVerts by bounds()
+		needUpdateBounds = true;
 	}
 
 	auto links = nif->getChildLinks(nif->getBlockNumber(iBlock));
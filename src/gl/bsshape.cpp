@@ -192,45 +192,13 @@ void BSShape::transformShapes()
 	Node::transformShapes();
 
 	transformRigid = true;
+	isGPUSkinned = false;
 
-	if ( isSkinned && weights.count() && scene->hasOption(Scene::DoSkinning) ) {
-		transformRigid = false;
-
-		transVerts.resize( numVerts );
-		transVerts.fill( Vector3() );
-		transNorms.resize( numVerts );
-		transNorms.fill( Vector3() );
-		transTangents.resize( numVerts );
-		transTangents.fill( Vector3() );
-		transBitangents.resize( numVerts );
-		transBitangents.fill( Vector3() );
-
-		Node * root = findParent( 0 );
-		for ( const BoneWeights & bw : weights ) {
-			Node * bone = root ? root->findChild( bw.bone ) : nullptr;
-			if ( bone ) {
-				Transform t = scene->view * bone->localTrans( 0 ) * bw.trans;
-				for ( const VertexWeight & w : bw.weights ) {
-					if ( w.vertex >= numVerts )
-						continue;
-
-					transVerts[w.vertex] += t * verts[w.vertex] * w.weight;
-					transNorms[w.vertex] += t.rotation * norms[w.vertex] * w.weight;
-					transTangents[w.vertex] += t.rotation * tangents[w.vertex] * w.weight;
-					transBitangents[w.vertex] += t.rotation * bitangents[w.vertex] * w.weight;
-				}
-			}
-		}
-
-		for ( int n = 0; n < numVerts; n++ ) {
-			transNorms[n].normalize();
-			transTangents[n].normalize();
-			transBitangents[n].normalize();
-		}
+	bool doSkinning = ( isSkinned && weights.count() && scene->hasOption(Scene::DoSkinning) );
 
-		boundSphere = BoundSphere( transVerts );
-		boundSphere.applyInv( viewTrans() );
-		needUpdateBounds = false;
+	if ( doSkinning ) {
+		transformRigid = false;
+		applySkinning();
 	} else {
 		transVerts = verts;
 		transNorms = norms;
@@ -238,17 +206,60 @@ void BSShape::transformShapes()
 		transBitangents = bitangents;
 	}
 
-	transColors = colors;
 	// TODO (Gavrant): suspicious code. Should the check be replaced with !bssp.hasVertexAlpha ?
-	if ( nif->getBSVersion() < 130 && bslsp && !bslsp->hasSF1(ShaderFlags::SLSF1_Vertex_Alpha) ) {
+	if ( !( nif->getBSVersion() < 130 && bslsp && !bslsp->hasSF1(ShaderFlags::SLSF1_Vertex_Alpha) ) ) {
+		transColors = colors;
+		transColorsAlpha = -1.0f;
+	} else if ( transColorsAlpha < 0.0f || transColors.count() != colors.count() ) {
+		// calculated only once, so that the buffer is not uploaded every frame
+		transColors.resize( colors.count() );
 		for ( int c = 0; c < colors.count(); c++ )
 			transColors[c] = Color4( colors[c].red(), colors[c].green(), colors[c].blue(), 1.0f );
+		transColorsAlpha = 2.0f;
+		markBuffersChanged( 1U << ColorBuffer );
+	}
+
+	updateViewBounds();
+}
+
+void BSShape::setSkinInfluences()
+{
+	for ( int b = 0; b < weights.count(); b++ ) {
+		for ( const VertexWeight & w : weights[b].weights ) {
+			if ( w.vertex < numVerts )
+				skinning.addInfluence( w.vertex, b, w.weight );
+		}
+	}
+}
+
+void BSShape::updateBoneTransforms()
+{
+	skinBoneTransforms.resize( weights.count() );
+
+	Node * root = findParent( 0 );
+	for ( int b = 0; b < weights.count(); b++ ) {
+		const BoneWeights & bw = weights.at( b );
+		Node * bone = root ? root->findChild( bw.bone ) : nullptr;
+		if ( bone ) {
+			skinBoneTransforms[b] = scene->view * bone->localTrans( 0 ) * bw.trans;
+		} else {
+			// bones that are not found do not contribute to the vertex positions
+			Transform t;
+			t.scale = 0.0f;
+			skinBoneTransforms[b] = t;
+		}
 	}
 }
 
+const QVector<Triangle> & BSShape::drawnTriangles( qsizetype & count ) const
+{
+	count = lodTriangleCount( triangles.size() );
+	return triangles;
+}
+
 void BSShape::drawShapes( NodeList * secondPass )
 {
-	if ( isHidden() )
+	if ( isHidden() || isCulled() )
 		return;
 
 	// TODO: Only run this if BSXFlags has "EditorMarkers present" flag
@@ -261,6 +272,14 @@ void BSShape::drawShapes( NodeList * secondPass )
 		return;
 	}
 
+	// Opaque meshes are drawn later, sorted by shader program and material
+	if ( secondPass && scene->queueShape( this ) )
+		return;
+
+	// Picking uses the vertices skinned on the CPU
+	if ( Node::SELECTING && isGPUSkinned )
+		transformShapes();
+
 	auto nif = NifModel::fromIndex( iBlock );
 
 	if ( Node::SELECTING ) {
@@ -283,12 +302,10 @@ void BSShape::drawShapes( NodeList * secondPass )
 	else
 		glPolygonOffset( 1.0f, 2.0f );
 
-	glEnableClientState( GL_VERTEX_ARRAY );
-	glVertexPointer( 3, GL_FLOAT, 0, transVerts.constData() );
+	setVertexArray( VertexBuffer, GL_VERTEX_ARRAY, 3, transVerts );
 
 	if ( !Node::SELECTING ) [[likely]] {
-		glEnableClientState( GL_NORMAL_ARRAY );
-		glNormalPointer( GL_FLOAT, 0, transNorms.constData() );
+		setVertexArray( NormalBuffer, GL_NORMAL_ARRAY, 3, transNorms );
 
 		bool doVCs = ( bssp && bssp->hasSF2(ShaderFlags::SLSF2_Vertex_Colors) );
 		// Always do vertex colors for FO4 if colors present
@@ -296,8 +313,7 @@ void BSShape::drawShapes( NodeList * secondPass )
 			doVCs = true;
 
 		if ( transColors.count() && scene->hasOption(Scene::DoVertexColors) && doVCs ) {
-			glEnableClientState( GL_COLOR_ARRAY );
-			glColorPointer( 4, GL_FLOAT, 0, transColors.constData() );
+			setVertexArray( ColorBuffer, GL_COLOR_ARRAY, 4, transColors );
 		} else if ( nif->getBSVersion() < 130 && !hasVertexColors && (bslsp && bslsp->hasVertexColors) ) {
 			// Correctly blacken the mesh if SLSF2_Vertex_Colors is still on
 			//	yet "Has Vertex Colors" is not.
@@ -332,36 +348,29 @@ void BSShape::drawShapes( NodeList * secondPass )
 
 	if ( isDoubleSided ) {
 		glCullFace( GL_FRONT );
-		glDrawElements( GL_TRIANGLES, triangles.count() * 3, GL_UNSIGNED_SHORT, triangles.constData() );
+		drawTriangles( triangles );
 		glCullFace( GL_BACK );
 	}
 
 	if ( !isLOD ) {
-		glDrawElements( GL_TRIANGLES, triangles.count() * 3, GL_UNSIGNED_SHORT, triangles.constData() );
+		drawTriangles( triangles );
 	} else if ( triangles.count() ) {
-		auto lod0 = nif->get<uint>( iBlock, "LOD0 Size" );
-		auto lod1 = nif->get<uint>( iBlock, "LOD1 Size" );
-		auto lod2 = nif->get<uint>( iBlock, "LOD2 Size" );
-
-		auto lod0tris = triangles.mid( 0, lod0 );
-		auto lod1tris = triangles.mid( lod0, lod1 );
-		auto lod2tris = triangles.mid( lod0 + lod1, lod2 );
+		qsizetype lod0 = nif->get<uint>( iBlock, "LOD0 Size" );
+		qsizetype lod1 = nif->get<uint>( iBlock, "LOD1 Size" );
+		qsizetype lod2 = nif->get<uint>( iBlock, "LOD2 Size" );
 
 		// If Level2, render all
 		// If Level1, also render Level0
 		switch ( scene->lodLevel ) {
 		case Scene::Level0:
-			if ( lod2tris.count() )
-				glDrawElements( GL_TRIANGLES, lod2tris.count() * 3, GL_UNSIGNED_SHORT, lod2tris.constData() );
+			drawTriangles( triangles, lod0 + lod1, lod2 );
 			[[fallthrough]];
 		case Scene::Level1:
-			if ( lod1tris.count() )
-				glDrawElements( GL_TRIANGLES, lod1tris.count() * 3, GL_UNSIGNED_SHORT, lod1tris.constData() );
+			drawTriangles( triangles, lod0, lod1 );
 			[[fallthrough]];
 		case Scene::Level2:
 		default:
-			if ( lod0tris.count() )
-				glDrawElements( GL_TRIANGLES, lod0tris.count() * 3, GL_UNSIGNED_SHORT, lod0tris.constData() );
+			drawTriangles( triangles, 0, lod0 );
 			break;
 		}
 	}
@@ -36,6 +36,11 @@ protected:
 
 	void updateImpl( const NifModel * nif, const QModelIndex & index ) override;
 	void updateData( const NifModel * nif ) override;
+
+	void setSkinInfluences() override;
+	void updateBoneTransforms() override;
+
+	const QVector<Triangle> & drawnTriangles( qsizetype & count ) const override;
 };
 
 #endif // BSSHAPE_H
@@ -0,0 +1,214 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+void TriangleBVH::clear()
+{
+	nodes.clear();
+	triangles.clear();
+	positions.clear();
+}
+
+void TriangleBVH::build( const Vector3 * verts, qsizetype vertexCnt, const Triangle * tris, qsizetype triangleCnt )
+{
+	clear();
+
+	positions.resize( size_t( std::max< qsizetype >( vertexCnt, 0 ) ) );
+	for ( size_t i = 0; i < positions.size(); i++ )
+		positions[i] = FloatVector4( verts[i] );
+
+	std::vector< BuildTriangle >	buf;
+	buf.reserve( size_t( std::max< qsizetype >( triangleCnt, 0 ) ) );
+	for ( qsizetype i = 0; i < triangleCnt; i++ ) {
+		const Triangle &	t = tris[i];
+		if ( t[0] >= vertexCnt || t[1] >= vertexCnt || t[2] >= vertexCnt )
+			continue;
+
+		BuildTriangle	b;
+		b.tri.index = std::uint32_t( i );
+		for ( int j = 0; j < 3; j++ )
+			b.tri.v[j] = t[j];
+		b.boundsMin = positions[t[0]];
+		b.boundsMax = positions[t[0]];
+		b.boundsMin.minValues( positions[t[1]] ).minValues( positions[t[2]] );
+		b.boundsMax.maxValues( positions[t[1]] ).maxValues( positions[t[2]] );
+		buf.push_back( b );
+	}
+	if ( buf.empty() ) {
+		positions.clear();
+		return;
+	}
+
+	// a median split creates at most twice as many nodes as leaves
+	nodes.reserve( ( buf.size() / maxLeafTriangles + 1 ) * 2 );
+	buildNode( buf, 0, std::uint32_t( buf.size() ) );
+
+	triangles.resize( buf.size() );
+	for ( size_t i = 0; i < buf.size(); i++ )
+		triangles[i] = buf[i].tri;
+}
+
+std::uint32_t TriangleBVH::buildNode( std::vector< BuildTriangle > & buf, std::uint32_t first, std::uint32_t count )
+{
+	std::uint32_t	n = std::uint32_t( nodes.size() );
+	nodes.emplace_back();
+
+	FloatVector4	boundsMin( buf[first].boundsMin );
+	FloatVector4	boundsMax( buf[first].boundsMax );
+	FloatVector4	centerMin( ( boundsMin + boundsMax ) * 0.5f );
+	FloatVector4	centerMax( centerMin );
+	for ( std::uint32_t i = first + 1; i < first + count; i++ ) {
+		const BuildTriangle &	b = buf[i];
+		boundsMin.minValues( b.boundsMin );
+		boundsMax.maxValues( b.boundsMax );
+		FloatVector4	c( ( b.boundsMin + b.boundsMax ) * 0.5f );
+		centerMin.minValues( c );
+		centerMax.maxValues( c );
+	}
+	nodes[n].boundsMin = boundsMin;
+	nodes[n].boundsMax = boundsMax;
+
+	FloatVector4	extent( centerMax - centerMin );
+	int	axis = 0;
+	if ( extent[1] > extent[axis] )
+		axis = 1;
+	if ( extent[2] > extent[axis] )
+		axis = 2;
+
+	if ( count <= maxLeafTriangles || !( extent[axis] > 0.0f ) ) {
+		nodes[n].first = first;
+		nodes[n].count = count;
+		return n;
+	}
+
+	std::uint32_t	mid = first + count / 2;
+	std::nth_element( buf.begin() + first, buf.begin() + mid, buf.begin() + ( first + count ),
+						[axis]( const BuildTriangle & a, const BuildTriangle & b ) {
+							return ( ( a.boundsMin[axis] + a.boundsMax[axis] ) < ( b.boundsMin[axis] + b.boundsMax[axis] ) );
+						} );
+
+	buildNode( buf, first, mid - first );
+	std::uint32_t	second = buildNode( buf, mid, first + count - mid );
+	nodes[n].first = second;
+	nodes[n].count = 0;
+	return n;
+}
+
+float TriangleBVH::intersectBounds( const Node & n, const FloatVector4 & origin, const FloatVector4 & invDir,
+									float maxDistance )
+{
+	FloatVector4	t0( ( n.boundsMin - origin ) * invDir );
+	FloatVector4	t1( ( n.boundsMax - origin ) * invDir );
+	FloatVector4	tNear( t0 );
+	FloatVector4	tFar( t0 );
+	tNear.minValues( t1 );
+	tFar.maxValues( t1 );
+
+	float	tEnter = std::max( std::max( tNear[0], tNear[1] ), std::max( tNear[2], 0.0f ) );
+	float	tExit = std::min( std::min( tFar[0], tFar[1] ), std::min( tFar[2], maxDistance ) );
+	return ( tEnter <= tExit ? tEnter : -1.0f );
+}
+
+bool TriangleBVH::intersect( const Vector3 & origin, const Vector3 & dir, Hit & hit ) const
+{
+	if ( nodes.empty() )
+		return false;
+
+	FloatVector4	o( origin );
+	FloatVector4	d( dir );
+	// avoid infinite values, these would result in NaN for rays in the plane of a bounding box side
+	FloatVector4	invDir( 0.0f );
+	for ( int i = 0; i < 3; i++ ) {
+		float	tmp = d[i];
+		if ( std::fabs( tmp ) < 1.0e-20f )
+			tmp = std::copysign( 1.0e-20f, tmp );
+		invDir[i] = 1.0f / tmp;
+	}
+
+	if ( intersectBounds( nodes[0], o, invDir, hit.distance ) < 0.0f )
+		return false;
+
+	struct StackEntry
+	{
+		std::uint32_t	node;
+		float	distance;
+	};
+	// the tree is balanced, its depth cannot be more than 33
+	StackEntry	stack[64];
+	int	sp = 0;
+	std::uint32_t	i = 0;
+	bool	found = false;
+	while ( true ) {
+		const Node &	n = nodes[i];
+		if ( n.count ) {
+			// Moller-Trumbore intersection with both sides of the triangles
+			for ( std::uint32_t k = n.first; k < n.first + n.count; k++ ) {
+				const TriangleRef &	t = triangles[k];
+				FloatVector4	p0( positions[t.v[0]] );
+				FloatVector4	e1( positions[t.v[1]] - p0 );
+				FloatVector4	e2( positions[t.v[2]] - p0 );
+				FloatVector4	pv( d.crossProduct3( e2 ) );
+				float	det = e1.dotProduct3( pv );
+				if ( !( std::fabs( det ) > 0.0f ) )
+					continue;
+				float	invDet = 1.0f / det;
+				FloatVector4	tv( o - p0 );
+				float	u = tv.dotProduct3( pv ) * invDet;
+				if ( !( u >= 0.0f && u <= 1.0f ) )
+					continue;
+				FloatVector4	qv( tv.crossProduct3( e1 ) );
+				float	v = d.dotProduct3( qv ) * invDet;
+				if ( !( v >= 0.0f && ( u + v ) <= 1.0f ) )
+					continue;
+				float	dist = e2.dotProduct3( qv ) * invDet;
+				if ( !( dist >= 0.0f && dist < hit.distance ) )
+					continue;
+
+				hit.distance = dist;
+				hit.triangle = qsizetype( t.index );
+				hit.u = u;
+				hit.v = v;
+				FloatVector4	p( o + d * dist );
+				float	minDistSqr = std::numeric_limits< float >::max();
+				for ( int j = 0; j < 3; j++ ) {
+					FloatVector4	tmp( positions[t.v[j]] - p );
+					float	distSqr = tmp.dotProduct3( tmp );
+					if ( distSqr < minDistSqr ) {
+						minDistSqr = distSqr;
+						hit.vertex = int( t.v[j] );
+					}
+				}
+				found = true;
+			}
+		} else {
+			std::uint32_t	a = i + 1;
+			std::uint32_t	b = n.first;
+			float	ta = intersectBounds( nodes[a], o, invDir, hit.distance );
+			float	tb = intersectBounds( nodes[b], o, invDir, hit.distance );
+			if ( ta >= 0.0f && tb >= 0.0f ) {
+				if ( tb < ta ) {
+					std::swap( a, b );
+					std::swap( ta, tb );
+				}
+				stack[sp++] = StackEntry{ b, tb };
+				i = a;
+				continue;
+			}
+			if ( ta >= 0.0f || tb >= 0.0f ) {
+				i = ( ta >= 0.0f ? a : b );
+				continue;
+			}
+		}
+
+		// continue with the closest node on the stack that can still contain a closer intersection
+		while ( sp > 0 && !( stack[sp - 1].distance < hit.distance ) )
+			sp--;
+		if ( sp < 1 )
+			break;
+		i = stack[--sp].node;
+	}
+
+	return found;
+}
@@ -0,0 +1,84 @@
+#ifndef BVH_H_INCLUDED
+#define BVH_H_INCLUDED
+
+#include "data/niftypes.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+//! Bounding volume hierarchy of the triangles of a mesh, for casting rays on the CPU
+/*!
+ * The triangles are split recursively at the median of their centroids along the longest axis of the centroid
+ * bounds, until at most maxLeafTriangles remain in a node. The nodes are stored in depth first order, so the first
+ * child of a node is always the next element. Rays are intersected with both sides of the triangles, visiting
+ * the closer child node first, and skipping nodes that are farther than the closest hit found so far.
+ *
+ * Only the vertex positions and triangle indices are used, this does not depend on OpenGL or on the scene.
+ */
+class TriangleBVH
+{
+public:
+	//! Closest intersection of a ray found by intersect()
+	struct Hit
+	{
+		//! Distance of the intersection from the ray origin, in units of the length of the ray direction
+		float	distance = std::numeric_limits< float >::max();
+		//! Index of the triangle in the array passed to build(), or -1 if nothing was hit
+		qsizetype	triangle = -1;
+		//! The vertex of the triangle that is closest to the intersection, or -1 if nothing was hit
+		int	vertex = -1;
+		//! Barycentric coordinates of the intersection relative to the second and third vertex of the triangle
+		float	u = 0.0f;
+		float	v = 0.0f;
+	};
+
+	void clear();
+	bool isEmpty() const { return nodes.empty(); }
+
+	//! Build the hierarchy for 'triangleCnt' triangles, triangles with invalid vertex indices are ignored
+	void build( const Vector3 * verts, qsizetype vertexCnt, const Triangle * tris, qsizetype triangleCnt );
+
+	/*! Intersect the ray origin + t * dir with the triangles, for 0 <= t < hit.distance. If a triangle is hit,
+	 * 'hit' is updated with the closest intersection, and true is returned. The same Hit can be passed to multiple
+	 * calls to find the closest intersection with several meshes, as long as t is the same for all of them.
+	 */
+	bool intersect( const Vector3 & origin, const Vector3 & dir, Hit & hit ) const;
+
+	//! Maximum number of triangles in a leaf node
+	static constexpr std::uint32_t maxLeafTriangles = 4;
+
+protected:
+	struct Node
+	{
+		FloatVector4	boundsMin;
+		FloatVector4	boundsMax;
+		//! Index of the second child node, or of the first triangle for leaf nodes
+		std::uint32_t	first;
+		//! Number of triangles, 0 for inner nodes
+		std::uint32_t	count;
+	};
+	struct TriangleRef
+	{
+		std::uint32_t	index;
+		std::uint32_t	v[3];
+	};
+	struct BuildTriangle
+	{
+		FloatVector4	boundsMin;
+		FloatVector4	boundsMax;
+		TriangleRef	tri;
+	};
+
+	std::vector< Node >	nodes;
+	//! Triangles in the order they are referenced by the leaf nodes
+	std::vector< TriangleRef >	triangles;
+	std::vector< FloatVector4 >	positions;
+
+	std::uint32_t buildNode( std::vector< BuildTriangle > & buf, std::uint32_t first, std::uint32_t count );
+	//! Returns the distance at which the ray enters the bounds of node 'n', or a negative value if it misses them
+	static float intersectBounds( const Node & n, const FloatVector4 & origin, const FloatVector4 & invDir,
+									float maxDistance );
+};
+
+#endif
@@ -439,6 +439,7 @@ void MorphController::updateTime( float time )
 	}
 
 	target->needUpdateBounds = true;
+	target->markBuffersChanged( 1U << Shape::VertexBuffer );
 }
 
 bool MorphController::update( const NifModel * nif, const QModelIndex & index )
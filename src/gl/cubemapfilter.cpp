@@ -0,0 +1,87 @@
+#include "cubemapfilter.h"
+
+#include "libfo76utils/src/sfcube2.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//! Pool of cube map filters shared by all threads
+class CubeMapFilterPool
+{
+public:
+	std::unique_ptr< SFCubeMapCache > acquire()
+	{
+		std::unique_lock< std::mutex >	lock( mutex );
+		cv.wait( lock, [this]() { return !freeFilters.empty() || filterCount < maxCubeMapFilters; } );
+		if ( freeFilters.empty() ) {
+			filterCount++;
+			return std::make_unique< SFCubeMapCache >();
+		}
+		std::unique_ptr< SFCubeMapCache >	p = std::move( freeFilters.back() );
+		freeFilters.pop_back();
+		return p;
+	}
+
+	void release( std::unique_ptr< SFCubeMapCache > && p )
+	{
+		{
+			std::lock_guard< std::mutex >	lock( mutex );
+			freeFilters.push_back( std::move( p ) );
+		}
+		cv.notify_one();
+	}
+
+protected:
+	std::mutex	mutex;
+	std::condition_variable	cv;
+	std::vector< std::unique_ptr< SFCubeMapCache > >	freeFilters;
+	int	filterCount = 0;
+};
+
+static CubeMapFilterPool	cubeMapFilterPool;
+
+bool filterPBRCubeMap( QByteArray & specular, QByteArray & diffuse, const QByteArray & data,
+						const CubeMapFilterSettings & s )
+{
+	std::unique_ptr< SFCubeMapCache >	sfCubeMapCache = cubeMapFilterPool.acquire();
+
+	specular = data;
+	if ( !s.filterDisabled ) {
+		std::uint32_t	width = std::uint32_t( s.resolution );
+		sfCubeMapCache->setOutputWidth( width );
+		sfCubeMapCache->setRoughnessTable( nullptr, 7 );
+		sfCubeMapCache->setNormalizeLevel( s.normalizeLevel );
+		sfCubeMapCache->setImportanceSamplingQuality( s.importanceSamples );
+		size_t	dataSize = size_t( specular.size() );
+		size_t	spaceRequired = width * width * 8 * 4 + 148;
+		if ( specular.size() < qsizetype(spaceRequired) )
+			specular.resize( spaceRequired );
+		size_t	newSize = sfCubeMapCache->convertImage( reinterpret_cast< unsigned char * >(specular.data()), dataSize,
+														true, spaceRequired, s.hdrToneMapLevel );
+		specular.resize( newSize );
+	}
+
+	// generate second cube map for diffuse lighting
+	std::uint32_t	width = 32;
+	diffuse = specular;
+	size_t	dataSize = size_t( diffuse.size() );
+	size_t	spaceRequired = width * width * 8 * 4 + 148;
+	if ( diffuse.size() < qsizetype(spaceRequired) )
+		diffuse.resize( spaceRequired );
+	static const float  roughnessDiffuse = 1.0f;
+	sfCubeMapCache->setOutputWidth( width );
+	sfCubeMapCache->setRoughnessTable( &roughnessDiffuse, 1 );
+	sfCubeMapCache->setImportanceSamplingQuality( -1 );
+	size_t	newSize = sfCubeMapCache->convertImage( reinterpret_cast< unsigned char * >(diffuse.data()), dataSize,
+													true, spaceRequired );
+	diffuse.resize( newSize );
+	// the results are kept in the cube map cache of TexCache instead
+	sfCubeMapCache->clear();
+
+	cubeMapFilterPool.release( std::move( sfCubeMapCache ) );
+
+	return ( specular.size() >= 128 && diffuse.size() >= 128 );
+}
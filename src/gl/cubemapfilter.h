@@ -0,0 +1,35 @@
+#ifndef CUBEMAPFILTER_H_INCLUDED
+#define CUBEMAPFILTER_H_INCLUDED
+
+#include <QByteArray>
+
+//! Parameters of prefiltering an environment map for PBR lighting
+struct CubeMapFilterSettings
+{
+	//! Width of the specular cube map, the diffuse one is always 32x32
+	int	resolution = 512;
+	int	importanceSamples = 256;
+	int	hdrToneMapLevel = 8;
+	float	normalizeLevel = 1.0f / 12.0f;
+	//! Only generate the diffuse cube map, the input is already a prefiltered specular cube map
+	bool	filterDisabled = false;
+};
+
+//! Prefilter an environment map into a specular and a diffuse cube map
+/*!
+ * 'data' is a DDS cube map or a Radiance HDR image, the results are DDS data. Returns false if the input could not be
+ * filtered.
+ *
+ * The filtering is done by SFCubeMapCache from libfo76utils, one complete cube map per call, it has no interface to
+ * filter single faces or mip levels. Cube maps are therefore filtered in parallel only with each other, on the threads
+ * that decode textures, and each cube map is filtered on one thread. The filters are kept in a pool of at most
+ * maxCubeMapFilters objects, so that their working memory is not allocated once per decoding thread, other threads
+ * wait for a free filter. The result does not depend on which filter or thread is used.
+ */
+bool filterPBRCubeMap( QByteArray & specular, QByteArray & diffuse, const QByteArray & data,
+						const CubeMapFilterSettings & s );
+
+//! Maximum number of cube maps filtered at the same time
+constexpr int	maxCubeMapFilters = 2;
+
+#endif
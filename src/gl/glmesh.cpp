@@ -63,6 +63,7 @@ void Mesh::updateImpl( const NifModel * nif, const QModelIndex & index )
 
 	} else if ( index == iData || index == iTangentData ) {
 		needUpdateData = true;
+		shader = ""; // the program conditions may depend on the geometry data
 
 	}
 }
@@ -614,128 +615,114 @@ void Mesh::transformShapes()
 	Node::transformShapes();
 
 	transformRigid = true;
+	isGPUSkinned = false;
 
-	if ( isSkinned && ( weights.count() || partitions.count() ) && scene->hasOption(Scene::DoSkinning) ) {
-		transformRigid = false;
-
-		int vcnt = verts.count();
-		int ncnt = norms.count();
-		int tcnt = tangents.count();
-		int bcnt = bitangents.count();
-
-		transVerts.resize( vcnt );
-		transVerts.fill( Vector3() );
-		transNorms.resize( ncnt );
-		transNorms.fill( Vector3() );
-		transTangents.resize( tcnt );
-		transTangents.fill( Vector3() );
-		transBitangents.resize( bcnt );
-		transBitangents.fill( Vector3() );
-
-		Node * root = findParent( skeletonRoot );
+	bool doSkinning = ( isSkinned && ( weights.count() || partitions.count() ) && scene->hasOption(Scene::DoSkinning) );
 
-		if ( partitions.count() ) {
-			for ( const SkinPartition& part : partitions ) {
-				QVector<Transform> boneTrans( part.boneMap.count() );
+	if ( doSkinning ) {
+		transformRigid = false;
+		applySkinning();
+	} else {
+		transVerts = verts;
+		transNorms = norms;
+		transTangents = tangents;
+		transBitangents = bitangents;
+	}
 
-				for ( int t = 0; t < boneTrans.count(); t++ ) {
-					Node * bone = root ? root->findChild( bones.value( part.boneMap[t] ) ) : 0;
-					boneTrans[ t ] = scene->view;
+	sortedTriangles = triangles;
 
-					if ( bone )
-						boneTrans[ t ] = boneTrans[ t ] * bone->localTrans( skeletonRoot ) * weights.value( part.boneMap[t] ).trans;
+	MaterialProperty * matprop = findProperty<MaterialProperty>();
+	float a = -1.0f;
+	if ( matprop && matprop->alphaValue() != 1.0 )
+		a = matprop->alphaValue();
+	// TODO (Gavrant): suspicious code. Should the check be replaced with !bssp.hasVertexAlpha ?
+	else if ( bslsp && !bslsp->hasSF1(ShaderFlags::SLSF1_Vertex_Alpha) )
+		a = 2.0f;
+
+	// the colors are only calculated again if the alpha has changed, so that the buffer is not uploaded every frame
+	if ( a < 0.0f ) {
+		transColors = colors;
+	} else if ( a != transColorsAlpha || transColors.count() != colors.count() ) {
+		transColors.resize( colors.count() );
+		for ( int c = 0; c < colors.count(); c++ ) {
+			if ( a > 1.0f )
+				transColors[c] = Color4( colors[c].red(), colors[c].green(), colors[c].blue(), 1.0f );
+			else
+				transColors[c] = colors[c].blend( a );
+		}
+		markBuffersChanged( 1U << ColorBuffer );
+	}
+	transColorsAlpha = a;
 
-					//if ( bone ) boneTrans[ t ] = bone->viewTrans() * weights.value( part.boneMap[t] ).trans;
-				}
+	updateViewBounds();
+}
 
-				for ( int v = 0; v < part.vertexMap.count(); v++ ) {
-					int vindex = part.vertexMap[ v ];
-					if ( vindex < 0 || vindex >= vcnt )
-						break;
+void Mesh::setSkinInfluences()
+{
+	int vcnt = verts.count();
 
-					if ( transVerts[vindex] == Vector3() ) {
-						for ( int w = 0; w < part.numWeightsPerVertex; w++ ) {
-							QPair<int, float> weight = part.weights[ v * part.numWeightsPerVertex + w ];
+	if ( partitions.count() ) {
+		// vertices shared by several partitions are skinned by the first one
+		QVector<bool> vertexDone( vcnt, false );
 
+		for ( const SkinPartition& part : partitions ) {
+			for ( int v = 0; v < part.vertexMap.count(); v++ ) {
+				int vindex = part.vertexMap[ v ];
+				if ( vindex < 0 || vindex >= vcnt )
+					break;
 
-							Transform trans = boneTrans.value( weight.first );
+				if ( vertexDone[vindex] )
+					continue;
+				vertexDone[vindex] = true;
 
-							if ( vcnt > vindex )
-								transVerts[vindex] += trans * verts[vindex] * weight.second;
-							if ( ncnt > vindex )
-								transNorms[vindex] += trans.rotation * norms[vindex] * weight.second;
-							if ( tcnt > vindex )
-								transTangents[vindex] += trans.rotation * tangents[vindex] * weight.second;
-							if ( bcnt > vindex )
-								transBitangents[vindex] += trans.rotation * bitangents[vindex] * weight.second;
-						}
-					}
+				for ( int w = 0; w < part.numWeightsPerVertex; w++ ) {
+					QPair<int, float> weight = part.weights.value( v * part.numWeightsPerVertex + w );
+					int b = part.boneMap.value( weight.first, -1 );
+					if ( b >= 0 && b < bones.count() )
+						skinning.addInfluence( vindex, b, weight.second );
 				}
 			}
-		} else {
-			int x = 0;
-			for ( const BoneWeights& bw : weights ) {
-				Transform trans = viewTrans() * skeletonTrans;
-				Node * bone = root ? root->findChild( bw.bone ) : nullptr;
-
-				if ( bone ) {
-					trans = trans * bone->localTrans( skeletonRoot ) * bw.trans;
-					weights[x].tcenter = bone->viewTrans() * bw.center;
-				}
-				x++;
-
-				for ( const VertexWeight& vw : bw.weights ) {
-					int vindex = vw.vertex;
-					if ( vindex < 0 || vindex >= vcnt )
-						break;
+		}
+	} else {
+		for ( int b = 0; b < weights.count(); b++ ) {
+			for ( const VertexWeight& vw : weights[b].weights ) {
+				int vindex = vw.vertex;
+				if ( vindex < 0 || vindex >= vcnt )
+					break;
 
-					if ( vcnt > vindex )
-						transVerts[vindex] += trans * verts[vindex] * vw.weight;
-					if ( ncnt > vindex )
-						transNorms[vindex] += trans.rotation * norms[vindex] * vw.weight;
-					if ( tcnt > vindex )
-						transTangents[vindex] += trans.rotation * tangents[vindex] * vw.weight;
-					if ( bcnt > vindex )
-						transBitangents[vindex] += trans.rotation * bitangents[vindex] * vw.weight;
-				}
+				skinning.addInfluence( vindex, b, vw.weight );
 			}
 		}
+	}
+}
 
-		for ( int n = 0; n < transNorms.count(); n++ )
-			transNorms[n].normalize();
+void Mesh::updateBoneTransforms()
+{
+	Node * root = findParent( skeletonRoot );
 
-		for ( int t = 0; t < transTangents.count(); t++ )
-			transTangents[t].normalize();
+	if ( partitions.count() ) {
+		skinBoneTransforms.resize( bones.count() );
 
-		for ( int t = 0; t < transBitangents.count(); t++ )
-			transBitangents[t].normalize();
+		for ( int b = 0; b < bones.count(); b++ ) {
+			Node * bone = root ? root->findChild( bones[b] ) : nullptr;
+			skinBoneTransforms[b] = scene->view;
 
-		boundSphere = BoundSphere( transVerts );
-		boundSphere.applyInv( viewTrans() );
-		needUpdateBounds = false;
+			if ( bone )
+				skinBoneTransforms[b] = skinBoneTransforms[b] * bone->localTrans( skeletonRoot ) * weights.value( b ).trans;
+		}
 	} else {
-		transVerts = verts;
-		transNorms = norms;
-		transTangents = tangents;
-		transBitangents = bitangents;
-		transColors = colors;
-	}
+		skinBoneTransforms.resize( weights.count() );
 
-	sortedTriangles = triangles;
-
-	MaterialProperty * matprop = findProperty<MaterialProperty>();
-	if ( matprop && matprop->alphaValue() != 1.0 ) {
-		float a = matprop->alphaValue();
-		transColors.resize( colors.count() );
+		for ( int x = 0; x < weights.count(); x++ ) {
+			const BoneWeights & bw = weights.at( x );
+			Transform trans = viewTrans() * skeletonTrans;
+			Node * bone = root ? root->findChild( bw.bone ) : nullptr;
 
-		for ( int c = 0; c < colors.count(); c++ )
-			transColors[c] = colors[c].blend( a );
-	} else {
-		transColors = colors;
-		// TODO (Gavrant): suspicious code. Should the check be replaced with !bssp.hasVertexAlpha ?
-		if ( bslsp && !bslsp->hasSF1(ShaderFlags::SLSF1_Vertex_Alpha) ) {
-			for ( int c = 0; c < colors.count(); c++ )
-				transColors[c] = Color4( colors[c].red(), colors[c].green(), colors[c].blue(), 1.0f );
+			if ( bone ) {
+				trans = trans * bone->localTrans( skeletonRoot ) * bw.trans;
+				weights[x].tcenter = bone->viewTrans() * bw.center;
+			}
+			skinBoneTransforms[x] = trans;
 		}
 	}
 }
@@ -752,7 +739,7 @@ BoundSphere Mesh::bounds() const
 
 void Mesh::drawShapes( NodeList * secondPass )
 {
-	if ( isHidden() )
+	if ( isHidden() || isCulled() )
 		return;
 
 	// TODO: Only run this if BSXFlags has "EditorMarkers present" flag
@@ -765,6 +752,14 @@ void Mesh::drawShapes( NodeList * secondPass )
 		return;
 	}
 
+	// Opaque meshes are drawn later, sorted by shader program and material
+	if ( secondPass && scene->queueShape( this ) )
+		return;
+
+	// Picking uses the vertices skinned on the CPU
+	if ( Node::SELECTING && isGPUSkinned )
+		transformShapes();
+
 	auto nif = NifModel::fromIndex( iBlock );
 
 	if ( Node::SELECTING ) {
@@ -801,21 +796,17 @@ void Mesh::drawShapes( NodeList * secondPass )
 	else
 		glPolygonOffset( 1.0f, 2.0f );
 
-	glEnableClientState( GL_VERTEX_ARRAY );
-	glVertexPointer( 3, GL_FLOAT, 0, transVerts.constData() );
+	setVertexArray( VertexBuffer, GL_VERTEX_ARRAY, 3, transVerts );
 
 	if ( !Node::SELECTING ) [[likely]] {
-		if ( transNorms.count() ) {
-			glEnableClientState( GL_NORMAL_ARRAY );
-			glNormalPointer( GL_FLOAT, 0, transNorms.constData() );
-		}
+		if ( transNorms.count() )
+			setVertexArray( NormalBuffer, GL_NORMAL_ARRAY, 3, transNorms );
 
 		// Do VCs if legacy or if either bslsp or bsesp is set
 		bool doVCs = ( !bssp || bssp->hasSF2(ShaderFlags::SLSF2_Vertex_Colors) || bssp->bsVersion < 83 );
 
 		if ( transColors.count() && scene->hasOption(Scene::DoVertexColors) && doVCs ) {
-			glEnableClientState( GL_COLOR_ARRAY );
-			glColorPointer( 4, GL_FLOAT, 0, transColors.constData() );
+			setVertexArray( ColorBuffer, GL_COLOR_ARRAY, 4, transColors );
 		} else {
 			if ( !hasVertexColors && (bslsp && bslsp->hasVertexColors) ) {
 				// Correctly blacken the mesh if SLSF2_Vertex_Colors is still on
@@ -850,40 +841,31 @@ void Mesh::drawShapes( NodeList * secondPass )
 
 	if ( !isLOD ) {
 		// render the triangles
-		if ( sortedTriangles.count() )
-			glDrawElements( GL_TRIANGLES, sortedTriangles.count() * 3, GL_UNSIGNED_SHORT, sortedTriangles.constData() );
+		drawTriangles( sortedTriangles );
 
 	} else if ( sortedTriangles.count() ) {
-		auto lod0 = nif->get<uint>( iBlock, "LOD0 Size" );
-		auto lod1 = nif->get<uint>( iBlock, "LOD1 Size" );
-		auto lod2 = nif->get<uint>( iBlock, "LOD2 Size" );
-
-		auto lod0tris = sortedTriangles.mid( 0, lod0 );
-		auto lod1tris = sortedTriangles.mid( lod0, lod1 );
-		auto lod2tris = sortedTriangles.mid( lod0 + lod1, lod2 );
+		qsizetype lod0 = nif->get<uint>( iBlock, "LOD0 Size" );
+		qsizetype lod1 = nif->get<uint>( iBlock, "LOD1 Size" );
+		qsizetype lod2 = nif->get<uint>( iBlock, "LOD2 Size" );
 
 		// If Level0, render all
 		// If Level1, also render Level2
 		switch ( scene->lodLevel ) {
 		case Scene::Level0:
-			if ( lod2tris.count() )
-				glDrawElements( GL_TRIANGLES, lod2tris.count() * 3, GL_UNSIGNED_SHORT, lod2tris.constData() );
+			drawTriangles( sortedTriangles, lod0 + lod1, lod2 );
 			[[fallthrough]];
 		case Scene::Level1:
-			if ( lod1tris.count() )
-				glDrawElements( GL_TRIANGLES, lod1tris.count() * 3, GL_UNSIGNED_SHORT, lod1tris.constData() );
+			drawTriangles( sortedTriangles, lod0, lod1 );
 			[[fallthrough]];
 		case Scene::Level2:
 		default:
-			if ( lod0tris.count() )
-				glDrawElements( GL_TRIANGLES, lod0tris.count() * 3, GL_UNSIGNED_SHORT, lod0tris.constData() );
+			drawTriangles( sortedTriangles, 0, lod0 );
 			break;
 		}
 	}
 
 	// render the tristrips
-	for ( const auto & s : tristrips )
-		glDrawElements( GL_TRIANGLE_STRIP, s.count(), GL_UNSIGNED_SHORT, s.constData() );
+	drawTriStrips( tristrips );
 
 	if ( isDoubleSided ) {
 		glEnable( GL_CULL_FACE );
@@ -68,6 +68,9 @@ protected:
 
 	void updateData_NiMesh( const NifModel * nif );
 	void updateData_NiTriShape( const NifModel * nif );
+
+	void setSkinInfluences() override;
+	void updateBoneTransforms() override;
 };
 
 #endif
@@ -492,9 +492,34 @@ void Node::transform()
 
 void Node::transformShapes()
 {
+	BoundSphere	bs;
+	bool	boundsKnown = true;
 	for ( Node * node : children.list() ) {
 		node->transformShapes();
+		// the bounds of the parent are not known either if those of any child are not
+		if ( std::isinf( node->viewBounds[3] ) ) [[unlikely]]
+			boundsKnown = false;
+		else
+			bs |= BoundSphere( Vector3( node->viewBounds ), node->viewBounds[3] );
 	}
+	setViewBounds( bs );
+	if ( !boundsKnown )
+		viewBounds[3] = std::numeric_limits< float >::infinity();
+}
+
+void Node::setViewBounds( const BoundSphere & bs )
+{
+	viewBounds = FloatVector4( bs.center );
+	viewBounds[3] = bs.radius;
+}
+
+bool Node::isCulled() const
+{
+	if ( scene->isInViewFrustum( viewBounds ) ) [[likely]]
+		return false;
+
+	scene->drawStats.culledNodes++;
+	return true;
 }
 
 void Node::draw()
@@ -1786,7 +1811,7 @@ void Node::drawFurn()
 
 void Node::drawShapes( NodeList * secondPass )
 {
-	if ( isHidden() )
+	if ( isHidden() || isCulled() )
 		return;
 
 	if ( presorted )
@@ -40,6 +40,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QPersistentModelIndex>
 #include <QPointer>
 
+#include <limits>
+
 
 //! @file glnode.h Node, NodeList
 
@@ -128,6 +130,8 @@ public:
 
 	bool isVisible() const { return !isHidden(); }
 	bool isPresorted() const { return presorted; }
+	//! Returns true if the shapes under the node are outside the view frustum, and do not need to be drawn
+	bool isCulled() const;
 
 	Node * findChild( int id ) const;
 	Node * findChild( const QString & str ) const;
@@ -155,6 +159,8 @@ protected:
 	void glHighlightColor() const;
 	void glNormalColor() const;
 
+	void setViewBounds( const class BoundSphere & bs );
+
 	QPointer<Node> parent;
 	NodeList children;
 
@@ -173,6 +179,11 @@ protected:
 
 	bool presorted = false;
 
+	//! Bounds of the shapes under the node in view space as ( center, radius ), updated by transformShapes().
+	// A negative radius means that there are no shapes under the node, and an infinite radius that the bounds
+	// are not known. The node is not culled in either case.
+	FloatVector4 viewBounds = FloatVector4( 0.0f, 0.0f, 0.0f, std::numeric_limits< float >::infinity() );
+
 	int nodeId;
 	int ref;
 };
@@ -117,6 +117,15 @@ void Particles::transformShapes()
 
 	for ( int v = 0; v < verts.count(); v++ )
 		transVerts[v] = vtrans * verts[v];
+
+	BoundSphere	bs( transVerts );
+	if ( bs.radius >= 0.0f )
+		bs.radius += size;
+	// include the bounds of the children calculated by Node::transformShapes()
+	if ( std::isinf( viewBounds[3] ) )
+		return;
+	bs |= BoundSphere( Vector3( viewBounds ), viewBounds[3] );
+	setViewBounds( bs );
 }
 
 BoundSphere Particles::bounds() const
@@ -128,7 +137,7 @@ BoundSphere Particles::bounds() const
 
 void Particles::drawShapes( NodeList * secondPass )
 {
-	if ( isHidden() || Node::SELECTING )
+	if ( isHidden() || Node::SELECTING || isCulled() )
 		return;
 
 	AlphaProperty * aprop = findProperty<AlphaProperty>();
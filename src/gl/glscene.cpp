@@ -47,6 +47,10 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QOpenGLFunctions>
 #include <QSettings>
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
 
 //! \file glscene.cpp %Scene management
 
@@ -98,6 +102,11 @@ Scene::Scene( TexCache * texcache, QObject * parent ) :
 
 Scene::~Scene()
 {
+	// shapes queue their buffer objects for deletion by the renderer
+	nodes.clear();
+	roots.clear();
+	shapes.clear();
+
 	if ( renderer )
 		delete renderer;
 }
@@ -337,6 +346,7 @@ void Scene::transform( const Transform & trans, float time )
 
 void Scene::draw()
 {
+	drawStats = DrawStats();
 	drawShapes();
 
 	if ( hasOption(ShowNodes) )
@@ -351,6 +361,12 @@ void Scene::draw()
 
 void Scene::drawShapes()
 {
+	renderer->deleteReleasedBuffers();
+	renderer->beginFrame();
+
+	std::uint64_t	programCalls = renderer->getProgramCallCount();
+	std::uint64_t	bindCalls = textures->getBindCallCount();
+
 	if ( hasOption(DoBlending) ) {
 		NodeList secondPass;
 
@@ -358,6 +374,8 @@ void Scene::drawShapes()
 			node->drawShapes( &secondPass );
 		}
 
+		drawRenderQueue();
+
 		renderer->drawSkyBox( this );
 
 		if ( secondPass.list().count() > 0 )
@@ -375,6 +393,159 @@ void Scene::drawShapes()
 
 		renderer->drawSkyBox( this );
 	}
+
+	drawStats.programSwitches = std::uint32_t( renderer->getProgramCallCount() - programCalls );
+	drawStats.textureBinds = std::uint32_t( textures->getBindCallCount() - bindCalls );
+}
+
+bool Scene::queueShape( Shape * shape )
+{
+	// the order of the children of ordered nodes is preserved
+	if ( shape->isPresorted() )
+		return false;
+
+	// program: 8 bits, shader or texturing property: 24 bits, distance from the camera: 32 bits
+	// the program ids are unique up to 255, all programs after that share the last id
+	std::uint64_t	k = std::uint64_t( std::min( renderer->getProgramSortId( shape ), 255 ) );
+	const void *	material = shape->bssp;
+	if ( !material )
+		material = shape->findProperty<TexturingProperty>();
+	k = ( k << 24 ) | ( ( quintptr( material ) >> 4 ) & 0xFFFFFFU );
+	// front to back, the bit pattern of a non-negative float has the same order as its value
+	float	d = std::max( -shape->viewDepth(), 0.0f );
+	k = ( k << 32 ) | std::bit_cast< std::uint32_t >( d );
+
+	renderQueue.append( RenderQueueItem{ k, shape } );
+	return true;
+}
+
+void Scene::drawRenderQueue()
+{
+	std::stable_sort( renderQueue.begin(), renderQueue.end(),
+						[]( const RenderQueueItem & a, const RenderQueueItem & b ) {
+							return ( a.sortKey < b.sortKey );
+						} );
+
+	for ( const RenderQueueItem & i : renderQueue )
+		i.shape->drawShapes();
+
+	drawStats.queuedShapes += std::uint32_t( renderQueue.size() );
+	renderQueue.clear();
+}
+
+void Scene::setViewFrustum( float w2, float h2, float nr, float fr, bool isPerspective )
+{
+	frustumPlanes[0] = FloatVector4( 0.0f, 0.0f, -1.0f, -nr );
+	frustumPlanes[1] = FloatVector4( 0.0f, 0.0f, 1.0f, fr );
+	if ( isPerspective ) {
+		// the side planes go through the camera position
+		frustumPlanes[2] = FloatVector4( nr, 0.0f, -w2, 0.0f );
+		frustumPlanes[3] = FloatVector4( -nr, 0.0f, -w2, 0.0f );
+		frustumPlanes[4] = FloatVector4( 0.0f, nr, -h2, 0.0f );
+		frustumPlanes[5] = FloatVector4( 0.0f, -nr, -h2, 0.0f );
+		for ( int i = 2; i < 6; i++ )
+			frustumPlanes[i] = frustumPlanes[i] / float( std::sqrt( frustumPlanes[i].dotProduct3( frustumPlanes[i] ) ) );
+	} else {
+		frustumPlanes[2] = FloatVector4( 1.0f, 0.0f, 0.0f, w2 );
+		frustumPlanes[3] = FloatVector4( -1.0f, 0.0f, 0.0f, w2 );
+		frustumPlanes[4] = FloatVector4( 0.0f, 1.0f, 0.0f, h2 );
+		frustumPlanes[5] = FloatVector4( 0.0f, -1.0f, 0.0f, h2 );
+	}
+	frustumSize = FloatVector4( w2, h2, nr, fr );
+	frustumValid = ( w2 > 0.0f && h2 > 0.0f && fr > nr );
+	frustumIsPerspective = isPerspective;
+}
+
+bool Scene::isInViewFrustum( const FloatVector4 & bounds ) const
+{
+	if ( !( frustumValid && bounds[3] >= 0.0f ) )
+		return true;
+
+	for ( const FloatVector4 & p : frustumPlanes ) {
+		if ( ( bounds.dotProduct3( p ) + p[3] ) < -bounds[3] )
+			return false;
+	}
+	return true;
+}
+
+bool Scene::pick( float x, float y, PickResult & result )
+{
+	result = PickResult();
+	if ( !frustumValid )
+		return false;
+
+	Vector3	origin;
+	Vector3	dir;
+	if ( frustumIsPerspective ) {
+		dir = Vector3( x * frustumSize[0] / frustumSize[2], y * frustumSize[1] / frustumSize[2], -1.0f );
+	} else {
+		origin = Vector3( x * frustumSize[0], y * frustumSize[1], -frustumSize[2] );
+		dir = Vector3( 0.0f, 0.0f, -1.0f );
+	}
+
+	// the Z coordinate of the ray direction is -1, so the distance of a hit is its depth from the ray origin
+	TriangleBVH::Hit	hit;
+	hit.distance = frustumSize[3] - ( frustumIsPerspective ? 0.0f : frustumSize[2] );
+
+	Node::SELECTING = 1;
+	for ( Shape * shape : shapes ) {
+		if ( shape->intersectRay( origin, dir, hit ) )
+			result.shape = shape;
+	}
+	Node::SELECTING = 0;
+
+	if ( !result.shape )
+		return false;
+
+	result.triangle = hit.triangle;
+	result.vertex = hit.vertex;
+	result.position = origin + dir * hit.distance;
+	return true;
+}
+
+bool Scene::pickVertex( float x, float y, float rx, float ry, float maxDepth, PickResult & result )
+{
+	result = PickResult();
+	if ( !( frustumValid && rx > 0.0f && ry > 0.0f ) )
+		return false;
+
+	float	distance = 1.0f;
+	Node::SELECTING = 1;
+	for ( Shape * shape : shapes ) {
+		if ( shape->findProjectedVertex( x, y, rx, ry, maxDepth, result.vertex, distance, result.position ) )
+			result.shape = shape;
+	}
+	Node::SELECTING = 0;
+
+	return bool( result.shape );
+}
+
+bool Scene::projectPoint( const Vector3 & p, float & x, float & y ) const
+{
+	float	z = -p[2];
+	if ( !( frustumValid && z >= frustumSize[2] && z <= frustumSize[3] ) )
+		return false;
+
+	x = p[0] / frustumSize[0];
+	y = p[1] / frustumSize[1];
+	if ( frustumIsPerspective ) {
+		x = x * frustumSize[2] / z;
+		y = y * frustumSize[2] / z;
+	}
+	return true;
+}
+
+float Scene::depthBufferValue( float z ) const
+{
+	float	nr = frustumSize[2];
+	float	fr = frustumSize[3];
+	float	d;
+	if ( frustumIsPerspective )
+		d = ( fr + nr + 2.0f * fr * nr / z ) / ( fr - nr );
+	else
+		d = ( -2.0f * z - ( fr + nr ) ) / ( fr - nr );
+
+	return std::clamp( d * 0.5f + 0.5f, 0.0f, 1.0f );
 }
 
 void Scene::drawNodes()
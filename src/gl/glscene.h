@@ -215,6 +215,51 @@ public:
 
 	QVector<Shape *> shapes;
 
+	//! Number of shapes drawn from the render queue, and state changes while drawing the shapes of the last frame,
+	// reset by draw() and shown in the status bar
+	struct DrawStats
+	{
+		std::uint32_t	queuedShapes = 0;
+		std::uint32_t	programSwitches = 0;
+		std::uint32_t	textureBinds = 0;
+		//! Nodes and shapes skipped because they were outside the view frustum
+		std::uint32_t	culledNodes = 0;
+	} drawStats;
+
+	//! Set the view frustum that shapes are culled against. The camera is at the origin of view space looking
+	// towards -Z, 'w2' and 'h2' are the half width and height of the view at the distance 'nr' of the near plane.
+	void setViewFrustum( float w2, float h2, float nr, float fr, bool isPerspective );
+	//! Returns false if a sphere in view space, given as ( center, radius ), is entirely outside the view frustum.
+	// Spheres with a negative or infinite radius are always considered to be visible.
+	bool isInViewFrustum( const FloatVector4 & bounds ) const;
+
+	//! Closest shape hit by the ray cast by pick()
+	struct PickResult
+	{
+		Shape *	shape = nullptr;
+		//! Index of the triangle hit in the drawn triangles of the shape, followed by those of its triangle strips
+		qsizetype	triangle = -1;
+		//! Index of the vertex of the triangle that is closest to the intersection
+		int	vertex = -1;
+		//! The intersection in view space
+		Vector3	position;
+	};
+	//! Cast a ray through the point ( x, y ) of the view frustum in normalized device coordinates (-1 to 1, Y up),
+	// and find the closest visible shape it hits. Returns false if no shape was hit.
+	bool pick( float x, float y, PickResult & result );
+	//! Find the vertex whose projection is closest to the point ( x, y ) in normalized device coordinates, and at most
+	// 'rx' and 'ry' away from it on the X and Y axes. Vertices farther than 'maxDepth' from the camera are ignored.
+	// Returns false if no vertex was found, 'result.triangle' is not set.
+	bool pickVertex( float x, float y, float rx, float ry, float maxDepth, PickResult & result );
+	//! Project a point in view space to normalized device coordinates, returns false if it is outside the near
+	// and far planes of the view frustum
+	bool projectPoint( const Vector3 & p, float & x, float & y ) const;
+	//! Returns the value in the depth buffer of a point at Z coordinate 'z' in view space
+	float depthBufferValue( float z ) const;
+
+	//! Add an opaque shape to the render queue of the current frame, returns false if it needs to be drawn now
+	bool queueShape( Shape * shape );
+
 	BoundSphere bounds() const;
 
 	float timeMin() const;
@@ -235,6 +280,23 @@ protected:
 	mutable float tMin = 0, tMax = 0;
 
 	void updateTimeBounds() const;
+
+	struct RenderQueueItem
+	{
+		//! Shader program, material and depth packed so that shapes with the same state are drawn together
+		std::uint64_t	sortKey;
+		Shape *	shape;
+	};
+	//! Opaque shapes collected while traversing the scene graph in drawShapes()
+	QVector<RenderQueueItem> renderQueue;
+	void drawRenderQueue();
+
+	//! View frustum planes ( normal, distance ) in view space, points inside have a non-negative distance from all
+	FloatVector4 frustumPlanes[6];
+	//! Half width and height of the view at the near plane, near and far plane distances
+	FloatVector4 frustumSize;
+	bool frustumValid = false;
+	bool frustumIsPerspective = false;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( Scene::SceneOptions )
@@ -34,17 +34,27 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gl/controllers.h"
 #include "gl/glscene.h"
+#include "gl/renderer.h"
 #include "model/nifmodel.h"
 #include "io/material.h"
+#include "lib/nvtristripwrapper.h"
 
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QOpenGLFunctions>
+
+#include <algorithm>
 
 Shape::Shape( Scene * s, const QModelIndex & b ) : Node( s, b )
 {
 	shapeNumber = s->shapes.count();
 }
 
+Shape::~Shape()
+{
+	releaseBuffers();
+}
+
 void Shape::clear()
 {
 	Node::clear();
@@ -60,6 +70,10 @@ void Shape::clear()
 	transBitangents.clear();
 	sortedTriangles.clear();
 
+	releaseBuffers();
+	// the arrays loaded next may be allocated at the same addresses
+	markBuffersChanged();
+
 	bssp = nullptr;
 	bslsp = nullptr;
 	bsesp = nullptr;
@@ -84,6 +98,8 @@ void Shape::transform()
 				for ( int i = 0; i < nColors; i++ )
 					colors[i].setRGBA( colors[i].red(), colors[i].green(), colors[i].blue(), 1 );
 			}
+			transColorsAlpha = -1.0f;
+			markBuffersChanged();
 		} else {
 			clear();
 			return;
@@ -93,6 +109,112 @@ void Shape::transform()
 	Node::transform();
 }
 
+bool Shape::bindBuffer( ShapeBuffer & b, GLenum target, const void * data, qsizetype bytes, bool upload ) const
+{
+	QOpenGLFunctions *	fn = ( scene->renderer ? scene->renderer->fn : nullptr );
+	if ( !fn ) [[unlikely]]
+		return false;
+
+	if ( !b.id ) {
+		fn->glGenBuffers( 1, &b.id );
+		if ( !b.id ) [[unlikely]]
+			return false;
+		upload = true;
+	}
+	fn->glBindBuffer( target, b.id );
+	if ( upload ) {
+		// data that has changed once, such as skinned or morphed vertices, is likely to change again
+		fn->glBufferData( target, GLsizeiptr( bytes ), ( bytes > 0 ? data : nullptr ),
+							( b.uploadCount > 0 ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW ) );
+		b.bytes = bytes;
+		b.uploadCount++;
+	}
+
+	return true;
+}
+
+void Shape::setClientArray( GLenum array, int components, const void * p, bool unbindBuffer ) const
+{
+	glEnableClientState( array );
+	switch ( array ) {
+	case GL_VERTEX_ARRAY:
+		glVertexPointer( components, GL_FLOAT, 0, p );
+		break;
+	case GL_NORMAL_ARRAY:
+		glNormalPointer( GL_FLOAT, 0, p );
+		break;
+	case GL_COLOR_ARRAY:
+		glColorPointer( components, GL_FLOAT, 0, p );
+		break;
+	default:
+		glTexCoordPointer( components, GL_FLOAT, 0, p );
+		break;
+	}
+
+	// other client arrays, like those of markers and particles, are not sourced from buffers
+	if ( unbindBuffer )
+		scene->renderer->fn->glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+void Shape::drawTriangles( const QVector<Triangle> & tris, qsizetype first, qsizetype count ) const
+{
+	qsizetype	n = tris.size();
+	first = std::min< qsizetype >( std::max< qsizetype >( first, 0 ), n );
+	if ( count < 0 || count > ( n - first ) )
+		count = n - first;
+	if ( count < 1 )
+		return;
+
+	if ( updateBuffer( IndexBuffer, GL_ELEMENT_ARRAY_BUFFER, tris ) ) [[likely]] {
+		glDrawElements( GL_TRIANGLES, GLsizei( count * 3 ), GL_UNSIGNED_SHORT,
+						reinterpret_cast< const void * >( first * qsizetype( sizeof( Triangle ) ) ) );
+		scene->renderer->fn->glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	} else {
+		glDrawElements( GL_TRIANGLES, GLsizei( count * 3 ), GL_UNSIGNED_SHORT, tris.constData() + first );
+	}
+}
+
+void Shape::drawTriStrips( const QVector<TriStrip> & strips ) const
+{
+	if ( strips.isEmpty() )
+		return;
+
+	// the strips are concatenated into a single index buffer
+	ShapeBuffer &	b = buffers[StripIndexBuffer];
+	bool	changed = ( !b.id || b.data != strips.constData() || ( changedBuffers & ( 1U << StripIndexBuffer ) ) );
+	QVector<quint16>	indices;
+	if ( changed ) {
+		for ( const auto & s : strips )
+			indices.append( s );
+	}
+
+	if ( bindBuffer( b, GL_ELEMENT_ARRAY_BUFFER, indices.constData(), indices.size() * 2, changed ) ) [[likely]] {
+		b.data = strips.constData();
+		changedBuffers &= ~( 1U << StripIndexBuffer );
+		qsizetype	offset = 0;
+		for ( const auto & s : strips ) {
+			if ( s.size() > 0 ) {
+				glDrawElements( GL_TRIANGLE_STRIP, GLsizei( s.size() ), GL_UNSIGNED_SHORT,
+								reinterpret_cast< const void * >( offset * 2 ) );
+			}
+			offset += s.size();
+		}
+		scene->renderer->fn->glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	} else {
+		for ( const auto & s : strips )
+			glDrawElements( GL_TRIANGLE_STRIP, GLsizei( s.size() ), GL_UNSIGNED_SHORT, s.constData() );
+	}
+}
+
+void Shape::releaseBuffers()
+{
+	for ( ShapeBuffer & b : buffers ) {
+		if ( b.id && scene->renderer )
+			scene->renderer->releaseBuffers( &b.id, 1 );
+		b = ShapeBuffer();
+	}
+}
+
 void Shape::setController( const NifModel * nif, const QModelIndex & iController )
 {
 	QString contrName = nif->itemName(iController);
@@ -134,6 +256,7 @@ void Shape::updateImpl( const NifModel * nif, const QModelIndex & index )
 		needUpdateData = true;
 
 	} else if ( (bssp && bssp->isParamBlock(index)) || (alphaProperty && index == alphaProperty->index()) ) {
+		shader = ""; // the program conditions may depend on the shader property
 		updateShader();
 
 	}
@@ -188,6 +311,228 @@ void Shape::resetSkeletonData()
 	bones.clear();
 	weights.clear();
 	partitions.clear();
+
+	skinning.clear();
+	hasSkinInfluences = false;
+	skinBoneIndices.clear();
+	skinBoneWeights.clear();
+	skinBoneTransforms.clear();
+	gpuSkinningStatus = 0;
+	isGPUSkinned = false;
+}
+
+bool Shape::useGPUSkinning() const
+{
+	if ( gpuSkinningStatus < 0 || Node::SELECTING || scene->isSelModeVertex() || !scene->renderer )
+		return false;
+
+	// the selection is drawn from the vertices skinned on the CPU
+	const QPersistentModelIndex &	blk = scene->currentBlock;
+	if ( blk.isValid() && ( blk == iBlock || blk == iData || blk == iSkin || blk == iSkinData || blk == iSkinPart ) )
+		return false;
+
+	return scene->renderer->canSkinOnGPU( this );
+}
+
+bool Shape::setGPUSkinWeights()
+{
+	if ( skinning.maxInfluences() > 4 || skinBoneTransforms.size() > Renderer::maxGPUSkinningBones )
+		return false;
+
+	qsizetype	n = skinning.vertexCount();
+	skinBoneIndices.fill( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), n );
+	skinBoneWeights.fill( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), n );
+	for ( qsizetype v = 0; v < n; v++ ) {
+		const std::uint16_t *	b = skinning.influenceBones( v );
+		const float *	w = skinning.influenceWeights( v );
+		for ( int i = 0; i < skinning.influenceCount( v ); i++ ) {
+			skinBoneIndices[v][i] = float( b[i] );
+			skinBoneWeights[v][i] = w[i];
+		}
+	}
+	markBuffersChanged( ( 1U << BoneIndexBuffer ) | ( 1U << BoneWeightBuffer ) );
+
+	return true;
+}
+
+void Shape::setGPUSkinnedData()
+{
+	transVerts = verts;
+	transNorms = norms;
+	transTangents = tangents;
+	transBitangents = bitangents;
+
+	// every skinned vertex is within the union of the bind pose bounds transformed by each bone
+	boundSphere = BoundSphere();
+	for ( const Transform & t : skinBoneTransforms ) {
+		if ( t.scale != 0.0f )
+			boundSphere |= t * skinBindBounds;
+	}
+	boundSphere.applyInv( viewTrans() );
+	needUpdateBounds = false;
+
+	isGPUSkinned = true;
+}
+
+void Shape::applySkinning()
+{
+	if ( !hasSkinInfluences ) {
+		skinning.clear( verts.count() );
+		setSkinInfluences();
+		skinning.finalize();
+		skinBindBounds = BoundSphere( verts );
+		hasSkinInfluences = true;
+	}
+
+	updateBoneTransforms();
+
+	if ( useGPUSkinning() ) {
+		if ( gpuSkinningStatus == 0 )
+			gpuSkinningStatus = ( setGPUSkinWeights() ? 1 : -1 );
+		if ( gpuSkinningStatus > 0 ) {
+			setGPUSkinnedData();
+			return;
+		}
+	}
+
+	skinning.setBoneTransforms( skinBoneTransforms.constData(), skinBoneTransforms.size() );
+	skinning.skin( transVerts, transNorms, transTangents, transBitangents, verts, norms, tangents, bitangents );
+	markBuffersChanged( ( 1U << VertexBuffer ) | ( 1U << NormalBuffer ) | ( 1U << TangentBuffer ) | ( 1U << BitangentBuffer ) );
+
+	boundSphere = BoundSphere( transVerts );
+	boundSphere.applyInv( viewTrans() );
+	needUpdateBounds = false;
+}
+
+const QVector<Triangle> & Shape::drawnTriangles( qsizetype & count ) const
+{
+	count = lodTriangleCount( sortedTriangles.size() );
+	return sortedTriangles;
+}
+
+qsizetype Shape::lodTriangleCount( qsizetype count ) const
+{
+	auto nif = NifModel::fromValidIndex( iBlock );
+	if ( !( isLOD && nif ) )
+		return count;
+
+	qsizetype lod0 = nif->get<uint>( iBlock, "LOD0 Size" );
+	qsizetype lod1 = nif->get<uint>( iBlock, "LOD1 Size" );
+	qsizetype lod2 = nif->get<uint>( iBlock, "LOD2 Size" );
+
+	// Level0 draws all three ranges, Level2 only the first one
+	switch ( scene->lodLevel ) {
+	case Scene::Level0:
+		return std::min( lod0 + lod1 + lod2, count );
+	case Scene::Level1:
+		return std::min( lod0 + lod1, count );
+	case Scene::Level2:
+	default:
+		return std::min( lod0, count );
+	}
+}
+
+bool Shape::isPickable() const
+{
+	return !( isHidden() || ( !scene->hasOption(Scene::ShowMarkers) && name.contains( "EditorMarker" ) ) );
+}
+
+bool Shape::intersectRay( const Vector3 & origin, const Vector3 & dir, TriangleBVH::Hit & hit )
+{
+	if ( !isPickable() )
+		return false;
+
+	// skip the shape if the ray does not pass through its bounding sphere
+	if ( viewBounds[3] >= 0.0f ) {
+		FloatVector4	d( dir );
+		FloatVector4	w( viewBounds - FloatVector4( origin ) );
+		float	t = std::max( w.dotProduct3( d ) / d.dotProduct3( d ), 0.0f );
+		w = w - d * t;
+		if ( w.dotProduct3( w ) > ( viewBounds[3] * viewBounds[3] ) )
+			return false;
+	}
+
+	// Picking uses the vertices skinned on the CPU
+	if ( isGPUSkinned && Node::SELECTING )
+		transformShapes();
+
+	qsizetype	triangleCount = 0;
+	const QVector<Triangle> &	tris = drawnTriangles( triangleCount );
+	if ( geometryGeneration != pickGeneration
+		|| transVerts.constData() != pickVertsData || transVerts.size() != pickVertCount
+		|| tris.constData() != pickTrianglesData || triangleCount != pickTriangleCount
+		|| tristrips.constData() != pickStripsData ) {
+		pickVertsData = transVerts.constData();
+		pickVertCount = transVerts.size();
+		pickTrianglesData = tris.constData();
+		pickTriangleCount = triangleCount;
+		pickStripsData = tristrips.constData();
+		pickGeneration = geometryGeneration;
+
+		QVector<Triangle>	t( tris.constBegin(), tris.constBegin() + triangleCount );
+		if ( !tristrips.isEmpty() )
+			t += triangulate( tristrips );
+		pickBVH.build( transVerts.constData(), transVerts.size(), t.constData(), t.size() );
+	}
+
+	if ( pickBVH.isEmpty() )
+		return false;
+	if ( !transformRigid )
+		return pickBVH.intersect( origin, dir, hit );
+
+	// rigid shapes are drawn with viewTrans(), transform the ray to the space of the vertices instead
+	const Transform &	t = viewTrans();
+	if ( t.scale == 0.0f )
+		return false;
+	Matrix	r = t.rotation.inverted();
+	return pickBVH.intersect( r * ( origin - t.translation ) / t.scale, r * dir / t.scale, hit );
+}
+
+bool Shape::findProjectedVertex( float x, float y, float rx, float ry, float maxDepth,
+									int & vertex, float & distance, Vector3 & position )
+{
+	if ( !isPickable() )
+		return false;
+
+	// Picking uses the vertices skinned on the CPU
+	if ( isGPUSkinned && Node::SELECTING )
+		transformShapes();
+
+	bool	found = false;
+	float	depth = maxDepth;
+	for ( qsizetype i = 0; i < transVerts.size(); i++ ) {
+		Vector3	p( vertexInView( int( i ) ) );
+		float	px, py;
+		if ( -p[2] > maxDepth || !scene->projectPoint( p, px, py ) )
+			continue;
+		px = ( px - x ) / rx;
+		py = ( py - y ) / ry;
+		float	d = px * px + py * py;
+		// of vertices at the same position on the screen, the one closest to the camera is picked
+		if ( d < distance || ( found && d == distance && -p[2] < depth ) ) {
+			vertex = int( i );
+			distance = d;
+			position = p;
+			depth = -p[2];
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+Vector3 Shape::vertexInView( int i ) const
+{
+	if ( !transformRigid )
+		return transVerts.at( i );
+	return viewTrans() * transVerts.at( i );
+}
+
+void Shape::updateViewBounds()
+{
+	// bounds() recalculates boundSphere if the vertex data has changed
+	(void) bounds();
+	setViewBounds( viewTrans() * boundSphere );
 }
 
 void Shape::updateShader()
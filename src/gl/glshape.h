@@ -34,12 +34,16 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define GLSHAPE_H
 
 #include "gl/glnode.h" // Inherited
+#include "gl/bvh.h"
 #include "gl/gltools.h"
+#include "gl/skinning.h"
 
 #include <QPersistentModelIndex>
 #include <QVector>
 #include <QString>
 
+#include <cstdint>
+
 //! @file glshape.h Shape
 
 class NifModel;
@@ -52,6 +56,7 @@ class Shape : public Node
 
 public:
 	Shape( Scene * s, const QModelIndex & b );
+	~Shape() override;
 
 	// IControllable
 
@@ -63,6 +68,19 @@ public:
 	virtual void drawVerts() const {};
 	virtual QModelIndex vertexAt( int ) const { return QModelIndex(); };
 
+	//! Intersect a ray in view space with the triangles of the shape as they are drawn, see TriangleBVH::intersect().
+	// Hidden shapes, and editor markers if they are not shown, are never hit.
+	bool intersectRay( const Vector3 & origin, const Vector3 & dir, TriangleBVH::Hit & hit );
+	/*! Find the vertex whose projection is closest to the point ( x, y ) of the view in normalized device
+	 * coordinates, see Scene::pickVertex(). 'distance' is the squared distance of the projection from the point,
+	 * in units of 'rx' and 'ry' on the X and Y axes. If a vertex closer than 'distance' and not farther than
+	 * 'maxDepth' from the camera is found, 'vertex', 'distance' and 'position' are updated and true is returned.
+	 */
+	bool findProjectedVertex( float x, float y, float rx, float ry, float maxDepth,
+								int & vertex, float & distance, Vector3 & position );
+	//! Returns the position of vertex 'i' in view space as it is drawn
+	Vector3 vertexInView( int i ) const;
+
 protected:
 	int shapeNumber;
 
@@ -119,11 +137,87 @@ protected:
 	QVector<Vector3> transNorms;
 	//! Transformed colors (alpha blended)
 	QVector<Color4> transColors;
+	//! Material alpha transColors was calculated with, 2.0 if vertex alpha was replaced with 1.0,
+	// and negative if transColors is the same as colors, or needs to be calculated again
+	float transColorsAlpha = -1.0f;
 	//! Transformed tangents
 	QVector<Vector3> transTangents;
 	//! Transformed bitangents
 	QVector<Vector3> transBitangents;
 
+	//! Buffer objects that the vertex and index data is drawn from
+	enum ShapeBufferType
+	{
+		VertexBuffer = 0,
+		NormalBuffer,
+		ColorBuffer,
+		TangentBuffer,
+		BitangentBuffer,
+		BoneIndexBuffer,
+		BoneWeightBuffer,
+		//! First of the texture coordinate sets, sets after the last one are drawn from client arrays
+		TexCoordBuffer,
+		IndexBuffer = TexCoordBuffer + 8,
+		StripIndexBuffer,
+		NumShapeBuffers
+	};
+
+	struct ShapeBuffer
+	{
+		GLuint	id = 0;
+		//! Address of the array last uploaded, a different array is always uploaded
+		const void *	data = nullptr;
+		qsizetype	bytes = 0;
+		int	uploadCount = 0;
+	};
+	mutable ShapeBuffer buffers[NumShapeBuffers];
+	//! Bit mask of the buffers (1 << ShapeBufferType) that need to be uploaded again, because the array
+	// they were uploaded from has been modified in place
+	mutable std::uint32_t changedBuffers = 0xFFFFFFFFU;
+
+	//! Incremented when the vertices, triangles or strips are marked as changed, see intersectRay()
+	std::uint32_t geometryGeneration = 0;
+
+	//! Must be called after modifying the contents of an array that is drawn from buffer objects,
+	// 'mask' is a combination of (1 << ShapeBufferType) bits
+	void markBuffersChanged( std::uint32_t mask = 0xFFFFFFFFU )
+	{
+		changedBuffers |= mask;
+		if ( mask & ( ( 1U << VertexBuffer ) | ( 1U << IndexBuffer ) | ( 1U << StripIndexBuffer ) ) )
+			geometryGeneration++;
+	}
+
+	//! Create and bind buffer 'b' to 'target', and upload 'bytes' bytes from 'data' if 'upload' is true.
+	// Returns false if buffer objects are not available, in which case client arrays must be used.
+	bool bindBuffer( ShapeBuffer & b, GLenum target, const void * data, qsizetype bytes, bool upload ) const;
+	//! Bind the buffer of 'type' to 'target', and upload 'data' if it is not the array last uploaded,
+	// or it has been marked as changed
+	template <typename T> bool updateBuffer( int type, GLenum target, const QVector<T> & data ) const
+	{
+		ShapeBuffer &	b = buffers[type];
+		qsizetype	bytes = data.size() * qsizetype( sizeof( T ) );
+		bool	changed = ( !b.id || b.data != data.constData() || b.bytes != bytes || ( changedBuffers & ( 1U << type ) ) );
+		if ( !bindBuffer( b, target, data.constData(), bytes, changed ) )
+			return false;
+		b.data = data.constData();
+		changedBuffers &= ~( 1U << type );
+		return true;
+	}
+	//! Enable client array 'array' (GL_VERTEX_ARRAY, GL_NORMAL_ARRAY, GL_COLOR_ARRAY or GL_TEXTURE_COORD_ARRAY)
+	// with 'components' floats per vertex, sourced from the buffer of 'type' that is updated from 'data' if needed
+	template <typename T> void setVertexArray( int type, GLenum array, int components, const QVector<T> & data ) const
+	{
+		const void *	p = data.constData();
+		bool	useBuffer = ( type < IndexBuffer && updateBuffer( type, GL_ARRAY_BUFFER, data ) );
+		setClientArray( array, components, ( useBuffer ? nullptr : p ), useBuffer );
+	}
+	void setClientArray( GLenum array, int components, const void * p, bool unbindBuffer ) const;
+	//! Draw 'count' triangles starting at 'first', or all triangles after 'first' if 'count' is negative
+	void drawTriangles( const QVector<Triangle> & tris, qsizetype first = 0, qsizetype count = -1 ) const;
+	void drawTriStrips( const QVector<TriStrip> & strips ) const;
+	//! Queue the buffer objects for deletion by the renderer
+	void releaseBuffers();
+
 	//! Toggle for skinning
 	bool isSkinned = false;
 
@@ -135,6 +229,39 @@ protected:
 
 	void resetSkeletonData();
 
+	//! Bone influences on the vertices, the bone indices refer to skinBoneTransforms
+	SkinningKernel skinning;
+	//! The influences have been added to 'skinning'
+	bool hasSkinInfluences = false;
+	//! Bone indices and weights of up to 4 influences per vertex, for skinning in the vertex shader
+	QVector<Vector4> skinBoneIndices;
+	QVector<Vector4> skinBoneWeights;
+	//! Bone transforms of the current frame
+	QVector<Transform> skinBoneTransforms;
+	//! Bounds of the untransformed vertices
+	BoundSphere skinBindBounds;
+	//! 1 if the skin can be rendered by the vertex shader, -1 if it cannot, 0 if not known yet
+	signed char gpuSkinningStatus = 0;
+	//! The transformed vertex data is in the bind pose, and the vertex shader does the skinning
+	bool isGPUSkinned = false;
+
+	//! Returns true if the skinning of the current frame can be done in the vertex shader
+	bool useGPUSkinning() const;
+	//! Set skinBoneIndices and skinBoneWeights from the influences,
+	// returns false if there are too many bones or influences per vertex for the vertex shader
+	bool setGPUSkinWeights();
+	//! Set the transformed vertex data to the bind pose, and the bounds from skinBoneTransforms
+	void setGPUSkinnedData();
+	//! Skin the vertex data with the bone transforms of the current frame, in the vertex shader if possible,
+	// otherwise on the CPU
+	void applySkinning();
+	//! Add the bone influences to 'skinning', this is called once after the skeleton data is reset
+	virtual void setSkinInfluences() {}
+	//! Calculate skinBoneTransforms for the current frame
+	virtual void updateBoneTransforms() {}
+	//! Set the view space bounds used for culling from boundSphere, this is called at the end of transformShapes()
+	void updateViewBounds();
+
 	//! Holds the name of the shader, or "" if no shader
 	QString shader = "";
 
@@ -165,6 +292,26 @@ protected:
 	mutable bool needUpdateBounds = false;
 
 	bool isLOD = false;
+
+	//! Returns the triangle array of the shape, of which the first 'count' elements are drawn with the current LOD
+	// level. The triangles of tristrips are always drawn in addition to these.
+	virtual const QVector<Triangle> & drawnTriangles( qsizetype & count ) const;
+	//! Number of triangles out of 'count' that are drawn with the current LOD level of a BSLODTriShape
+	qsizetype lodTriangleCount( qsizetype count ) const;
+
+	//! Hierarchy of the drawn triangles for picking, rebuilt by intersectRay() after the geometry has changed
+	TriangleBVH pickBVH;
+	//! Addresses and sizes of the arrays that pickBVH was built from, like ShapeBuffer::data. Arrays modified in place
+	// are detected by comparing geometryGeneration with pickGeneration.
+	const void * pickVertsData = nullptr;
+	const void * pickTrianglesData = nullptr;
+	const void * pickStripsData = nullptr;
+	qsizetype pickVertCount = -1;
+	qsizetype pickTriangleCount = -1;
+	std::uint32_t pickGeneration = 0;
+
+	//! Returns false for hidden shapes, and for editor markers if they are not shown
+	bool isPickable() const;
 };
 
 #endif
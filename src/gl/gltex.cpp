@@ -39,12 +39,21 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QListView>
 #include <QOpenGLContext>
 #include <QOpenGLFunctions>
 #include <QSettings>
 
 #include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 
 //! @file gltex.cpp TexCache management
@@ -59,6 +68,11 @@ int TexCache::num_txtunits_client = 0;
 int TexCache::pbrCubeMapResolution = 512;
 int TexCache::pbrImportanceSamples = 256;
 int TexCache::hdrToneMapLevel = 8;
+int TexCache::uploadTimeBudget = 8;
+std::uint64_t TexCache::memoryBudget = std::uint64_t( 2048 ) << 20;
+bool TexCache::dropMipLevels = false;
+bool TexCache::progressiveLoading = true;
+bool TexCache::shareIdenticalTextures = true;
 
 //! Maximum anisotropy
 float max_anisotropy = 1.0f;
@@ -199,16 +213,171 @@ QString TexCache::TexFmt::toString() const
 	return QString();
 }
 
+//! Worker threads that read and decode texture files for TexCache
+struct TexCache::AsyncLoader
+{
+	struct Job
+	{
+		QString	name;
+		std::uint64_t	generation;
+		TexLoadData	data;
+	};
+
+	TexCache *	cache;
+	std::mutex	mutex;
+	std::condition_variable	cv;
+	// jobs waiting to be decoded
+	std::deque< Job * >	jobQueue;
+	// decoded jobs waiting to be uploaded on the GL thread
+	std::deque< Job * >	doneQueue;
+	// jobs of textures uploaded as a low resolution preview, waiting for the full resolution upload
+	// (only used on the GL thread)
+	std::vector< Job * >	previewJobs;
+	// number of jobs queued or being decoded
+	size_t	jobsPending = 0;
+	// incremented when the pending jobs are cancelled
+	std::uint64_t	generation = 0;
+	bool	quitFlag = false;
+	std::vector< std::thread >	threads;
+
+	AsyncLoader( TexCache * p );
+	~AsyncLoader();
+	void addJob( Job * job );
+	Job * takeDoneJob();
+	bool haveDoneJobs();
+	void waitForJobs();
+	void cancelJobs();
+	void run();
+};
+
+TexCache::AsyncLoader::AsyncLoader( TexCache * p )
+	: cache( p )
+{
+	// decoding PBR cube maps can take a long time, use more than one thread so that it does not delay other textures
+	size_t	threadCnt = std::min< size_t >( std::max< size_t >( std::thread::hardware_concurrency() >> 1, 2 ), 4 );
+	for ( size_t i = 0; i < threadCnt; i++ )
+		threads.emplace_back( &AsyncLoader::run, this );
+}
+
+TexCache::AsyncLoader::~AsyncLoader()
+{
+	{
+		std::lock_guard< std::mutex >	lock( mutex );
+		quitFlag = true;
+	}
+	cv.notify_all();
+	for ( std::thread & t : threads )
+		t.join();
+	cancelJobs();
+}
+
+void TexCache::AsyncLoader::addJob( Job * job )
+{
+	{
+		std::lock_guard< std::mutex >	lock( mutex );
+		job->generation = generation;
+		jobQueue.push_back( job );
+		jobsPending++;
+	}
+	cv.notify_all();
+}
+
+TexCache::AsyncLoader::Job * TexCache::AsyncLoader::takeDoneJob()
+{
+	std::lock_guard< std::mutex >	lock( mutex );
+	if ( doneQueue.empty() )
+		return nullptr;
+	Job *	job = doneQueue.front();
+	doneQueue.pop_front();
+	return job;
+}
+
+bool TexCache::AsyncLoader::haveDoneJobs()
+{
+	std::lock_guard< std::mutex >	lock( mutex );
+	return !doneQueue.empty();
+}
+
+void TexCache::AsyncLoader::waitForJobs()
+{
+	std::unique_lock< std::mutex >	lock( mutex );
+	while ( jobsPending > 0 )
+		cv.wait( lock );
+}
+
+void TexCache::AsyncLoader::cancelJobs()
+{
+	std::lock_guard< std::mutex >	lock( mutex );
+	// a job that is currently being decoded is discarded by the worker thread when it is finished
+	generation++;
+	jobsPending -= jobQueue.size();
+	for ( Job * job : jobQueue )
+		delete job;
+	jobQueue.clear();
+	for ( Job * job : doneQueue )
+		delete job;
+	doneQueue.clear();
+	for ( Job * job : previewJobs )
+		delete job;
+	previewJobs.clear();
+	cache->previewBytes = 0;
+}
+
+void TexCache::AsyncLoader::run()
+{
+	std::unique_lock< std::mutex >	lock( mutex );
+	while ( true ) {
+		while ( jobQueue.empty() && !quitFlag )
+			cv.wait( lock );
+		if ( quitFlag )
+			break;
+		Job *	job = jobQueue.front();
+		jobQueue.pop_front();
+		lock.unlock();
+
+		try {
+			texLoadDecode( job->data );
+		} catch ( std::exception & e ) {
+			job->data.error = QString::fromUtf8( e.what() );
+		}
+
+		lock.lock();
+		jobsPending--;
+		bool	isFirstDoneJob = false;
+		if ( job->generation != generation ) {
+			delete job;
+		} else {
+			isFirstDoneJob = doneQueue.empty();
+			doneQueue.push_back( job );
+		}
+		cv.notify_all();
+		if ( isFirstDoneJob ) {
+			// request a repaint, the signal is delivered to the GL thread via a queued connection
+			lock.unlock();
+			emit cache->sigRefresh();
+			lock.lock();
+		}
+	}
+}
+
 TexCache::TexCache( QObject * parent ) : QObject( parent )
 {
 	textures = nullptr;
 	textureHashMask = 0;
 	textureCount = 0;
+	asyncLoader = nullptr;
+	residentBytes = 0;
+	previewBytes = 0;
+	frameCounter = 0;
+	evictionCount = 0;
+	mipDropCount = 0;
+	bindCalls = 0;
 	rehashTextures();
 }
 
 TexCache::~TexCache()
 {
+	delete asyncLoader;
 #if 0
 	flush();
 #endif
@@ -299,7 +468,7 @@ bool TexCache::isSupported( const QString & filePath )
 	return texIsSupported( filePath );
 }
 
-const TexCache::Tex::ImageInfo * TexCache::getTextureInfo( const QStringView & file ) const
+TexCache::Tex * TexCache::findTex( const QStringView & file ) const
 {
 	if ( file.isEmpty() ) [[unlikely]]
 		return nullptr;
@@ -308,13 +477,23 @@ const TexCache::Tex::ImageInfo * TexCache::getTextureInfo( const QStringView & f
 	std::uint32_t	h = hashFunctionUInt32( s, nameLen * sizeof( QChar ) );
 	std::uint32_t	m = textureHashMask;
 	for ( h = h & m; textures[h].nameLen; h = ( h + 1U ) & m ) {
-		const Tex &	p = textures[h];
+		Tex &	p = textures[h];
 		if ( p.nameLen == nameLen && std::memcmp( p.nameData, s, nameLen * sizeof( QChar ) ) == 0 )
-			return p.imageInfo;
+			return &p;
 	}
 	return nullptr;
 }
 
+const TexCache::Tex::ImageInfo * TexCache::getTextureInfo( const QStringView & file ) const
+{
+	const Tex *	p = findTex( file );
+	if ( p && p->isAlias ) [[unlikely]]
+		p = findTex( p->imageInfo->aliasOf );
+	if ( !p )
+		return nullptr;
+	return p->imageInfo;
+}
+
 static inline const QString & convertToQString( const QString & s )
 {
 	return s;
@@ -346,6 +525,17 @@ template< typename T > inline TexCache::Tex * TexCache::insertTex( const T & fil
 	tx.imageInfo->filename = convertToQString( file );
 	tx.nameData = tx.imageInfo->filename.constData();
 	tx.nameLen = std::uint16_t( nameLen );
+	if ( *s != QChar('#') ) {
+		// different spellings of the same path (e.g. "Textures\\a.dds" and "data/textures/a.dds") share the first one's texture
+		QString	key( QString::fromStdString( Game::GameManager::get_full_path( tx.imageInfo->filename, "textures", "" ) ) );
+		auto	i = pathOwners.constFind( key );
+		if ( i == pathOwners.cend() ) {
+			pathOwners.insert( key, tx.imageInfo->filename );
+		} else {
+			tx.isAlias = true;
+			tx.imageInfo->aliasOf = i.value();
+		}
+	}
 
 	textureCount++;
 	if ( ( std::uint64_t(textureCount) * 3U ) > ( std::uint64_t(textureHashMask) * 2U ) )
@@ -382,15 +572,33 @@ TexCache::Tex * TexCache::rehashTextures( Tex * p )
 
 int TexCache::bind( const QStringView & fname, const NifModel * nif )
 {
+	bindCalls++;
 	Tex *	tx = insertTex( fname );
 	if ( !tx ) [[unlikely]]
 		return 0;
+	if ( tx->isAlias ) [[unlikely]] {
+		countBind( *tx );
+		tx = resolveAlias( tx );
+		if ( !tx ) [[unlikely]]
+			return 0;
+	}
+	countBind( *tx );
 	if ( !tx->isLoaded() ) [[unlikely]] {
 		if ( tx->id[0] )
 			return 0;
 
+		if ( asyncLoader && queueTex( *tx, nif ) )
+			return bindPlaceholder( *tx, nif );
 		return loadTex( *tx, nif );
 	}
+	if ( tx->droppedMips ) [[unlikely]] {
+		// the texture is used again, reload it at full resolution
+		// while it is being loaded asynchronously (or is a preview), the reduced resolution version is still used
+		if ( !( asyncLoader && queueTex( *tx, nif ) ) ) {
+			releaseTex( *tx );
+			return loadTex( *tx, nif );
+		}
+	}
 
 	if ( !tx->target ) [[unlikely]]
 		tx->target = GL_TEXTURE_2D;
@@ -401,12 +609,25 @@ int TexCache::bind( const QStringView & fname, const NifModel * nif )
 
 bool TexCache::bindCube( const QString & fname, const NifModel * nif, bool useSecondTexture )
 {
+	bindCalls++;
 	Tex *	tx = insertTex( fname );
 	if ( !tx ) [[unlikely]]
 		return false;
+	if ( tx->isAlias ) [[unlikely]] {
+		countBind( *tx );
+		tx = resolveAlias( tx );
+		if ( !tx ) [[unlikely]]
+			return false;
+	}
+	countBind( *tx );
 
 	if ( !tx->isLoaded() ) [[unlikely]] {
-		if ( tx->id[0] || !loadTex( *tx, nif ) )
+		if ( tx->id[0] )
+			return false;
+		// the caller falls back to a default cube map while the texture is pending
+		if ( asyncLoader && queueTex( *tx, nif ) )
+			return false;
+		if ( !loadTex( *tx, nif ) )
 			return false;
 	} else {
 		if ( !tx->id[size_t(useSecondTexture)] ) [[unlikely]]
@@ -453,19 +674,358 @@ std::uint16_t TexCache::loadTex( Tex & tx, const NifModel * nif )
 	if ( tx.target )
 		glBindTexture( tx.target, tx.id[0] );
 
+	QElapsedTimer	t;
 	try
 	{
-		i->mipmaps = texLoad( nif, i->filepath, i->format, tx.target, i->width, i->height, tx.id );
+		TexLoadData	d;
+		d.filepath = i->filepath;
+		if ( !texLoadFind( d, nif ) )
+			throw QString( "could not open file" );
+		texLoadDecode( d );
+		if ( d.isStale ) [[unlikely]] {
+			if ( !texLoadFind( d, nif ) )
+				throw QString( "could not open file" );
+			texLoadDecode( d );
+			if ( d.isStale )
+				throw QString( "could not open file" );
+		}
+		addLoadStats( tx, d );
+		t.start();
+		i->mipmaps = texLoadUpload( d, i->format, tx.target, i->width, i->height, tx.id );
 		tx.mipmaps = std::uint16_t( i->mipmaps );
 	}
 	catch ( QString & e )
 	{
 		i->status = e;
 	}
+	if ( t.isValid() )
+		i->uploadTime += std::uint64_t( t.nsecsElapsed() / 1000 );
+	if ( tx.mipmaps )
+		updateMemoryUsage( tx );
 
 	return tx.mipmaps;
 }
 
+void TexCache::releaseTex( Tex & tx )
+{
+	if ( tx.isLoaded() )
+		glDeleteTextures( ( !tx.id[1] ? 1 : 2 ), tx.id );
+	tx.id[0] = 0;
+	tx.id[1] = 0;
+	tx.mipmaps = 0;
+	tx.droppedMips = 0;
+	residentBytes -= tx.gpuBytes;
+	tx.gpuBytes = 0;
+}
+
+void TexCache::updateMemoryUsage( Tex & tx )
+{
+	size_t	n = 0;
+	for ( size_t i = ( !tx.id[1] ? 0 : 1 ); ; i-- ) {
+		glBindTexture( tx.target, tx.id[i] );
+		n += texGetMemoryUsage( tx.target );
+		if ( !i )
+			break;
+	}
+	n = std::min< size_t >( n, std::numeric_limits< std::uint32_t >::max() );
+
+	residentBytes = residentBytes - tx.gpuBytes + n;
+	tx.gpuBytes = std::uint32_t( n );
+}
+
+void TexCache::nextFrame()
+{
+	frameCounter++;
+	if ( !memoryBudget || ( residentBytes + previewBytes ) <= memoryBudget ) [[likely]]
+		return;
+
+	if ( previewBytes ) {
+		// release the file data of previews, least recently bound and largest first, the preview remains in use
+		// with mip levels dropped, and the texture is loaded again at full resolution when it is bound
+		std::vector< AsyncLoader::Job * > &	previewJobs = asyncLoader->previewJobs;
+		std::vector< std::pair< std::pair< std::uint32_t, qsizetype >, AsyncLoader::Job * > >	jobs;
+		for ( AsyncLoader::Job * job : previewJobs ) {
+			const Tex *	tx = findTex( job->name );
+			std::uint32_t	age = ( tx ? frameCounter - tx->lastBound : 0xFFFFFFFFU );
+			jobs.emplace_back( std::make_pair( age, job->data.fileData.size() ), job );
+		}
+		std::stable_sort( jobs.begin(), jobs.end(),
+							[]( const auto & a, const auto & b ) { return ( a.first < b.first ); } );
+		while ( !jobs.empty() && ( residentBytes + previewBytes ) > memoryBudget ) {
+			AsyncLoader::Job *	job = jobs.back().second;
+			jobs.pop_back();
+			Tex *	tx = findTex( job->name );
+			if ( tx )
+				tx->isPending = false;
+			previewBytes -= std::uint64_t( job->data.fileData.size() );
+			delete job;
+		}
+		previewJobs.clear();
+		for ( const auto & j : jobs )
+			previewJobs.push_back( j.second );
+		if ( residentBytes <= memoryBudget )
+			return;
+	}
+
+	// (frames since last bound, texture index) of the textures not used in the last evictionMinAge frames
+	std::vector< std::pair< std::uint32_t, std::uint32_t > >	lru;
+	for ( std::uint32_t i = 0; i <= textureHashMask; i++ ) {
+		const Tex &	tx = textures[i];
+		std::uint32_t	age = frameCounter - tx.lastBound;
+		if ( tx.gpuBytes && !tx.isPending && age > evictionMinAge )
+			lru.emplace_back( age, i );
+	}
+	std::sort( lru.begin(), lru.end(), std::greater< std::pair< std::uint32_t, std::uint32_t > >() );
+
+	if ( dropMipLevels ) {
+		for ( const auto & i : lru ) {
+			if ( residentBytes <= memoryBudget )
+				return;
+			Tex &	tx = textures[i.second];
+			if ( tx.droppedMips || tx.mipmaps < 4 )
+				continue;
+			GLuint	m = texDropMipLevels( tx.id, tx.target, tx.mipmaps, 1 );
+			if ( !m )
+				continue;
+			tx.mipmaps = std::uint16_t( m );
+			tx.droppedMips = 1;
+			updateMemoryUsage( tx );
+			mipDropCount++;
+		}
+	}
+
+	for ( const auto & i : lru ) {
+		if ( residentBytes <= memoryBudget )
+			break;
+		releaseTex( textures[i.second] );
+		evictionCount++;
+	}
+}
+
+bool TexCache::queueTex( Tex & tx, const NifModel * nif )
+{
+	if ( tx.isPending )
+		return true;
+
+	Tex::ImageInfo *	i = tx.imageInfo;
+	// solid color textures are small and are also used as placeholders, these are always generated immediately
+	if ( i->filename.startsWith( QChar('#') ) || !isSupported( i->filename ) )
+		return false;
+
+	i->filepath = find( i->filename, nif );
+
+	AsyncLoader::Job *	job = new AsyncLoader::Job;
+	job->name = i->filename;
+	job->data.filepath = i->filepath;
+	job->data.hashContent = shareIdenticalTextures;
+	// the file is looked up on this thread, but read and decoded on the worker thread
+	if ( !texLoadFind( job->data, nif ) ) {
+		// let loadTex() report the error
+		delete job;
+		return false;
+	}
+	asyncLoader->addJob( job );
+	tx.isPending = true;
+
+	return true;
+}
+
+int TexCache::bindPlaceholder( const Tex & tx, const NifModel * nif )
+{
+	static const QString	placeholder = "#FF808080";
+	static const QString	placeholderNormal = "#FFFF8080";
+	static const QString	placeholderNormalSigned = "#FFFF8080n";
+
+	// flat normal for normal maps, and mid grey for any other texture
+	QStringView	name = tx.filename();
+	if ( !( name.endsWith( u"_n.dds", Qt::CaseInsensitive ) || name.endsWith( u"_msn.dds", Qt::CaseInsensitive )
+			|| name.endsWith( u"_normal.dds", Qt::CaseInsensitive ) ) ) {
+		return bind( placeholder, nif );
+	}
+	return bind( ( nif && nif->getBSVersion() >= 151 ? placeholderNormalSigned : placeholderNormal ), nif );
+}
+
+void TexCache::setAsyncLoading( bool enabled )
+{
+	if ( enabled ) {
+		if ( !asyncLoader )
+			asyncLoader = new AsyncLoader( this );
+		return;
+	}
+	if ( !asyncLoader )
+		return;
+
+	asyncLoader->waitForJobs();
+	(void) uploadPendingTextures( std::numeric_limits< int >::max() );
+	delete asyncLoader;
+	asyncLoader = nullptr;
+}
+
+void TexCache::uploadTex( Tex & tx, TexLoadData & d )
+{
+	Tex::ImageInfo *	i = tx.imageInfo;
+	tx.isPending = false;
+	// replace the reduced resolution version of a texture that had mip levels dropped
+	if ( tx.isLoaded() )
+		releaseTex( tx );
+	if ( !tx.id[0] )
+		glGenTextures( 1, tx.id );
+	QElapsedTimer	t;
+	t.start();
+	try
+	{
+		i->mipmaps = texLoadUpload( d, i->format, tx.target, i->width, i->height, tx.id );
+		tx.mipmaps = std::uint16_t( i->mipmaps );
+	}
+	catch ( QString & e )
+	{
+		i->status = e;
+	}
+	i->uploadTime += std::uint64_t( t.nsecsElapsed() / 1000 );
+	if ( tx.mipmaps )
+		updateMemoryUsage( tx );
+}
+
+void TexCache::addLoadStats( Tex & tx, const TexLoadData & d )
+{
+	Tex::ImageInfo *	i = tx.imageInfo;
+	const Game::GameManager::FileRef &	ref = d.fileRef;
+	if ( !ref.source.isEmpty() )
+		i->source = ref.source;
+	i->fileBytes = ref.packedSize;
+	i->dataBytes = ref.unpackedSize;
+	i->readTime += d.readTime;
+	i->decodeTime += d.decodeTime;
+	i->loadCount++;
+}
+
+TexCache::Tex * TexCache::resolveAlias( Tex * tx )
+{
+	// aliases are normally created for a texture that is not an alias, but it may have become one later
+	for ( int n = 0; n < 4 && tx->isAlias; n++ ) {
+		QString	name( tx->imageInfo->aliasOf );
+		tx = insertTex( name );
+		if ( !tx ) [[unlikely]]
+			return nullptr;
+	}
+	return ( !tx->isAlias ? tx : nullptr );
+}
+
+bool TexCache::shareContent( Tex & tx, const TexLoadData & d )
+{
+	addLoadStats( tx, d );
+	if ( d.contentHash.isEmpty() )
+		return false;
+
+	auto	i = contentOwners.find( d.contentHash );
+	if ( i == contentOwners.end() ) {
+		contentOwners.insert( d.contentHash, tx.imageInfo->filename );
+		return false;
+	}
+	const Tex *	owner = findTex( i.value() );
+	if ( owner == &tx )
+		return false;
+	if ( !owner || owner->isAlias ) {
+		i.value() = tx.imageInfo->filename;
+		return false;
+	}
+
+	// the texture is loaded again when the alias is bound, if it has been evicted since
+	if ( tx.isLoaded() )
+		releaseTex( tx );
+	tx.isPending = false;
+	tx.isAlias = true;
+	tx.imageInfo->aliasOf = i.value();
+	return true;
+}
+
+std::vector< TexCache::LoadRecord > TexCache::getLoadRecords() const
+{
+	std::vector< LoadRecord >	records;
+	records.reserve( textureCount );
+	for ( std::uint32_t n = 0; n <= textureHashMask; n++ ) {
+		const Tex &	tx = textures[n];
+		if ( !tx.imageInfo )
+			continue;
+		LoadRecord &	r = records.emplace_back();
+		r.info = *(tx.imageInfo);
+		r.gpuBytes = tx.gpuBytes;
+		r.bindCount = tx.imageInfo->bindCount + tx.bindCount;
+		r.isLoaded = tx.isLoaded();
+		// the texture remains pending while a progressive loading preview is resident
+		r.isPreview = ( tx.isPending && tx.droppedMips && r.isLoaded );
+		r.isPending = ( tx.isPending && !r.isPreview );
+	}
+	return records;
+}
+
+bool TexCache::uploadPendingTextures( int timeBudget )
+{
+	if ( !asyncLoader )
+		return false;
+
+	QElapsedTimer	t;
+	t.start();
+	std::vector< AsyncLoader::Job * > &	previewJobs = asyncLoader->previewJobs;
+	while ( AsyncLoader::Job * job = asyncLoader->takeDoneJob() ) {
+		Tex *	tx = findTex( job->name );
+		if ( job->data.isStale ) [[unlikely]] {
+			// the archives have been reloaded, the texture is looked up again and queued on the next bind
+			if ( tx && tx->isPending )
+				tx->isPending = false;
+			delete job;
+			emit sigRefresh();
+			continue;
+		}
+		if ( tx && tx->isPending && !shareContent( *tx, job->data ) ) {
+			// no preview if a texture with dropped mip levels is reloaded, it is already resident at a lower resolution
+			if ( progressiveLoading && !tx->isLoaded() )
+				job->data.skipLevels = texLoadPreviewLevels( job->data, previewSize );
+			uploadTex( *tx, job->data );
+			if ( job->data.skipLevels && tx->mipmaps ) {
+				// keep the job for uploading the full resolution texture later, the texture remains pending until then
+				tx->isPending = true;
+				tx->droppedMips = std::uint8_t( std::min< std::uint32_t >( job->data.skipLevels, 255 ) );
+				job->data.skipLevels = 0;
+				previewBytes += std::uint64_t( job->data.fileData.size() );
+				previewJobs.push_back( job );
+				job = nullptr;
+			}
+		}
+		delete job;
+
+		if ( t.elapsed() >= timeBudget )
+			return true;
+	}
+
+	if ( !previewJobs.empty() ) {
+		// textures bound in the last frame are replaced first, in order of the number of times they were bound
+		// as an estimate of screen coverage, the job with the highest priority is at the end of the list
+		std::vector< std::pair< std::uint32_t, AsyncLoader::Job * > >	jobs;
+		for ( AsyncLoader::Job * job : previewJobs ) {
+			const Tex *	tx = findTex( job->name );
+			jobs.emplace_back( ( tx && tx->lastBound == frameCounter ? tx->bindCount : 0U ), job );
+		}
+		std::stable_sort( jobs.begin(), jobs.end(),
+							[]( const auto & a, const auto & b ) { return ( a.first < b.first ); } );
+		previewJobs.clear();
+		for ( const auto & j : jobs )
+			previewJobs.push_back( j.second );
+
+		while ( !previewJobs.empty() && t.elapsed() < timeBudget ) {
+			AsyncLoader::Job *	job = previewJobs.back();
+			previewJobs.pop_back();
+			previewBytes -= std::uint64_t( job->data.fileData.size() );
+			Tex *	tx = findTex( job->name );
+			if ( tx && tx->isPending )
+				uploadTex( *tx, job->data );
+			delete job;
+		}
+	}
+
+	return ( asyncLoader->haveDoneJobs() || !previewJobs.empty() );
+}
+
 int TexCache::bind( const QModelIndex & iSource )
 {
 	auto nif = NifModel::fromValidIndex(iSource);
@@ -506,6 +1066,9 @@ int TexCache::bind( const QModelIndex & iSource )
 
 void TexCache::flush()
 {
+	if ( asyncLoader )
+		asyncLoader->cancelJobs();
+
 	for ( size_t i = 0; i <= textureHashMask; i++ ) {
 		Tex &	tx = textures[i];
 		if ( tx.isLoaded() )
@@ -515,7 +1078,10 @@ void TexCache::flush()
 	}
 	textureHashMask = 0;
 	textureCount = 0;
+	residentBytes = 0;
 	rehashTextures();
+	pathOwners.clear();
+	contentOwners.clear();
 
 	for ( Tex & tx : embedTextures ) {
 		if ( tx.id[0] )
@@ -642,6 +1208,15 @@ bool TexCache::loadSettings( QSettings & settings )
 	r = r | ( tmp != hdrToneMapLevel );
 	hdrToneMapLevel = tmp;
 
+	tmp = settings.value( "Settings/Render/General/Texture Upload Time Budget", 8 ).toInt();
+	uploadTimeBudget = std::min< int >( std::max< int >( tmp, 1 ), 1000 );
+
+	tmp = settings.value( "Settings/Render/General/Texture Memory Budget", 2048 ).toInt();
+	memoryBudget = std::uint64_t( std::min< int >( std::max< int >( tmp, 0 ), 65536 ) ) << 20;
+	dropMipLevels = settings.value( "Settings/Render/General/Drop Mip Levels", false ).toBool();
+	progressiveLoading = settings.value( "Settings/Render/General/Progressive Texture Loading", true ).toBool();
+	shareIdenticalTextures = settings.value( "Settings/Render/General/Share Identical Textures", true ).toBool();
+
 	return r;
 }
 
@@ -40,12 +40,15 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QString>
 #include <QStringView>
 
+#include <vector>
+
 
 //! @file gltex.h TexCache etc. header
 
 class NifModel;
 class QOpenGLContext;
 class QSettings;
+struct TexLoadData;
 
 typedef unsigned int GLuint;
 typedef unsigned int GLenum;
@@ -105,6 +108,23 @@ public:
 			TexFmt format;
 			//! Status messages
 			QString status;
+			//! Archive or loose file the texture was read from
+			QString source;
+			//! Size of the file in the archive, and after decompression
+			std::uint64_t fileBytes = 0;
+			std::uint64_t dataBytes = 0;
+			//! Time in microseconds spent reading, decoding and uploading the texture, summed over all loads.
+			// TGA, BMP and NIF textures are decoded while uploading.
+			std::uint64_t readTime = 0;
+			std::uint64_t decodeTime = 0;
+			std::uint64_t uploadTime = 0;
+			//! Number of times the texture was loaded, including reloads after eviction
+			std::uint32_t loadCount = 0;
+			//! Number of times the texture was bound before frame Tex::lastBound
+			std::uint64_t bindCount = 0;
+			//! Name of the texture whose GL texture is used instead, if this is a different spelling of the same
+			// path, or has the same content as a texture that was loaded earlier
+			QString aliasOf;
 
 			//! Save the texture as pixel data
 			bool savePixelData( NifModel * nif, QModelIndex & iData ) const;
@@ -113,10 +133,23 @@ public:
 		const QChar *	nameData;
 		std::uint16_t	nameLen;
 		std::uint16_t	mipmaps;
+		//! True while the texture is being loaded on the worker thread
+		bool	isPending;
+		//! Number of mip levels removed by TexCache::nextFrame() to reduce memory usage,
+		// or not uploaded yet because the texture is a progressive loading preview
+		std::uint8_t	droppedMips;
+		//! True if binding the texture binds imageInfo->aliasOf, this texture is never loaded
+		bool	isAlias;
 		//! The format target
 		GLenum	target;
 		//! IDs for use with GL texture functions
 		GLuint	id[2];
+		//! Value of the frame counter when the texture was last bound
+		std::uint32_t	lastBound;
+		//! Number of times the texture was bound in frame 'lastBound'
+		std::uint32_t	bindCount;
+		//! Estimated video memory used by the texture in bytes
+		std::uint32_t	gpuBytes;
 		//! Detailed information about the image file
 		ImageInfo *	imageInfo;
 
@@ -125,9 +158,15 @@ public:
 			nameData = nullptr;
 			nameLen = 0;
 			mipmaps = 0;
+			isPending = false;
+			droppedMips = 0;
+			isAlias = false;
 			target = 0;	// = 0x0DE1; // GL_TEXTURE_2D
 			id[0] = 0;
 			id[1] = 0;
+			lastBound = 0;
+			bindCount = 0;
+			gpuBytes = 0;
 			imageInfo = nullptr;
 		}
 
@@ -156,6 +195,66 @@ public:
 	//! Bind a texture from pixel data
 	int bind( const QModelIndex & iSource );
 
+	/*! Enable or disable loading texture files on a worker thread
+	 *
+	 * While a texture is being loaded, bind() returns a neutral placeholder texture instead.
+	 * Disabling asynchronous loading waits for all pending textures and uploads them.
+	 */
+	void setAsyncLoading( bool enabled );
+	/*! Upload textures that have been loaded by the worker thread, spending at most about 'timeBudget' milliseconds.
+	 *
+	 * This should be called once per frame, and it returns true if there are more textures still being loaded.
+	 * If progressive loading is enabled, large DDS textures are first uploaded at a reduced resolution, and the
+	 * full resolution versions replace them in later calls, those bound most often in the last frame first.
+	 */
+	bool uploadPendingTextures( int timeBudget );
+
+	/*! Start a new frame, and evict textures if the memory budget is exceeded
+	 *
+	 * The file data kept for upgrading progressive loading previews is counted in the budget, and it is
+	 * released first, the full resolution texture is then read again when it is bound. Textures that have not
+	 * been bound in the last evictionMinAge frames are evicted next in least recently bound order, they are
+	 * reloaded when bound again. If mip level dropping is enabled, the largest mip level of these textures is
+	 * removed first, before deleting any texture.
+	 */
+	void nextFrame();
+
+	//! Returns the estimated video memory used by the loaded textures in bytes
+	inline std::uint64_t getResidentBytes() const
+	{
+		return residentBytes;
+	}
+	//! Returns the number of textures evicted to stay within the memory budget
+	inline std::uint32_t getEvictionCount() const
+	{
+		return evictionCount;
+	}
+	//! Returns the number of textures that had mip levels dropped to stay within the memory budget
+	inline std::uint32_t getMipDropCount() const
+	{
+		return mipDropCount;
+	}
+	//! Returns the number of calls to bind() and bindCube()
+	inline std::uint64_t getBindCallCount() const
+	{
+		return bindCalls;
+	}
+
+	//! Loading statistics of a texture file, returned by getLoadRecords()
+	struct LoadRecord
+	{
+		Tex::ImageInfo	info;
+		//! Current estimated video memory usage, 0 if the texture is not resident
+		std::uint64_t	gpuBytes = 0;
+		//! Total number of times the texture was bound
+		std::uint64_t	bindCount = 0;
+		bool	isLoaded = false;
+		bool	isPending = false;
+		bool	isPreview = false;
+	};
+	//! Returns the loading statistics of all texture files used since the last flush()
+	std::vector< LoadRecord > getLoadRecords() const;
+
 	//! Debug function for getting info about a texture
 	QString info( const QModelIndex & iSource );
 
@@ -180,6 +279,21 @@ public:
 	static int	pbrCubeMapResolution;
 	static int	pbrImportanceSamples;
 	static int	hdrToneMapLevel;
+	//! Time in milliseconds spent uploading asynchronously loaded textures per frame
+	static int	uploadTimeBudget;
+	//! Video memory budget for textures in bytes, 0 = unlimited
+	static std::uint64_t	memoryBudget;
+	//! Allow reducing the resolution of textures not used recently instead of evicting them
+	static bool	dropMipLevels;
+	//! Minimum number of frames since a texture was last bound before it can be evicted or have mip levels dropped,
+	// so that textures not drawn for a few frames (e.g. culled while the camera turns) are not reloaded immediately
+	static constexpr std::uint32_t	evictionMinAge = 8;
+	//! Upload a low resolution preview of large textures before the full mip chain
+	static bool	progressiveLoading;
+	//! Maximum width and height of the preview uploaded by progressive loading
+	static constexpr std::uint32_t	previewSize = 256;
+	//! Share a single GL texture between texture files with identical content
+	static bool	shareIdenticalTextures;
 
 signals:
 	void sigRefresh();
@@ -195,15 +309,57 @@ public slots:
 	void setNifFolder( const QString & );
 
 protected:
+	struct AsyncLoader;
+
 	Tex * textures;
 	std::uint32_t textureHashMask;
 	std::uint32_t textureCount;
 	QHash<QModelIndex, Tex> embedTextures;
-
+	AsyncLoader * asyncLoader;
+	std::uint64_t residentBytes;
+	//! Size of the file data kept in memory by AsyncLoader::previewJobs
+	std::uint64_t previewBytes;
+	std::uint32_t frameCounter;
+	std::uint32_t evictionCount;
+	std::uint32_t mipDropCount;
+	std::uint64_t bindCalls;
+	//! Name of the texture that is loaded for each normalized path, other spellings of the path are aliases of it
+	QHash<QString, QString> pathOwners;
+	//! Name of the texture that is loaded for each content hash, if shareIdenticalTextures is enabled
+	QHash<QByteArray, QString> contentOwners;
+
+	Tex * findTex( const QStringView & file ) const;
 	template< typename T > inline Tex * insertTex( const T & file );
 	Tex * rehashTextures( Tex * p = nullptr );
 	//! Load the texture
-	static std::uint16_t loadTex( Tex & tx, const NifModel * nif );
+	std::uint16_t loadTex( Tex & tx, const NifModel * nif );
+	//! Delete the GL texture(s) of 'tx', it will be reloaded when it is bound again
+	void releaseTex( Tex & tx );
+	//! Update gpuBytes of 'tx' and residentBytes, this binds the texture
+	void updateMemoryUsage( Tex & tx );
+	//! Queue the texture for loading on the worker thread, returns false if it needs to be loaded with loadTex()
+	bool queueTex( Tex & tx, const NifModel * nif );
+	//! Bind the placeholder texture used while 'tx' is pending
+	int bindPlaceholder( const Tex & tx, const NifModel * nif );
+	//! Create the GL texture of 'tx' from data loaded by the worker thread, replacing any previous version
+	void uploadTex( Tex & tx, TexLoadData & d );
+	//! Add the file information and read and decode times of 'd' to the statistics of 'tx'
+	static void addLoadStats( Tex & tx, const TexLoadData & d );
+	//! Returns the texture that is loaded for alias 'tx', it is inserted if it does not exist yet
+	Tex * resolveAlias( Tex * tx );
+	//! Make 'tx' an alias of the texture previously loaded with the same content hash as 'd', if there is one.
+	// Returns false if 'tx' needs to be uploaded.
+	bool shareContent( Tex & tx, const TexLoadData & d );
+	//! Update lastBound and bindCount when 'tx' is bound
+	inline void countBind( Tex & tx )
+	{
+		if ( tx.lastBound != frameCounter ) {
+			tx.imageInfo->bindCount += tx.bindCount;
+			tx.lastBound = frameCounter;
+			tx.bindCount = 0;
+		}
+		tx.bindCount++;
+	}
 
 public:
 	const Tex::ImageInfo * getTextureInfo( const QStringView & file ) const;
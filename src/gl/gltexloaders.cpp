@@ -32,6 +32,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gltexloaders.h"
 #include "gltex.h"
+#include "texconvert.h"
+#include "cubemapfilter.h"
 
 #include "message.h"
 #include "model/nifmodel.h"
@@ -39,18 +41,27 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "dds.h"
 #include "libfo76utils/src/filebuf.hpp"
 #include "libfo76utils/src/pbr_lut.hpp"
-#include "libfo76utils/src/sfcube2.hpp"
 
 #include <QBuffer>
 #include <QByteArray>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QModelIndex>
 #include <QOpenGLContext>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QString>
 #include <QtEndian>
 
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
 #ifdef __APPLE__
 #include <gl3.h>
 #include <gl3ext.h>
@@ -82,6 +93,15 @@ static bool extInitialized = false;
 // OpenGL 4.2
 static PFNGLTEXSTORAGE2DPROC glTexStorage2D = nullptr;
 static bool extStorageSupported = true;
+// pixel buffer object for uploading textures
+static PFNGLGENBUFFERSPROC pboGenBuffers = nullptr;
+static PFNGLBINDBUFFERPROC pboBindBuffer = nullptr;
+static PFNGLBUFFERDATAPROC pboBufferData = nullptr;
+static PFNGLMAPBUFFERPROC pboMapBuffer = nullptr;
+static PFNGLUNMAPBUFFERPROC pboUnmapBuffer = nullptr;
+static GLuint pixelUnpackBuffer = 0;
+// OpenGL 4.3, used for dropping mip levels of textures
+static PFNGLCOPYIMAGESUBDATAPROC glCopyImageSubData = nullptr;
 #else
 static bool extStorageSupported = false;
 #endif
@@ -95,30 +115,6 @@ static PFNGLCOMPRESSEDTEXIMAGE2DPROC glCompressedTexImage2D = nullptr;
 #define FOURCC_DXT3 MAKEFOURCC( 'D', 'X', 'T', '3' )
 #define FOURCC_DXT5 MAKEFOURCC( 'D', 'X', 'T', '5' )
 
-//! Shift amounts for RGBA conversion
-static const int rgbashift[4] = {
-	0, 8, 16, 24
-};
-//! Mask for TGA greyscale
-static const quint32 TGA_L_MASK[4] = {
-	0xff, 0xff, 0xff, 0x00
-};
-//! Mask for TGA greyscale with alpha
-static const quint32 TGA_LA_MASK[4] = {
-	0x00ff, 0x00ff, 0x00ff, 0xff00
-};
-//! Mask for TGA RGBA
-static const quint32 TGA_RGBA_MASK[4] = {
-	0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000
-};
-//! Mask for TGA RGB
-static const quint32 TGA_RGB_MASK[4] = {
-	0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000
-};
-//! Mask for BMP RGBA (identical to TGA RGB)
-static const quint32 BMP_RGBA_MASK[4] = {
-	0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000
-};
 //! Inverse mask for RGBA
 static const quint32 RGBA_INV_MASK[4] = {
 	0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000
@@ -142,172 +138,53 @@ bool isPowerOfTwo( unsigned int x )
 	return ( x == 1 );
 }
 
-/*! Completes mipmap sequence of the current active OpenGL texture.
+/*! Generate the remaining mip levels of the current 2D texture on the CPU.
  *
- * @param m Number of mipmaps that are already in the texture.
- * @return	Total number of mipmaps.
+ * @param data	RGBA pixel data of mip level m - 1
+ * @param w		Width of mip level m - 1
+ * @param h		Height of mip level m - 1
+ * @param m		Number of mipmaps that are already in the texture.
+ * @return		Total number of mipmaps.
  */
-int generateMipMaps( int m )
+static int uploadMipMaps( const quint8 * data, int w, int h, int m )
 {
-	GLint w = 0, h = 0;
-
-	// load the (m-1)'th mipmap as a basis
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_WIDTH, &w );
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_HEIGHT, &h );
-
-	//qDebug() << m-1 << w << h;
-
-	quint8 * data = (quint8 *)malloc( w * h * 4 );
-	glGetTexImage( GL_TEXTURE_2D, m - 1, GL_RGBA, GL_UNSIGNED_BYTE, data );
-
-	// now generate the mipmaps until width is one or height is one.
-	while ( w > 1 || h > 1 ) {
-		// Shut up Code Analysis C6011
-		if ( !data )
-			break;
-		// the buffer overwrites itself to save memory
-		const quint8 * src = data;
-		quint8 * dst = data;
-
-		quint32 xo = ( w > 1 ? 1 * 4 : 0 );
-		quint32 yo = ( h > 1 ? w * 4 : 0 );
-
-		w /= 2;
-		h /= 2;
-
-		if ( w == 0 )
-			w = 1;
-
-		if ( h == 0 )
-			h = 1;
-
-		//qDebug() << m << w << h;
-
-		for ( int y = 0; y < h; y++ ) {
-			for ( int x = 0; x < w; x++ ) {
-				for ( int b = 0; b < 4; b++ ) {
-					*dst++ = ( *(src + xo) + *(src + yo) + *(src + xo + yo) + *src) / 4;
-					src++;
-				}
-
-				src += xo;
-			}
-
-			src += yo;
-		}
-
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data );
+	std::vector< quint8 >	buf[2];
+	const quint8 *	src = data;
+
+	for ( size_t i = 0; w > 1 || h > 1; i = i ^ 1 ) {
+		int	w2 = std::max< int >( w >> 1, 1 );
+		int	h2 = std::max< int >( h >> 1, 1 );
+		buf[i].resize( size_t( w2 ) * size_t( h2 ) * 4 );
+		downsampleRGBA( buf[i].data(), src, w, h );
+		w = w2;
+		h = h2;
+		src = buf[i].data();
+
+		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, src );
 	}
 
-	free( data );
-
 	return m;
 }
 
-/*! Converts RLE-encoded data into pixel data.
- *
- * TGA in particular uses the PackBits format described at
- * http://en.wikipedia.org/wiki/PackBits and in the TGA spec.
- */
-bool uncompressRLE( QIODevice & f, int w, int h, int bytespp, quint8 * pixel )
-{
-	QByteArray data = f.readAll();
-
-	int c = 0; // total pixel count
-	int o = 0; // data offset
-
-	quint8 rl; // runlength - 1
-
-	while ( c < w * h ) {
-		rl = data[o++];
-
-		if ( rl & 0x80 ) {
-			// if RLE packet
-			quint8 px[8] = {}; // pixel data in this packet (assume bytespp < 8)
-
-			for ( int b = 0; b < bytespp; b++ )
-				px[b] = data[o++];
-
-			rl &= 0x7f; // strip RLE bit
-
-			do {
-				for ( int b = 0; b < bytespp; b++ )
-					*pixel++ = px[b]; // expand pixel data (rl+1) times
-			} while ( ++c < w * h && rl-- > 0 );
-		} else {
-			do {
-				for ( int b = 0; b < bytespp; b++ )
-					*pixel++ = data[o++]; // write (rl+1) raw pixels
-			} while ( ++c < w * h && rl-- > 0 );
-		}
-
-		if ( o >= data.size() )
-			return false;
-	}
-
-	return true;
-}
-
-/*! Convert pixels to RGBA
+/*! Completes mipmap sequence of the current active OpenGL texture.
  *
- * @param data		Pixels to convert
- * @param w			Width of the image
- * @param h			Height of the image
- * @param bytespp	Number of bytes per pixel
- * @param mask		Bitmask for pixel data
- * @param flipV		Whether to flip the data vertically
- * @param flipH		Whether to flip the data horizontally
- * @param pixl		Pixels to output
+ * @param m Number of mipmaps that are already in the texture.
+ * @return	Total number of mipmaps.
  */
-void convertToRGBA( const quint8 * data, int w, int h, int bytespp, const quint32 mask[], bool flipV, bool flipH, quint8 * pixl )
+int generateMipMaps( int m )
 {
-	memset( pixl, 0, w * h * 4 );
-
-	for ( int a = 0; a < 4; a++ ) {
-		if ( mask[a] ) {
-			quint32 msk = mask[ a ];
-			int rshift  = 0;
-
-			while ( msk != 0 && ( msk & 0xffffff00 ) ) {
-				msk = msk >> 1; rshift++;
-			}
-
-			int lshift = rgbashift[ a ];
-
-			while ( msk != 0 && ( ( msk & 0x80 ) == 0 ) ) {
-				msk = msk << 1; lshift++;
-			}
-
-			msk = mask[ a ];
-
-			const quint8 * src = data;
-			const quint32 inc  = ( flipH ? -1 : 1 );
+	GLint w = 0, h = 0;
 
-			for ( int y = 0; y < h; y++ ) {
-				quint32 * dst = (quint32 *)( pixl + 4 * ( w * ( flipV ? h - y - 1 : y ) + ( flipH ? w - 1 : 0 ) ) );
+	// load the (m-1)'th mipmap as a basis
+	glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_WIDTH, &w );
+	glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_HEIGHT, &h );
+	if ( w < 1 || h < 1 )
+		return m;
 
-				if ( rshift == lshift ) {
-					for ( int x = 0; x < w; x++ ) {
-						*dst |= *( (const quint32 *)src ) & msk;
-						dst  += inc;
-						src  += bytespp;
-					}
-				} else {
-					for ( int x = 0; x < w; x++ ) {
-						*dst |= ( *( (const quint32 *)src ) & msk ) >> rshift << lshift;
-						dst  += inc;
-						src  += bytespp;
-					}
-				}
-			}
-		} else if ( a == 3 ) {
-			quint32 * dst = (quint32 *)pixl;
-			quint32 x = 0xff << rgbashift[ a ];
+	std::vector< quint8 >	data( size_t( w ) * size_t( h ) * 4 );
+	glGetTexImage( GL_TEXTURE_2D, m - 1, GL_RGBA, GL_UNSIGNED_BYTE, data.data() );
 
-			for ( int c = w * h; c > 0; c-- )
-				*dst++ |= x;
-		}
-	}
+	return uploadMipMaps( data.data(), w, h, m );
 }
 
 //! Load raw pixel data
@@ -319,8 +196,8 @@ int texLoadRaw( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
 	glPixelStorei( GL_UNPACK_SWAP_BYTES, GL_FALSE );
 
-	quint8 * data1 = (quint8 *)malloc( width * height * 4 );
-	quint8 * data2 = (quint8 *)malloc( width * height * 4 );
+	std::vector< quint8 >	data1( size_t( width ) * size_t( height ) * size_t( bytespp ) );
+	std::vector< quint8 >	data2( size_t( width ) * size_t( height ) * 4 );
 
 	int w = width;
 	int h = height;
@@ -336,31 +213,24 @@ int texLoadRaw( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 		if ( h == 0 )
 			h = 1;
 
+		qint64	n = qint64( w ) * qint64( h ) * bytespp;
 		if ( rle ) {
-			if ( !uncompressRLE( f, w, h, bytespp, data1 ) ) {
-				free( data2 );
-				free( data1 );
+			if ( !uncompressRLE( f, w, h, bytespp, data1.data() ) )
 				throw QString( "unexpected EOF" );
-			}
-		} else if ( f.read( (char *)data1, w * h * bytespp ) != w * h * bytespp ) {
-			free( data2 );
-			free( data1 );
+		} else if ( f.read( reinterpret_cast< char * >( data1.data() ), n ) != n ) {
 			throw QString( "unexpected EOF" );
 		}
 
-		convertToRGBA( data1, w, h, bytespp, mask, flipV, flipH, data2 );
+		convertToRGBA( data1.data(), w, h, bytespp, mask, flipV, flipH, data2.data() );
 
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data2 );
+		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data2.data() );
 
 		if ( w == 1 && h == 1 )
 			break;
 	}
 
-	free( data2 );
-	free( data1 );
-
 	if ( w > 1 || h > 1 )
-		m = generateMipMaps( m );
+		m = uploadMipMaps( data2.data(), w, h, m );
 
 	return m;
 }
@@ -374,8 +244,8 @@ int texLoadPal( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
 	glPixelStorei( GL_UNPACK_SWAP_BYTES, GL_FALSE );
 
-	quint8 * data = (quint8 *)malloc( width * height * 1 );
-	quint8 * pixl = (quint8 *)malloc( width * height * 4 );
+	std::vector< quint8 >	data( size_t( width ) * size_t( height ) );
+	std::vector< quint8 >	pixl( size_t( width ) * size_t( height ) * 4 );
 
 	int w = width;
 	int h = height;
@@ -391,39 +261,24 @@ int texLoadPal( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 		if ( h == 0 )
 			h = 1;
 
+		qint64	n = qint64( w ) * qint64( h );
 		if ( rle ) {
-			if ( !uncompressRLE( f, w, h, bytespp, data ) ) {
-				free( pixl );
-				free( data );
+			if ( !uncompressRLE( f, w, h, bytespp, data.data() ) )
 				throw QString( "unexpected EOF" );
-			}
-		} else if ( f.read( (char *)data, w * h * bytespp ) != w * h * bytespp ) {
-			free( pixl );
-			free( data );
+		} else if ( f.read( reinterpret_cast< char * >( data.data() ), n ) != n ) {
 			throw QString( "unexpected EOF" );
 		}
 
-		quint8 * src = data;
-
-		for ( int y = 0; y < h; y++ ) {
-			quint32 * dst = (quint32 *)( pixl + 4 * ( w * ( flipV ? h - y - 1 : y ) + ( flipH ? w - 1 : 0 ) ) );
-
-			for ( int x = 0; x < w; x++ ) {
-				*dst++ = colormap[*src++];
-			}
-		}
+		convertPalToRGBA( data.data(), w, h, colormap, flipV, flipH, pixl.data() );
 
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixl );
+		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixl.data() );
 
 		if ( w == 1 && h == 1 )
 			break;
 	}
 
-	free( pixl );
-	free( data );
-
 	if ( w > 1 || h > 1 )
-		m = generateMipMaps( m );
+		m = uploadMipMaps( pixl.data(), w, h, m );
 
 	return m;
 }
@@ -628,31 +483,29 @@ GLuint texLoadBMP( QIODevice & f, TexCache::TexFmt & texformat, GLenum & target,
 	return 0;
 }
 
-GLuint texLoadDDS( const QString & filepath, GLenum & target, QByteArray & data, GLuint * id )
-{
-	if ( data.size() < 128 )
-		return 0;
+static GLuint texCreateStorage( const DDSImageView & img, GLenum & target, GLuint * id );
+static GLuint texCreateFallback( const DDSImageView & img, GLenum & target, GLuint * id );
 
+//! Create the OpenGL texture from a DDS image
+static GLuint texUploadDDS( const QString & filepath, GLenum & target, const DDSImageView & img, GLuint * id )
+{
 	GLuint mipmaps = 0;
 	GLuint result = 0;
-	gli::texture texture;
-	if ( extStorageSupported ) {
-		texture = load_if_valid( data.constData(), data.size() );
-		if ( !texture.empty() )
-			result = GLI_create_texture( texture, target, id );
+	if ( img.empty() ) {
+		// corrupt or unsupported
+	} else if ( extStorageSupported ) {
+		result = texCreateStorage( img, target, id );
 #ifdef Q_OS_WIN32
 	} else if ( glCompressedTexImage2D ) {
 #else
 	} else {
 #endif
-		texture = load_if_valid( data.constData(), data.size() );
-		if ( !texture.empty() )
-			result = GLI_create_texture_fallback( texture, target, id );
+		result = texCreateFallback( img, target, id );
 	}
 
 	if ( result ) {
 		id[0] = result;
-		mipmaps = (GLuint)texture.levels();
+		mipmaps = img.levels;
 	} else {
 		QString file = filepath;
 		Message::append( "One or more textures failed to load.",
@@ -660,23 +513,174 @@ GLuint texLoadDDS( const QString & filepath, GLenum & target, QByteArray & data,
 		);
 	}
 
+	return mipmaps;
+}
+
+//! Create the OpenGL texture from a decoded DDS image
+static GLuint texUploadDDS( const QString & filepath, GLenum & target, gli::texture & texture, GLuint * id )
+{
+	DDSImageView	img;
+	img.setTexture( texture );
+	GLuint	mipmaps = texUploadDDS( filepath, target, img, id );
+
 	if ( !texture.empty() )
 		texture.clear();
 
 	return mipmaps;
 }
 
-static SFCubeMapCache	sfCubeMapCache;
+//! Returns true if the image can be uploaded directly from the file data, without using gli
+static inline bool canUploadDirectly( const DDSImageView & img )
+{
+	return ( ( img.target == gli::TARGET_2D || img.target == gli::TARGET_CUBE ) && img.layers == 1 && img.depth == 1 );
+}
+
+GLuint texLoadDDS( const QString & filepath, GLenum & target, QByteArray & data, GLuint * id )
+{
+	if ( data.size() < 128 )
+		return 0;
+
+	DDSImageView	img;
+	if ( img.parse( data.constData(), size_t( data.size() ) ) && canUploadDirectly( img ) )
+		return texUploadDDS( filepath, target, img, id );
+
+	gli::texture texture = load_if_valid( data.constData(), data.size() );
+
+	return texUploadDDS( filepath, target, texture, id );
+}
+
+/*
+ * Cache of prefiltered PBR cube maps
+ *
+ * The filtered DDS data is kept in memory, and also saved on disk, with two files per entry: "<key>_s.dds"
+ * (specular) and "<key>_d.dds" (diffuse), where the key is a hash of the source image and of all parameters that
+ * affect the filtered output. The filtering itself is done by filterPBRCubeMap(), the mutex only protects the
+ * shared table of cube maps in memory.
+ */
+
+struct CachedCubeMaps
+{
+	QByteArray	specular;
+	QByteArray	diffuse;
+};
+
+static QHash< QByteArray, CachedCubeMaps >	cubeMapMemoryCache;
+static std::mutex	cubeMapMemoryCacheMutex;
+
+//! Incremented when the output of the cube map filtering changes
+static constexpr std::uint32_t	cubeMapCacheVersion = 1;
+//! Maximum number of cube maps kept in the cache on disk, the oldest ones are removed first
+static constexpr int	cubeMapCacheMaxEntries = 32;
+//! Maximum number of cube maps kept in memory
+static constexpr qsizetype	cubeMapMemoryCacheMaxEntries = 8;
 
 void TexCache::clearCubeCache()
 {
-	sfCubeMapCache.clear();
+	std::lock_guard< std::mutex >	lock( cubeMapMemoryCacheMutex );
+	cubeMapMemoryCache.clear();
+}
+
+static QByteArray getCubeMapCacheKey( const QByteArray & data, bool filterDisabled, float normalizeLevel )
+{
+	std::uint32_t	params[6];
+	params[0] = cubeMapCacheVersion;
+	params[1] = std::uint32_t( TexCache::pbrCubeMapResolution );
+	params[2] = std::uint32_t( TexCache::pbrImportanceSamples );
+	params[3] = std::uint32_t( TexCache::hdrToneMapLevel );
+	std::memcpy( &(params[4]), &normalizeLevel, sizeof( float ) );
+	params[5] = std::uint32_t( filterDisabled );
+
+	QCryptographicHash	h( QCryptographicHash::Sha1 );
+	h.addData( QByteArrayView( data ) );
+	h.addData( QByteArrayView( reinterpret_cast< const char * >( params ), qsizetype( sizeof( params ) ) ) );
+
+	return h.result();
+}
+
+static QString getCubeMapCachePath( const QByteArray & key )
+{
+	static const QString	cacheDir = QStandardPaths::writableLocation( QStandardPaths::CacheLocation );
+	if ( cacheDir.isEmpty() )
+		return QString();
+
+	return cacheDir + "/cubemaps/" + QString::fromLatin1( key.toHex() );
+}
+
+static bool findCachedCubeMaps( CachedCubeMaps & c, const QByteArray & key )
+{
+	std::lock_guard< std::mutex >	lock( cubeMapMemoryCacheMutex );
+	auto	i = cubeMapMemoryCache.constFind( key );
+	if ( i == cubeMapMemoryCache.constEnd() )
+		return false;
+	c = i.value();
+	return true;
+}
+
+static void addCachedCubeMaps( const CachedCubeMaps & c, const QByteArray & key )
+{
+	std::lock_guard< std::mutex >	lock( cubeMapMemoryCacheMutex );
+	if ( cubeMapMemoryCache.size() >= cubeMapMemoryCacheMaxEntries && !cubeMapMemoryCache.contains( key ) )
+		cubeMapMemoryCache.erase( cubeMapMemoryCache.begin() );
+	cubeMapMemoryCache.insert( key, c );
 }
 
-GLuint texLoadPBRCubeMap( const NifModel * nif, const QString & filepath, GLenum & target, QByteArray & data, GLuint * id )
+static bool loadCachedCubeMaps( CachedCubeMaps & c, const QString & cachePath )
 {
+	for ( size_t i = 0; i < 2; i++ ) {
+		QFile	f( cachePath + ( i == 0 ? "_s.dds" : "_d.dds" ) );
+		if ( !f.open( QIODevice::ReadOnly ) )
+			return false;
+		( i == 0 ? c.specular : c.diffuse ) = f.readAll();
+	}
+
+	return ( c.specular.size() >= 128 && c.diffuse.size() >= 128 );
+}
+
+static void saveCachedCubeMaps( const CachedCubeMaps & c, const QString & cachePath )
+{
+	QFileInfo	cacheInfo( cachePath );
+	QDir	cacheDir( cacheInfo.path() );
+	if ( !cacheDir.mkpath( "." ) )
+		return;
+
+	for ( size_t i = 0; i < 2; i++ ) {
+		// QSaveFile writes to a temporary file first, so that other instances never read incomplete data
+		QSaveFile	f( cachePath + ( i == 0 ? "_s.dds" : "_d.dds" ) );
+		if ( !f.open( QIODevice::WriteOnly ) )
+			return;
+		const QByteArray &	buf = ( i == 0 ? c.specular : c.diffuse );
+		if ( f.write( buf ) != buf.size() || !f.commit() )
+			return;
+	}
+
+	QFileInfoList	files = cacheDir.entryInfoList( { "*_s.dds" }, QDir::Files, QDir::Time );
+	for ( qsizetype i = cubeMapCacheMaxEntries; i < files.size(); i++ ) {
+		QString	fileName = files.at( i ).filePath();
+		(void) QFile::remove( fileName );
+		fileName.chop( 6 );
+		(void) QFile::remove( fileName + "_d.dds" );
+	}
+}
+
+//! Create the specular and diffuse textures of 'd' from filtered DDS data, returns false if the data is invalid
+static bool loadCubeMapTextures( TexLoadData & d, const CachedCubeMaps & c )
+{
+	d.textures[0] = gli::texture();
+	d.textures[1] = gli::texture();
+	if ( c.specular.size() >= 128 )
+		d.textures[0] = load_if_valid( c.specular.constData(), c.specular.size() );
+	d.isCorrupt = d.textures[0].empty();
+	if ( c.diffuse.size() >= 128 )
+		d.textures[1] = load_if_valid( c.diffuse.constData(), c.diffuse.size() );
+	return !( d.isCorrupt || d.textures[1].empty() );
+}
+
+static void texDecodePBRCubeMap( TexLoadData & d )
+{
+	QByteArray &	data = d.data;
+	d.isDDS = true;
 	if ( data.size() < 148 )
-		return 0;
+		return;
 
 	const unsigned char *	dataPtr = reinterpret_cast< unsigned char * >( data.data() );
 	float	normalizeLevel = 1.0f / 12.0f;
@@ -685,7 +689,7 @@ GLuint texLoadPBRCubeMap( const NifModel * nif, const QString & filepath, GLenum
 		if ( FileBuffer::readUInt64Fast( dataPtr ) == 0x4E41494441523F23ULL ) {	// "#?RADIAN"
 			normalizeLevel = float( ( 16 - TexCache::hdrToneMapLevel ) * ( 16 - TexCache::hdrToneMapLevel ) + 128 );
 			normalizeLevel *= 3.0f / 4096.0f;
-			if ( nif->getBSVersion() >= 170 )	// not Fallout 76
+			if ( d.bsVersion >= 170 )	// not Fallout 76
 				break;
 			for ( size_t i = 0; i <= 144; i++ ) {
 				std::uint32_t	tmp = FileBuffer::readUInt32Fast( dataPtr + i );
@@ -706,48 +710,39 @@ GLuint texLoadPBRCubeMap( const NifModel * nif, const QString & filepath, GLenum
 				break;
 			}
 		}
-		return 0;
+		return;
 	} while ( false );
 
-	if ( !filterDisabled ) {
-		std::uint32_t	width = std::uint32_t( TexCache::pbrCubeMapResolution );
-		sfCubeMapCache.setOutputWidth( width );
-		sfCubeMapCache.setRoughnessTable( nullptr, 7 );
-		sfCubeMapCache.setNormalizeLevel( normalizeLevel );
-		sfCubeMapCache.setImportanceSamplingQuality( TexCache::pbrImportanceSamples );
-		size_t	dataSize = size_t( data.size() );
-		size_t	spaceRequired = width * width * 8 * 4 + 148;
-		if ( data.size() < qsizetype(spaceRequired) )
-			data.resize( spaceRequired );
-		size_t	newSize = sfCubeMapCache.convertImage( reinterpret_cast< unsigned char * >(data.data()), dataSize,
-														true, spaceRequired, TexCache::hdrToneMapLevel );
-		data.resize( newSize );
+	QByteArray	key = getCubeMapCacheKey( data, filterDisabled, normalizeLevel );
+	CachedCubeMaps	c;
+	if ( findCachedCubeMaps( c, key ) && loadCubeMapTextures( d, c ) )
+		return;
+	QString	cachePath = getCubeMapCachePath( key );
+	if ( !cachePath.isEmpty() && loadCachedCubeMaps( c, cachePath ) && loadCubeMapTextures( d, c ) ) {
+		addCachedCubeMaps( c, key );
+		return;
 	}
 
-	{
-		// generate and load second cube map for diffuse lighting
-		std::uint32_t	width = 32;
-		QByteArray	tmpData( data );
-		size_t	dataSize = size_t( tmpData.size() );
-		size_t	spaceRequired = width * width * 8 * 4 + 148;
-		if ( tmpData.size() < qsizetype(spaceRequired) )
-			tmpData.resize( spaceRequired );
-		static const float  roughnessDiffuse = 1.0f;
-		sfCubeMapCache.setOutputWidth( width );
-		sfCubeMapCache.setRoughnessTable( &roughnessDiffuse, 1 );
-		sfCubeMapCache.setImportanceSamplingQuality( -1 );
-		size_t	newSize = sfCubeMapCache.convertImage( reinterpret_cast< unsigned char * >(tmpData.data()), dataSize,
-														true, spaceRequired );
-		tmpData.resize( newSize );
-		(void) texLoadDDS( filepath, target, tmpData, id + 1 );
+	CubeMapFilterSettings	s;
+	s.resolution = TexCache::pbrCubeMapResolution;
+	s.importanceSamples = TexCache::pbrImportanceSamples;
+	s.hdrToneMapLevel = TexCache::hdrToneMapLevel;
+	s.normalizeLevel = normalizeLevel;
+	s.filterDisabled = filterDisabled;
+	// on failure, the textures are still loaded from the results so that the image is reported as corrupt
+	(void) filterPBRCubeMap( c.specular, c.diffuse, data, s );
+	if ( loadCubeMapTextures( d, c ) ) {
+		addCachedCubeMaps( c, key );
+		if ( !cachePath.isEmpty() )
+			saveCachedCubeMaps( c, cachePath );
 	}
-
-	return texLoadDDS( filepath, target, data, id );
 }
 
-GLuint texLoadColor( const NifModel * nif, const QString & filepath, GLenum & target, GLuint & width, GLuint & height, QByteArray & data, GLuint * id )
+static void texDecodeColor( TexLoadData & d )
 {
 	// generate 1x1 texture from an RGBA color in "#AABBGGRR" format
+	const QString &	filepath = d.filepath;
+	QByteArray &	data = d.data;
 	QChar	c;
 	if ( filepath.length() >= 10 )
 		c = filepath.back().toLower();
@@ -758,8 +753,6 @@ GLuint texLoadColor( const NifModel * nif, const QString & filepath, GLenum & ta
 		unsigned short	tmp = filepath.at( i ).toLower().unicode();
 		color = color | ( ( tmp + ( (tmp >> 6) * 9 ) ) & 0x0F );
 	}
-	width = 1;
-	height = 1;
 	int	n = ( !isCubeMap ? 1 : 6 );
 	data.resize( n * 4 + 148 );
 	unsigned char	dxgiFmt = 0x1C;		// DXGI_FORMAT_R8G8B8A8_UNORM
@@ -774,9 +767,13 @@ GLuint texLoadColor( const NifModel * nif, const QString & filepath, GLenum & ta
 	for ( int i = 0; i < n; i++ )
 		FileBuffer::writeUInt32Fast( dataPtr + ( 148 + (i << 2) ), color );
 
-	if ( isCubeMap && nif && nif->getBSVersion() >= 151 )
-		return texLoadPBRCubeMap( nif, filepath, target, data, id );
-	return texLoadDDS( filepath, target, data, id );
+	if ( isCubeMap && d.bsVersion >= 151 ) {
+		texDecodePBRCubeMap( d );
+		return;
+	}
+	d.isDDS = true;
+	d.textures[0] = load_if_valid( data.constData(), data.size() );
+	d.isCorrupt = d.textures[0].empty();
 }
 
 // (public function, documented in gltexloaders.h)
@@ -974,6 +971,14 @@ void initializeTextureLoaders( [[maybe_unused]] const QOpenGLContext * context )
 		glTexStorage2D = (PFNGLTEXSTORAGE2DPROC)context->getProcAddress( "glTexStorage2D" );
 		if ( !glTexStorage2D )
 			extStorageSupported = false;
+		pboGenBuffers = (PFNGLGENBUFFERSPROC)context->getProcAddress( "glGenBuffers" );
+		pboBindBuffer = (PFNGLBINDBUFFERPROC)context->getProcAddress( "glBindBuffer" );
+		pboBufferData = (PFNGLBUFFERDATAPROC)context->getProcAddress( "glBufferData" );
+		pboMapBuffer = (PFNGLMAPBUFFERPROC)context->getProcAddress( "glMapBuffer" );
+		pboUnmapBuffer = (PFNGLUNMAPBUFFERPROC)context->getProcAddress( "glUnmapBuffer" );
+		if ( !( pboGenBuffers && pboBindBuffer && pboBufferData && pboMapBuffer && pboUnmapBuffer ) )
+			pboGenBuffers = nullptr;
+		glCopyImageSubData = (PFNGLCOPYIMAGESUBDATAPROC)context->getProcAddress( "glCopyImageSubData" );
 #endif
 #ifdef Q_OS_WIN32
 		glCompressedTexSubImage2D = (PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC)context->getProcAddress( "glCompressedTexSubImage2D" );
@@ -986,22 +991,113 @@ void initializeTextureLoaders( [[maybe_unused]] const QOpenGLContext * context )
 	}
 }
 
-//! Create texture with glTexStorage2D using GLI
-GLuint GLI_create_texture( gli::texture& texture, GLenum& target, GLuint * id )
+// (public function, documented in gltexloaders.h)
+size_t texGetMemoryUsage( GLenum target )
+{
+	GLenum	t = target;
+	size_t	faces = 1;
+	if ( target == GL_TEXTURE_CUBE_MAP ) {
+		t = GL_TEXTURE_CUBE_MAP_POSITIVE_X;
+		faces = 6;
+	}
+
+	GLint	isCompressed = 0;
+	glGetTexLevelParameteriv( t, 0, GL_TEXTURE_COMPRESSED, &isCompressed );
+	size_t	bitsPerPixel = 0;
+	if ( !isCompressed ) {
+		static const GLenum	componentSizes[7] = {
+			GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE,
+			GL_TEXTURE_LUMINANCE_SIZE, GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_SHARED_SIZE
+		};
+		for ( GLenum c : componentSizes ) {
+			GLint	tmp = 0;
+			glGetTexLevelParameteriv( t, 0, c, &tmp );
+			bitsPerPixel += size_t( std::max< GLint >( tmp, 0 ) );
+		}
+	}
+
+	size_t	n = 0;
+	for ( GLint level = 0; level < 16; level++ ) {
+		GLint	w = 0;
+		GLint	h = 0;
+		glGetTexLevelParameteriv( t, level, GL_TEXTURE_WIDTH, &w );
+		glGetTexLevelParameteriv( t, level, GL_TEXTURE_HEIGHT, &h );
+		if ( w <= 0 || h <= 0 )
+			break;
+		if ( isCompressed ) {
+			GLint	tmp = 0;
+			glGetTexLevelParameteriv( t, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &tmp );
+			n += size_t( std::max< GLint >( tmp, 0 ) );
+		} else {
+			n += ( size_t( w ) * size_t( h ) * bitsPerPixel + 7 ) >> 3;
+		}
+	}
+
+	return n * faces;
+}
+
+// (public function, documented in gltexloaders.h)
+GLuint texDropMipLevels( [[maybe_unused]] GLuint * id, [[maybe_unused]] GLenum target,
+							[[maybe_unused]] GLuint mipmaps, [[maybe_unused]] GLuint levelsToDrop )
+{
+#ifndef __APPLE__
+	if ( !( glCopyImageSubData && extStorageSupported ) || target != GL_TEXTURE_2D )
+		return 0;
+	if ( levelsToDrop < 1 || mipmaps <= levelsToDrop )
+		return 0;
+
+	glBindTexture( target, id[0] );
+	GLint	w = 0;
+	GLint	h = 0;
+	GLint	internalFormat = 0;
+	GLint	swizzle[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+	glGetTexLevelParameteriv( target, GLint( levelsToDrop ), GL_TEXTURE_WIDTH, &w );
+	glGetTexLevelParameteriv( target, GLint( levelsToDrop ), GL_TEXTURE_HEIGHT, &h );
+	glGetTexLevelParameteriv( target, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat );
+	glGetTexParameteriv( target, GL_TEXTURE_SWIZZLE_RGBA, swizzle );
+	if ( w <= 0 || h <= 0 || !internalFormat )
+		return 0;
+
+	GLuint	newMipmaps = mipmaps - levelsToDrop;
+	GLuint	newID = 0;
+	glGenTextures( 1, &newID );
+	glBindTexture( target, newID );
+	glTexParameteri( target, GL_TEXTURE_BASE_LEVEL, 0 );
+	glTexParameteri( target, GL_TEXTURE_MAX_LEVEL, GLint( newMipmaps - 1 ) );
+	glTexParameteriv( target, GL_TEXTURE_SWIZZLE_RGBA, swizzle );
+	glTexStorage2D( target, GLsizei( newMipmaps ), GLenum( internalFormat ), w, h );
+	for ( GLuint i = 0; i < newMipmaps; i++ ) {
+		GLsizei	levelWidth = std::max< GLsizei >( w >> i, 1 );
+		GLsizei	levelHeight = std::max< GLsizei >( h >> i, 1 );
+		glCopyImageSubData( id[0], target, GLint( levelsToDrop + i ), 0, 0, 0,
+							newID, target, GLint( i ), 0, 0, 0, levelWidth, levelHeight, 1 );
+	}
+
+	glDeleteTextures( 1, id );
+	id[0] = newID;
+
+	return newMipmaps;
+#else
+	return 0;
+#endif
+}
+
+//! Create texture with glTexStorage2D from image data in the gli::texture layout
+static GLuint texCreateStorage( const DDSImageView & img, GLenum & target, GLuint * id )
 {
 	if ( !extStorageSupported )
 		return 0;
 
 	gli::gl glProfile( gli::gl::PROFILE_GL33 );
-	gli::gl::format const format = glProfile.translate( texture.format(), texture.swizzles() );
-	target = glProfile.translate( texture.target() );
+	gli::gl::format const format = glProfile.translate( img.format, img.swizzles );
+	target = glProfile.translate( img.target );
 
 	if ( !id[0] )
 		glGenTextures( 1, id );
 	glBindTexture( target, id[0] );
 	glTexParameteri( target, GL_TEXTURE_BASE_LEVEL, 0 );
-	glTexParameteri( target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels() - 1) );
-	if ( gli::component_count(texture.format()) == 1 ) {
+	glTexParameteri( target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(img.levels - 1) );
+	if ( gli::component_count(img.format) == 1 ) {
 		glTexParameteri( target, GL_TEXTURE_SWIZZLE_R, format.Swizzles[0] );
 		glTexParameteri( target, GL_TEXTURE_SWIZZLE_G, format.Swizzles[0] );
 		glTexParameteri( target, GL_TEXTURE_SWIZZLE_B, format.Swizzles[0] );
@@ -1013,71 +1109,90 @@ GLuint GLI_create_texture( gli::texture& texture, GLenum& target, GLuint * id )
 		glTexParameteri( target, GL_TEXTURE_SWIZZLE_A, format.Swizzles[3] );
 	}
 
-	glm::tvec3<GLsizei> const textureExtent( texture.extent() );
-
-	switch ( texture.target() ) {
+	switch ( img.target ) {
 	case gli::TARGET_2D:
 	case gli::TARGET_CUBE:
-		glTexStorage2D( target, static_cast<GLint>(texture.levels()), format.Internal,
-						textureExtent.x, textureExtent.y
+		glTexStorage2D( target, static_cast<GLint>(img.levels), format.Internal,
+						static_cast<GLsizei>(img.width), static_cast<GLsizei>(img.height)
 		);
 		break;
 	default:
 		return 0;
 	}
 
-	for ( size_t layer = 0; layer < texture.layers(); ++layer )
-	for ( size_t face = 0; face < texture.faces(); ++face )
-	for ( size_t level = 0; level < texture.levels(); ++level ) {
-		glm::tvec3<GLsizei> textureLevelExtent( texture.extent( level ) );
-		switch ( texture.target() ) {
-		case gli::TARGET_2D:
-		case gli::TARGET_CUBE:
-			if ( gli::is_compressed( texture.format() ) )
-				glCompressedTexSubImage2D(
-					gli::is_target_cube( texture.target() ) ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face)
-					: target,
-					static_cast<GLint>(level),
-					0, 0,
-					textureLevelExtent.x, textureLevelExtent.y,
-					format.Internal, static_cast<GLsizei>(texture.size( level )),
-					texture.data( layer, face, level ) );
-			else
-				glTexSubImage2D(
-					gli::is_target_cube( texture.target() ) ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face)
-					: target,
-					static_cast<GLint>(level),
-					0, 0,
-					textureLevelExtent.x, textureLevelExtent.y,
-					format.External, format.Type,
-					texture.data( layer, face, level ) );
-			break;
-		default:
-			return 0;
+	// copy the image data to a pixel buffer object, so that the driver can transfer it asynchronously
+	const unsigned char *	srcData = img.data;
+	size_t	dataSize = img.size();
+	bool	usePBO = false;
+#ifndef __APPLE__
+	if ( pboGenBuffers && dataSize >= 65536 ) {
+		if ( !pixelUnpackBuffer )
+			pboGenBuffers( 1, &pixelUnpackBuffer );
+		pboBindBuffer( GL_PIXEL_UNPACK_BUFFER, pixelUnpackBuffer );
+		// orphan the previous buffer storage, which may still be in use by an earlier upload
+		pboBufferData( GL_PIXEL_UNPACK_BUFFER, GLsizeiptr( dataSize ), nullptr, GL_STREAM_DRAW );
+		if ( void * p = pboMapBuffer( GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY ) ) {
+			std::memcpy( p, srcData, dataSize );
+			usePBO = bool( pboUnmapBuffer( GL_PIXEL_UNPACK_BUFFER ) );
 		}
+		if ( !usePBO )
+			pboBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
 	}
+#endif
+
+	bool	isCompressed = gli::is_compressed( img.format );
+	bool	isCubeMap = gli::is_target_cube( img.target );
+	for ( size_t layer = 0; layer < img.layers; ++layer )
+	for ( size_t face = 0; face < img.faces; ++face )
+	for ( size_t level = 0; level < img.levels; ++level ) {
+		size_t	levelOffset = img.offset( layer, face, level );
+		// offset in the pixel buffer object, or pointer to the data in memory
+		const void *	levelData = reinterpret_cast< const void * >( usePBO ? levelOffset : std::uintptr_t( srcData + levelOffset ) );
+		GLenum	levelTarget = ( isCubeMap ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face) : target );
+		if ( isCompressed )
+			glCompressedTexSubImage2D(
+				levelTarget,
+				static_cast<GLint>(level),
+				0, 0,
+				static_cast<GLsizei>(img.levelWidth( level )), static_cast<GLsizei>(img.levelHeight( level )),
+				format.Internal, static_cast<GLsizei>(img.levelSize( level )),
+				levelData );
+		else
+			glTexSubImage2D(
+				levelTarget,
+				static_cast<GLint>(level),
+				0, 0,
+				static_cast<GLsizei>(img.levelWidth( level )), static_cast<GLsizei>(img.levelHeight( level )),
+				format.External, format.Type,
+				levelData );
+	}
+
+#ifndef __APPLE__
+	if ( usePBO )
+		pboBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+#endif
 
 	return id[0];
 }
 
 //! Fallback for systems that do not have glTexStorage2D
-GLuint GLI_create_texture_fallback( gli::texture& texture, GLenum & target, GLuint * id )
+static GLuint texCreateFallback( const DDSImageView & img, GLenum & target, GLuint * id )
 {
-	if ( texture.empty() )
+	if ( img.empty() )
 		return 0;
 
 	gli::gl GL( gli::gl::PROFILE_GL33 );
-	gli::gl::format const fmt = GL.translate( texture.format(), texture.swizzles() );
-	target = GL.translate( texture.target() );
+	gli::gl::format const fmt = GL.translate( img.format, img.swizzles );
+	target = GL.translate( img.target );
 
 	if ( !id[0] )
 		glGenTextures( 1, id );
 	glBindTexture( target, id[0] );
 	// Base and max level are not supported by OpenGL ES 2.0
 	glTexParameteri( target, GL_TEXTURE_BASE_LEVEL, 0 );
-	glTexParameteri( target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels() - 1) );
+	glTexParameteri( target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(img.levels - 1) );
 	// Texture swizzle is not supported by OpenGL ES 2.0 and OpenGL 3.2
-	if ( gli::component_count(texture.format()) == 1 ) {
+	if ( gli::component_count(img.format) == 1 ) {
 		glTexParameteri( target, GL_TEXTURE_SWIZZLE_R, fmt.Swizzles[0] );
 		glTexParameteri( target, GL_TEXTURE_SWIZZLE_G, fmt.Swizzles[0] );
 		glTexParameteri( target, GL_TEXTURE_SWIZZLE_B, fmt.Swizzles[0] );
@@ -1089,33 +1204,35 @@ GLuint GLI_create_texture_fallback( gli::texture& texture, GLenum & target, GLui
 		glTexParameteri( target, GL_TEXTURE_SWIZZLE_A, fmt.Swizzles[3] );
 	}
 
-	for ( std::size_t layer = 0; layer < texture.layers(); ++layer )
-	for ( std::size_t face = 0; face < texture.faces(); ++face )
-	for ( std::size_t level = 0; level < texture.levels(); ++level ) {
-		glm::tvec3<GLsizei> extent( texture.extent( level ) );
-		switch ( texture.target() ) {
+	for ( std::size_t layer = 0; layer < img.layers; ++layer )
+	for ( std::size_t face = 0; face < img.faces; ++face )
+	for ( std::size_t level = 0; level < img.levels; ++level ) {
+		GLsizei	w = static_cast<GLsizei>(img.levelWidth( level ));
+		GLsizei	h = static_cast<GLsizei>(img.levelHeight( level ));
+		const unsigned char *	levelData = img.data + img.offset( layer, face, level );
+		switch ( img.target ) {
 		case gli::TARGET_2D:
 		case gli::TARGET_CUBE:
-			if ( gli::is_compressed( texture.format() ) )
+			if ( gli::is_compressed( img.format ) )
 				glCompressedTexImage2D(
-					gli::is_target_cube( texture.target() ) ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face)
+					gli::is_target_cube( img.target ) ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face)
 					: target,
 					static_cast<GLint>(level),
 					fmt.Internal,
-					extent.x, extent.y,
+					w, h,
 					0,
-					static_cast<GLsizei>(texture.size( level )),
-					texture.data( layer, face, level ) );
+					static_cast<GLsizei>(img.levelSize( level )),
+					levelData );
 			else
 				glTexImage2D(
-					gli::is_target_cube( texture.target() ) ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face)
+					gli::is_target_cube( img.target ) ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face)
 					: target,
 					static_cast<GLint>(level),
 					fmt.Internal,
-					extent.x, extent.y,
+					w, h,
 					0,
 					fmt.External, fmt.Type,
-					texture.data( layer, face, level ) );
+					levelData );
 			break;
 		default:
 			return 0;
@@ -1124,14 +1241,85 @@ GLuint GLI_create_texture_fallback( gli::texture& texture, GLenum & target, GLui
 	return id[0];
 }
 
-//! Rewrite of gli::load_dds to not crash on invalid textures
-gli::texture load_if_valid( const char * data, unsigned int size )
+//! Create texture with glTexStorage2D using GLI
+GLuint GLI_create_texture( gli::texture& texture, GLenum& target, GLuint * id )
+{
+	DDSImageView	img;
+	img.setTexture( texture );
+	return texCreateStorage( img, target, id );
+}
+
+//! Fallback for systems that do not have glTexStorage2D
+GLuint GLI_create_texture_fallback( gli::texture& texture, GLenum & target, GLuint * id )
+{
+	DDSImageView	img;
+	img.setTexture( texture );
+	return texCreateFallback( img, target, id );
+}
+
+/*
+ * DDSImageView
+ */
+
+size_t DDSImageView::levelSize( size_t level ) const
+{
+	gli::extent3d	blockExtent = gli::block_extent( format );
+	size_t	w = ( size_t( levelWidth( level ) ) + size_t( blockExtent.x ) - 1 ) / size_t( blockExtent.x );
+	size_t	h = ( size_t( levelHeight( level ) ) + size_t( blockExtent.y ) - 1 ) / size_t( blockExtent.y );
+	size_t	d = ( size_t( std::max< std::uint32_t >( depth >> level, 1U ) ) + size_t( blockExtent.z ) - 1 ) / size_t( blockExtent.z );
+	return w * h * d * size_t( gli::block_size( format ) );
+}
+
+size_t DDSImageView::faceSize() const
+{
+	size_t	n = 0;
+	for ( size_t level = 0; level < levels; level++ )
+		n += levelSize( level );
+	return n;
+}
+
+size_t DDSImageView::offset( size_t layer, size_t face, size_t level ) const
+{
+	size_t	n = faceSize() * ( layer * faces + face );
+	for ( size_t i = 0; i < level; i++ )
+		n += levelSize( i );
+	return n;
+}
+
+void DDSImageView::setTexture( const gli::texture & texture )
+{
+	if ( texture.empty() ) {
+		clear();
+		return;
+	}
+	data = reinterpret_cast< const unsigned char * >( texture.data() );
+	format = texture.format();
+	target = texture.target();
+	swizzles = texture.swizzles();
+	width = std::uint32_t( texture.extent().x );
+	height = std::uint32_t( texture.extent().y );
+	depth = std::uint32_t( texture.extent().z );
+	layers = std::uint32_t( texture.layers() );
+	faces = std::uint32_t( texture.faces() );
+	levels = std::uint32_t( texture.levels() );
+}
+
+void DDSImageView::clear()
+{
+	*this = DDSImageView();
+}
+
+bool DDSImageView::parse( const char * fileData, size_t fileSize )
 {
 	using namespace gli;
 	using namespace gli::detail;
 
-	if ( strncmp( data, FOURCC_DDS, 4 ) != 0 || size < sizeof( dds_header ) )
-		return texture();
+	// note: 'format' and 'target' refer to the members of DDSImageView, the gli types need to be qualified
+
+	clear();
+	const char *	data = fileData;
+	if ( fileSize < ( sizeof( FOURCC_DDS ) + sizeof( dds_header ) ) || strncmp( data, FOURCC_DDS, 4 ) != 0 )
+		return false;
 
 	std::size_t Offset = sizeof( FOURCC_DDS );
 
@@ -1140,14 +1328,16 @@ gli::texture load_if_valid( const char * data, unsigned int size )
 
 	dds_header10 Header10;
 	if ( (Header.Format.flags & dx::DDPF_FOURCC) && (Header.Format.fourCC == dx::D3DFMT_DX10 || Header.Format.fourCC == dx::D3DFMT_GLI1) ) {
+		if ( fileSize < ( Offset + sizeof( dds_header10 ) ) )
+			return false;
 		std::memcpy( &Header10, data + Offset, sizeof( Header10 ) );
 		Offset += sizeof( dds_header10 );
 	}
 
 	dx DX;
 
-	format Format( static_cast<format>(FORMAT_UNDEFINED) );
-	if ( (Header.Format.flags & (dx::DDPF_RGB | dx::DDPF_ALPHAPIXELS | dx::DDPF_ALPHA | dx::DDPF_YUV | dx::DDPF_LUMINANCE | 0x00080000)) && Format == static_cast<format>(gli::FORMAT_UNDEFINED) && Header.Format.bpp != 0 ) {
+	gli::format Format( static_cast<gli::format>(FORMAT_UNDEFINED) );
+	if ( (Header.Format.flags & (dx::DDPF_RGB | dx::DDPF_ALPHAPIXELS | dx::DDPF_ALPHA | dx::DDPF_YUV | dx::DDPF_LUMINANCE | 0x00080000)) && Format == static_cast<gli::format>(gli::FORMAT_UNDEFINED) && Header.Format.bpp != 0 ) {
 		switch ( Header.Format.bpp ) {
 		default:
 			break;
@@ -1218,14 +1408,14 @@ gli::texture load_if_valid( const char * data, unsigned int size )
 				break;
 			}
 		}
-	} else if ( (Header.Format.flags & dx::DDPF_FOURCC) && (Header.Format.fourCC != dx::D3DFMT_DX10) && (Header.Format.fourCC != dx::D3DFMT_GLI1) && (Format == static_cast<format>(gli::FORMAT_UNDEFINED)) ) {
+	} else if ( (Header.Format.flags & dx::DDPF_FOURCC) && (Header.Format.fourCC != dx::D3DFMT_DX10) && (Header.Format.fourCC != dx::D3DFMT_GLI1) && (Format == static_cast<gli::format>(gli::FORMAT_UNDEFINED)) ) {
 		dx::d3dfmt const FourCC = remap_four_cc( Header.Format.fourCC );
 		Format = DX.find( FourCC );
 	} else if ( Header.Format.fourCC == dx::D3DFMT_DX10 || Header.Format.fourCC == dx::D3DFMT_GLI1 )
 		Format = DX.find( Header.Format.fourCC, Header10.Format );
 
-	if ( Format == static_cast<format>(FORMAT_UNDEFINED) )
-		return texture();
+	if ( Format == static_cast<gli::format>(FORMAT_UNDEFINED) )
+		return false;
 
 	size_t const MipMapCount = (Header.Flags & DDSD_MIPMAPCOUNT) ? Header.MipMapLevels : 1;
 	size_t FaceCount = 1;
@@ -1236,76 +1426,212 @@ gli::texture load_if_valid( const char * data, unsigned int size )
 	if ( Header.CubemapFlags & DDSCAPS2_VOLUME )
 		DepthCount = Header.Depth;
 
+	if ( !( Header.Width && Header.Height && DepthCount && FaceCount && MipMapCount ) || MipMapCount > 16 )
+		return false;
+
+	format = Format;
+	target = get_target( Header, Header10 );
+	width = std::uint32_t( Header.Width );
+	height = std::uint32_t( Header.Height );
+	depth = std::uint32_t( DepthCount );
+	layers = std::max< std::uint32_t >( std::uint32_t( Header10.ArraySize ), 1U );
+	faces = std::uint32_t( FaceCount );
+	levels = std::uint32_t( MipMapCount );
+
+	if ( size() > ( fileSize - Offset ) ) {
+		clear();
+		return false;
+	}
+	data = reinterpret_cast< const unsigned char * >( fileData + Offset );
+
+	return true;
+}
+
+//! Rewrite of gli::load_dds to not crash on invalid textures
+gli::texture load_if_valid( const char * data, unsigned int size )
+{
+	using namespace gli;
+
+	DDSImageView	img;
+	if ( !img.parse( data, size ) )
+		return texture();
+
 	texture Texture(
-		get_target( Header, Header10 ), Format,
-		texture::extent_type( Header.Width, Header.Height, DepthCount ),
-		std::max<texture::size_type>( Header10.ArraySize, 1 ), FaceCount, MipMapCount );
+		img.target, img.format, texture::extent_type( img.width, img.height, img.depth ), img.layers, img.faces, img.levels );
 
-	std::size_t const SourceSize = Offset + Texture.size();
+	std::size_t const SourceSize = std::size_t( img.data - reinterpret_cast< const unsigned char * >( data ) ) + Texture.size();
 	if ( SourceSize > size )
 		return texture();
 
-	std::memcpy( Texture.data(), data + Offset, Texture.size() );
+	std::memcpy( Texture.data(), img.data, Texture.size() );
 
 	return Texture;
 }
 
 
-static void extract_pbr_lut_data( QByteArray & data )
+static QByteArray create_pbr_lut_data()
 {
-	static QByteArray	pbrLUTData;
-	if ( pbrLUTData.isEmpty() ) {
-		SF_PBR_Tables	pbrLUT( 512, 4096 );
-		pbrLUTData.resize( qsizetype( pbrLUT.getImageData().size() ) );
-		std::memcpy( pbrLUTData.data(), pbrLUT.getImageData().data(), pbrLUT.getImageData().size() );
-	}
-	data = pbrLUTData;
+	SF_PBR_Tables	pbrLUT( 512, 4096 );
+	QByteArray	pbrLUTData;
+	pbrLUTData.resize( qsizetype( pbrLUT.getImageData().size() ) );
+	std::memcpy( pbrLUTData.data(), pbrLUT.getImageData().data(), pbrLUT.getImageData().size() );
+	return pbrLUTData;
 }
 
-GLuint texLoad( const NifModel * nif, const QString & filepath, TexCache::TexFmt & format, GLenum & target, GLuint & width, GLuint & height, GLuint * id )
+static inline bool isColorTexture( const QString & filepath )
 {
-	width = height = 0;
-	GLuint	mipmaps = 0;
+	return ( filepath.startsWith('#') && (filepath.length() == 9 || filepath.length() == 10) );
+}
 
-	QByteArray	data;
-	if ( filepath.startsWith('#') && (filepath.length() == 9 || filepath.length() == 10) ) {
-		if ( filepath == "#sfpbr.dds" )
-			extract_pbr_lut_data( data );
-		else
-			return texLoadColor( nif, filepath, target, width, height, data, id );
-	} else {
-		bool	fileFound;
-		if ( !nif )
-			fileFound = Game::GameManager::get_file( data, Game::OTHER, filepath, "textures", "" );
-		else
-			fileFound = nif->getResourceFile( data, filepath, "textures", "" );
-		if ( !fileFound )
-			throw QString( "could not open file" );
-	}
+// (public function, documented in gltexloaders.h)
+bool texLoadFind( TexLoadData & d, const NifModel * nif )
+{
+	d.bsVersion = ( nif ? nif->getBSVersion() : 0 );
+	d.fileRef.clear();
+	d.isStale = false;
+	if ( isColorTexture( d.filepath ) )
+		return true;
+
+	std::string	fullPath( Game::GameManager::get_full_path( d.filepath, "textures", "" ) );
+	if ( !nif )
+		return Game::GameManager::find_file_ref( d.fileRef, Game::OTHER, fullPath );
+	return nif->findResourceFileRef( d.fileRef, fullPath );
+}
 
-	if ( data.isEmpty() )
-		return 0;
+// decode the data read by texLoadDecode()
+static void texDecodeFileData( TexLoadData & d )
+{
+	const QString &	filepath = d.filepath;
+	QByteArray &	data = d.data;
 
-	if ( filepath.endsWith( ".dds", Qt::CaseInsensitive ) || ( filepath.endsWith( ".hdr", Qt::CaseInsensitive ) && nif && nif->getBSVersion() >= 151 ) ) {
+	if ( filepath.endsWith( ".dds", Qt::CaseInsensitive ) || ( filepath.endsWith( ".hdr", Qt::CaseInsensitive ) && d.bsVersion >= 151 ) ) {
 		bool	isCubeMap = false;
 		if ( data.size() >= 148 ) {
 			if ( FileBuffer::readUInt32Fast( data.data() ) == 0x20534444 ) {	// "DDS "
 				if ( data.data()[113] & 0x02 ) {	// DDSCAPS2_CUBEMAP
 					isCubeMap = true;
-					if ( nif->getBSVersion() < 170 && FileBuffer::readUInt32Fast( data.data() + 84 ) == 0x30315844 && data.data()[128] == 0x57 )
+					if ( d.bsVersion < 170 && FileBuffer::readUInt32Fast( data.data() + 84 ) == 0x30315844 && data.data()[128] == 0x57 )
 						data[128] = 0x5B;	// Fallout 76: DXGI_FORMAT_B8G8R8A8_UNORM -> DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
 				}
 			} else if ( FileBuffer::readUInt64Fast( data.data() ) == 0x4E41494441523F23ULL ) {	// "#?RADIAN"
 				isCubeMap = true;
 			}
 		}
-		if ( isCubeMap && nif && nif->getBSVersion() >= 151 ) {
-			mipmaps = texLoadPBRCubeMap( nif, filepath, target, data, id );
+		if ( isCubeMap && d.bsVersion >= 151 ) {
+			texDecodePBRCubeMap( d );
 		} else {
-			mipmaps = texLoadDDS( filepath, target, data, id );
+			d.isDDS = true;
+			if ( data.size() >= 128 ) {
+				// upload directly from the file data if possible, which avoids a copy of all mip levels
+				if ( d.ddsImage.parse( data.constData(), size_t( data.size() ) ) && canUploadDirectly( d.ddsImage ) )
+					return;
+				d.ddsImage.clear();
+				d.textures[0] = load_if_valid( data.constData(), data.size() );
+				d.isCorrupt = d.textures[0].empty();
+			}
+		}
+		// the raw data is no longer needed
+		data.clear();
+		d.fileData.clear();
+	}
+	// other formats are converted while uploading
+}
+
+// (public function, documented in gltexloaders.h)
+void texLoadDecode( TexLoadData & d )
+{
+	const QString &	filepath = d.filepath;
+	QByteArray &	data = d.data;
+	QElapsedTimer	t;
+	t.start();
+
+	if ( isColorTexture( filepath ) ) {
+		if ( filepath != "#sfpbr.dds" ) {
+			texDecodeColor( d );
+			return;
 		}
+		static const QByteArray	pbrLUTData( create_pbr_lut_data() );
+		data = pbrLUTData;
 	} else {
-		QBuffer f( &data );
+		// loose files are memory mapped, 'data' refers to the mapping without copying it
+		std::string	errorMessage;
+		bool	readOk = Game::GameManager::read_file( d.fileData, d.fileRef, &errorMessage );
+		d.readTime = std::uint32_t( std::min< qint64 >( t.nsecsElapsed() / 1000, 0xFFFFFFFF ) );
+		if ( !readOk ) {
+			if ( errorMessage.empty() && !Game::GameManager::is_valid_file_ref( d.fileRef ) )
+				d.isStale = true;
+			else if ( errorMessage.empty() )
+				d.error = "could not open file";
+			else
+				d.error = QString::fromStdString( errorMessage );
+			return;
+		}
+		data = d.fileData.byteArray();
+	}
+
+	if ( data.isEmpty() )
+		return;
+
+	if ( d.hashContent ) {
+		// the extension and BS version are included, because they affect how the data is decoded
+		QCryptographicHash	h( QCryptographicHash::Sha1 );
+		h.addData( QByteArrayView( data ) );
+		h.addData( filepath.mid( filepath.lastIndexOf( QChar('.') ) + 1 ).toLower().toUtf8() );
+		h.addData( QByteArrayView( reinterpret_cast< const char * >( &(d.bsVersion) ), qsizetype( sizeof( quint32 ) ) ) );
+		d.contentHash = h.result();
+	}
+
+	texDecodeFileData( d );
+	d.decodeTime = std::uint32_t( std::min< qint64 >( t.nsecsElapsed() / 1000 - d.readTime, 0xFFFFFFFF ) );
+}
+
+// (public function, documented in gltexloaders.h)
+std::uint32_t texLoadPreviewLevels( const TexLoadData & d, std::uint32_t maxSize )
+{
+	const DDSImageView &	img = d.ddsImage;
+	if ( !d.isDDS || img.empty() || img.target != gli::TARGET_2D || img.faces != 1 || img.layers != 1 )
+		return 0;
+
+	std::uint32_t	n = 0;
+	while ( ( n + 1 ) < img.levels && std::max( img.levelWidth( n ), img.levelHeight( n ) ) > maxSize )
+		n++;
+	return n;
+}
+
+// (public function, documented in gltexloaders.h)
+GLuint texLoadUpload( TexLoadData & d, TexCache::TexFmt & format, GLenum & target, GLuint & width, GLuint & height, GLuint * id )
+{
+	width = height = 0;
+	GLuint	mipmaps = 0;
+	const QString &	filepath = d.filepath;
+
+	if ( !d.error.isEmpty() )
+		throw d.error;
+
+	bool	isPreview = false;
+	if ( d.isDDS ) {
+		if ( !d.textures[1].empty() )
+			(void) texUploadDDS( filepath, target, d.textures[1], id + 1 );
+		if ( d.skipLevels > 0 && d.skipLevels < d.ddsImage.levels && d.ddsImage.faces == 1 ) {
+			// the mip levels of a single 2D image are contiguous, the preview is the tail of the mip chain
+			DDSImageView	img( d.ddsImage );
+			img.data = img.data + img.offset( 0, 0, d.skipLevels );
+			img.width = img.levelWidth( d.skipLevels );
+			img.height = img.levelHeight( d.skipLevels );
+			img.levels = img.levels - d.skipLevels;
+			mipmaps = texUploadDDS( filepath, target, img, id );
+			isPreview = true;
+		} else if ( !d.ddsImage.empty() ) {
+			mipmaps = texUploadDDS( filepath, target, d.ddsImage, id );
+		} else if ( !d.textures[0].empty() || d.isCorrupt ) {
+			mipmaps = texUploadDDS( filepath, target, d.textures[0], id );
+		}
+		if ( !isPreview )
+			d.ddsImage.clear();
+	} else if ( d.data.isEmpty() ) {
+		return 0;
+	} else {
+		QBuffer f( &d.data );
 		if ( !f.open( QIODevice::ReadWrite ) )
 			throw QString( "could not open buffer" );
 
@@ -1318,7 +1644,10 @@ GLuint texLoad( const NifModel * nif, const QString & filepath, TexCache::TexFmt
 
 		f.close();
 	}
-	data.clear();
+	if ( !isPreview ) {
+		d.data.clear();
+		d.fileData.clear();
+	}
 
 	if ( !target )
 		target = GL_TEXTURE_2D;
@@ -1361,6 +1690,18 @@ GLuint texLoad( const NifModel * nif, const QString & filepath, TexCache::TexFmt
 	return mipmaps;
 }
 
+// (public function, documented in gltexloaders.h)
+GLuint texLoad( const NifModel * nif, const QString & filepath, TexCache::TexFmt & format, GLenum & target, GLuint & width, GLuint & height, GLuint * id )
+{
+	TexLoadData	d;
+	d.filepath = filepath;
+	if ( !texLoadFind( d, nif ) )
+		throw QString( "could not open file" );
+	texLoadDecode( d );
+
+	return texLoadUpload( d, format, target, width, height, id );
+}
+
 bool texIsSupported( const QString & filepath )
 {
 	return ( filepath.endsWith( ".dds", Qt::CaseInsensitive )
@@ -37,6 +37,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma warning(push, 0)
 #endif
 
+#include "gamemanager.h"
 #include "gl/gltex.h"
 
 #include <gli.hpp>
@@ -45,6 +46,9 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma warning(pop)
 #endif
 
+#include <algorithm>
+#include <cstdint>
+
 class QOpenGLContext;
 class QByteArray;
 class QModelIndex;
@@ -63,6 +67,57 @@ extern GLuint GLI_create_texture_fallback( gli::texture& texture, GLenum & targe
 //! Rewrite of gli::load_dds to not crash on invalid textures
 extern gli::texture load_if_valid( const char * data, unsigned int size );
 
+//! DDS image data referenced in place, without copying it to a gli::texture
+/*!
+ * The images are stored in the same order and with the same sizes as in gli::texture (layer, face, level),
+ * which is also the layout of the DDS format, so the pixel data of a DDS file can be uploaded directly.
+ */
+struct DDSImageView
+{
+	//! Pointer to the first mip level of the first face, nullptr if the view is empty
+	const unsigned char *	data = nullptr;
+	gli::format	format = gli::FORMAT_UNDEFINED;
+	gli::target	target = gli::TARGET_2D;
+	gli::texture::swizzles_type	swizzles = gli::texture::swizzles_type( gli::SWIZZLE_RED, gli::SWIZZLE_GREEN,
+																		gli::SWIZZLE_BLUE, gli::SWIZZLE_ALPHA );
+	std::uint32_t	width = 0;
+	std::uint32_t	height = 0;
+	std::uint32_t	depth = 1;
+	std::uint32_t	layers = 1;
+	std::uint32_t	faces = 1;
+	std::uint32_t	levels = 1;
+
+	inline bool empty() const
+	{
+		return !data;
+	}
+	inline std::uint32_t levelWidth( size_t level ) const
+	{
+		return std::max< std::uint32_t >( width >> level, 1U );
+	}
+	inline std::uint32_t levelHeight( size_t level ) const
+	{
+		return std::max< std::uint32_t >( height >> level, 1U );
+	}
+	//! Size in bytes of a single image at mip level 'level'
+	size_t levelSize( size_t level ) const;
+	//! Size in bytes of all mip levels of one face
+	size_t faceSize() const;
+	//! Total size in bytes of the image data
+	inline size_t size() const
+	{
+		return faceSize() * faces * layers;
+	}
+	//! Offset of an image relative to 'data'
+	size_t offset( size_t layer, size_t face, size_t level ) const;
+
+	//! Parse the header of DDS file data, returns false if the format is not supported or the data is truncated
+	bool parse( const char * fileData, size_t fileSize );
+	//! Refer to the image data of a gli texture
+	void setTexture( const gli::texture & texture );
+	void clear();
+};
+
 //! @file gltexloaders.h Texture loading functions header
 
 /*! A function for loading textures.
@@ -79,6 +134,81 @@ extern gli::texture load_if_valid( const char * data, unsigned int size );
  */
 extern GLuint texLoad( const NifModel * nif, const QString & filepath, TexCache::TexFmt & format, GLenum & target, GLuint & width, GLuint & height, GLuint * id );
 
+//! Texture file loaded in three stages: texLoadFind(), texLoadDecode() and texLoadUpload()
+struct TexLoadData
+{
+	//! The full path to the texture, or a color in the format described for texLoad()
+	QString	filepath;
+	//! BS version of the model the texture is loaded for, 0 if none
+	quint32	bsVersion = 0;
+	//! True if the image was decoded as DDS
+	bool	isDDS = false;
+	//! True if the DDS data is corrupt or unsupported
+	bool	isCorrupt = false;
+	//! The resource file found by texLoadFind()
+	Game::GameManager::FileRef	fileRef;
+	Game::GameManager::FileData	fileData;
+	//! Raw image data of formats that are decoded while uploading (TGA, BMP and NIF)
+	QByteArray	data;
+	//! Decoded DDS textures, the second one is the diffuse cube map generated for PBR environment maps
+	gli::texture	textures[2];
+	//! DDS image uploaded directly from 'data' if it is not empty, this is used instead of textures[0]
+	DDSImageView	ddsImage;
+	//! Number of largest mip levels of ddsImage that texLoadUpload() does not upload, for a low resolution preview
+	std::uint32_t	skipLevels = 0;
+	//! Error message if the file could not be read
+	QString	error;
+	//! True if the archives were reloaded after texLoadFind(), and the file needs to be looked up again
+	bool	isStale = false;
+	//! If true, texLoadDecode() stores a hash of the file data in contentHash
+	bool	hashContent = false;
+	QByteArray	contentHash;
+	//! Time in microseconds spent by texLoadDecode() reading and decoding the file
+	std::uint32_t	readTime = 0;
+	std::uint32_t	decodeTime = 0;
+};
+
+/*! Find the texture file d.filepath in the resources of 'nif' (or the global resources if nif is nullptr).
+ *
+ * This must be called on the main thread. Returns false if the file is not found.
+ */
+extern bool texLoadFind( TexLoadData & d, const NifModel * nif );
+
+/*! Read and decode the texture file previously found with texLoadFind().
+ *
+ * This does not use OpenGL and can be called on a worker thread. Errors are stored in d.error. If the archives
+ * the file was found in have been closed since, d.isStale is set instead, and nothing is read.
+ */
+extern void texLoadDecode( TexLoadData & d );
+
+/*! Create the OpenGL texture(s) from data decoded by texLoadDecode().
+ *
+ * Returns the number of mipmaps on success, and throws a QString otherwise. The parameters are the same as for texLoad().
+ */
+extern GLuint texLoadUpload( TexLoadData & d, TexCache::TexFmt & format, GLenum & target, GLuint & width, GLuint & height, GLuint * id );
+
+/*! Returns the number of mip levels to skip for a preview of the texture decoded by texLoadDecode().
+ *
+ * The largest mip level of the preview is at most 'maxSize' pixels wide and high. Only 2D DDS images
+ * that are uploaded directly from the file data can have a preview, the return value is 0 otherwise.
+ * When texLoadUpload() is called with d.skipLevels set to this value, it keeps the file data, so that
+ * the full resolution texture can be uploaded with a second call after resetting d.skipLevels to 0.
+ */
+extern std::uint32_t texLoadPreviewLevels( const TexLoadData & d, std::uint32_t maxSize );
+
+/*! Estimate the amount of video memory in bytes used by the texture currently bound to 'target'.
+ *
+ * The size of each defined mip level is queried from OpenGL, cube maps include all six faces.
+ */
+extern size_t texGetMemoryUsage( GLenum target );
+
+/*! Replace the 2D texture id[0] with a new texture that does not contain the 'levelsToDrop' largest mip levels.
+ *
+ * The remaining mip levels are copied on the GPU. Returns the new number of mip levels,
+ * or 0 if the texture could not be reduced, in which case it is left unchanged.
+ */
+extern GLuint texDropMipLevels( GLuint * id, GLenum target, GLuint mipmaps, GLuint levelsToDrop );
+
 /*! A function for loading textures.
  *
  * Loads a texture pointed to by model index.
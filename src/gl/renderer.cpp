@@ -53,6 +53,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QSettings>
 #include <QTextStream>
 #include <chrono>
+#include <cstring>
 
 
 //! @file renderer.cpp Renderer and child classes implementation
@@ -182,7 +183,7 @@ const QHash<Renderer::ConditionSingle::Type, QString> Renderer::ConditionSingle:
 	{ NAND, " !& " }
 };
 
-Renderer::ConditionSingle::ConditionSingle( const QString & line, bool neg ) : invert( neg )
+Renderer::ConditionSingle::ConditionSingle( const QString & line, bool neg, Renderer * renderer ) : invert( neg )
 {
 	QHashIterator<Type, QString> i( compStrs );
 	int pos = -1;
@@ -207,90 +208,178 @@ Renderer::ConditionSingle::ConditionSingle( const QString & line, bool neg ) : i
 		left = line;
 		comp = NONE;
 	}
+
+	input = renderer->addConditionInput( left );
+	rightCount = right.toULongLong( nullptr, 0 );
+	rightFloat = float( right.toDouble() );
+	rightUInt = right.toUInt( nullptr, 0 );
 }
 
-QModelIndex Renderer::ConditionSingle::getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlocks, QString blkid ) const
+bool Renderer::ConditionSingle::eval( const QVector<ConditionValue> & values ) const
 {
-	QString childid;
+	const ConditionValue &	v = values.at( input );
 
-	if ( blkid.startsWith( "HEADER/" ) ) {
-		auto blk = blkid.remove( "HEADER/" );
-		if ( blk.contains("/") ) {
-			auto blks = blk.split( "/" );
-			return nif->getIndex( nif->getIndex( nif->getHeaderIndex(), blks.at(0) ), blks.at(1) );
+	if ( v.type == ConditionValue::Missing )
+		return invert;
+
+	if ( comp == NONE )
+		return !invert;
+
+	switch ( v.type ) {
+	case ConditionValue::String:
+		return compare( v.string, right ) ^ invert;
+	case ConditionValue::Count:
+		return compare( v.number, rightCount ) ^ invert;
+	case ConditionValue::Float:
+		return compare( v.floatValue, rightFloat ) ^ invert;
+	case ConditionValue::FileVersion:
+		return compare( quint32( v.number ), quint32( rightUInt ) ) ^ invert;
+	case ConditionValue::VertexFlags:
+		return compare( uint( v.number ), rightUInt ) ^ invert;
+	default:
+		return false;
+	}
+}
+
+bool Renderer::ConditionGroup::eval( const QVector<ConditionValue> & values ) const
+{
+	if ( conditions.isEmpty() )
+		return true;
+
+	if ( isOrGroup() ) {
+		for ( Condition * cond : conditions ) {
+			if ( cond->eval( values ) )
+				return true;
+		}
+		return false;
+	} else {
+		for ( Condition * cond : conditions ) {
+			if ( !cond->eval( values ) )
+				return false;
 		}
-		return nif->getIndex( nif->getHeaderIndex(), blk );
+		return true;
+	}
+}
+
+void Renderer::ConditionGroup::addCondition( Condition * c )
+{
+	conditions.append( c );
+}
+
+Renderer::ConditionInput::ConditionInput( const QString & path ) : inputPath( path )
+{
+	QString	blkid = path;
+
+	if ( blkid.startsWith( "HEADER/" ) ) {
+		isHeader = true;
+		childPath = blkid.remove( "HEADER/" ).split( "/" );
+		return;
 	}
 
 	int pos = blkid.indexOf( "/" );
 
 	if ( pos > 0 ) {
-		childid = blkid.right( blkid.length() - pos - 1 );
+		childPath.append( blkid.right( blkid.length() - pos - 1 ) );
 		blkid = blkid.left( pos );
 	}
+	blockType = blkid;
+}
+
+QModelIndex Renderer::ConditionInput::getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const
+{
+	if ( isHeader ) {
+		if ( childPath.size() > 1 )
+			return nif->getIndex( nif->getIndex( nif->getHeaderIndex(), childPath.at(0) ), childPath.at(1) );
+		return nif->getIndex( nif->getHeaderIndex(), childPath.at(0) );
+	}
 
 	for ( QModelIndex iBlock : iBlocks ) {
-		if ( nif->blockInherits( iBlock, blkid ) ) {
-			if ( childid.isEmpty() )
+		if ( nif->blockInherits( iBlock, blockType ) ) {
+			if ( childPath.isEmpty() )
 				return iBlock;
 
-			return nif->getIndex( iBlock, childid );
+			return nif->getIndex( iBlock, childPath.at(0) );
 		}
 	}
 	return QModelIndex();
 }
 
-bool Renderer::ConditionSingle::eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const
+Renderer::ConditionValue Renderer::ConditionInput::getValue( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const
 {
-	QModelIndex iLeft = getIndex( nif, iBlocks, left );
+	ConditionValue	v;
 
-	if ( !iLeft.isValid() )
-		return invert;
+	QModelIndex	index = getIndex( nif, iBlocks );
+	if ( !index.isValid() )
+		return v;
 
-	if ( comp == NONE )
-		return !invert;
-
-	const NifItem * item = nif->getItem( iLeft );
+	v.type = ConditionValue::Other;
+	const NifItem * item = nif->getItem( index );
 	if ( !item )
-		return false;
-
-	if ( item->isString() )
-		return compare( item->getValueAsString(), right ) ^ invert;
-	else if ( item->isCount() )
-		return compare( item->getCountValue(), right.toULongLong( nullptr, 0 ) ) ^ invert;
-	else if ( item->isFloat() )
-		return compare( item->getFloatValue(), (float)right.toDouble() ) ^ invert;
-	else if ( item->isFileVersion() )
-		return compare( item->getFileVersionValue(), right.toUInt( nullptr, 0 ) ) ^ invert;
-	else if ( item->valueType() == NifValue::tBSVertexDesc )
-		return compare( (uint) item->get<BSVertexDesc>().GetFlags(), right.toUInt( nullptr, 0 ) ) ^ invert;
+		return v;
+
+	if ( item->isString() ) {
+		v.type = ConditionValue::String;
+		v.string = item->getValueAsString();
+	} else if ( item->isCount() ) {
+		v.type = ConditionValue::Count;
+		v.number = item->getCountValue();
+	} else if ( item->isFloat() ) {
+		v.type = ConditionValue::Float;
+		v.floatValue = item->getFloatValue();
+	} else if ( item->isFileVersion() ) {
+		v.type = ConditionValue::FileVersion;
+		v.number = item->getFileVersionValue();
+	} else if ( item->valueType() == NifValue::tBSVertexDesc ) {
+		v.type = ConditionValue::VertexFlags;
+		v.number = (uint) item->get<BSVertexDesc>().GetFlags();
+	}
 
-	return false;
+	return v;
 }
 
-bool Renderer::ConditionGroup::eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const
+void Renderer::ConditionValue::appendTo( QByteArray & key ) const
 {
-	if ( conditions.isEmpty() )
-		return true;
+	key.append( char( type ) );
+	if ( type == String ) {
+		key.append( string.toUtf8() );
+		key.append( '\0' );
+	} else if ( type == Float ) {
+		key.append( reinterpret_cast< const char * >( &floatValue ), sizeof( floatValue ) );
+	} else if ( type > String ) {
+		key.append( reinterpret_cast< const char * >( &number ), sizeof( number ) );
+	}
+}
 
-	if ( isOrGroup() ) {
-		for ( Condition * cond : conditions ) {
-			if ( cond->eval( nif, iBlocks ) )
-				return true;
-		}
-		return false;
-	} else {
-		for ( Condition * cond : conditions ) {
-			if ( !cond->eval( nif, iBlocks ) )
-				return false;
-		}
-		return true;
+int Renderer::addConditionInput( const QString & path )
+{
+	for ( qsizetype i = 0; i < conditionInputs.size(); i++ ) {
+		if ( conditionInputs.at( i ).path() == path )
+			return int( i );
 	}
+	conditionInputs.append( ConditionInput( path ) );
+	return int( conditionInputs.size() - 1 );
 }
 
-void Renderer::ConditionGroup::addCondition( Condition * c )
+QVector<Renderer::Program *> Renderer::selectPrograms( const NifModel * nif, const QVector<QModelIndex> & iBlocks )
 {
-	conditions.append( c );
+	QVector<ConditionValue>	values( conditionInputs.size() );
+	QByteArray	key;
+	for ( qsizetype i = 0; i < conditionInputs.size(); i++ ) {
+		values[i] = conditionInputs.at( i ).getValue( nif, iBlocks );
+		values.at( i ).appendTo( key );
+	}
+
+	auto	i = programSelections.constFind( key );
+	if ( i == programSelections.constEnd() ) {
+		QVector<Program *>	selection;
+		for ( Program * program : programs ) {
+			if ( program->status && program->conditions.eval( values ) )
+				selection.append( program );
+		}
+		i = programSelections.insert( key, selection );
+	}
+
+	return i.value();
 }
 
 Renderer::Shader::Shader( const QString & n, GLenum t, QOpenGLFunctions * fn )
@@ -348,8 +437,8 @@ bool Renderer::Shader::load( const QString & filepath )
 }
 
 
-Renderer::Program::Program( const QString & n, QOpenGLFunctions * fn )
-	: f( fn ), name( n.toLower() ), id( 0 )
+Renderer::Program::Program( const QString & n, QOpenGLFunctions * fn, StateStats * stats )
+	: f( fn ), name( n.toLower() ), id( 0 ), stats( stats )
 {
 	uniLocationsMap = new UniformLocationMapItem[512];
 	uniLocationsMapMask = 511;
@@ -421,7 +510,7 @@ bool Renderer::Program::load( const QString & filepath, Renderer * renderer )
 					line = line.remove( 0, 4 ).trimmed();
 				}
 
-				chkgrps.top()->addCondition( new ConditionSingle( line, invert ) );
+				chkgrps.top()->addCondition( new ConditionSingle( line, invert, renderer ) );
 			} else if ( line.startsWith( "texcoords" ) ) {
 				line = line.remove( 0, 9 ).simplified();
 				QStringList list = line.split( " " );
@@ -454,6 +543,8 @@ bool Renderer::Program::load( const QString & filepath, Renderer * renderer )
 			}
 		}
 
+		hasGPUSkinning = ( texcoords.values().contains( CT_BONE ) && texcoords.values().contains( CT_WEIGHT ) );
+
 		f->glLinkProgram( id );
 
 		GLint result;
@@ -494,6 +585,7 @@ Renderer::Renderer( QOpenGLContext * c, QOpenGLFunctions * f )
 	: cx( c ), fn( f )
 {
 	updateSettings();
+	logStateStats = qEnvironmentVariableIsSet( "NIFSKOPE_GL_STATS" );
 
 	connect( NifSkope::getOptions(), &SettingsDialog::saveSettings, this, &Renderer::updateSettings );
 }
@@ -501,6 +593,101 @@ Renderer::Renderer( QOpenGLContext * c, QOpenGLFunctions * f )
 Renderer::~Renderer()
 {
 	releaseShaders();
+	if ( QOpenGLContext::currentContext() == cx )
+		deleteReleasedBuffers();
+}
+
+void Renderer::releaseBuffers( const GLuint * ids, qsizetype n )
+{
+	for ( qsizetype i = 0; i < n; i++ ) {
+		if ( ids[i] )
+			releasedBuffers.append( ids[i] );
+	}
+}
+
+void Renderer::beginFrame()
+{
+	// other code may have changed the program since the last frame
+	currentProgram = GLuint( -1 );
+
+	if ( !logStateStats ) [[likely]]
+		return;
+	StateStats &	n = stateStats;
+	if ( ++n.frameCount < 600 )
+		return;
+	qCInfo( nsGl ) << "Renderer state changes in" << n.frameCount << "frames:"
+					<< "uniforms" << n.uniformCalls << "set," << n.uniformsSkipped << "skipped;"
+					<< "programs" << n.programCalls << "set," << n.programsSkipped << "skipped";
+	n = StateStats();
+}
+
+void Renderer::useProgram( GLuint id )
+{
+	if ( id == currentProgram ) {
+		stateStats.programsSkipped++;
+		return;
+	}
+	fn->glUseProgram( id );
+	currentProgram = id;
+	stateStats.programCalls++;
+}
+
+void Renderer::deleteReleasedBuffers()
+{
+	if ( releasedBuffers.isEmpty() ) [[likely]]
+		return;
+	fn->glDeleteBuffers( GLsizei( releasedBuffers.size() ), releasedBuffers.constData() );
+	releasedBuffers.clear();
+}
+
+//! Blocks that the conditions of the programs are evaluated on
+static QVector<QModelIndex> programInputBlocks( const Shape * mesh )
+{
+	QVector<QModelIndex> iBlocks;
+	iBlocks << mesh->index();
+	iBlocks << mesh->iData;
+	{
+		PropertyList props;
+		mesh->activeProperties( props );
+
+		for ( Property * p : props ) {
+			iBlocks.append( p->index() );
+		}
+	}
+
+	return iBlocks;
+}
+
+bool Renderer::canSkinOnGPU( const Shape * mesh ) const
+{
+	// the program is not known until the shape has been drawn once, the first frame is skinned on the CPU
+	if ( !( cfg.gpuSkinning && shader_ready ) || mesh->shader.isEmpty() || mesh->scene->hasOption(Scene::DisableShaders) )
+		return false;
+
+	const Program *	prog = programs.value( mesh->shader );
+	return ( prog && prog->status && prog->hasGPUSkinning );
+}
+
+int Renderer::getProgramSortId( const Shape * mesh )
+{
+	// a null program name means that the shape is drawn with the fixed function pipeline, see setupProgram()
+	const NifModel *	nif;
+	if ( !shader_ready
+		|| mesh->shader.isNull()
+		|| ( nif = mesh->scene->nifModel ) == nullptr
+		|| ( nif->getBSVersion() == 0 )
+		|| mesh->scene->hasOption(Scene::DisableShaders) ) {
+		return 0;
+	}
+
+	if ( !mesh->shader.isEmpty() ) {
+		const Program *	prog = programs.value( mesh->shader );
+		return ( prog ? prog->sortId : 0 );
+	}
+
+	// the shape has not been drawn yet, or its program is selected again after an edit
+	QVector<Program *>	selection = selectPrograms( nif, programInputBlocks( mesh ) );
+	return ( selection.isEmpty() ? 0 : selection.first()->sortId );
 }
 
 
@@ -509,6 +696,7 @@ void Renderer::updateSettings()
 	QSettings settings;
 
 	cfg.useShaders = settings.value( "Settings/Render/General/Use Shaders", true ).toBool();
+	cfg.gpuSkinning = settings.value( "Settings/Render/General/GPU Skinning", true ).toBool();
 	int	tmp = settings.value( "Settings/Render/General/Cube Map Bgnd", 1 ).toInt();
 	cfg.cubeBgndMipLevel = std::int8_t( std::min< int >( std::max< int >( tmp, -1 ), 6 ) );
 	cfg.sfParallaxMaxSteps = short( settings.value( "Settings/Render/General/Sf Parallax Steps", 200 ).toInt() );
@@ -560,11 +748,15 @@ void Renderer::updateShaders()
 
 	dir.setNameFilters( { "*.prog" } );
 	for ( const QString& name : dir.entryList() ) {
-		Program * program = new Program( name, fn );
+		Program * program = new Program( name, fn, &stateStats );
 		program->load( dir.filePath( name ), this );
 		program->setUniformLocations();
 		programs.insert( name, program );
 	}
+
+	int	sortId = 0;
+	for ( Program * program : programs )
+		program->sortId = ++sortId;
 }
 
 void Renderer::releaseShaders()
@@ -572,8 +764,11 @@ void Renderer::releaseShaders()
 	if ( !shader_ready )
 		return;
 
+	programSelections.clear();
+	currentProgram = GLuint( -1 );
 	qDeleteAll( programs );
 	programs.clear();
+	conditionInputs.clear();
 	qDeleteAll( shaders );
 	shaders.clear();
 }
@@ -593,7 +788,7 @@ QString Renderer::setupProgram( Shape * mesh, const QString & hint )
 	if ( !hint.isEmpty() ) {
 		Program * program = programs.value( hint );
 		if ( program && program->status ) {
-			fn->glUseProgram( program->id );
+			useProgram( program->id );
 			bool	setupStatus;
 			if ( nif->getBSVersion() >= 170 )
 				setupStatus = setupProgramCE2( nif, program, mesh );
@@ -607,42 +802,43 @@ QString Renderer::setupProgram( Shape * mesh, const QString & hint )
 		}
 	}
 
-	QVector<QModelIndex> iBlocks;
-	iBlocks << mesh->index();
-	iBlocks << mesh->iData;
-	{
-		PropertyList props;
-		mesh->activeProperties( props );
-
-		for ( Property * p : props ) {
-			iBlocks.append( p->index() );
-		}
-	}
-
-	for ( Program * program : programs ) {
-		if ( program->status && program->conditions.eval( nif, iBlocks ) ) {
-			fn->glUseProgram( program->id );
-			bool	setupStatus;
-			if ( nif->getBSVersion() >= 170 )
-				setupStatus = setupProgramCE2( nif, program, mesh );
-			else if ( nif->getBSVersion() >= 83 )
-				setupStatus = setupProgramCE1( nif, program, mesh );
-			else
-				setupStatus = setupProgramFO3( nif, program, mesh );
-			if ( setupStatus )
-				return program->name;
-			stopProgram();
-		}
+	for ( Program * program : selectPrograms( nif, programInputBlocks( mesh ) ) ) {
+		useProgram( program->id );
+		bool	setupStatus;
+		if ( nif->getBSVersion() >= 170 )
+			setupStatus = setupProgramCE2( nif, program, mesh );
+		else if ( nif->getBSVersion() >= 83 )
+			setupStatus = setupProgramCE1( nif, program, mesh );
+		else
+			setupStatus = setupProgramFO3( nif, program, mesh );
+		if ( setupStatus )
+			return program->name;
+		stopProgram();
 	}
 
 	setupFixedFunction( mesh );
 	return QString();
 }
 
+void Renderer::setupSkinning( Program * prog, const Shape * mesh )
+{
+	bool	gpuSkinned = mesh->isGPUSkinned;
+	prog->uni1i( SKINNED, int( gpuSkinned ) );
+	prog->uni1i( GPU_SKINNED, int( gpuSkinned ) );
+	if ( !gpuSkinned )
+		return;
+
+	qsizetype	n = std::min< qsizetype >( mesh->skinBoneTransforms.size(), maxGPUSkinningBones );
+	Matrix4	boneTransforms[maxGPUSkinningBones];
+	for ( qsizetype i = 0; i < n; i++ )
+		boneTransforms[i] = mesh->skinBoneTransforms.at( i ).toMatrix4();
+	prog->uni4mv( GPU_BONES, boneTransforms, int( n ) );
+}
+
 void Renderer::stopProgram()
 {
 	if ( shader_ready ) {
-		fn->glUseProgram( 0 );
+		useProgram( 0 );
 	}
 
 	int	numTex = fixedFuncTexUnits;
@@ -650,43 +846,89 @@ void Renderer::stopProgram()
 	resetTextureUnits( numTex );
 }
 
+bool Renderer::Program::uniformChanged( int l, const void * data, size_t n )
+{
+	if ( l < 0 ) {
+		// setting a uniform at location -1 is silently ignored by OpenGL
+		stats->uniformsSkipped++;
+		return false;
+	}
+	if ( l >= 65536 ) [[unlikely]] {
+		stats->uniformCalls++;
+		return true;
+	}
+
+	if ( size_t( l ) >= uniformValues.size() )
+		uniformValues.resize( size_t( l ) + 1 );
+	std::vector< std::uint32_t > &	v = uniformValues[l];
+	if ( v.size() == n && std::memcmp( v.data(), data, n * sizeof( std::uint32_t ) ) == 0 ) {
+		stats->uniformsSkipped++;
+		return false;
+	}
+	const std::uint32_t *	p = reinterpret_cast< const std::uint32_t * >( data );
+	v.assign( p, p + n );
+	stats->uniformCalls++;
+	return true;
+}
+
+bool Renderer::Program::uniformArrayChanged( int l )
+{
+	if ( l < 0 ) {
+		stats->uniformsSkipped++;
+		return false;
+	}
+	if ( size_t( l ) < uniformValues.size() )
+		uniformValues[l].clear();
+	stats->uniformCalls++;
+	return true;
+}
+
 void Renderer::Program::uni1f( UniformType var, float x )
 {
-	f->glUniform1f( uniformLocations[var], x );
+	uni1f_l( uniformLocations[var], x );
 }
 
 void Renderer::Program::uni2f( UniformType var, float x, float y )
 {
-	f->glUniform2f( uniformLocations[var], x, y );
+	uni2f_l( uniformLocations[var], x, y );
 }
 
 void Renderer::Program::uni3f( UniformType var, float x, float y, float z )
 {
-	f->glUniform3f( uniformLocations[var], x, y, z );
+	const float	tmp[3] = { x, y, z };
+	if ( uniformChanged( uniformLocations[var], tmp, 3 ) )
+		f->glUniform3f( uniformLocations[var], x, y, z );
 }
 
 void Renderer::Program::uni4f( UniformType var, float x, float y, float z, float w )
 {
-	f->glUniform4f( uniformLocations[var], x, y, z, w );
+	uni4f_l( uniformLocations[var], FloatVector4( x, y, z, w ) );
 }
 
 void Renderer::Program::uni1i( UniformType var, int val )
 {
-	f->glUniform1i( uniformLocations[var], val );
+	uni1i_l( uniformLocations[var], val );
 }
 
 void Renderer::Program::uni3m( UniformType var, const Matrix & val )
 {
-	if ( uniformLocations[var] >= 0 )
+	if ( uniformChanged( uniformLocations[var], val.data(), 9 ) )
 		f->glUniformMatrix3fv( uniformLocations[var], 1, 0, val.data() );
 }
 
 void Renderer::Program::uni4m( UniformType var, const Matrix4 & val )
 {
-	if ( uniformLocations[var] >= 0 )
+	if ( uniformChanged( uniformLocations[var], val.data(), 16 ) )
 		f->glUniformMatrix4fv( uniformLocations[var], 1, 0, val.data() );
 }
 
+void Renderer::Program::uni4mv( UniformType var, const Matrix4 * val, int n )
+{
+	static_assert( sizeof( Matrix4 ) == 64 );
+	if ( n > 0 && uniformArrayChanged( uniformLocations[var] ) )
+		f->glUniformMatrix4fv( uniformLocations[var], n, 0, val->data() );
+}
+
 bool Renderer::Program::uniSampler( BSShaderLightingProperty * bsprop, UniformType var,
 									int textureSlot, int & texunit, const QString & alternate,
 									uint clamp, const QString & forced )
@@ -722,7 +964,7 @@ bool Renderer::Program::uniSampler( BSShaderLightingProperty * bsprop, UniformTy
 		return false;
 	} while ( false );
 
-	f->glUniform1i( uniSamp, texunit++ );
+	uni1i_l( uniSamp, texunit++ );
 	return true;
 }
 
@@ -826,12 +1068,12 @@ void Renderer::Program::uni1i( const char * name, int x )
 	size_t	i = key.hashFunction() & hashMask;
 	for ( ; uniLocationsMap[i].fmt; i = (i + 1) & hashMask ) {
 		if ( uniLocationsMap[i] == key ) {
-			f->glUniform1i( uniLocationsMap[i].l, x );
+			uni1i_l( uniLocationsMap[i].l, x );
 			return;
 		}
 	}
 
-	f->glUniform1i( storeUniformLocation( key, i ), x );
+	uni1i_l( storeUniformLocation( key, i ), x );
 }
 
 void Renderer::Program::uni1f( const char * name, float x )
@@ -842,43 +1084,47 @@ void Renderer::Program::uni1f( const char * name, float x )
 	size_t	i = key.hashFunction() & hashMask;
 	for ( ; uniLocationsMap[i].fmt; i = (i + 1) & hashMask ) {
 		if ( uniLocationsMap[i] == key ) {
-			f->glUniform1f( uniLocationsMap[i].l, x );
+			uni1f_l( uniLocationsMap[i].l, x );
 			return;
 		}
 	}
 
-	f->glUniform1f( storeUniformLocation( key, i ), x );
+	uni1f_l( storeUniformLocation( key, i ), x );
 }
 
 void Renderer::Program::uni1b_l( int l, bool x )
 {
-	f->glUniform1i( l, int(x) );
+	uni1i_l( l, int(x) );
 }
 
 void Renderer::Program::uni1i_l( int l, int x )
 {
-	f->glUniform1i( l, x );
+	if ( uniformChanged( l, &x, 1 ) )
+		f->glUniform1i( l, x );
 }
 
 void Renderer::Program::uni1f_l( int l, float x )
 {
-	f->glUniform1f( l, x );
+	if ( uniformChanged( l, &x, 1 ) )
+		f->glUniform1f( l, x );
 }
 
 void Renderer::Program::uni2f_l( int l, float x, float y )
 {
-	f->glUniform2f( l, x, y );
+	const float	tmp[2] = { x, y };
+	if ( uniformChanged( l, tmp, 2 ) )
+		f->glUniform2f( l, x, y );
 }
 
 void Renderer::Program::uni4f_l( int l, FloatVector4 x )
 {
-	f->glUniform4f( l, x[0], x[1], x[2], x[3] );
+	if ( uniformChanged( l, &(x[0]), 4 ) )
+		f->glUniform4f( l, x[0], x[1], x[2], x[3] );
 }
 
 void Renderer::Program::uni4srgb_l( int l, FloatVector4 x )
 {
-	x = DDSTexture16::srgbExpand( x );
-	f->glUniform4f( l, x[0], x[1], x[2], x[3] );
+	uni4f_l( l, DDSTexture16::srgbExpand( x ) );
 }
 
 void Renderer::Program::uni4c_l( int l, std::uint32_t c, bool isSRGB )
@@ -887,7 +1133,7 @@ void Renderer::Program::uni4c_l( int l, std::uint32_t c, bool isSRGB )
 	x *= 1.0f / 255.0f;
 	if ( isSRGB )
 		x = DDSTexture16::srgbExpand( x );
-	f->glUniform4f( l, x[0], x[1], x[2], x[3] );
+	uni4f_l( l, x );
 }
 
 void Renderer::Program::uni1bv_l( int l, const bool * x, size_t n )
@@ -896,22 +1142,25 @@ void Renderer::Program::uni1bv_l( int l, const bool * x, size_t n )
 	GLint	tmp[64];
 	for ( size_t i = 0; i < n; i++ )
 		tmp[i] = GLint( x[i] );
-	f->glUniform1iv( l, GLsizei(n), tmp );
+	uni1iv_l( l, tmp, n );
 }
 
 void Renderer::Program::uni1iv_l( int l, const int * x, size_t n )
 {
-	f->glUniform1iv( l, GLsizei(n), x );
+	if ( uniformArrayChanged( l ) )
+		f->glUniform1iv( l, GLsizei(n), x );
 }
 
 void Renderer::Program::uni1fv_l( int l, const float * x, size_t n )
 {
-	f->glUniform1fv( l, GLsizei(n), x );
+	if ( uniformArrayChanged( l ) )
+		f->glUniform1fv( l, GLsizei(n), x );
 }
 
 void Renderer::Program::uni4fv_l( int l, const FloatVector4 * x, size_t n )
 {
-	f->glUniform4fv( l, GLsizei(n), &(x[0][0]) );
+	if ( uniformArrayChanged( l ) )
+		f->glUniform4fv( l, GLsizei(n), &(x[0][0]) );
 }
 
 void Renderer::Program::uniSampler_l( int l, int firstTextureUnit, int textureCnt, int arraySize )
@@ -924,7 +1173,7 @@ void Renderer::Program::uniSampler_l( int l, int firstTextureUnit, int textureCn
 		tmp[i] = firstTextureUnit + i;
 	for ( ; i < arraySize; i++ )
 		tmp[i] = firstTextureUnit;
-	f->glUniform1iv( l, arraySize, tmp );
+	uni1iv_l( l, tmp, size_t( arraySize ) );
 }
 
 static int setFlipbookParameters( const CE2Material::Material & m, FloatVector4 & uvScaleAndOffset )
@@ -999,7 +1248,7 @@ bool Renderer::setupProgramCE2( const NifModel * nif, Program * prog, Shape * me
 	hasCubeMap = hasCubeMap && scene->bindCube( cfg.cubeMapPathSTF );
 	if ( !hasCubeMap ) [[unlikely]]
 		scene->bindCube( grayCube, 1 );
-	fn->glUniform1i( uniCubeMap, texunit++ );
+	prog->uni1i_l( uniCubeMap, texunit++ );
 
 	uniCubeMap = prog->uniformLocations[SAMP_CUBE_2];
 	if ( uniCubeMap < 0 || !activateTextureUnit( texunit ) )
@@ -1007,7 +1256,7 @@ bool Renderer::setupProgramCE2( const NifModel * nif, Program * prog, Shape * me
 	hasCubeMap = hasCubeMap && scene->bindCube( cfg.cubeMapPathSTF, 2 );
 	if ( !hasCubeMap ) [[unlikely]]
 		scene->bindCube( grayCube, 1 );
-	fn->glUniform1i( uniCubeMap, texunit++ );
+	prog->uni1i_l( uniCubeMap, texunit++ );
 
 	prog->uni1i( HAS_MAP_CUBE, hasCubeMap );
 
@@ -1337,6 +1586,8 @@ bool Renderer::setupProgramCE2( const NifModel * nif, Program * prog, Shape * me
 	prog->uni4m( MAT_VIEW, mesh->viewTrans().toMatrix4() );
 	prog->uni4m( MAT_WORLD, mesh->worldTrans().toMatrix4() );
 
+	setupSkinning( prog, mesh );
+
 	QMapIterator<int, Program::CoordType> itx( prog->texcoords );
 
 	while ( itx.hasNext() ) {
@@ -1348,25 +1599,26 @@ bool Renderer::setupProgramCE2( const NifModel * nif, Program * prog, Shape * me
 		auto it = itx.value();
 		if ( it == Program::CT_TANGENT ) {
 			if ( mesh->transTangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->transTangents.constData() );
+				mesh->setVertexArray( Shape::TangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->transTangents );
 			} else if ( mesh->tangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->tangents.constData() );
+				mesh->setVertexArray( Shape::TangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->tangents );
 			} else {
 				return false;
 			}
 
 		} else if ( it == Program::CT_BITANGENT ) {
 			if ( mesh->transBitangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->transBitangents.constData() );
+				mesh->setVertexArray( Shape::BitangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->transBitangents );
 			} else if ( mesh->bitangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->bitangents.constData() );
+				mesh->setVertexArray( Shape::BitangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->bitangents );
 			} else {
 				return false;
 			}
+		} else if ( mesh->isGPUSkinned && ( it == Program::CT_BONE || it == Program::CT_WEIGHT ) ) {
+			if ( it == Program::CT_BONE )
+				mesh->setVertexArray( Shape::BoneIndexBuffer, GL_TEXTURE_COORD_ARRAY, 4, mesh->skinBoneIndices );
+			else
+				mesh->setVertexArray( Shape::BoneWeightBuffer, GL_TEXTURE_COORD_ARRAY, 4, mesh->skinBoneWeights );
 		} else {
 			int txid = it;
 			if ( txid < 0 )
@@ -1378,8 +1630,7 @@ bool Renderer::setupProgramCE2( const NifModel * nif, Program * prog, Shape * me
 			if ( !sfMesh || sfMesh->coords.count() != sfMesh->positions.count() )
 				return false;
 
-			glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-			glTexCoordPointer( 4, GL_FLOAT, 0, sfMesh->coords.constData() );
+			mesh->setVertexArray( Shape::TexCoordBuffer, GL_TEXTURE_COORD_ARRAY, 4, sfMesh->coords );
 		}
 	}
 
@@ -1584,7 +1835,7 @@ bool Renderer::setupProgramCE1( const NifModel * nif, Program * prog, Shape * me
 			}
 			if ( !hasCubeMap ) [[unlikely]]
 				scene->bindCube( grayCube, 1 );
-			fn->glUniform1i( uniCubeMap, texunit++ );
+			prog->uni1i_l( uniCubeMap, texunit++ );
 			if ( nifVersion >= 151 && ( uniCubeMap = prog->uniformLocations[SAMP_CUBE_2] ) >= 0 ) {
 				// Fallout 76: load second cube map for diffuse lighting
 				if ( !activateTextureUnit( texunit ) )
@@ -1592,7 +1843,7 @@ bool Renderer::setupProgramCE1( const NifModel * nif, Program * prog, Shape * me
 				hasCubeMap = hasCubeMap && scene->bindCube( *cube, 2 );
 				if ( !hasCubeMap ) [[unlikely]]
 					scene->bindCube( grayCube, 1 );
-				fn->glUniform1i( uniCubeMap, texunit++ );
+				prog->uni1i_l( uniCubeMap, texunit++ );
 			}
 		}
 		prog->uni1i( HAS_MAP_CUBE, hasCubeMap );
@@ -1606,7 +1857,7 @@ bool Renderer::setupProgramCE1( const NifModel * nif, Program * prog, Shape * me
 					return false;
 				if ( !bsprop->bind( pbr_lut_sf, true, TexClampMode::CLAMP_S_CLAMP_T ) )
 					return false;
-				fn->glUniform1i( prog->uniformLocations[SAMP_ENV_MASK], texunit++ );
+				prog->uni1i_l( prog->uniformLocations[SAMP_ENV_MASK], texunit++ );
 			}
 			prog->uniSampler( bsprop, SAMP_REFLECTIVITY, 8, texunit, reflectivity, clamp );
 			prog->uniSampler( bsprop, SAMP_LIGHTING, 9, texunit, lighting, clamp );
@@ -1680,7 +1931,7 @@ bool Renderer::setupProgramCE1( const NifModel * nif, Program * prog, Shape * me
 				if ( !scene->bindCube( fname ) && !scene->bindCube( cube ) && !scene->bindCube( grayCube, 1 ) )
 					return false;
 
-				fn->glUniform1i( uniCubeMap, texunit++ );
+				prog->uni1i_l( uniCubeMap, texunit++ );
 			}
 			if ( nifVersion < 151 ) {
 				prog->uniSampler( bsprop, SAMP_SPECULAR, 4, texunit, white, clamp );
@@ -1701,6 +1952,8 @@ bool Renderer::setupProgramCE1( const NifModel * nif, Program * prog, Shape * me
 
 	prog->uni4m( MAT_WORLD, mesh->worldTrans().toMatrix4() );
 
+	setupSkinning( prog, mesh );
+
 	QMapIterator<int, Program::CoordType> itx( prog->texcoords );
 
 	while ( itx.hasNext() ) {
@@ -1712,25 +1965,26 @@ bool Renderer::setupProgramCE1( const NifModel * nif, Program * prog, Shape * me
 		auto it = itx.value();
 		if ( it == Program::CT_TANGENT ) {
 			if ( mesh->transTangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->transTangents.constData() );
+				mesh->setVertexArray( Shape::TangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->transTangents );
 			} else if ( mesh->tangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->tangents.constData() );
+				mesh->setVertexArray( Shape::TangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->tangents );
 			} else {
 				return false;
 			}
 
 		} else if ( it == Program::CT_BITANGENT ) {
 			if ( mesh->transBitangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->transBitangents.constData() );
+				mesh->setVertexArray( Shape::BitangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->transBitangents );
 			} else if ( mesh->bitangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->bitangents.constData() );
+				mesh->setVertexArray( Shape::BitangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->bitangents );
 			} else {
 				return false;
 			}
+		} else if ( mesh->isGPUSkinned && ( it == Program::CT_BONE || it == Program::CT_WEIGHT ) ) {
+			if ( it == Program::CT_BONE )
+				mesh->setVertexArray( Shape::BoneIndexBuffer, GL_TEXTURE_COORD_ARRAY, 4, mesh->skinBoneIndices );
+			else
+				mesh->setVertexArray( Shape::BoneWeightBuffer, GL_TEXTURE_COORD_ARRAY, 4, mesh->skinBoneWeights );
 		} else {
 			int txid = it;
 			if ( txid < 0 )
@@ -1741,8 +1995,7 @@ bool Renderer::setupProgramCE1( const NifModel * nif, Program * prog, Shape * me
 			if ( set < 0 || !(set < mesh->coords.count()) || !mesh->coords[set].count() )
 				return false;
 
-			glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-			glTexCoordPointer( 2, GL_FLOAT, 0, mesh->coords[set].constData() );
+			mesh->setVertexArray( Shape::TexCoordBuffer + set, GL_TEXTURE_COORD_ARRAY, 2, mesh->coords[set] );
 		}
 	}
 
@@ -1862,7 +2115,7 @@ bool Renderer::setupProgramFO3( const NifModel * nif, Program * prog, Shape * me
 				return false;
 			if ( !texprop->bind( 0 ) )
 				texprop->bind( 0, ( !scene->hasOption(Scene::DoErrorColor) ? white : magenta ) );
-			fn->glUniform1i( uniBaseMap, texunit++ );
+			prog->uni1i_l( uniBaseMap, texunit++ );
 		}
 	}
 
@@ -1875,7 +2128,7 @@ bool Renderer::setupProgramFO3( const NifModel * nif, Program * prog, Shape * me
 			scene->bindCube( grayCube, 1 );
 			hasCubeMap = false;
 		}
-		fn->glUniform1i( uniCubeMap, texunit++ );
+		prog->uni1i_l( uniCubeMap, texunit++ );
 	} else {
 		hasCubeMap = false;
 	}
@@ -1908,7 +2161,7 @@ bool Renderer::setupProgramFO3( const NifModel * nif, Program * prog, Shape * me
 					hasSpecular = false;
 				}
 			}
-			fn->glUniform1i( uniNormalMap, texunit++ );
+			prog->uni1i_l( uniNormalMap, texunit++ );
 		}
 	}
 
@@ -1942,7 +2195,7 @@ bool Renderer::setupProgramFO3( const NifModel * nif, Program * prog, Shape * me
 			hasGlowMap = result;
 			if ( !result )
 				texprop->bind( 0, black );
-			fn->glUniform1i( uniGlowMap, texunit++ );
+			prog->uni1i_l( uniGlowMap, texunit++ );
 		}
 	}
 
@@ -2008,6 +2261,8 @@ bool Renderer::setupProgramFO3( const NifModel * nif, Program * prog, Shape * me
 
 	prog->uni4m( MAT_WORLD, mesh->worldTrans().toMatrix4() );
 
+	setupSkinning( prog, mesh );
+
 	QMapIterator<int, Program::CoordType> itx( prog->texcoords );
 
 	while ( itx.hasNext() ) {
@@ -2019,25 +2274,26 @@ bool Renderer::setupProgramFO3( const NifModel * nif, Program * prog, Shape * me
 		auto it = itx.value();
 		if ( it == Program::CT_TANGENT ) {
 			if ( mesh->transTangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->transTangents.constData() );
+				mesh->setVertexArray( Shape::TangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->transTangents );
 			} else if ( mesh->tangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->tangents.constData() );
+				mesh->setVertexArray( Shape::TangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->tangents );
 			} else {
 				return false;
 			}
 
 		} else if ( it == Program::CT_BITANGENT ) {
 			if ( mesh->transBitangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->transBitangents.constData() );
+				mesh->setVertexArray( Shape::BitangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->transBitangents );
 			} else if ( mesh->bitangents.count() ) {
-				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->bitangents.constData() );
+				mesh->setVertexArray( Shape::BitangentBuffer, GL_TEXTURE_COORD_ARRAY, 3, mesh->bitangents );
 			} else {
 				return false;
 			}
+		} else if ( mesh->isGPUSkinned && ( it == Program::CT_BONE || it == Program::CT_WEIGHT ) ) {
+			if ( it == Program::CT_BONE )
+				mesh->setVertexArray( Shape::BoneIndexBuffer, GL_TEXTURE_COORD_ARRAY, 4, mesh->skinBoneIndices );
+			else
+				mesh->setVertexArray( Shape::BoneWeightBuffer, GL_TEXTURE_COORD_ARRAY, 4, mesh->skinBoneWeights );
 		} else if ( texprop ) {
 			int txid = it;
 			if ( txid < 0 )
@@ -2048,8 +2304,7 @@ bool Renderer::setupProgramFO3( const NifModel * nif, Program * prog, Shape * me
 			if ( set < 0 || !(set < mesh->coords.count()) || !mesh->coords[set].count() )
 				return false;
 
-			glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-			glTexCoordPointer( 2, GL_FLOAT, 0, mesh->coords[set].constData() );
+			mesh->setVertexArray( Shape::TexCoordBuffer + set, GL_TEXTURE_COORD_ARRAY, 2, mesh->coords[set] );
 		} else if ( bsprop ) {
 			int txid = it;
 			if ( txid < 0 )
@@ -2060,8 +2315,7 @@ bool Renderer::setupProgramFO3( const NifModel * nif, Program * prog, Shape * me
 			if ( set < 0 || !(set < mesh->coords.count()) || !mesh->coords[set].count() )
 				return false;
 
-			glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-			glTexCoordPointer( 2, GL_FLOAT, 0, mesh->coords[set].constData() );
+			mesh->setVertexArray( Shape::TexCoordBuffer + set, GL_TEXTURE_COORD_ARRAY, 2, mesh->coords[set] );
 		}
 	}
 
@@ -2402,7 +2656,7 @@ void Renderer::drawSkyBox( Scene * scene )
 	glVertexPointer( 3, GL_FLOAT, 0, skyBoxVertices );
 	glEnable( GL_FRAMEBUFFER_SRGB );
 
-	fn->glUseProgram( prog->id );
+	useProgram( prog->id );
 
 	// texturing
 
@@ -2421,7 +2675,7 @@ void Renderer::drawSkyBox( Scene * scene )
 		hasCubeMap = scene->bindCube( bsVersion < 170 ? cfg.cubeMapPathFO76 : cfg.cubeMapPathSTF );
 	if ( !hasCubeMap )
 		scene->bindCube( grayCube, 1 );
-	fn->glUniform1i( uniCubeMap, texunit++ );
+	prog->uni1i_l( uniCubeMap, texunit++ );
 
 	prog->uni1i( HAS_MAP_CUBE, hasCubeMap );
 	prog->uni1b( "invertZAxis", ( bsVersion < 170 ) );
@@ -36,12 +36,14 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <data/niftypes.h>
 
 #include <QCoreApplication>
+#include <QHash>
 #include <QMap>
 #include <QVector>
 #include <QString>
 
 #include <array>
 #include <string>
+#include <vector>
 
 #include "material.hpp"
 
@@ -88,6 +90,27 @@ public:
 	//! Stop shader program
 	void stopProgram();
 
+	//! Called at the start of drawing the shapes of a frame, resets the tracked GL state. If the environment
+	// variable NIFSKOPE_GL_STATS is set, the number of state changes skipped is also logged every 600 frames.
+	void beginFrame();
+	//! Returns the number of glUseProgram() calls, this is reset when the state changes are logged by beginFrame()
+	std::uint64_t getProgramCallCount() const { return stateStats.programCalls; }
+
+	//! Queue buffer objects of a shape for deletion, the context does not need to be current
+	void releaseBuffers( const GLuint * ids, qsizetype n );
+	//! Delete the buffer objects queued by releaseBuffers(), the context must be current
+	void deleteReleasedBuffers();
+
+	//! Size of the boneTransforms array in the vertex shaders
+	static constexpr int maxGPUSkinningBones = 100;
+	//! Returns true if the shader program last used by the shape can do the skinning in the vertex shader
+	bool canSkinOnGPU( const Shape * mesh ) const;
+	//! Returns a number identifying the program the shape is drawn with, for sorting shapes by program. This is 0 for
+	// the fixed function pipeline, and the position of the program in the sorted list of .prog files plus one
+	// otherwise. Shapes without a program name get the first program whose conditions match, which is the one
+	// setupProgram() tries first.
+	int getProgramSortId( const Shape * mesh );
+
 	typedef enum
 	{
 		// Samplers
@@ -170,6 +193,56 @@ public slots:
 	void updateSettings();
 
 protected:
+	//! Number of GL calls made and skipped by the renderer because the state was already set
+	struct StateStats
+	{
+		std::uint64_t	uniformCalls = 0;
+		std::uint64_t	uniformsSkipped = 0;
+		std::uint64_t	programCalls = 0;
+		std::uint64_t	programsSkipped = 0;
+		std::uint32_t	frameCount = 0;
+	};
+
+	//! Value of a field that shader program conditions refer to, as it is compared by ConditionSingle
+	struct ConditionValue
+	{
+		enum Type : unsigned char
+		{
+			// the field or block is not found, or it is found but its value cannot be compared
+			Missing, Other,
+			String, Count, Float, FileVersion, VertexFlags
+		};
+		Type	type = Missing;
+		quint64	number = 0;
+		float	floatValue = 0.0f;
+		QString	string;
+
+		//! Append the value to a key of the program selection cache
+		void appendTo( QByteArray & key ) const;
+	};
+
+	//! Block or field path used by shader program conditions, e.g. "NiTriBasedGeomData/Has Normals",
+	// "BSLightingShaderProperty" or "HEADER/BS Header/BS Version". The path is parsed only once,
+	// and each distinct path is looked up once per shape, regardless of the number of conditions using it.
+	class ConditionInput
+	{
+public:
+		ConditionInput( const QString & path );
+
+		const QString & path() const { return inputPath; }
+		//! Returns the value of the field in the header, or in the first block of 'iBlocks' that inherits blockType
+		ConditionValue getValue( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const;
+
+protected:
+		QString	inputPath;
+		bool	isHeader = false;
+		QString	blockType;
+		//! Field name relative to the block, or the name of the header field and optionally of its child
+		QStringList	childPath;
+
+		QModelIndex getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const;
+	};
+
 	//! Base Condition class for shader programs
 	class Condition
 	{
@@ -177,16 +250,17 @@ public:
 		Condition() {}
 		virtual ~Condition() {}
 
-		virtual bool eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const = 0;
+		//! Evaluate the condition, 'values' holds the value of each ConditionInput of the renderer
+		virtual bool eval( const QVector<ConditionValue> & values ) const = 0;
 	};
 
 	//! Condition class for single conditions
 	class ConditionSingle final : public Condition
 	{
 public:
-		ConditionSingle( const QString & line, bool neg = false );
+		ConditionSingle( const QString & line, bool neg, Renderer * renderer );
 
-		bool eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const override final;
+		bool eval( const QVector<ConditionValue> & values ) const override final;
 
 protected:
 		QString left, right;
@@ -199,7 +273,13 @@ protected:
 
 		bool invert;
 
-		QModelIndex getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlock, QString name ) const;
+		//! Index of 'left' in Renderer::conditionInputs
+		int input;
+		// 'right' converted to the types of the field values it may be compared to
+		quint64 rightCount;
+		float rightFloat;
+		uint rightUInt;
+
 		template <typename T> bool compare( T a, T b ) const;
 	};
 
@@ -210,7 +290,7 @@ public:
 		ConditionGroup( bool o = false ) { _or = o; }
 		~ConditionGroup() { qDeleteAll( conditions ); }
 
-		bool eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const override final;
+		bool eval( const QVector<ConditionValue> & values ) const override final;
 
 		void addCondition( Condition * c );
 
@@ -243,7 +323,7 @@ protected:
 	class Program
 	{
 public:
-		Program( const QString & name, QOpenGLFunctions * fn );
+		Program( const QString & name, QOpenGLFunctions * fn, StateStats * stats );
 		~Program();
 
 		bool load( const QString & filepath, Renderer * );
@@ -274,6 +354,10 @@ public:
 
 		ConditionGroup conditions;
 		QMap<int, CoordType> texcoords;
+		//! The program has texture coordinate inputs for bone indices and weights
+		bool hasGPUSkinning = false;
+		//! Position of the program in Renderer::programs plus one, see getProgramSortId()
+		int sortId = 0;
 
 		static const char * const uniforms[NUM_UNIFORM_TYPES];
 		int uniformLocations[NUM_UNIFORM_TYPES];
@@ -295,6 +379,17 @@ private:
 		unsigned int	uniLocationsMapMask;
 		unsigned int	uniLocationsMapSize;
 		int storeUniformLocation( const UniformLocationMapItem & o, size_t i );
+
+		//! Last values set for each uniform location. Uniform values are part of the program object, so setting
+		// the same material parameters again for the next shape does not need to upload anything.
+		std::vector< std::vector< std::uint32_t > >	uniformValues;
+		StateStats *	stats;
+		//! Returns false if 'n' 32-bit words at 'data' are already the value of location 'l',
+		// otherwise stores them and returns true. Locations out of range are not cached.
+		bool uniformChanged( int l, const void * data, size_t n );
+		//! Returns false if 'l' is -1. Arrays are not cached, the elements of an array have locations of their own,
+		// so the cached value of the first element is discarded.
+		bool uniformArrayChanged( int l );
 public:
 		void setUniformLocations();
 
@@ -305,6 +400,7 @@ public:
 		void uni1i( UniformType var, int val );
 		void uni3m( UniformType var, const Matrix & val );
 		void uni4m( UniformType var, const Matrix4 & val );
+		void uni4mv( UniformType var, const Matrix4 * val, int n );
 		bool uniSampler( class BSShaderLightingProperty * bsprop, UniformType var, int textureSlot,
 							int & texunit, const QString & alternate, uint clamp, const QString & forced = {} );
 
@@ -339,6 +435,23 @@ public:
 	QMap<QString, Shader *> shaders;
 	QMap<QString, Program *> programs;
 
+	StateStats	stateStats;
+	bool	logStateStats = false;
+	//! Program in use, or GLuint(-1) if not known
+	GLuint	currentProgram = GLuint( -1 );
+	//! Call glUseProgram() if 'id' is not already the current program
+	void useProgram( GLuint id );
+
+	//! Distinct paths used by the conditions of all programs
+	QVector<ConditionInput> conditionInputs;
+	//! Returns the index of 'path' in conditionInputs, adding it if it is not found
+	int addConditionInput( const QString & path );
+	//! Programs whose conditions are true, in the order they are tried, keyed on the values of conditionInputs.
+	// Shapes that only differ in fields that no condition refers to share the same entry.
+	QHash<QByteArray, QVector<Program *>> programSelections;
+	//! Returns the programs whose conditions are true for the blocks of a shape
+	QVector<Program *> selectPrograms( const NifModel * nif, const QVector<QModelIndex> & iBlocks );
+
 	// Starfield
 	bool setupProgramCE2( const NifModel *, Program *, Shape * );
 	// Skyrim, Fallout 4, Fallout 76
@@ -347,10 +460,13 @@ public:
 	bool setupProgramFO3( const NifModel *, Program *, Shape * );
 	// other games
 	void setupFixedFunction( Shape * );
+	//! Set the skinning uniforms, and the bone transforms if the shape is skinned by the vertex shader
+	void setupSkinning( Program *, const Shape * );
 
 	struct Settings
 	{
 		bool	useShaders = true;
+		bool	gpuSkinning = true;
 		std::int8_t	cubeBgndMipLevel = 1;
 		short	sfParallaxMaxSteps = 200;
 		float	sfParallaxScale = 0.0f;
@@ -361,6 +477,8 @@ public:
 
 	unsigned char	fixedFuncTexUnits = 0;
 
+	QVector<GLuint>	releasedBuffers;
+
 public:
 	void drawSkyBox( Scene * scene );
 };
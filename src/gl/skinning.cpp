@@ -0,0 +1,256 @@
+#include "skinning.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+//! Worker threads shared by all SkinningKernel instances, created on first use
+class SkinningThreadPool
+{
+public:
+	static SkinningThreadPool & instance()
+	{
+		static SkinningThreadPool	pool;
+		return pool;
+	}
+
+	//! Call f( i ) for each i from 0 to chunkCount - 1 on the worker threads and on the calling thread,
+	// and wait for all calls to return
+	void run( const std::function< void( qsizetype ) > & f, qsizetype chunkCount );
+
+protected:
+	SkinningThreadPool();
+	~SkinningThreadPool();
+	void worker();
+
+	// run() is not reentrant, calls from different threads are serialized
+	std::mutex	runMutex;
+	std::mutex	mutex;
+	std::condition_variable	cvStart;
+	std::condition_variable	cvDone;
+	std::vector< std::thread >	threads;
+	const std::function< void( qsizetype ) > *	task = nullptr;
+	qsizetype	taskChunks = 0;
+	std::atomic< qsizetype >	nextChunk = 0;
+	std::uint64_t	generation = 0;
+	size_t	threadsDone = 0;
+	bool	quitFlag = false;
+};
+
+SkinningThreadPool::SkinningThreadPool()
+{
+	int	threadCnt = std::clamp< int >( int( std::thread::hardware_concurrency() ), 1, 8 );
+	for ( int i = 1; i < threadCnt; i++ )
+		threads.emplace_back( &SkinningThreadPool::worker, this );
+}
+
+SkinningThreadPool::~SkinningThreadPool()
+{
+	{
+		std::lock_guard< std::mutex >	lock( mutex );
+		quitFlag = true;
+	}
+	cvStart.notify_all();
+	for ( std::thread & t : threads )
+		t.join();
+}
+
+void SkinningThreadPool::worker()
+{
+	std::uint64_t	prvGeneration = 0;
+	std::unique_lock< std::mutex >	lock( mutex );
+	while ( true ) {
+		cvStart.wait( lock, [&] { return ( quitFlag || generation != prvGeneration ); } );
+		if ( quitFlag )
+			return;
+		prvGeneration = generation;
+		const std::function< void( qsizetype ) > &	f = *task;
+		qsizetype	n = taskChunks;
+		lock.unlock();
+
+		for ( qsizetype i; ( i = nextChunk.fetch_add( 1, std::memory_order_relaxed ) ) < n; )
+			f( i );
+
+		lock.lock();
+		if ( ++threadsDone == threads.size() )
+			cvDone.notify_one();
+	}
+}
+
+void SkinningThreadPool::run( const std::function< void( qsizetype ) > & f, qsizetype chunkCount )
+{
+	std::lock_guard< std::mutex >	runLock( runMutex );
+	if ( threads.empty() || chunkCount < 2 ) {
+		for ( qsizetype i = 0; i < chunkCount; i++ )
+			f( i );
+		return;
+	}
+
+	{
+		std::lock_guard< std::mutex >	lock( mutex );
+		task = &f;
+		taskChunks = chunkCount;
+		nextChunk = 0;
+		threadsDone = 0;
+		generation++;
+	}
+	cvStart.notify_all();
+
+	for ( qsizetype i; ( i = nextChunk.fetch_add( 1, std::memory_order_relaxed ) ) < chunkCount; )
+		f( i );
+
+	// all workers need to have seen the task before it can be destroyed
+	std::unique_lock< std::mutex >	lock( mutex );
+	cvDone.wait( lock, [&] { return ( threadsDone == threads.size() ); } );
+	task = nullptr;
+}
+
+
+void SkinningKernel::clear( qsizetype vertexCount )
+{
+	pending.clear();
+	offsets.assign( size_t( std::max< qsizetype >( vertexCount, 0 ) ) + 1, 0 );
+	bones.clear();
+	weights.clear();
+	boneMatrices.clear();
+	maxInfluenceCnt = 0;
+	maxBone = -1;
+}
+
+void SkinningKernel::addInfluence( int vertex, int bone, float weight )
+{
+	if ( weight == 0.0f || vertex < 0 || vertex >= vertexCount() || bone < 0 || bone > 0xFFFF )
+		return;
+
+	pending.push_back( Influence{ std::uint32_t( vertex ), std::uint16_t( bone ), weight } );
+}
+
+void SkinningKernel::finalize()
+{
+	qsizetype	n = vertexCount();
+
+	// counting sort by vertex, this keeps the order in which the influences of each vertex were added
+	std::fill( offsets.begin(), offsets.end(), 0U );
+	for ( const Influence & i : pending ) {
+		offsets[i.vertex + 1]++;
+		maxBone = std::max< int >( maxBone, i.bone );
+	}
+	for ( qsizetype v = 0; v < n; v++ ) {
+		maxInfluenceCnt = std::max< int >( maxInfluenceCnt, int( offsets[v + 1] ) );
+		offsets[v + 1] += offsets[v];
+	}
+
+	bones.resize( pending.size() );
+	weights.resize( pending.size() );
+	std::vector< std::uint32_t >	pos( offsets.begin(), offsets.end() - 1 );
+	for ( const Influence & i : pending ) {
+		std::uint32_t	k = pos[i.vertex]++;
+		bones[k] = i.bone;
+		weights[k] = i.weight;
+	}
+
+	pending.clear();
+	pending.shrink_to_fit();
+}
+
+void SkinningKernel::setBoneTransforms( const Transform * t, qsizetype n )
+{
+	boneMatrices.resize( size_t( std::max< qsizetype >( n, qsizetype( maxBone ) + 1 ) ) );
+
+	for ( qsizetype b = 0; b < qsizetype( boneMatrices.size() ); b++ ) {
+		BoneMatrix &	m = boneMatrices[b];
+		if ( b >= n || t[b].scale == 0.0f ) {
+			for ( int c = 0; c < 4; c++ )
+				m.position[c] = FloatVector4( 0.0f );
+			for ( int c = 0; c < 3; c++ )
+				m.rotation[c] = FloatVector4( 0.0f );
+			continue;
+		}
+
+		const Transform &	x = t[b];
+		for ( int c = 0; c < 3; c++ ) {
+			m.rotation[c] = FloatVector4( x.rotation( 0, c ), x.rotation( 1, c ), x.rotation( 2, c ), 0.0f );
+			m.position[c] = m.rotation[c] * x.scale;
+		}
+		m.position[3] = FloatVector4( x.translation[0], x.translation[1], x.translation[2], 0.0f );
+	}
+}
+
+void SkinningKernel::skinRange( const Arrays & a, qsizetype begin, qsizetype end ) const
+{
+	const BoneMatrix *	m = boneMatrices.data();
+
+	for ( qsizetype v = begin; v < end; v++ ) {
+		// blend the bone matrices of the vertex
+		FloatVector4	p0( 0.0f );
+		FloatVector4	p1( 0.0f );
+		FloatVector4	p2( 0.0f );
+		FloatVector4	p3( 0.0f );
+		FloatVector4	r0( 0.0f );
+		FloatVector4	r1( 0.0f );
+		FloatVector4	r2( 0.0f );
+		for ( std::uint32_t i = offsets[v]; i < offsets[v + 1]; i++ ) {
+			const BoneMatrix &	b = m[bones[i]];
+			float	w = weights[i];
+			p0 += b.position[0] * w;
+			p1 += b.position[1] * w;
+			p2 += b.position[2] * w;
+			p3 += b.position[3] * w;
+			r0 += b.rotation[0] * w;
+			r1 += b.rotation[1] * w;
+			r2 += b.rotation[2] * w;
+		}
+
+		if ( v < a.size[0] ) [[likely]] {
+			FloatVector4	p( a.in[0][v] );
+			a.out[0][v] = Vector3( p0 * p[0] + p1 * p[1] + p2 * p[2] + p3 );
+		}
+
+		for ( int j = 1; j < 4; j++ ) {
+			if ( v >= a.size[j] )
+				continue;
+			FloatVector4	n( a.in[j][v] );
+			n = r0 * n[0] + r1 * n[1] + r2 * n[2];
+			float	d = n.dotProduct3( n );
+			a.out[j][v] = ( d > 0.0f ? Vector3( n / float( std::sqrt( d ) ) ) : Vector3() );
+		}
+	}
+}
+
+void SkinningKernel::skin( QVector<Vector3> & outVerts, QVector<Vector3> & outNorms,
+							QVector<Vector3> & outTangents, QVector<Vector3> & outBitangents,
+							const QVector<Vector3> & verts, const QVector<Vector3> & norms,
+							const QVector<Vector3> & tangents, const QVector<Vector3> & bitangents ) const
+{
+	qsizetype	n = vertexCount();
+	if ( maxBone >= qsizetype( boneMatrices.size() ) ) [[unlikely]]
+		n = 0;	// setBoneTransforms() has not been called
+
+	QVector<Vector3> *	out[4] = { &outVerts, &outNorms, &outTangents, &outBitangents };
+	const QVector<Vector3> *	in[4] = { &verts, &norms, &tangents, &bitangents };
+	Arrays	a;
+	for ( int j = 0; j < 4; j++ ) {
+		qsizetype	size = in[j]->size();
+		out[j]->resize( size );
+		a.out[j] = out[j]->data();
+		a.in[j] = in[j]->constData();
+		a.size[j] = std::min< qsizetype >( size, n );
+		for ( qsizetype v = a.size[j]; v < size; v++ )
+			a.out[j][v] = Vector3();
+	}
+
+	if ( n < minVerticesPerThread ) {
+		skinRange( a, 0, n );
+		return;
+	}
+
+	SkinningThreadPool::instance().run(
+		[&]( qsizetype i ) {
+			skinRange( a, i * chunkSize, std::min< qsizetype >( ( i + 1 ) * chunkSize, n ) );
+		}, ( n + chunkSize - 1 ) / chunkSize );
+}
@@ -0,0 +1,87 @@
+#ifndef SKINNING_H_INCLUDED
+#define SKINNING_H_INCLUDED
+
+#include "data/niftypes.h"
+
+#include <QVector>
+
+#include <cstdint>
+#include <vector>
+
+//! CPU skinning of vertex positions, normals, tangents and bitangents
+/*!
+ * The bone influences are stored sorted by vertex, so each output vertex is computed from its own inputs in one pass,
+ * instead of accumulating the contribution of each bone with scattered writes. For every vertex, the matrices of its
+ * bones are blended with FloatVector4 arithmetic on the matrix columns, and the blended matrix is applied to all
+ * arrays. The influences of a vertex are summed in the order they were added, so that the results match adding
+ * Transform * Vector3 * weight per bone. Large meshes are split into chunks of vertices that are processed on a
+ * shared pool of worker threads.
+ */
+class SkinningKernel
+{
+public:
+	//! Remove all influences and bone transforms, and set the number of vertices that can be skinned
+	void clear( qsizetype vertexCount = 0 );
+	//! Add an influence of 'bone' on 'vertex', influences with zero weight or an invalid vertex are ignored
+	void addInfluence( int vertex, int bone, float weight );
+	//! Sort the influences added by vertex, this must be called before the influences are used
+	void finalize();
+
+	qsizetype vertexCount() const { return qsizetype( offsets.size() ) - 1; }
+	//! Largest number of influences on a single vertex
+	int maxInfluences() const { return maxInfluenceCnt; }
+	int influenceCount( qsizetype vertex ) const { return int( offsets[vertex + 1] - offsets[vertex] ); }
+	const std::uint16_t * influenceBones( qsizetype vertex ) const { return bones.data() + offsets[vertex]; }
+	const float * influenceWeights( qsizetype vertex ) const { return weights.data() + offsets[vertex]; }
+
+	//! Set the bone transforms that the bone indices of the influences refer to. A transform with a scale of zero
+	// disables the bone, it does not contribute to the vertices it influences, and so do bones after the last one.
+	void setBoneTransforms( const Transform * t, qsizetype n );
+
+	/*! Skin the vertex data. Positions are transformed with the complete bone transforms, and the other arrays with
+	 * the rotations only, and normalized. The outputs are resized to the size of the corresponding inputs, elements
+	 * without influences (including those beyond vertexCount()) are set to zero.
+	 */
+	void skin( QVector<Vector3> & outVerts, QVector<Vector3> & outNorms,
+				QVector<Vector3> & outTangents, QVector<Vector3> & outBitangents,
+				const QVector<Vector3> & verts, const QVector<Vector3> & norms,
+				const QVector<Vector3> & tangents, const QVector<Vector3> & bitangents ) const;
+
+	//! Number of vertices processed by one thread at a time
+	static constexpr qsizetype chunkSize = 2048;
+	//! Vertex count above which the vertices are skinned on multiple threads
+	static constexpr qsizetype minVerticesPerThread = 8192;
+
+protected:
+	struct Influence
+	{
+		std::uint32_t	vertex;
+		std::uint16_t	bone;
+		float	weight;
+	};
+	//! Columns of the bone transforms: position[0..2] = rotation * scale, position[3] = translation,
+	// rotation[0..2] = rotation only
+	struct BoneMatrix
+	{
+		FloatVector4	position[4];
+		FloatVector4	rotation[3];
+	};
+	struct Arrays
+	{
+		Vector3 *	out[4];
+		const Vector3 *	in[4];
+		qsizetype	size[4];
+	};
+
+	std::vector< Influence >	pending;
+	std::vector< std::uint32_t >	offsets = { 0 };
+	std::vector< std::uint16_t >	bones;
+	std::vector< float >	weights;
+	std::vector< BoneMatrix >	boneMatrices;
+	int	maxInfluenceCnt = 0;
+	int	maxBone = -1;
+
+	void skinRange( const Arrays & a, qsizetype begin, qsizetype end ) const;
+};
+
+#endif
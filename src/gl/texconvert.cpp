@@ -0,0 +1,202 @@
+#include "texconvert.h"
+
+#include <QByteArray>
+#include <QIODevice>
+
+#include <algorithm>
+#include <cstring>
+
+//! Shift amounts for RGBA conversion
+static const int rgbashift[4] = {
+	0, 8, 16, 24
+};
+//! Mask for TGA greyscale
+const quint32 TGA_L_MASK[4] = {
+	0xff, 0xff, 0xff, 0x00
+};
+//! Mask for TGA greyscale with alpha
+const quint32 TGA_LA_MASK[4] = {
+	0x00ff, 0x00ff, 0x00ff, 0xff00
+};
+//! Mask for TGA RGBA
+const quint32 TGA_RGBA_MASK[4] = {
+	0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000
+};
+//! Mask for TGA RGB
+const quint32 TGA_RGB_MASK[4] = {
+	0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000
+};
+//! Mask for BMP RGBA (identical to TGA RGB)
+const quint32 BMP_RGBA_MASK[4] = {
+	0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000
+};
+
+bool uncompressRLE( QIODevice & f, int w, int h, int bytespp, quint8 * pixel )
+{
+	QByteArray data = f.readAll();
+	const quint8 *	p = reinterpret_cast< const quint8 * >( data.constData() );
+	const quint8 *	endp = p + data.size();
+
+	size_t	n = size_t( w ) * size_t( h );	// total pixel count
+	size_t	c = 0;
+
+	while ( c < n ) {
+		if ( p >= endp )
+			return false;
+		size_t	rl = size_t( *p & 0x7F ) + 1;	// run length
+		bool	isRLEPacket = bool( *p & 0x80 );
+		p++;
+		rl = std::min( rl, n - c );
+
+		if ( isRLEPacket ) {
+			// expand pixel data rl times
+			if ( size_t( endp - p ) < size_t( bytespp ) )
+				return false;
+			if ( bytespp == 1 ) {
+				std::memset( pixel, *p, rl );
+			} else {
+				for ( size_t i = 0; i < rl; i++ )
+					std::memcpy( pixel + i * size_t( bytespp ), p, size_t( bytespp ) );
+			}
+			p += bytespp;
+		} else {
+			// rl raw pixels
+			size_t	nBytes = rl * size_t( bytespp );
+			if ( size_t( endp - p ) < nBytes )
+				return false;
+			std::memcpy( pixel, p, nBytes );
+			p += nBytes;
+		}
+		pixel += rl * size_t( bytespp );
+		c += rl;
+	}
+
+	return true;
+}
+
+//! Masks and shifts for converting pixels to RGBA, see convertToRGBA()
+struct PixelConversion
+{
+	quint32	mask[4];
+	int	rshift[4];
+	int	lshift[4];
+	// 0xFF000000 if the image has no alpha channel
+	quint32	alpha;
+
+	PixelConversion( const quint32 srcMask[] )
+	{
+		alpha = 0;
+		for ( int a = 0; a < 4; a++ ) {
+			quint32 msk = srcMask[ a ];
+			int rs = 0;
+
+			while ( msk != 0 && ( msk & 0xffffff00 ) ) {
+				msk = msk >> 1; rs++;
+			}
+
+			int ls = rgbashift[ a ];
+
+			while ( msk != 0 && ( ( msk & 0x80 ) == 0 ) ) {
+				msk = msk << 1; ls++;
+			}
+
+			mask[a] = srcMask[ a ];
+			if ( rs == ls )
+				rs = ls = 0;
+			rshift[a] = rs;
+			lshift[a] = ls;
+			if ( a == 3 && !srcMask[ a ] )
+				alpha = quint32( 0xff ) << rgbashift[ a ];
+		}
+	}
+
+	inline bool isRGBA32() const
+	{
+		return ( mask[0] == 0x000000FF && mask[1] == 0x0000FF00 && mask[2] == 0x00FF0000 && mask[3] == 0xFF000000
+				&& !( rshift[0] | rshift[1] | rshift[2] | rshift[3] | lshift[0] | lshift[1] | lshift[2] | lshift[3] ) );
+	}
+};
+
+//! Convert a row of pixels to RGBA, the loop has no branches so that it can be vectorized
+template< int bytespp >
+static void convertRowToRGBA( quint32 * dst, const quint8 * src, int w, const PixelConversion & c )
+{
+	for ( int x = 0; x < w; x++, src += bytespp ) {
+		quint32	p = src[0];
+		if constexpr ( bytespp >= 2 )
+			p = p | ( quint32( src[1] ) << 8 );
+		if constexpr ( bytespp >= 3 )
+			p = p | ( quint32( src[2] ) << 16 );
+		if constexpr ( bytespp >= 4 )
+			p = p | ( quint32( src[3] ) << 24 );
+		dst[x] = ( ( ( p & c.mask[0] ) >> c.rshift[0] ) << c.lshift[0] ) | ( ( ( p & c.mask[1] ) >> c.rshift[1] ) << c.lshift[1] )
+				| ( ( ( p & c.mask[2] ) >> c.rshift[2] ) << c.lshift[2] ) | ( ( ( p & c.mask[3] ) >> c.rshift[3] ) << c.lshift[3] )
+				| c.alpha;
+	}
+}
+
+void convertToRGBA( const quint8 * data, int w, int h, int bytespp, const quint32 mask[], bool flipV, bool flipH, quint8 * pixl )
+{
+	PixelConversion	c( mask );
+	bool	isRGBA32 = ( bytespp == 4 && c.isRGBA32() );
+	const quint8 * src = data;
+
+	for ( int y = 0; y < h; y++, src += size_t( w ) * size_t( bytespp ) ) {
+		quint32 * dst = reinterpret_cast< quint32 * >( pixl + size_t( 4 ) * size_t( w ) * size_t( flipV ? h - y - 1 : y ) );
+
+		if ( isRGBA32 ) {
+			std::memcpy( dst, src, size_t( w ) * 4 );
+		} else {
+			switch ( bytespp ) {
+			case 1:
+				convertRowToRGBA< 1 >( dst, src, w, c );
+				break;
+			case 2:
+				convertRowToRGBA< 2 >( dst, src, w, c );
+				break;
+			case 3:
+				convertRowToRGBA< 3 >( dst, src, w, c );
+				break;
+			default:
+				convertRowToRGBA< 4 >( dst, src, w, c );
+				break;
+			}
+		}
+
+		if ( flipH )
+			std::reverse( dst, dst + w );
+	}
+}
+
+void convertPalToRGBA( const quint8 * data, int w, int h, const quint32 colormap[], bool flipV, bool flipH, quint8 * pixl )
+{
+	const quint8 * src = data;
+
+	for ( int y = 0; y < h; y++, src += w ) {
+		quint32 * dst = reinterpret_cast< quint32 * >( pixl + size_t( 4 ) * size_t( w ) * size_t( flipV ? h - y - 1 : y ) );
+
+		for ( int x = 0; x < w; x++ )
+			dst[x] = colormap[src[x]];
+
+		if ( flipH )
+			std::reverse( dst, dst + w );
+	}
+}
+
+void downsampleRGBA( quint8 * dst, const quint8 * src, int w, int h )
+{
+	int	w2 = std::max< int >( w >> 1, 1 );
+	int	h2 = std::max< int >( h >> 1, 1 );
+	size_t	xo = ( w > 1 ? 4 : 0 );
+
+	for ( int y = 0; y < h2; y++ ) {
+		const quint8 *	s0 = src + size_t( std::min< int >( y * 2, h - 1 ) ) * size_t( w ) * 4;
+		const quint8 *	s1 = src + size_t( std::min< int >( y * 2 + 1, h - 1 ) ) * size_t( w ) * 4;
+		quint8 *	d = dst + size_t( y ) * size_t( w2 ) * 4;
+		// simple loop over all bytes of the row that the compiler can vectorize
+		for ( size_t x = 0; x < size_t( w2 ) * 4; x++ ) {
+			size_t	i = ( ( x >> 2 ) << 3 ) | ( x & 3 );
+			d[x] = quint8( ( unsigned( s0[i] ) + unsigned( s0[i + xo] ) + unsigned( s1[i] ) + unsigned( s1[i + xo] ) ) >> 2 );
+		}
+	}
+}
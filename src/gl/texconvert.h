@@ -0,0 +1,48 @@
+#ifndef TEXCONVERT_H_INCLUDED
+#define TEXCONVERT_H_INCLUDED
+
+#include <QtGlobal>
+
+class QIODevice;
+
+//! @file texconvert.h Conversion of TGA, BMP and NiPixelData pixels to RGBA, without OpenGL
+
+//! Mask for TGA greyscale
+extern const quint32 TGA_L_MASK[4];
+//! Mask for TGA greyscale with alpha
+extern const quint32 TGA_LA_MASK[4];
+//! Mask for TGA RGBA
+extern const quint32 TGA_RGBA_MASK[4];
+//! Mask for TGA RGB
+extern const quint32 TGA_RGB_MASK[4];
+//! Mask for BMP RGBA (identical to TGA RGB)
+extern const quint32 BMP_RGBA_MASK[4];
+
+/*! Converts RLE-encoded data into pixel data.
+ *
+ * TGA in particular uses the PackBits format described at
+ * http://en.wikipedia.org/wiki/PackBits and in the TGA spec.
+ * Returns false if the data ends before w * h pixels are decoded.
+ */
+bool uncompressRLE( QIODevice & f, int w, int h, int bytespp, quint8 * pixel );
+
+/*! Convert pixels to RGBA
+ *
+ * @param data		Pixels to convert
+ * @param w			Width of the image
+ * @param h			Height of the image
+ * @param bytespp	Number of bytes per pixel
+ * @param mask		Bitmask for pixel data
+ * @param flipV		Whether to flip the data vertically
+ * @param flipH		Whether to flip the data horizontally
+ * @param pixl		Pixels to output
+ */
+void convertToRGBA( const quint8 * data, int w, int h, int bytespp, const quint32 mask[], bool flipV, bool flipH, quint8 * pixl );
+
+//! Convert 8-bit palettized pixels to RGBA, the parameters are the same as for convertToRGBA()
+void convertPalToRGBA( const quint8 * data, int w, int h, const quint32 colormap[], bool flipV, bool flipH, quint8 * pixl );
+
+//! Downsample an RGBA image by a factor of two using a box filter, 'dst' must not overlap 'src'
+void downsampleRGBA( quint8 * dst, const quint8 * src, int w, int h );
+
+#endif
@@ -71,6 +71,9 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QOpenGLFunctions>
 #include <QOpenGLFramebufferObject>
 
+#include <algorithm>
+#include <limits>
+
 
 // NOTE: The FPS define is a frame limiter,
 //	NOT the guaranteed FPS in the viewport.
@@ -134,6 +137,7 @@ GLView::GLView( QWindow * p )
 	lastTime = QTime::currentTime();
 
 	textures = new TexCache( this );
+	textures->setAsyncLoading( true );
 
 	updateSettings();
 
@@ -241,10 +245,6 @@ void GLView::updateSettings()
 static bool envMapFileListFilterFunction( void * p, const std::string_view & s )
 {
 	(void) p;
-	if ( !s.starts_with("textures/") )
-		return false;
-	if ( !(s.ends_with(".dds") || s.ends_with(".hdr")) )
-		return false;
 	return ( s.find("/cubemaps/") != std::string_view::npos );
 }
 
@@ -255,14 +255,16 @@ bool GLView::selectPBRCubeMapForGame( quint32 bsVersion )
 	bool	isStarfield = ( bsVersion >= 170 );
 	QString	cfgPath( !isStarfield ? "Settings/Render/General/Cube Map Path FO 76" : "Settings/Render/General/Cube Map Path STF" );
 
-	std::set< std::string_view >	fileSet;
-	Game::GameManager::list_files( fileSet, (!isStarfield ? Game::FALLOUT_76 : Game::STARFIELD), &envMapFileListFilterFunction );
+	std::vector< std::string_view >	fileList;
+	Game::GameManager::list_files(
+		fileList, (!isStarfield ? Game::FALLOUT_76 : Game::STARFIELD), "textures/", { ".dds", ".hdr" },
+		&envMapFileListFilterFunction );
 	QSettings	settings;
 	std::string	prvPath( settings.value( cfgPath ).toString().toStdString() );
-	if ( !prvPath.empty() && fileSet.find( prvPath ) == fileSet.end() )
+	if ( !prvPath.empty() && !std::binary_search( fileList.begin(), fileList.end(), std::string_view( prvPath ) ) )
 		prvPath.clear();
 
-	FileBrowserWidget	fileBrowser( 640, 480, "Select Default Environment Map", fileSet, prvPath );
+	FileBrowserWidget	fileBrowser( 640, 480, "Select Default Environment Map", fileList, prvPath );
 	const std::string_view *	newPath = nullptr;
 	if ( fileBrowser.exec() == QDialog::Accepted )
 		newPath = fileBrowser.getItemSelected();
@@ -414,11 +416,13 @@ void GLView::glProjection( int x, int y )
 		GLdouble h2 = tan( ( cfg.fov / Zoom ) / 360 * M_PI ) * nr;
 		GLdouble w2 = h2 * aspect;
 		glFrustum( -w2, +w2, -h2, +h2, nr, fr );
+		scene->setViewFrustum( float( w2 ), float( h2 ), float( nr ), float( fr ), true );
 	} else {
 		// Orthographic View
 		GLdouble h2 = Dist / Zoom;
 		GLdouble w2 = h2 * aspect;
 		glOrtho( -w2, +w2, -h2, +h2, nr, fr );
+		scene->setViewFrustum( float( w2 ), float( h2 ), float( nr ), float( fr ), false );
 	}
 
 	glMatrixMode( GL_MODELVIEW );
@@ -477,6 +481,11 @@ void GLView::paintGL()
 		doCompile = false;
 	}
 
+	// Upload the textures that have been loaded in the background since the last frame
+	bool	texturesPending = textures->uploadPendingTextures( TexCache::uploadTimeBudget );
+	// Evict textures not used recently if the texture memory budget is exceeded
+	textures->nextFrame();
+
 	// Center the model
 	if ( doCenter ) {
 		setCenter();
@@ -739,6 +748,10 @@ void GLView::paintGL()
 	while ( ( err = glGetError() ) != GL_NO_ERROR )
 		qDebug() << tr( "glview.cpp - GL ERROR (paint): " ) << getGLErrorString( int(err) );
 
+	// continue uploading in the next frame if the time budget has been exceeded
+	if ( texturesPending ) [[unlikely]]
+		update();
+
 	emit paintUpdate();
 }
 
@@ -865,10 +878,10 @@ void GLView::setVisMode( Scene::VisMode mode, bool checked )
 
 typedef void (Scene::* DrawFunc)( void );
 
-int indexAt( /*GLuint *buffer,*/ NifModel * model, Scene * scene, QList<DrawFunc> drawFunc, int cycle, const QPointF & pos, int & furn )
+int indexAt( /*GLuint *buffer,*/ NifModel * model, Scene * scene, QList<DrawFunc> drawFunc, int cycle, const QPointF & pos, int & furn, float & depth )
 {
 	Q_UNUSED( model ); Q_UNUSED( cycle );
-	// Color Key O(1) selection
+	// Color Key O(1) selection of nodes, collision and furniture markers, shapes are picked by Scene::pick()
 	//	Open GL 3.0 says glRenderMode is deprecated
 	//	ATI OpenGL API implementation of GL_SELECT corrupts NifSkope memory
 	//
@@ -914,6 +927,11 @@ int indexAt( /*GLuint *buffer,*/ NifModel * model, Scene * scene, QList<DrawFunc
 	}
 	Node::SELECTING = 0;
 
+	// Depth of the pixel, for comparing with the shape hit by the ray
+	QPoint p( pos.toPoint() );
+	depth = 1.0f;
+	glReadPixels( p.x(), viewport[3] - 1 - p.y(), 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth );
+
 	fbo.release();
 
 	QImage img( fbo.toImage() );
@@ -973,21 +991,27 @@ QModelIndex GLView::indexAt( const QPointF & pos, int cycle )
 	glViewport( 0, 0, wp, hp );
 	glProjection( int( posScaled.x() + 0.5 ), int( posScaled.y() + 0.5 ) );
 
-	QList<DrawFunc> df;
+	// Shapes are picked by casting a ray on the CPU
+	Scene::PickResult hit;
+	bool shapeHit = scene->pick( float( ( posScaled.x() + 0.5 ) * 2.0 / wp - 1.0 ), float( 1.0 - ( posScaled.y() + 0.5 ) * 2.0 / hp ), hit );
 
-	if ( scene->hasOption(Scene::ShowCollision) )
-		df << &Scene::drawHavok;
+	QList<DrawFunc> df;
 
-	if ( scene->hasOption(Scene::ShowNodes) )
-		df << &Scene::drawNodes;
+	if ( scene->isSelModeObject() ) {
+		if ( scene->hasOption(Scene::ShowCollision) )
+			df << &Scene::drawHavok;
 
-	if ( scene->hasOption(Scene::ShowMarkers) )
-		df << &Scene::drawFurn;
+		if ( scene->hasOption(Scene::ShowNodes) )
+			df << &Scene::drawNodes;
 
-	df << &Scene::drawShapes;
+		if ( scene->hasOption(Scene::ShowMarkers) )
+			df << &Scene::drawFurn;
+	}
 
 	int choose = -1, furn = -1;
-	choose = ::indexAt( model, scene, df, cycle, posScaled, /*out*/ furn );
+	float depth = 1.0f;
+	if ( !df.isEmpty() )
+		choose = ::indexAt( model, scene, df, cycle, posScaled, /*out*/ furn, depth );
 
 	glPopAttrib();
 	glMatrixMode( GL_MODELVIEW );
@@ -995,16 +1019,51 @@ QModelIndex GLView::indexAt( const QPointF & pos, int cycle )
 	glMatrixMode( GL_PROJECTION );
 	glPopMatrix();
 
-	QModelIndex chooseIndex;
+	// The shape wins if it is in front of the closest node, collision or marker under the cursor
+	if ( shapeHit && ( choose == -1 || scene->depthBufferValue( hit.position[2] ) < depth ) ) {
+		choose = -1;
+		furn = -1;
+	} else {
+		shapeHit = false;
+	}
 
 	if ( scene->isSelModeVertex() ) {
-		// Vertex
-		int block = choose >> 16;
-		int vert = choose & 0xFFFF;
+		// If no triangle is hit, or the closest vertex of the triangle is not under the cursor, pick the vertex
+		// closest to the cursor on the screen within the size of the points drawn for selecting vertices,
+		// that is not behind the triangle hit
+		float	x = float( ( posScaled.x() + 0.5 ) * 2.0 / wp - 1.0 );
+		float	y = float( 1.0 - ( posScaled.y() + 0.5 ) * 2.0 / hp );
+		float	rx = GLView::Settings::vertexSelectPointSize / float( wp );
+		float	ry = GLView::Settings::vertexSelectPointSize / float( hp );
+		float	vx, vy;
+		bool	vertexHit = ( shapeHit && scene->projectPoint( hit.shape->vertexInView( hit.vertex ), vx, vy ) );
+		if ( vertexHit ) {
+			vx = ( vx - x ) / rx;
+			vy = ( vy - y ) / ry;
+			vertexHit = ( ( vx * vx + vy * vy ) <= 1.0f );
+		}
+		if ( !vertexHit ) {
+			float	maxDepth = std::numeric_limits< float >::max();
+			if ( shapeHit )
+				maxDepth = -hit.position[2] * 1.01f;
+			Scene::PickResult	v;
+			if ( scene->pickVertex( x, y, rx, ry, maxDepth, v ) ) {
+				hit = v;
+				shapeHit = true;
+			}
+		}
+	}
+
+	QModelIndex chooseIndex;
 
-		auto shape = scene->shapes.value( block );
-		if ( shape )
-			chooseIndex = shape->vertexAt( vert );
+	if ( shapeHit ) {
+		if ( scene->isSelModeVertex() ) {
+			// Vertex
+			chooseIndex = hit.shape->vertexAt( hit.vertex );
+		} else {
+			// Block Index
+			chooseIndex = model->getBlockIndex( hit.shape->id() );
+		}
 	} else if ( choose != -1 ) {
 		// Block Index
 		chooseIndex = model->getBlockIndex( choose );
@@ -1610,6 +1669,8 @@ void GLView::saveImage()
 			QImage	rgbImg;
 			QImage	alphaImg;
 			const QColor & c = cfg.background;
+			// the screenshot should not contain placeholder textures
+			textures->setAsyncLoading( false );
 			try {
 				for ( int i = 0; i <= int( useSilhouette ); i++ ) {
 					QOpenGLFramebufferObjectFormat fboFmt;
@@ -1640,6 +1701,7 @@ void GLView::saveImage()
 			}
 
 			// Restore settings and return viewport to original size
+			textures->setAsyncLoading( true );
 			scene->options = savedSceneOptions;
 			scene->visMode = savedSceneVisMode;
 			glClearColor( c.redF(), c.greenF(), c.blueF(), c.alphaF() );
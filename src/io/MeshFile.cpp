@@ -218,7 +218,7 @@ void MeshFile::update( const NifModel * nif, const QString & path )
 	if ( path.isEmpty() || !nif )
 		return;
 
-	QByteArray	data;
+	Game::GameManager::FileData	data;
 	if ( nif->getResourceFile( data, path, "geometries", ".mesh" ) )
 		update( data.data(), size_t(data.size()) );
 	if ( haveData )
@@ -3118,6 +3118,14 @@ bool NifModel::getResourceFile(
 	return gameResources->get_file( data, fullPath );
 }
 
+bool NifModel::getResourceFile(
+	Game::GameManager::FileData & data,
+	const QString & path, const char * archiveFolder, const char * extension ) const
+{
+	std::string	fullPath( Game::GameManager::get_full_path( path, archiveFolder, extension ) );
+	return gameResources->get_file( data, fullPath );
+}
+
 CE2MaterialDB * NifModel::getCE2Materials() const
 {
 	if ( gameResources->sfMaterialDB_ID ) [[likely]]
@@ -3126,9 +3134,10 @@ CE2MaterialDB * NifModel::getCE2Materials() const
 }
 
 void NifModel::listResourceFiles(
-	std::set< std::string_view > & fileSet,
+	std::vector< std::string_view > & fileList, const std::string_view & prefix,
+	std::initializer_list< std::string_view > extensions,
 	bool (*fileListFilterFunc)( void * p, const std::string_view & fileName ), void * fileListFilterFuncData ) const
 {
-	gameResources->list_files( fileSet, fileListFilterFunc, fileListFilterFuncData );
+	gameResources->list_files( fileList, prefix, extensions, fileListFilterFunc, fileListFilterFuncData );
 }
 
@@ -774,6 +774,19 @@ public:
 	}
 	bool getResourceFile(
 		QByteArray & data, const QString & path, const char * archiveFolder, const char * extension ) const;
+	//! Find resource file and map or load it to 'data' without an additional copy. The return value is true on success.
+	inline bool getResourceFile( Game::GameManager::FileData & data, const std::string_view & fullPath ) const
+	{
+		return gameResources->get_file( data, fullPath );
+	}
+	bool getResourceFile(
+		Game::GameManager::FileData & data,
+		const QString & path, const char * archiveFolder, const char * extension ) const;
+	//! Find resource file for reading it later with GameManager::read_file(), possibly on a worker thread.
+	inline bool findResourceFileRef( Game::GameManager::FileRef & ref, const std::string_view & fullPath ) const
+	{
+		return gameResources->find_file_ref( ref, fullPath );
+	}
 
 	//! Return pointer to Starfield material database, loading it first if necessary.
 	// On error, nullptr is returned.
@@ -786,10 +799,12 @@ public:
 		return gameResources->sfMaterialDB_ID;
 	}
 
-	//! List resource files available on the archive filesystem, as a set of null-terminated strings.
+	//! List resource files available on the archive filesystem that begin with 'prefix' and have any of the
+	// extensions in 'extensions', as a sorted vector of null-terminated strings.
 	// The file list can be optionally filtered by a function that returns false if the file should be excluded.
 	void listResourceFiles(
-		std::set< std::string_view > & fileSet,
+		std::vector< std::string_view > & fileList, const std::string_view & prefix,
+		std::initializer_list< std::string_view > extensions = {},
 		bool (*fileListFilterFunc)( void * p, const std::string_view & fileName ) = nullptr,
 		void * fileListFilterFuncData = nullptr ) const;
 
@@ -44,6 +44,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ui/widgets/fileselect.h"
 #include "ui/widgets/nifview.h"
 #include "ui/widgets/refrbrowser.h"
+#include "ui/widgets/texturestats.h"
 #include "ui/widgets/inspect.h"
 #include "ui/about_dialog.h"
 #include "ui/settingsdialog.h"
@@ -325,6 +326,12 @@ NifSkope::NifSkope()
 	inspect->setNifModel( nif );
 	inspect->setScene( ogl->getScene() );
 
+	// Create TextureStatsView
+	/* ********************** */
+
+	texStats = new TextureStatsView;
+	texStats->setTexCache( ogl->textures );
+
 	// Create Progress Bar
 	/* ********************** */
 	progress = new QProgressBar( ui->statusbar );
@@ -976,14 +983,15 @@ void NifSkope::openArchive( const QString & archive )
 		connect( filterTimer, &QTimer::timeout, [this]() {
 			auto text = ui->bsaFilter->text();
 
-			bsaProxyModel->setFilterRegularExpression(
-				QRegularExpression::fromWildcard(
-					text, Qt::CaseInsensitive, QRegularExpression::UnanchoredWildcardConversion ) );
-			bsaView->expandAll();
+			bsaProxyModel->setNameFilter( text );
 
 			if ( text.isEmpty() ) {
 				bsaView->collapseAll();
 				bsaProxyModel->resetFilter();
+			} else {
+				// folders with many matches are left collapsed, and are populated when expanded by the user
+				for ( const QModelIndex & i : bsaProxyModel->matchingFolders( 1000 ) )
+					bsaView->expand( i );
 			}
 
 		} );
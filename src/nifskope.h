@@ -67,6 +67,7 @@ class NifTreeView;
 class ReferenceBrowser;
 class SettingsDialog;
 class SpellBook;
+class TextureStatsView;
 class BA2File;
 class BSAModel;
 class BSAProxyModel;
@@ -377,6 +378,9 @@ private:
 	//! Transform inspect view
 	InspectView * inspect;
 
+	//! Texture loading statistics view
+	TextureStatsView * texStats;
+
 	//! The main window
 	GLView * ogl;
 	QWidget * graphicsView;
@@ -396,6 +400,7 @@ private:
 	QDockWidget * dRefr;
 	QDockWidget * dInsp;
 	QDockWidget * dBrowser;
+	QDockWidget * dTexStats;
 
 	QToolBar * tool;
 
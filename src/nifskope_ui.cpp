@@ -38,6 +38,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "spellbook.h"
 #include "version.h"
 #include "gl/glscene.h"
+#include "gl/gltex.h"
 #include "model/kfmmodel.h"
 #include "model/nifmodel.h"
 #include "model/nifproxymodel.h"
@@ -64,6 +65,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QFontDialog>
 #include <QGroupBox>
 #include <QHeaderView>
+#include <QLabel>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMouseEvent>
@@ -378,6 +380,7 @@ void NifSkope::initDockWidgets()
 	dInsp = ui->InspectDock;
 	dKfm = ui->KfmDock;
 	dBrowser = ui->BrowserDock;
+	dTexStats = ui->TextureStatsDock;
 
 	// Tabify List and Header
 	tabifyDockWidget( dList, dHeader );
@@ -390,10 +393,12 @@ void NifSkope::initDockWidgets()
 	dRefr->toggleViewAction()->setChecked( false );
 	dInsp->toggleViewAction()->setChecked( false );
 	dKfm->toggleViewAction()->setChecked( false );
+	dTexStats->toggleViewAction()->setChecked( false );
 
 	dRefr->setVisible( false );
 	dInsp->setVisible( false );
 	dKfm->setVisible( false );
+	dTexStats->setVisible( false );
 
 	ui->menuShow->addAction(dList->toggleViewAction());
 	ui->menuShow->addAction(dTree->toggleViewAction());
@@ -402,6 +407,7 @@ void NifSkope::initDockWidgets()
 	ui->menuShow->addAction(dInsp->toggleViewAction());
 	ui->menuShow->addAction(dKfm->toggleViewAction());
 	ui->menuShow->addAction(dRefr->toggleViewAction());
+	ui->menuShow->addAction(dTexStats->toggleViewAction());
 
 	ui->tView->addAction(dList->toggleViewAction());
 	ui->tView->addAction(dTree->toggleViewAction());
@@ -410,9 +416,12 @@ void NifSkope::initDockWidgets()
 	ui->tView->addAction(dInsp->toggleViewAction());
 	ui->tView->addAction(dKfm->toggleViewAction());
 	ui->tView->addAction(dRefr->toggleViewAction());
+	ui->tView->addAction(dTexStats->toggleViewAction());
 
 	// Set Inspect widget
 	dInsp->setWidget( inspect );
+	// Set Texture Statistics widget
+	dTexStats->setWidget( texStats );
 
 	connect( dList->toggleViewAction(), &QAction::triggered, tree, &NifTreeView::clearRootIndex );
 
@@ -542,6 +551,34 @@ void NifSkope::initToolBars()
 	ui->statusbar->setContentsMargins( 0, 0, 0, 0 );
 	ui->statusbar->addPermanentWidget( progress );
 
+	// Texture memory usage
+	auto texMemoryLabel = new QLabel( this );
+	texMemoryLabel->setToolTip( tr( "Estimated video memory used by textures, and the number of textures evicted to stay within the budget" ) );
+	ui->statusbar->addPermanentWidget( texMemoryLabel );
+	connect( ogl, &GLView::paintUpdate, texMemoryLabel, [this, texMemoryLabel]() {
+		const TexCache *	t = ogl->textures;
+		QString	s = tr( "Textures: %1 MB" ).arg( ( t->getResidentBytes() + 0x80000 ) >> 20 );
+		if ( TexCache::memoryBudget )
+			s += tr( " / %1 MB" ).arg( TexCache::memoryBudget >> 20 );
+		if ( t->getEvictionCount() || t->getMipDropCount() )
+			s += tr( ", %1 evicted, %2 reduced" ).arg( t->getEvictionCount() ).arg( t->getMipDropCount() );
+		if ( texMemoryLabel->text() != s )
+			texMemoryLabel->setText( s );
+	} );
+
+	// Draw statistics of the last frame
+	auto drawStatsLabel = new QLabel( this );
+	drawStatsLabel->setToolTip( tr( "Shapes drawn sorted by shader and material, nodes outside the view, "
+									"and shader program changes and texture binds in the last frame" ) );
+	ui->statusbar->addPermanentWidget( drawStatsLabel );
+	connect( ogl, &GLView::paintUpdate, drawStatsLabel, [this, drawStatsLabel]() {
+		const Scene::DrawStats &	d = ogl->getScene()->drawStats;
+		QString	s = tr( "Shapes: %1 sorted, %2 culled; %3 programs, %4 binds" )
+					.arg( d.queuedShapes ).arg( d.culledNodes ).arg( d.programSwitches ).arg( d.textureBinds );
+		if ( drawStatsLabel->text() != s )
+			drawStatsLabel->setText( s );
+	} );
+
 	// TODO: Split off into own widget
 	ui->statusbar->addPermanentWidget( filePathWidget( this ) );
 
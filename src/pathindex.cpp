@@ -0,0 +1,262 @@
+#include "pathindex.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+// Characters are mapped to 6-bit codes for the trigram index. Letters are case insensitive, and
+// uncommon characters share codes, the false positives are removed when the results are verified.
+static constexpr std::array< unsigned char, 256 > createCharCodeTable()
+{
+	std::array< unsigned char, 256 >	t{};
+	for ( unsigned int c = 0; c < 256; c++ ) {
+		if ( c >= 'a' && c <= 'z' )
+			t[c] = (unsigned char) ( c - 'a' + 1 );
+		else if ( c >= 'A' && c <= 'Z' )
+			t[c] = (unsigned char) ( c - 'A' + 1 );
+		else if ( c >= '0' && c <= '9' )
+			t[c] = (unsigned char) ( c - '0' + 27 );
+		else if ( c == '/' || c == '\\' )
+			t[c] = 37;
+		else if ( c == '.' )
+			t[c] = 38;
+		else if ( c == '_' )
+			t[c] = 39;
+		else if ( c == '-' )
+			t[c] = 40;
+		else if ( c == ' ' )
+			t[c] = 41;
+		else
+			t[c] = (unsigned char) ( 42 + ( c % 22 ) );
+	}
+	return t;
+}
+
+static constexpr std::array< unsigned char, 256 >	charCodeTable = createCharCodeTable();
+
+static inline unsigned char toLowerASCII( unsigned char c )
+{
+	return ( c >= 'A' && c <= 'Z' ? (unsigned char) ( c + ( 'a' - 'A' ) ) : c );
+}
+
+FilePathIndex::FilePathIndex()
+{
+}
+
+void FilePathIndex::clear()
+{
+	paths.clear();
+	trigramOffsets.clear();
+	trigramBlocks.clear();
+	extensionOrder.clear();
+}
+
+void FilePathIndex::getTrigrams( std::vector< std::uint32_t > & codes, const std::string_view & s )
+{
+	if ( s.length() < 3 )
+		return;
+	const unsigned char *	p = reinterpret_cast< const unsigned char * >( s.data() );
+	std::uint32_t	c = ( std::uint32_t( charCodeTable[p[0]] ) << 6 ) | charCodeTable[p[1]];
+	for ( size_t i = 2; i < s.length(); i++ ) {
+		c = ( ( c << 6 ) | charCodeTable[p[i]] ) & ( ( 1U << trigramBits ) - 1U );
+		codes.push_back( c );
+	}
+}
+
+void FilePathIndex::getBlockTrigrams( std::vector< std::uint32_t > & codes, size_t blockNum ) const
+{
+	codes.clear();
+	size_t	i0 = blockNum << blockSizeShift;
+	size_t	i1 = std::min( paths.size(), i0 + ( size_t(1) << blockSizeShift ) );
+	for ( size_t i = i0; i < i1; i++ )
+		getTrigrams( codes, paths[i] );
+	std::sort( codes.begin(), codes.end() );
+	codes.erase( std::unique( codes.begin(), codes.end() ), codes.end() );
+}
+
+void FilePathIndex::build( bool isSorted, bool createTrigramIndex )
+{
+	if ( !isSorted )
+		std::sort( paths.begin(), paths.end() );
+	paths.erase( std::unique( paths.begin(), paths.end() ), paths.end() );
+
+	trigramOffsets.clear();
+	trigramBlocks.clear();
+	extensionOrder.resize( paths.size() );
+	for ( size_t i = 0; i < paths.size(); i++ )
+		extensionOrder[i] = std::uint32_t( i );
+	// stable sort keeps the paths with the same extension in ascending order
+	std::stable_sort( extensionOrder.begin(), extensionOrder.end(),
+						[this]( std::uint32_t a, std::uint32_t b ) {
+							return ( getExtension( paths[a] ) < getExtension( paths[b] ) );
+						} );
+	if ( paths.empty() || !createTrigramIndex )
+		return;
+	trigramOffsets.resize( ( size_t(1) << trigramBits ) + 1, 0 );
+
+	size_t	blockCnt = ( paths.size() + ( size_t(1) << blockSizeShift ) - 1 ) >> blockSizeShift;
+	std::vector< std::uint32_t >	codes;
+	// count the number of blocks for each trigram
+	for ( size_t b = 0; b < blockCnt; b++ ) {
+		getBlockTrigrams( codes, b );
+		for ( std::uint32_t c : codes )
+			trigramOffsets[c + 1]++;
+	}
+	for ( size_t i = 1; i < trigramOffsets.size(); i++ )
+		trigramOffsets[i] += trigramOffsets[i - 1];
+
+	// store block numbers, the lists are sorted because the blocks are processed in ascending order
+	trigramBlocks.resize( trigramOffsets.back() );
+	std::vector< std::uint32_t >	writePos( trigramOffsets.begin(), trigramOffsets.end() - 1 );
+	for ( size_t b = 0; b < blockCnt; b++ ) {
+		getBlockTrigrams( codes, b );
+		for ( std::uint32_t c : codes )
+			trigramBlocks[writePos[c]++] = std::uint32_t( b );
+	}
+}
+
+void FilePathIndex::findPrefix( size_t & firstPath, size_t & endPath, const std::string_view & prefix ) const
+{
+	auto	i0 = std::lower_bound( paths.begin(), paths.end(), prefix );
+	auto	i1 = std::partition_point( i0, paths.end(),
+										[&prefix]( const std::string_view & s ) {
+											return s.starts_with( prefix );
+										} );
+	firstPath = size_t( i0 - paths.begin() );
+	endPath = size_t( i1 - paths.begin() );
+}
+
+void FilePathIndex::findFiles(
+	std::vector< std::uint32_t > & results, const std::string_view & prefix, const std::string_view & ext ) const
+{
+	if ( ext.empty() ) {
+		size_t	i0, i1;
+		findPrefix( i0, i1, prefix );
+		for ( size_t i = i0; i < i1; i++ )
+			results.push_back( std::uint32_t( i ) );
+		return;
+	}
+
+	auto	e0 = std::partition_point( extensionOrder.begin(), extensionOrder.end(),
+										[this, &ext]( std::uint32_t i ) {
+											return ( getExtension( paths[i] ) < ext );
+										} );
+	auto	e1 = std::partition_point( e0, extensionOrder.end(),
+										[this, &ext]( std::uint32_t i ) {
+											return ( getExtension( paths[i] ) == ext );
+										} );
+	// paths with the same extension are sorted, so the prefix matches are contiguous
+	auto	i = std::partition_point( e0, e1,
+									[this, &prefix]( std::uint32_t n ) {
+										return ( paths[n] < prefix );
+									} );
+	for ( ; i != e1 && paths[*i].starts_with( prefix ); i++ )
+		results.push_back( *i );
+}
+
+std::string_view FilePathIndex::getExtension( const std::string_view & path )
+{
+	size_t	n = path.rfind( '.' );
+	if ( n == std::string_view::npos )
+		return std::string_view();
+	size_t	d = path.find( '/', n );
+	if ( d != std::string_view::npos )
+		return std::string_view();
+	return path.substr( n );
+}
+
+bool FilePathIndex::matchPattern( const std::string_view & path, const std::string_view & pattern )
+{
+	// Unanchored match: the pattern is treated as if it began and ended with '*'
+	size_t	p = 0;
+	size_t	s = 0;
+	size_t	starP = 0;
+	size_t	starS = 0;
+	while ( true ) {
+		if ( p >= pattern.length() )
+			return true;
+		if ( s >= path.length() )
+			break;
+		char	c = pattern[p];
+		if ( c == '*' ) {
+			starP = ++p;
+			starS = s;
+		} else if ( c == '?' || toLowerASCII( (unsigned char) c ) == toLowerASCII( (unsigned char) path[s] ) ) {
+			p++;
+			s++;
+		} else {
+			p = starP;
+			s = ++starS;
+		}
+	}
+	while ( p < pattern.length() && pattern[p] == '*' )
+		p++;
+	return ( p >= pattern.length() );
+}
+
+std::string FilePathIndex::normalizePattern( const std::string_view & pattern )
+{
+	std::string	s( pattern );
+	for ( char & c : s )
+		c = ( c == '\\' ? '/' : char( toLowerASCII( (unsigned char) c ) ) );
+	return s;
+}
+
+void FilePathIndex::find( std::vector< std::uint32_t > & results, const std::string_view & pattern, bool nameOnly ) const
+{
+	if ( paths.empty() )
+		return;
+
+	std::string	p( normalizePattern( pattern ) );
+
+	// Collect the trigrams of all literal parts of the pattern
+	std::vector< std::uint32_t >	codes;
+	for ( size_t i = 0; i < p.length(); ) {
+		size_t	j = p.find_first_of( "*?", i );
+		if ( j == std::string::npos )
+			j = p.length();
+		getTrigrams( codes, std::string_view( p.data() + i, j - i ) );
+		i = j + 1;
+	}
+	std::sort( codes.begin(), codes.end() );
+	codes.erase( std::unique( codes.begin(), codes.end() ), codes.end() );
+
+	// Intersect the block lists, starting from the shortest one
+	std::vector< std::uint32_t >	candidates;
+	bool	allBlocks = ( codes.empty() || trigramOffsets.empty() );
+	if ( !allBlocks ) {
+		std::sort( codes.begin(), codes.end(),
+					[this]( std::uint32_t a, std::uint32_t b ) {
+						return ( ( trigramOffsets[a + 1] - trigramOffsets[a] )
+								< ( trigramOffsets[b + 1] - trigramOffsets[b] ) );
+					} );
+		candidates.assign( trigramBlocks.begin() + trigramOffsets[codes[0]],
+							trigramBlocks.begin() + trigramOffsets[codes[0] + 1] );
+		std::vector< std::uint32_t >	tmp;
+		for ( size_t i = 1; i < codes.size() && !candidates.empty(); i++ ) {
+			tmp.clear();
+			std::set_intersection( candidates.begin(), candidates.end(),
+									trigramBlocks.begin() + trigramOffsets[codes[i]],
+									trigramBlocks.begin() + trigramOffsets[codes[i] + 1],
+									std::back_inserter( tmp ) );
+			candidates.swap( tmp );
+		}
+	}
+
+	size_t	blockCnt = ( allBlocks ? ( ( paths.size() + ( size_t(1) << blockSizeShift ) - 1 ) >> blockSizeShift ) : candidates.size() );
+	for ( size_t k = 0; k < blockCnt; k++ ) {
+		size_t	b = ( allBlocks ? k : size_t( candidates[k] ) );
+		size_t	i0 = b << blockSizeShift;
+		size_t	i1 = std::min( paths.size(), i0 + ( size_t(1) << blockSizeShift ) );
+		for ( size_t i = i0; i < i1; i++ ) {
+			std::string_view	s( paths[i] );
+			if ( nameOnly ) {
+				size_t	n = s.rfind( '/' );
+				if ( n != std::string_view::npos )
+					s.remove_prefix( n + 1 );
+			}
+			if ( matchPattern( s, p ) )
+				results.push_back( std::uint32_t( i ) );
+		}
+	}
+}
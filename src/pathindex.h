@@ -0,0 +1,80 @@
+#ifndef PATHINDEX_H_INCLUDED
+#define PATHINDEX_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Sorted table of resource file paths with a trigram index for substring and wildcard searches
+/*!
+ * Prefix queries are answered by binary search on the sorted table, and extension queries by
+ * binary search on a secondary ordering of the paths by extension.
+ *
+ * Paths are stored as string views, the data they refer to (typically file names owned by a BA2File)
+ * must remain valid while the index is in use. The trigram index is built over blocks of consecutive
+ * sorted paths, which share most of their folder trigrams, and is only used to find candidate blocks.
+ * All results are verified against the full query, so hash collisions do not cause false matches.
+ */
+class FilePathIndex
+{
+public:
+	FilePathIndex();
+
+	void clear();
+	//! Add a path to the table, build() needs to be called before the new path can be searched
+	inline void addPath( const std::string_view & path )
+	{
+		paths.push_back( path );
+	}
+	//! Sort the path table (unless 'isSorted' is true), remove duplicates and create the search indices.
+	// If 'createTrigramIndex' is false, find() scans all paths, but prefix and extension queries are still fast.
+	void build( bool isSorted = false, bool createTrigramIndex = true );
+
+	inline size_t size() const
+	{
+		return paths.size();
+	}
+	inline const std::string_view & operator[]( size_t n ) const
+	{
+		return paths[n];
+	}
+	inline const std::vector< std::string_view > & getPaths() const
+	{
+		return paths;
+	}
+
+	//! Append to 'results' the indices of all paths matching 'pattern', in ascending order.
+	// The pattern may contain '*' (any number of characters) and '?' (any single character) wildcards,
+	// and it can match anywhere in the path. Letters are compared case insensitively.
+	// If 'nameOnly' is true, only the part of the path after the last '/' is searched.
+	void find( std::vector< std::uint32_t > & results, const std::string_view & pattern, bool nameOnly = false ) const;
+	//! Get the range of indices of the paths that begin with 'prefix'
+	void findPrefix( size_t & firstPath, size_t & endPath, const std::string_view & prefix ) const;
+	//! Append to 'results' the indices of the paths that begin with 'prefix' and have the extension 'ext'
+	// (e.g. ".dds", or any extension if empty), in ascending order. The query does not scan paths outside the result.
+	void findFiles( std::vector< std::uint32_t > & results, const std::string_view & prefix, const std::string_view & ext ) const;
+	//! Returns the extension of 'path' including the '.', or an empty string if the file name has no extension
+	static std::string_view getExtension( const std::string_view & path );
+	//! Returns true if 'path' matches the wildcard pattern as described for find()
+	static bool matchPattern( const std::string_view & path, const std::string_view & pattern );
+	//! Convert search pattern to lower case and replace backslashes with forward slashes
+	static std::string normalizePattern( const std::string_view & pattern );
+
+protected:
+	static constexpr unsigned int	blockSizeShift = 3;
+	static constexpr unsigned int	trigramBits = 18;
+
+	static void getTrigrams( std::vector< std::uint32_t > & codes, const std::string_view & s );
+	void getBlockTrigrams( std::vector< std::uint32_t > & codes, size_t blockNum ) const;
+
+	std::vector< std::string_view >	paths;
+	// offsets of the block lists in trigramBlocks, indexed by trigram code
+	std::vector< std::uint32_t >	trigramOffsets;
+	// sorted lists of block numbers containing each trigram
+	std::vector< std::uint32_t >	trigramBlocks;
+	// path indices sorted by extension first, and then by full path
+	std::vector< std::uint32_t >	extensionOrder;
+};
+
+#endif
@@ -166,18 +166,15 @@ public:
 	}
 };
 
-static bool bgsmFileNameFilterFunc( [[maybe_unused]] void * p, const std::string_view & s )
-{
-	return ( s.starts_with( "materials/" ) && ( s.ends_with( ".bgsm" ) || s.ends_with( ".bgem" ) ) );
-}
-
 QString spEditStringIndex::browseMaterial( const NifModel * nif, const QString & matPath )
 {
 	std::set< std::string_view >	materials;
 	AllocBuffers	stringBuf;
 	quint32	bsVersion = nif->getBSVersion();
 	if ( bsVersion < 170 ) {
-		nif->listResourceFiles( materials, &bgsmFileNameFilterFunc );
+		std::vector< std::string_view >	fileList;
+		nif->listResourceFiles( fileList, "materials/", { ".bgsm", ".bgem" } );
+		materials.insert( fileList.begin(), fileList.end() );
 	} else {
 		const CE2MaterialDB * matDB = nif->getCE2Materials();
 		if ( matDB )
@@ -2,7 +2,11 @@
 
 #include "spellbook.h"
 #include "gl/gltex.h"
+#include "nifskope.h"
 #include "spells/blocks.h"
+#include "texturedecoder.h"
+#include "textureencoder.h"
+#include "textureinfo.h"
 #include "ui/widgets/fileselect.h"
 #include "ui/widgets/nifeditors.h"
 #include "ui/widgets/uvedit.h"
@@ -15,15 +19,22 @@
 #include <QCheckBox>
 #include <QColorDialog>
 #include <QComboBox>
+#include <QDir>
 #include <QFileDialog>
 #include <QGridLayout>
 #include <QLabel>
 #include <QListView>
+#include <QMessageBox>
 #include <QPainter>
 #include <QPushButton>
+#include <QSaveFile>
 #include <QSettings>
 #include <QStringListModel>
 
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+
 
 // Brief description is deliberately not autolinked to class Spell
 /*! \file texture.cpp
@@ -156,11 +167,6 @@ QModelIndex getUV( const NifModel * nif, const QModelIndex & index )
 	return QModelIndex();
 }
 
-static bool texturePathFilterFunc( [[maybe_unused]] void *p, const std::string_view & s )
-{
-	return ( s.starts_with( "textures/" ) && s.ends_with( ".dds" ) );
-}
-
 //! Selects a texture filename
 class spChooseTexture final : public Spell
 {
@@ -242,8 +248,8 @@ public:
 		if ( file.isEmpty() )
 			file = settings.value( key, QVariant( QDir::homePath() ) ).toString();
 
-		std::set< std::string_view >	texturePaths;
-		nif->listResourceFiles( texturePaths, &texturePathFilterFunc );
+		std::vector< std::string_view >	texturePaths;
+		nif->listResourceFiles( texturePaths, "textures/", { ".dds" } );
 		std::string	prvPath( file.toStdString() );
 		FileBrowserWidget	fileBrowser( 800, 600, "Choose Texture", texturePaths, prvPath );
 		if ( fileBrowser.exec() == QDialog::Accepted ) {
@@ -877,12 +883,40 @@ public:
 
 REGISTER_SPELL( spMultiApplyMode )
 
+//! Read the fields of an NiPixelData block that TextureInfo::parsePixelData() needs
+static TextureInfo::PixelDataHeader readPixelDataHeader( const NifModel * nif, const QModelIndex & iData )
+{
+	TextureInfo::PixelDataHeader	h;
+	h.mipLevels = nif->get<uint>( iData, "Num Mipmaps" );
+	QModelIndex	iMipmaps = nif->getIndex( iData, "Mipmaps" );
+	if ( h.mipLevels > 0 && iMipmaps.isValid() ) {
+		QModelIndex	iMipmap = nif->getIndex( iMipmaps, 0 );
+		h.width = nif->get<uint>( iMipmap, "Width" );
+		h.height = nif->get<uint>( iMipmap, "Height" );
+	}
+	h.faces = std::max< std::uint32_t >( nif->get<uint>( iData, "Num Faces" ), 1U );
+	h.bitsPerPixel = nif->get<uint>( iData, "Bits Per Pixel" );
+	h.bytesPerPixel = nif->get<uint>( iData, "Bytes Per Pixel" );
+	h.pixelFormat = nif->get<uint>( iData, "Pixel Format" );
+	h.hasPalette = nif->getBlockIndex( nif->getLink( iData, "Palette" ) ).isValid();
+
+	QModelIndex	iPixelData = nif->getIndex( iData, "Pixel Data" );
+	if ( iPixelData.isValid() ) {
+		h.pixelDataSize = 0;
+		if ( const QByteArray * pdata = nif->get<QByteArray *>( nif->getIndex( iPixelData, 0 ) ) )
+			h.pixelDataSize = pdata->size();
+	}
+
+	return h;
+}
+
 //! Debug function - display information about a texture
 class spTexInfo final : public Spell
 {
 public:
 	QString name() const override final { return Spell::tr( "Info" ); }
 	QString page() const override final { return Spell::tr( "Texture" ); }
+	bool constant() const override final { return true; }
 
 	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
 	{
@@ -896,25 +930,43 @@ public:
 
 	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final
 	{
-		TexCache * tex = new TexCache();
-		tex->setNifFolder( nif->getFolder() );
-		int isExternal = nif->get<int>( index, "Use External" );
-
-		if ( isExternal ) {
-			QString filename = nif->get<QString>( index, "File Name" );
-			tex->bind( filename );
+		QModelIndex iBlock = nif->getBlockIndex( index );
+		TextureInfo info;
+		QString filename;
+		QImage preview;
+
+		if ( nif->get<int>( iBlock, "Use External" ) ) {
+			filename = nif->get<QString>( iBlock, "File Name" );
+			QString fullPath = TexCache::find( filename, nif );
+			QByteArray data;
+			if ( nif->getResourceFile( data, Game::GameManager::get_full_path( fullPath, "textures", "" ) ) ) {
+				info.parse( data.constData(), size_t( data.size() ), fullPath );
+				if ( info.fileFormat == TextureInfo::FileDDS && info.isValid() )
+					preview = TextureDecoder::decodeDDS( data.constData(), size_t( data.size() ), 128 );
+			} else {
+				info.errors.append( Spell::tr( "texture file not found" ) );
+			}
 		} else {
-			tex->bind( index );
+			filename = Spell::tr( "Internal texture" );
+			QModelIndex iData = nif->getBlockIndex( nif->getLink( iBlock, "Pixel Data" ) );
+			if ( iData.isValid() ) {
+				info.parsePixelData( readPixelDataHeader( nif, iData ) );
+			} else {
+				info.fileFormat = TextureInfo::FileNIF;
+				info.errors.append( Spell::tr( "invalid pixel data block" ) );
+			}
 		}
 
-		qDebug() << tex->info( index );
+		QMessageBox msgBox( QMessageBox::Information, Spell::tr( "Texture Info" ), filename + "\n\n" + info.toString(),
+							QMessageBox::Ok, qApp->activeWindow() );
+		if ( !preview.isNull() )
+			msgBox.setIconPixmap( QPixmap::fromImage( preview ) );
+		msgBox.exec();
 		return QModelIndex();
 	}
 };
 
-#ifndef QT_NO_DEBUG
 REGISTER_SPELL( spTexInfo )
-#endif
 
 //! Export a packed NiPixelData texture
 class spExportTexture final : public Spell
@@ -1296,3 +1348,289 @@ public:
 };
 
 REGISTER_SPELL( spTextureFlipper )
+
+//! Re-encode the DDS textures used by multiple NIF files, and regenerate their mip maps
+class spBatchConvertTextures final : public Spell
+{
+public:
+	QString name() const override final { return Spell::tr( "Convert Textures of Multiple NIF Files" ); }
+	QString page() const override final { return Spell::tr( "Batch" ); }
+	QIcon icon() const override final
+	{
+		return QIcon();
+	}
+	bool constant() const override final { return true; }
+	bool instant() const override final { return true; }
+
+	bool isApplicable( [[maybe_unused]] const NifModel * nif, const QModelIndex & index ) override final
+	{
+		return !index.isValid();
+	}
+
+	struct BatchState
+	{
+		TextureEncoder::Options	options;
+		QString	outputPath;
+		// full paths of the textures already converted, each is processed only once for all NIF files
+		std::unordered_set< std::string >	processedPaths;
+		int	convertedCnt = 0;
+		std::uint64_t	inputBytes = 0;
+		std::uint64_t	outputBytes = 0;
+		double	worstPSNR = 999.0;
+		QString	worstPSNRPath;
+		QStringList	errors;
+	};
+	// converted textures with a lower PSNR are assumed to be broken, and are not written
+	static constexpr double	minimumPSNR = 20.0;
+
+	static void addTexturePaths( QStringList & paths, const NifModel * nif, const QModelIndex & iBlock, const QString & name );
+	static bool processFile( NifModel * nif, void * p );
+	QModelIndex cast( NifModel * nif, const QModelIndex & index ) override final;
+};
+
+void spBatchConvertTextures::addTexturePaths(
+	QStringList & paths, const NifModel * nif, const QModelIndex & iBlock, const QString & name )
+{
+	auto	iString = nif->getIndex( iBlock, name );
+	if ( !iString.isValid() )
+		return;
+	if ( nif->isArray( iString ) )
+		paths << nif->getArray<QString>( iString );
+	else
+		paths << nif->get<QString>( iString );
+}
+
+bool spBatchConvertTextures::processFile( NifModel * nif, void * p )
+{
+	BatchState &	s = *( reinterpret_cast< BatchState * >( p ) );
+
+	// same texture paths as checked by spErrorInvalidPaths, textures referenced only by material files are not included
+	QStringList	paths;
+	for ( int i = 0; i < nif->getBlockCount(); i++ ) {
+		QModelIndex	iBlock = nif->getBlockIndex( i );
+		if ( nif->blockInherits( iBlock, "BSShaderTextureSet" ) ) {
+			addTexturePaths( paths, nif, iBlock, "Textures" );
+		} else if ( nif->blockInherits( iBlock, "BSShaderNoLightingProperty" ) ) {
+			addTexturePaths( paths, nif, iBlock, "File Name" );
+		} else if ( nif->blockInherits( iBlock, "BSEffectShaderProperty" ) ) {
+			for ( const char * name : { "Source Texture", "Greyscale Texture", "Env Map Texture", "Normal Texture", "Env Mask Texture" } )
+				addTexturePaths( paths, nif, iBlock, name );
+		} else if ( nif->blockInherits( iBlock, "NiSourceTexture" ) && nif->get<int>( iBlock, "Use External" ) ) {
+			addTexturePaths( paths, nif, iBlock, "File Name" );
+		}
+	}
+
+	struct ConvertJob
+	{
+		Game::GameManager::FileRef	ref;
+		QString	errorMessage;
+		double	psnr = 999.0;
+		std::uint64_t	inputBytes = 0;
+		std::uint64_t	outputBytes = 0;
+	};
+	std::vector< ConvertJob >	jobs;
+	for ( const auto & path : paths ) {
+		std::string	fullPath( Game::GameManager::get_full_path( path, "textures", "" ) );
+		if ( !fullPath.ends_with( ".dds" ) || !s.processedPaths.insert( fullPath ).second )
+			continue;
+		// files are located on the main thread, and read by the worker threads
+		jobs.emplace_back();
+		if ( !nif->findResourceFileRef( jobs.back().ref, fullPath ) ) {
+			s.errors.append( QString( "%1: file not found" ).arg( QString::fromStdString( fullPath ) ) );
+			jobs.pop_back();
+		}
+	}
+	if ( jobs.empty() )
+		return false;
+
+	std::atomic< size_t >	nextJob( 0 );
+	auto	convertFiles = [&]() {
+		Game::GameManager::FileData	data;
+		size_t	i;
+		while ( ( i = nextJob.fetch_add( 1 ) ) < jobs.size() ) {
+			ConvertJob &	j = jobs[i];
+			std::string	err;
+			if ( !Game::GameManager::read_file( data, j.ref, &err ) ) {
+				j.errorMessage = QString::fromStdString( err );
+				continue;
+			}
+			j.inputBytes = std::uint64_t( data.size() );
+			QByteArray	buf = TextureEncoder::convertDDS( data.data(), size_t( data.size() ), s.options, &j.errorMessage, &j.psnr );
+			data.clear();
+			if ( buf.isEmpty() )
+				continue;
+
+			// round trip check of the output, the PSNR is calculated by decoding the converted image again
+			TextureInfo	info;
+			if ( !info.parseDDS( reinterpret_cast< const unsigned char * >( buf.constData() ), size_t( buf.size() ) )
+				|| std::uint64_t( buf.size() ) < ( std::uint64_t( info.dataOffset ) + info.dataSize ) ) {
+				j.errorMessage = QString( "verification failed: invalid DDS output" );
+				continue;
+			}
+			if ( s.options.generateMips && !info.hasCompleteMipChain() ) {
+				j.errorMessage = QString( "verification failed: incomplete mip chain" );
+				continue;
+			}
+			if ( j.psnr < minimumPSNR ) {
+				j.errorMessage = QString( "verification failed: PSNR is %1 dB" ).arg( j.psnr, 0, 'f', 2 );
+				continue;
+			}
+
+			QString	fileName( QDir( s.outputPath ).filePath( QString::fromStdString( j.ref.fullPath ) ) );
+			if ( !QDir().mkpath( QFileInfo( fileName ).absolutePath() ) ) {
+				j.errorMessage = QString( "error creating output directory" );
+				continue;
+			}
+			QSaveFile	f( fileName );
+			if ( !( f.open( QIODevice::WriteOnly ) && f.write( buf ) == buf.size() && f.commit() ) ) {
+				j.errorMessage = QString( "error writing output file: %1" ).arg( f.errorString() );
+				continue;
+			}
+			j.outputBytes = std::uint64_t( buf.size() );
+		}
+	};
+
+	// one texture per thread, since most textures are too small for decoding and encoding them to scale well
+	size_t	threadCount = std::max< size_t >( std::thread::hardware_concurrency(), 1 );
+	threadCount = std::min< size_t >( std::min< size_t >( threadCount, jobs.size() ), 64 );
+	s.options.threadCount = 1;
+	std::vector< std::thread >	threads;
+	for ( size_t i = 1; i < threadCount; i++ )
+		threads.emplace_back( convertFiles );
+	convertFiles();
+	for ( auto & t : threads )
+		t.join();
+
+	for ( const auto & j : jobs ) {
+		QString	path( QString::fromStdString( j.ref.fullPath ) );
+		if ( !j.errorMessage.isEmpty() ) {
+			s.errors.append( QString( "%1: %2" ).arg( path, j.errorMessage ) );
+			continue;
+		}
+		s.convertedCnt++;
+		s.inputBytes += j.inputBytes;
+		s.outputBytes += j.outputBytes;
+		if ( j.psnr < s.worstPSNR ) {
+			s.worstPSNR = j.psnr;
+			s.worstPSNRPath = path;
+		}
+	}
+
+	// the NIF files are not modified
+	return false;
+}
+
+QModelIndex spBatchConvertTextures::cast( NifModel * nif, const QModelIndex & index )
+{
+	if ( index.isValid() )
+		return index;
+
+	BatchState	s;
+	QSettings	settings;
+	{
+		QDialog	dlg;
+		QLabel *	lb = new QLabel( &dlg );
+		lb->setText( "Convert the DDS textures used by multiple models, and write them to an output folder" );
+		QComboBox *	formatBox = new QComboBox( &dlg );
+		formatBox->addItem( "Keep Format", QVariant( 0U ) );
+		formatBox->addItem( "BC1 (DXT1)", QVariant( 71U ) );
+		formatBox->addItem( "BC1 sRGB", QVariant( 72U ) );
+		formatBox->addItem( "BC3 (DXT5)", QVariant( 77U ) );
+		formatBox->addItem( "BC3 sRGB", QVariant( 78U ) );
+		formatBox->addItem( "BC4 (ATI1)", QVariant( 80U ) );
+		formatBox->addItem( "BC5 (ATI2)", QVariant( 83U ) );
+		formatBox->addItem( "BC5 Signed", QVariant( 84U ) );
+		formatBox->addItem( "R8G8B8A8", QVariant( 28U ) );
+		formatBox->addItem( "R8G8B8A8 sRGB", QVariant( 29U ) );
+		formatBox->setCurrentIndex( std::max( formatBox->findData(
+			QVariant( settings.value( "Spells//Batch/Convert Textures/Format", 0U ).toUInt() ) ), 0 ) );
+		QComboBox *	sizeBox = new QComboBox( &dlg );
+		sizeBox->addItem( "No Limit", QVariant( 0U ) );
+		for ( std::uint32_t n = 8192; n >= 128; n = n >> 1 )
+			sizeBox->addItem( QString::number( n ), QVariant( n ) );
+		sizeBox->setCurrentIndex( std::max( sizeBox->findData(
+			QVariant( settings.value( "Spells//Batch/Convert Textures/Maximum Size", 0U ).toUInt() ) ), 0 ) );
+		QCheckBox *	checkMips = new QCheckBox( "Regenerate Mip Maps", &dlg );
+		checkMips->setChecked( settings.value( "Spells//Batch/Convert Textures/Generate Mips", true ).toBool() );
+		QPushButton *	okButton = new QPushButton( "OK", &dlg );
+		QPushButton *	cancelButton = new QPushButton( "Cancel", &dlg );
+
+		QGridLayout *	grid = new QGridLayout;
+		dlg.setLayout( grid );
+		grid->addWidget( lb, 0, 0, 1, 5 );
+		grid->addWidget( new QLabel( "", &dlg ), 1, 0, 1, 5 );
+		grid->addWidget( new QLabel( "Output Format:", &dlg ), 2, 0, 1, 2 );
+		grid->addWidget( formatBox, 2, 2, 1, 3 );
+		grid->addWidget( new QLabel( "Maximum Width and Height:", &dlg ), 3, 0, 1, 2 );
+		grid->addWidget( sizeBox, 3, 2, 1, 3 );
+		grid->addWidget( checkMips, 4, 0, 1, 5 );
+		grid->addWidget( new QLabel( "", &dlg ), 5, 0, 1, 5 );
+		grid->addWidget( okButton, 6, 1, 1, 1 );
+		grid->addWidget( cancelButton, 6, 3, 1, 1 );
+
+		QObject::connect( okButton, &QPushButton::clicked, &dlg, &QDialog::accept );
+		QObject::connect( cancelButton, &QPushButton::clicked, &dlg, &QDialog::reject );
+
+		if ( dlg.exec() != QDialog::Accepted )
+			return index;
+
+		s.options.dxgiFormat = formatBox->currentData().toUInt();
+		s.options.maxSize = sizeBox->currentData().toUInt();
+		s.options.generateMips = checkMips->isChecked();
+		settings.setValue( "Spells//Batch/Convert Textures/Format", QVariant( s.options.dxgiFormat ) );
+		settings.setValue( "Spells//Batch/Convert Textures/Maximum Size", QVariant( s.options.maxSize ) );
+		settings.setValue( "Spells//Batch/Convert Textures/Generate Mips", QVariant( s.options.generateMips ) );
+	}
+
+	QStringList	fileList;
+	{
+		QFileDialog	fd( nullptr, "Select NIF Files to Process" );
+		fd.setFileMode( QFileDialog::ExistingFiles );
+		fd.setNameFilter( "NIF files (*.nif)" );
+		if ( fd.exec() )
+			fileList = fd.selectedFiles();
+	}
+	if ( fileList.isEmpty() )
+		return index;
+
+	{
+		QString	key( "Spells//Batch/Convert Textures/Output Path" );
+		QFileDialog	dialog( nullptr, "Select Output Data Path" );
+		dialog.setFileMode( QFileDialog::Directory );
+		QString	dstPath( settings.value( key ).toString() );
+		if ( !dstPath.isEmpty() )
+			dialog.setDirectory( dstPath );
+		if ( !dialog.exec() )
+			return index;
+		s.outputPath = dialog.selectedFiles().value( 0 );
+		if ( s.outputPath.isEmpty() )
+			return index;
+		settings.setValue( key, QVariant( s.outputPath ) );
+	}
+
+	NifSkope *	w = dynamic_cast< NifSkope * >( nif->getWindow() );
+	if ( !w )
+		return index;
+	w->batchProcessFiles( fileList, &processFile, &s );
+
+	QString	msg( QString( "%1 textures converted, %2 MB read, %3 MB written" )
+					.arg( s.convertedCnt ).arg( double( s.inputBytes ) / 1048576.0, 0, 'f', 1 )
+					.arg( double( s.outputBytes ) / 1048576.0, 0, 'f', 1 ) );
+	if ( s.convertedCnt ) {
+		if ( s.worstPSNR < 999.0 )
+			msg += QString( "\nLowest PSNR: %1 dB (%2)" ).arg( s.worstPSNR, 0, 'f', 2 ).arg( s.worstPSNRPath );
+		else
+			msg += QString( "\nAll textures were converted without loss" );
+	}
+	if ( !s.errors.isEmpty() )
+		msg += QString( "\n%1 textures could not be converted" ).arg( s.errors.size() );
+	QMessageBox	msgBox( ( s.errors.isEmpty() ? QMessageBox::Information : QMessageBox::Warning ),
+						Spell::tr( "Convert Textures" ), msg, QMessageBox::Ok, w );
+	if ( !s.errors.isEmpty() )
+		msgBox.setDetailedText( s.errors.join( QChar( '\n' ) ) );
+	msgBox.exec();
+
+	return index;
+}
+
+REGISTER_SPELL( spBatchConvertTextures )
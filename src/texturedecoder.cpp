@@ -0,0 +1,900 @@
+#include "texturedecoder.h"
+
+#include "textureinfo.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+
+static inline std::uint32_t readUInt16( const unsigned char * p )
+{
+	return qFromLittleEndian< quint16 >( p );
+}
+
+static inline std::uint32_t readUInt32( const unsigned char * p )
+{
+	return qFromLittleEndian< quint32 >( p );
+}
+
+static inline std::uint64_t readUInt64( const unsigned char * p )
+{
+	return qFromLittleEndian< quint64 >( p );
+}
+
+static inline std::uint32_t packRGBA( std::uint32_t r, std::uint32_t g, std::uint32_t b, std::uint32_t a = 255 )
+{
+	return ( r | ( g << 8 ) | ( b << 16 ) | ( a << 24 ) );
+}
+
+static inline std::uint32_t packGrey( std::uint32_t c )
+{
+	return ( ( c * 0x00010101U ) | 0xFF000000U );
+}
+
+static inline float halfToFloat( std::uint32_t h )
+{
+	std::uint32_t	s = ( h & 0x8000U ) << 16;
+	std::uint32_t	e = ( h >> 10 ) & 0x1F;
+	std::uint32_t	m = h & 0x03FF;
+	if ( !e ) [[unlikely]] {
+		float	f = float( int( m ) ) * ( 1.0f / 16777216.0f );
+		return ( !s ? f : -f );
+	}
+	std::uint32_t	b = s | ( e < 31 ? ( ( e + 112 ) << 23 ) : 0x7F800000U ) | ( m << 13 );
+	float	f;
+	std::memcpy( &f, &b, sizeof( float ) );
+	return f;
+}
+
+static inline std::uint32_t floatToUNorm8( float x )
+{
+	if ( !( x > 0.0f ) )	// also handles NaN
+		return 0;
+	if ( x >= 1.0f )
+		return 255;
+	return std::uint32_t( x * 255.0f + 0.5f );
+}
+
+static inline std::uint32_t uNorm16ToUNorm8( std::uint32_t x )
+{
+	return ( x * 255U + 32767U ) / 65535U;
+}
+
+static inline std::uint32_t sNorm8ToUNorm8( std::uint32_t x )
+{
+	int	v = std::max< int >( std::int8_t( x ), -127 );
+	return std::uint32_t( ( ( v + 127 ) * 255 + 127 ) / 254 );
+}
+
+static inline std::uint32_t rgb565ToRGBA( std::uint32_t c )
+{
+	std::uint32_t	r = ( c >> 11 ) & 0x1F;
+	std::uint32_t	g = ( c >> 5 ) & 0x3F;
+	std::uint32_t	b = c & 0x1F;
+	return packRGBA( ( r << 3 ) | ( r >> 2 ), ( g << 2 ) | ( g >> 4 ), ( b << 3 ) | ( b >> 2 ) );
+}
+
+// returns the 8 channel values of a BC4 block (or the alpha block of BC3) in 'dst'
+static void decodeBC4Palette( int * dst, const unsigned char * src, bool isSigned )
+{
+	int	a0 = src[0];
+	int	a1 = src[1];
+	if ( isSigned ) {
+		a0 = std::max< int >( std::int8_t( a0 ), -127 );
+		a1 = std::max< int >( std::int8_t( a1 ), -127 );
+	}
+	dst[0] = a0;
+	dst[1] = a1;
+	if ( a0 > a1 ) {
+		for ( int i = 1; i < 7; i++ )
+			dst[i + 1] = ( ( 7 - i ) * a0 + i * a1 ) / 7;
+	} else {
+		for ( int i = 1; i < 5; i++ )
+			dst[i + 1] = ( ( 5 - i ) * a0 + i * a1 ) / 5;
+		dst[6] = ( isSigned ? -127 : 0 );
+		dst[7] = ( isSigned ? 127 : 255 );
+	}
+	if ( isSigned ) {
+		for ( int i = 0; i < 8; i++ )
+			dst[i] = ( ( dst[i] + 127 ) * 255 + 127 ) / 254;
+	}
+}
+
+static inline std::uint64_t getBC4Indices( const unsigned char * src )
+{
+	return ( std::uint64_t( readUInt16( src + 2 ) ) | ( std::uint64_t( readUInt32( src + 4 ) ) << 16 ) );
+}
+
+void TextureDecoder::decodeBlockBC1( std::uint32_t * dst, const unsigned char * src, bool isBC1 )
+{
+	std::uint32_t	c0 = readUInt16( src );
+	std::uint32_t	c1 = readUInt16( src + 2 );
+	std::uint32_t	palette[4];
+	palette[0] = rgb565ToRGBA( c0 );
+	palette[1] = rgb565ToRGBA( c1 );
+	std::uint32_t	r0 = palette[0] & 0xFF;
+	std::uint32_t	g0 = ( palette[0] >> 8 ) & 0xFF;
+	std::uint32_t	b0 = ( palette[0] >> 16 ) & 0xFF;
+	std::uint32_t	r1 = palette[1] & 0xFF;
+	std::uint32_t	g1 = ( palette[1] >> 8 ) & 0xFF;
+	std::uint32_t	b1 = ( palette[1] >> 16 ) & 0xFF;
+	if ( c0 > c1 || !isBC1 ) {
+		palette[2] = packRGBA( ( r0 * 2 + r1 ) / 3, ( g0 * 2 + g1 ) / 3, ( b0 * 2 + b1 ) / 3 );
+		palette[3] = packRGBA( ( r0 + r1 * 2 ) / 3, ( g0 + g1 * 2 ) / 3, ( b0 + b1 * 2 ) / 3 );
+	} else {
+		palette[2] = packRGBA( ( r0 + r1 ) >> 1, ( g0 + g1 ) >> 1, ( b0 + b1 ) >> 1 );
+		palette[3] = 0;
+	}
+
+	std::uint32_t	indices = readUInt32( src + 4 );
+	for ( int i = 0; i < 16; i++, indices = indices >> 2 )
+		dst[i] = palette[indices & 3];
+}
+
+void TextureDecoder::decodeBlockBC2( std::uint32_t * dst, const unsigned char * src )
+{
+	decodeBlockBC1( dst, src + 8, false );
+	std::uint64_t	alpha = readUInt64( src );
+	for ( int i = 0; i < 16; i++, alpha = alpha >> 4 )
+		dst[i] = ( dst[i] & 0x00FFFFFFU ) | ( std::uint32_t( alpha & 15 ) * 0x11000000U );
+}
+
+void TextureDecoder::decodeBlockBC3( std::uint32_t * dst, const unsigned char * src )
+{
+	decodeBlockBC1( dst, src + 8, false );
+	int	palette[8];
+	decodeBC4Palette( palette, src, false );
+	std::uint64_t	indices = getBC4Indices( src );
+	for ( int i = 0; i < 16; i++, indices = indices >> 3 )
+		dst[i] = ( dst[i] & 0x00FFFFFFU ) | ( std::uint32_t( palette[indices & 7] ) << 24 );
+}
+
+void TextureDecoder::decodeBlockBC4( std::uint32_t * dst, const unsigned char * src, bool isSigned )
+{
+	int	palette[8];
+	decodeBC4Palette( palette, src, isSigned );
+	std::uint64_t	indices = getBC4Indices( src );
+	for ( int i = 0; i < 16; i++, indices = indices >> 3 )
+		dst[i] = packGrey( std::uint32_t( palette[indices & 7] ) );
+}
+
+void TextureDecoder::decodeBlockBC5( std::uint32_t * dst, const unsigned char * src, bool isSigned )
+{
+	int	paletteR[8];
+	int	paletteG[8];
+	decodeBC4Palette( paletteR, src, isSigned );
+	decodeBC4Palette( paletteG, src + 8, isSigned );
+	std::uint64_t	indicesR = getBC4Indices( src );
+	std::uint64_t	indicesG = getBC4Indices( src + 8 );
+	// the missing blue channel is 0.0 mapped to the output range
+	std::uint32_t	blue = ( isSigned ? 128 : 0 );
+	for ( int i = 0; i < 16; i++, indicesR = indicesR >> 3, indicesG = indicesG >> 3 )
+		dst[i] = packRGBA( std::uint32_t( paletteR[indicesR & 7] ), std::uint32_t( paletteG[indicesG & 7] ), blue );
+}
+
+// reads the bits of a 128-bit BC6H or BC7 block, starting from the least significant bit of the first byte
+class BlockBitReader
+{
+public:
+	BlockBitReader( const unsigned char * src )
+		: lo( readUInt64( src ) ), hi( readUInt64( src + 8 ) ), pos( 0 )
+	{
+	}
+	inline std::uint32_t getBits( unsigned int n )
+	{
+		std::uint64_t	b;
+		if ( pos >= 64 )
+			b = hi >> ( pos - 64 );
+		else if ( pos > 0 )
+			b = ( lo >> pos ) | ( hi << ( 64 - pos ) );
+		else
+			b = lo;
+		pos += n;
+		return std::uint32_t( b & ( ( std::uint64_t( 1 ) << n ) - 1U ) );
+	}
+
+protected:
+	std::uint64_t	lo;
+	std::uint64_t	hi;
+	unsigned int	pos;
+};
+
+// partition tables shared by BC6H and BC7: subset 1 pixels of the two subset partitions as bit masks,
+// and the subset of each pixel of the three subset partitions as 2-bit fields
+static const std::uint16_t	bcPartitions2[64] = {
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00,
+	0xFFF0, 0xF000, 0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C,
+	0x17E8, 0x0FF0, 0x718E, 0x399C, 0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8,
+	0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660, 0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+	0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+static const std::uint32_t	bcPartitions3[64] = {
+	0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+	0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+	0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+	0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+	0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+	0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+	0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+	0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+};
+
+// anchor pixel indices of subset 1 of two subset partitions, and of subsets 1 and 2 of three subset partitions
+static const unsigned char	bcAnchors2[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,
+	 8,  8,  2,  2, 15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,  6,  2,  6,  8, 15, 15,  2,  2,
+	15, 15, 15, 15, 15,  2,  2, 15
+};
+
+static const unsigned char	bcAnchors3a[64] = {
+	 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,  3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,
+	 8,  5, 15, 15,  8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,  3, 15,  5,  5,  5,  8,  5, 10,
+	 5, 10,  8, 13, 15, 12,  3,  3
+};
+
+static const unsigned char	bcAnchors3b[64] = {
+	15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8, 15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10,
+	15, 15, 10,  8, 15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8, 15,  3, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15,  3, 15, 15,  8
+};
+
+static const unsigned char	bcWeights2[4] = { 0, 21, 43, 64 };
+static const unsigned char	bcWeights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const unsigned char	bcWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static inline int bcInterpolate( int a, int b, unsigned int w )
+{
+	return ( a * int( 64 - w ) + b * int( w ) + 32 ) >> 6;
+}
+
+// BC6H modes, in the order of the mode numbers in the format specification
+struct BC6HMode
+{
+	unsigned char	numSubsets;
+	bool	isTransformed;
+	unsigned char	endpointBits;
+	unsigned char	deltaBits[3];
+	// endpoint bit fields in the order they are stored: endpoint * 3 + channel, lowest bit, number of bits
+	// (+ 0x80 if the bits are stored in reverse order), terminated by a zero bit count
+	unsigned char	layout[24][3];
+};
+
+static const BC6HMode	bc6hModes[14] = {
+	{ 2, true, 10, { 5, 5, 5 }, {
+		{ 7, 4, 1 }, { 8, 4, 1 }, { 11, 4, 1 }, { 0, 0, 10 }, { 1, 0, 10 }, { 2, 0, 10 }, { 3, 0, 5 }, { 10, 4, 1 },
+		{ 7, 0, 4 }, { 4, 0, 5 }, { 11, 0, 1 }, { 10, 0, 4 }, { 5, 0, 5 }, { 11, 1, 1 }, { 8, 0, 4 }, { 6, 0, 5 },
+		{ 11, 2, 1 }, { 9, 0, 5 }, { 11, 3, 1 } } },
+	{ 2, true, 7, { 6, 6, 6 }, {
+		{ 7, 5, 1 }, { 10, 4, 1 }, { 10, 5, 1 }, { 0, 0, 7 }, { 11, 0, 1 }, { 11, 1, 1 }, { 8, 4, 1 }, { 1, 0, 7 },
+		{ 8, 5, 1 }, { 11, 2, 1 }, { 7, 4, 1 }, { 2, 0, 7 }, { 11, 3, 1 }, { 11, 5, 1 }, { 11, 4, 1 }, { 3, 0, 6 },
+		{ 7, 0, 4 }, { 4, 0, 6 }, { 10, 0, 4 }, { 5, 0, 6 }, { 8, 0, 4 }, { 6, 0, 6 }, { 9, 0, 6 } } },
+	{ 2, true, 11, { 5, 4, 4 }, {
+		{ 0, 0, 10 }, { 1, 0, 10 }, { 2, 0, 10 }, { 3, 0, 5 }, { 0, 10, 1 }, { 7, 0, 4 }, { 4, 0, 4 }, { 1, 10, 1 },
+		{ 11, 0, 1 }, { 10, 0, 4 }, { 5, 0, 4 }, { 2, 10, 1 }, { 11, 1, 1 }, { 8, 0, 4 }, { 6, 0, 5 }, { 11, 2, 1 },
+		{ 9, 0, 5 }, { 11, 3, 1 } } },
+	{ 2, true, 11, { 4, 5, 4 }, {
+		{ 0, 0, 10 }, { 1, 0, 10 }, { 2, 0, 10 }, { 3, 0, 4 }, { 0, 10, 1 }, { 10, 4, 1 }, { 7, 0, 4 }, { 4, 0, 5 },
+		{ 1, 10, 1 }, { 10, 0, 4 }, { 5, 0, 4 }, { 2, 10, 1 }, { 11, 1, 1 }, { 8, 0, 4 }, { 6, 0, 4 }, { 11, 0, 1 },
+		{ 11, 2, 1 }, { 9, 0, 4 }, { 7, 4, 1 }, { 11, 3, 1 } } },
+	{ 2, true, 11, { 4, 4, 5 }, {
+		{ 0, 0, 10 }, { 1, 0, 10 }, { 2, 0, 10 }, { 3, 0, 4 }, { 0, 10, 1 }, { 8, 4, 1 }, { 7, 0, 4 }, { 4, 0, 4 },
+		{ 1, 10, 1 }, { 11, 0, 1 }, { 10, 0, 4 }, { 5, 0, 5 }, { 2, 10, 1 }, { 8, 0, 4 }, { 6, 0, 4 }, { 11, 1, 1 },
+		{ 11, 2, 1 }, { 9, 0, 4 }, { 11, 4, 1 }, { 11, 3, 1 } } },
+	{ 2, true, 9, { 5, 5, 5 }, {
+		{ 0, 0, 9 }, { 8, 4, 1 }, { 1, 0, 9 }, { 7, 4, 1 }, { 2, 0, 9 }, { 11, 4, 1 }, { 3, 0, 5 }, { 10, 4, 1 },
+		{ 7, 0, 4 }, { 4, 0, 5 }, { 11, 0, 1 }, { 10, 0, 4 }, { 5, 0, 5 }, { 11, 1, 1 }, { 8, 0, 4 }, { 6, 0, 5 },
+		{ 11, 2, 1 }, { 9, 0, 5 }, { 11, 3, 1 } } },
+	{ 2, true, 8, { 6, 5, 5 }, {
+		{ 0, 0, 8 }, { 10, 4, 1 }, { 8, 4, 1 }, { 1, 0, 8 }, { 11, 2, 1 }, { 7, 4, 1 }, { 2, 0, 8 }, { 11, 3, 1 },
+		{ 11, 4, 1 }, { 3, 0, 6 }, { 7, 0, 4 }, { 4, 0, 5 }, { 11, 0, 1 }, { 10, 0, 4 }, { 5, 0, 5 }, { 11, 1, 1 },
+		{ 8, 0, 4 }, { 6, 0, 6 }, { 9, 0, 6 } } },
+	{ 2, true, 8, { 5, 6, 5 }, {
+		{ 0, 0, 8 }, { 11, 0, 1 }, { 8, 4, 1 }, { 1, 0, 8 }, { 7, 5, 1 }, { 7, 4, 1 }, { 2, 0, 8 }, { 10, 5, 1 },
+		{ 11, 4, 1 }, { 3, 0, 5 }, { 10, 4, 1 }, { 7, 0, 4 }, { 4, 0, 6 }, { 10, 0, 4 }, { 5, 0, 5 }, { 11, 1, 1 },
+		{ 8, 0, 4 }, { 6, 0, 5 }, { 11, 2, 1 }, { 9, 0, 5 }, { 11, 3, 1 } } },
+	{ 2, true, 8, { 5, 5, 6 }, {
+		{ 0, 0, 8 }, { 11, 1, 1 }, { 8, 4, 1 }, { 1, 0, 8 }, { 8, 5, 1 }, { 7, 4, 1 }, { 2, 0, 8 }, { 11, 5, 1 },
+		{ 11, 4, 1 }, { 3, 0, 5 }, { 10, 4, 1 }, { 7, 0, 4 }, { 4, 0, 5 }, { 11, 0, 1 }, { 10, 0, 4 }, { 5, 0, 6 },
+		{ 8, 0, 4 }, { 6, 0, 5 }, { 11, 2, 1 }, { 9, 0, 5 }, { 11, 3, 1 } } },
+	{ 2, false, 6, { 6, 6, 6 }, {
+		{ 0, 0, 6 }, { 10, 4, 1 }, { 11, 0, 1 }, { 11, 1, 1 }, { 8, 4, 1 }, { 1, 0, 6 }, { 7, 5, 1 }, { 8, 5, 1 },
+		{ 11, 2, 1 }, { 7, 4, 1 }, { 2, 0, 6 }, { 10, 5, 1 }, { 11, 3, 1 }, { 11, 5, 1 }, { 11, 4, 1 }, { 3, 0, 6 },
+		{ 7, 0, 4 }, { 4, 0, 6 }, { 10, 0, 4 }, { 5, 0, 6 }, { 8, 0, 4 }, { 6, 0, 6 }, { 9, 0, 6 } } },
+	{ 1, false, 10, { 10, 10, 10 }, {
+		{ 0, 0, 10 }, { 1, 0, 10 }, { 2, 0, 10 }, { 3, 0, 10 }, { 4, 0, 10 }, { 5, 0, 10 } } },
+	{ 1, true, 11, { 9, 9, 9 }, {
+		{ 0, 0, 10 }, { 1, 0, 10 }, { 2, 0, 10 }, { 3, 0, 9 }, { 0, 10, 1 }, { 4, 0, 9 }, { 1, 10, 1 }, { 5, 0, 9 },
+		{ 2, 10, 1 } } },
+	{ 1, true, 12, { 8, 8, 8 }, {
+		{ 0, 0, 10 }, { 1, 0, 10 }, { 2, 0, 10 }, { 3, 0, 8 }, { 0, 10, 0x82 }, { 4, 0, 8 }, { 1, 10, 0x82 },
+		{ 5, 0, 8 }, { 2, 10, 0x82 } } },
+	{ 1, true, 16, { 4, 4, 4 }, {
+		{ 0, 0, 10 }, { 1, 0, 10 }, { 2, 0, 10 }, { 3, 0, 4 }, { 0, 10, 0x86 }, { 4, 0, 4 }, { 1, 10, 0x86 },
+		{ 5, 0, 4 }, { 2, 10, 0x86 } } }
+};
+
+static inline int signExtend( int x, unsigned int bits )
+{
+	return ( x ^ ( 1 << ( bits - 1 ) ) ) - ( 1 << ( bits - 1 ) );
+}
+
+static int bc6hUnquantize( int x, unsigned int bits, bool isSigned )
+{
+	if ( !isSigned ) {
+		if ( bits >= 15 || x == 0 )
+			return x;
+		if ( x == ( 1 << bits ) - 1 )
+			return 0xFFFF;
+		return ( ( x << 16 ) + 0x8000 ) >> bits;
+	}
+	if ( bits >= 16 || x == 0 )
+		return x;
+	int	s = ( x < 0 ? -1 : 1 );
+	x = x * s;
+	if ( x >= ( 1 << ( bits - 1 ) ) - 1 )
+		x = 0x7FFF;
+	else
+		x = ( ( x << 15 ) + 0x4000 ) >> ( bits - 1 );
+	return x * s;
+}
+
+static inline std::uint32_t bc6hFinishUnquantize( int x, bool isSigned )
+{
+	if ( !isSigned )
+		return std::uint32_t( ( x * 31 ) >> 6 );
+	if ( x < 0 )
+		return 0x8000U | std::uint32_t( ( -x * 31 ) >> 5 );
+	return std::uint32_t( ( x * 31 ) >> 5 );
+}
+
+void TextureDecoder::decodeBlockBC6H( std::uint32_t * dst, const unsigned char * src, bool isSigned )
+{
+	BlockBitReader	bits( src );
+	std::uint32_t	m = bits.getBits( 2 );
+	if ( m >= 2 )
+		m = m | ( bits.getBits( 3 ) << 2 );
+	// mode numbers by the value of the mode bits, reserved modes are -1
+	static const signed char	modeTable[32] = {
+		0, 1, 2, 10, -1, -1, 3, 11, -1, -1, 4, 12, -1, -1, 5, 13,
+		-1, -1, 6, -1, -1, -1, 7, -1, -1, -1, 8, -1, -1, -1, 9, -1
+	};
+	int	modeNum = modeTable[m];
+	if ( modeNum < 0 ) [[unlikely]] {
+		for ( int i = 0; i < 16; i++ )
+			dst[i] = 0xFF000000U;
+		return;
+	}
+	const BC6HMode &	mode = bc6hModes[modeNum];
+
+	int	endpoints[12];
+	for ( int i = 0; i < 12; i++ )
+		endpoints[i] = 0;
+	for ( const auto & l : mode.layout ) {
+		unsigned int	n = l[2] & 0x7F;
+		if ( !n )
+			break;
+		std::uint32_t	b = bits.getBits( n );
+		if ( l[2] & 0x80 ) {
+			// reverse the order of the bits
+			std::uint32_t	tmp = 0;
+			for ( unsigned int i = 0; i < n; i++, b = b >> 1 )
+				tmp = ( tmp << 1 ) | ( b & 1 );
+			b = tmp;
+		}
+		endpoints[l[0]] |= int( b << l[1] );
+	}
+	unsigned int	partition = 0;
+	if ( mode.numSubsets > 1 )
+		partition = bits.getBits( 5 );
+
+	unsigned int	numEndpoints = mode.numSubsets * 2U;
+	unsigned int	prec = mode.endpointBits;
+	if ( isSigned ) {
+		for ( int c = 0; c < 3; c++ )
+			endpoints[c] = signExtend( endpoints[c], prec );
+	}
+	for ( unsigned int i = 3; i < numEndpoints * 3; i++ ) {
+		int	c = int( i % 3 );
+		if ( mode.isTransformed ) {
+			endpoints[i] = ( endpoints[c] + signExtend( endpoints[i], mode.deltaBits[c] ) ) & ( ( 1 << prec ) - 1 );
+			if ( isSigned )
+				endpoints[i] = signExtend( endpoints[i], prec );
+		} else if ( isSigned ) {
+			endpoints[i] = signExtend( endpoints[i], prec );
+		}
+	}
+	for ( unsigned int i = 0; i < numEndpoints * 3; i++ )
+		endpoints[i] = bc6hUnquantize( endpoints[i], prec, isSigned );
+
+	unsigned int	indexBits = ( mode.numSubsets > 1 ? 3 : 4 );
+	const unsigned char *	weights = ( indexBits == 3 ? bcWeights3 : bcWeights4 );
+	unsigned int	anchor = ( mode.numSubsets > 1 ? bcAnchors2[partition] : 0 );
+	std::uint32_t	subsetMask = ( mode.numSubsets > 1 ? bcPartitions2[partition] : 0 );
+	for ( unsigned int i = 0; i < 16; i++ ) {
+		std::uint32_t	w = weights[bits.getBits( indexBits - ( i == 0 || i == anchor ? 1 : 0 ) )];
+		const int *	e = endpoints + ( ( subsetMask >> i ) & 1 ) * 6;
+		std::uint32_t	c[3];
+		for ( int j = 0; j < 3; j++ )
+			c[j] = floatToUNorm8( halfToFloat( bc6hFinishUnquantize( bcInterpolate( e[j], e[j + 3], w ), isSigned ) ) );
+		dst[i] = packRGBA( c[0], c[1], c[2] );
+	}
+}
+
+// BC7 modes: number of subsets, partition bits, rotation bits, index selection bits, color bits, alpha bits,
+// endpoint p-bits, shared p-bits, index bits, secondary index bits
+static const unsigned char	bc7Modes[8][10] = {
+	{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+	{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+	{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+	{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+	{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+	{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+void TextureDecoder::decodeBlockBC7( std::uint32_t * dst, const unsigned char * src )
+{
+	unsigned int	modeNum = 0;
+	while ( modeNum < 8 && !( src[0] & ( 1U << modeNum ) ) )
+		modeNum++;
+	if ( modeNum >= 8 ) [[unlikely]] {
+		for ( int i = 0; i < 16; i++ )
+			dst[i] = 0;
+		return;
+	}
+	const unsigned char *	mode = bc7Modes[modeNum];
+	unsigned int	numSubsets = mode[0];
+	unsigned int	colorBits = mode[4];
+	unsigned int	alphaBits = mode[5];
+
+	BlockBitReader	bits( src );
+	(void) bits.getBits( modeNum + 1 );
+	unsigned int	partition = bits.getBits( mode[1] );
+	unsigned int	rotation = bits.getBits( mode[2] );
+	unsigned int	indexSelection = bits.getBits( mode[3] );
+
+	// endpoints[subset * 2 + n][channel]
+	int	endpoints[6][4];
+	for ( unsigned int c = 0; c < 4; c++ ) {
+		for ( unsigned int i = 0; i < numSubsets * 2; i++ )
+			endpoints[i][c] = ( c < 3 ? int( bits.getBits( colorBits ) ) : ( alphaBits ? int( bits.getBits( alphaBits ) ) : 255 ) );
+	}
+	if ( mode[6] | mode[7] ) {
+		std::uint32_t	pBits[6];
+		for ( unsigned int i = 0; i < numSubsets * 2; i++ )
+			pBits[i] = ( ( mode[6] || !( i & 1 ) ) ? bits.getBits( 1 ) : pBits[i - 1] );
+		for ( unsigned int i = 0; i < numSubsets * 2; i++ ) {
+			for ( unsigned int c = 0; c < 3; c++ )
+				endpoints[i][c] = ( endpoints[i][c] << 1 ) | int( pBits[i] );
+			if ( alphaBits )
+				endpoints[i][3] = ( endpoints[i][3] << 1 ) | int( pBits[i] );
+		}
+		colorBits++;
+		if ( alphaBits )
+			alphaBits++;
+	}
+	// expand to 8 bits by replicating the most significant bits
+	for ( unsigned int i = 0; i < numSubsets * 2; i++ ) {
+		for ( unsigned int c = 0; c < 3; c++ )
+			endpoints[i][c] = ( endpoints[i][c] << ( 8 - colorBits ) ) | ( endpoints[i][c] >> ( colorBits * 2 - 8 ) );
+		if ( alphaBits )
+			endpoints[i][3] = ( endpoints[i][3] << ( 8 - alphaBits ) ) | ( endpoints[i][3] >> ( alphaBits * 2 - 8 ) );
+	}
+
+	unsigned int	subsets[16];
+	unsigned int	anchor1 = 16;
+	unsigned int	anchor2 = 16;
+	for ( unsigned int i = 0; i < 16; i++ ) {
+		if ( numSubsets == 2 )
+			subsets[i] = ( bcPartitions2[partition] >> i ) & 1;
+		else if ( numSubsets == 3 )
+			subsets[i] = ( bcPartitions3[partition] >> ( i * 2 ) ) & 3;
+		else
+			subsets[i] = 0;
+	}
+	if ( numSubsets == 2 ) {
+		anchor1 = bcAnchors2[partition];
+	} else if ( numSubsets == 3 ) {
+		anchor1 = bcAnchors3a[partition];
+		anchor2 = bcAnchors3b[partition];
+	}
+
+	unsigned int	indexBits = mode[8];
+	unsigned int	indexBits2 = mode[9];
+	unsigned char	indices[16];
+	unsigned char	indices2[16];
+	for ( unsigned int i = 0; i < 16; i++ ) {
+		bool	isAnchor = ( i == 0 || i == anchor1 || i == anchor2 );
+		indices[i] = (unsigned char) bits.getBits( indexBits - ( isAnchor ? 1 : 0 ) );
+	}
+	if ( indexBits2 ) {
+		for ( unsigned int i = 0; i < 16; i++ )
+			indices2[i] = (unsigned char) bits.getBits( indexBits2 - ( i == 0 ? 1 : 0 ) );
+	}
+
+	static const unsigned char * const	weightTables[5] = { nullptr, nullptr, bcWeights2, bcWeights3, bcWeights4 };
+	for ( unsigned int i = 0; i < 16; i++ ) {
+		const int *	e0 = endpoints[subsets[i] * 2];
+		const int *	e1 = endpoints[subsets[i] * 2 + 1];
+		unsigned int	wc = weightTables[indexBits][indices[i]];
+		unsigned int	wa = wc;
+		if ( indexBits2 ) {
+			unsigned int	w2 = weightTables[indexBits2][indices2[i]];
+			if ( indexSelection )
+				wc = w2;
+			else
+				wa = w2;
+		}
+		int	c[4];
+		for ( int j = 0; j < 3; j++ )
+			c[j] = bcInterpolate( e0[j], e1[j], wc );
+		c[3] = bcInterpolate( e0[3], e1[3], wa );
+		if ( rotation )
+			std::swap( c[3], c[rotation - 1] );
+		dst[i] = packRGBA( std::uint32_t( c[0] ), std::uint32_t( c[1] ), std::uint32_t( c[2] ), std::uint32_t( c[3] ) );
+	}
+}
+
+bool TextureDecoder::isSupported( std::uint32_t fmt )
+{
+	switch ( fmt ) {
+	case 2:		// R32G32B32A32_FLOAT
+	case 10:	// R16G16B16A16_FLOAT
+	case 11:	// R16G16B16A16_UNORM
+	case 16:	// R32G32_FLOAT
+	case 24:	// R10G10B10A2_UNORM
+	case 28:	// R8G8B8A8_UNORM
+	case 29:	// R8G8B8A8_UNORM_SRGB
+	case 31:	// R8G8B8A8_SNORM
+	case 34:	// R16G16_FLOAT
+	case 35:	// R16G16_UNORM
+	case 41:	// R32_FLOAT
+	case 49:	// R8G8_UNORM
+	case 51:	// R8G8_SNORM
+	case 54:	// R16_FLOAT
+	case 56:	// R16_UNORM
+	case 61:	// R8_UNORM
+	case 65:	// A8_UNORM
+	case 71:	// BC1_UNORM
+	case 72:	// BC1_UNORM_SRGB
+	case 74:	// BC2_UNORM
+	case 75:	// BC2_UNORM_SRGB
+	case 77:	// BC3_UNORM
+	case 78:	// BC3_UNORM_SRGB
+	case 80:	// BC4_UNORM
+	case 81:	// BC4_SNORM
+	case 83:	// BC5_UNORM
+	case 84:	// BC5_SNORM
+	case 85:	// B5G6R5_UNORM
+	case 86:	// B5G5R5A1_UNORM
+	case 87:	// B8G8R8A8_UNORM
+	case 88:	// B8G8R8X8_UNORM
+	case 91:	// B8G8R8A8_UNORM_SRGB
+	case 93:	// B8G8R8X8_UNORM_SRGB
+	case 95:	// BC6H_UF16
+	case 96:	// BC6H_SF16
+	case 98:	// BC7_UNORM
+	case 99:	// BC7_UNORM_SRGB
+	case 115:	// B4G4R4A4_UNORM
+		return true;
+	}
+	return false;
+}
+
+static void decodeRow( std::uint32_t * dst, const unsigned char * src, std::uint32_t fmt, int width )
+{
+	switch ( fmt ) {
+	case 2:
+		for ( int x = 0; x < width; x++, src = src + 16 ) {
+			float	c[4];
+			std::memcpy( c, src, sizeof( float ) * 4 );
+			dst[x] = packRGBA( floatToUNorm8( c[0] ), floatToUNorm8( c[1] ), floatToUNorm8( c[2] ), floatToUNorm8( c[3] ) );
+		}
+		break;
+	case 10:
+		for ( int x = 0; x < width; x++, src = src + 8 ) {
+			dst[x] = packRGBA( floatToUNorm8( halfToFloat( readUInt16( src ) ) ),
+								floatToUNorm8( halfToFloat( readUInt16( src + 2 ) ) ),
+								floatToUNorm8( halfToFloat( readUInt16( src + 4 ) ) ),
+								floatToUNorm8( halfToFloat( readUInt16( src + 6 ) ) ) );
+		}
+		break;
+	case 11:
+		for ( int x = 0; x < width; x++, src = src + 8 ) {
+			dst[x] = packRGBA( uNorm16ToUNorm8( readUInt16( src ) ), uNorm16ToUNorm8( readUInt16( src + 2 ) ),
+								uNorm16ToUNorm8( readUInt16( src + 4 ) ), uNorm16ToUNorm8( readUInt16( src + 6 ) ) );
+		}
+		break;
+	case 16:
+		for ( int x = 0; x < width; x++, src = src + 8 ) {
+			float	c[2];
+			std::memcpy( c, src, sizeof( float ) * 2 );
+			dst[x] = packRGBA( floatToUNorm8( c[0] ), floatToUNorm8( c[1] ), 0 );
+		}
+		break;
+	case 24:
+		for ( int x = 0; x < width; x++, src = src + 4 ) {
+			std::uint32_t	c = readUInt32( src );
+			dst[x] = packRGBA( ( ( c & 0x03FF ) * 255U + 511U ) / 1023U, ( ( ( c >> 10 ) & 0x03FF ) * 255U + 511U ) / 1023U,
+								( ( ( c >> 20 ) & 0x03FF ) * 255U + 511U ) / 1023U, ( c >> 30 ) * 85U );
+		}
+		break;
+	case 28:
+	case 29:
+		std::memcpy( dst, src, size_t( width ) * 4 );
+		break;
+	case 31:
+		for ( int x = 0; x < width; x++, src = src + 4 )
+			dst[x] = packRGBA( sNorm8ToUNorm8( src[0] ), sNorm8ToUNorm8( src[1] ), sNorm8ToUNorm8( src[2] ), sNorm8ToUNorm8( src[3] ) );
+		break;
+	case 34:
+		for ( int x = 0; x < width; x++, src = src + 4 ) {
+			dst[x] = packRGBA( floatToUNorm8( halfToFloat( readUInt16( src ) ) ),
+								floatToUNorm8( halfToFloat( readUInt16( src + 2 ) ) ), 0 );
+		}
+		break;
+	case 35:
+		for ( int x = 0; x < width; x++, src = src + 4 )
+			dst[x] = packRGBA( uNorm16ToUNorm8( readUInt16( src ) ), uNorm16ToUNorm8( readUInt16( src + 2 ) ), 0 );
+		break;
+	case 41:
+		for ( int x = 0; x < width; x++, src = src + 4 ) {
+			float	c;
+			std::memcpy( &c, src, sizeof( float ) );
+			dst[x] = packGrey( floatToUNorm8( c ) );
+		}
+		break;
+	case 49:
+		for ( int x = 0; x < width; x++, src = src + 2 )
+			dst[x] = packRGBA( src[0], src[1], 0 );
+		break;
+	case 51:
+		for ( int x = 0; x < width; x++, src = src + 2 )
+			dst[x] = packRGBA( sNorm8ToUNorm8( src[0] ), sNorm8ToUNorm8( src[1] ), 128 );
+		break;
+	case 54:
+		for ( int x = 0; x < width; x++, src = src + 2 )
+			dst[x] = packGrey( floatToUNorm8( halfToFloat( readUInt16( src ) ) ) );
+		break;
+	case 56:
+		for ( int x = 0; x < width; x++, src = src + 2 )
+			dst[x] = packGrey( uNorm16ToUNorm8( readUInt16( src ) ) );
+		break;
+	case 61:
+		for ( int x = 0; x < width; x++ )
+			dst[x] = packGrey( src[x] );
+		break;
+	case 65:
+		for ( int x = 0; x < width; x++ )
+			dst[x] = std::uint32_t( src[x] ) << 24;
+		break;
+	case 85:
+		for ( int x = 0; x < width; x++, src = src + 2 )
+			dst[x] = rgb565ToRGBA( readUInt16( src ) );
+		break;
+	case 86:
+		for ( int x = 0; x < width; x++, src = src + 2 ) {
+			std::uint32_t	c = readUInt16( src );
+			std::uint32_t	r = ( c >> 10 ) & 0x1F;
+			std::uint32_t	g = ( c >> 5 ) & 0x1F;
+			std::uint32_t	b = c & 0x1F;
+			dst[x] = packRGBA( ( r << 3 ) | ( r >> 2 ), ( g << 3 ) | ( g >> 2 ), ( b << 3 ) | ( b >> 2 ), ( c & 0x8000 ) ? 255 : 0 );
+		}
+		break;
+	case 87:
+	case 88:
+	case 91:
+	case 93:
+		for ( int x = 0; x < width; x++, src = src + 4 ) {
+			dst[x] = packRGBA( src[2], src[1], src[0], ( fmt == 87 || fmt == 91 ) ? src[3] : 255 );
+		}
+		break;
+	case 115:
+		for ( int x = 0; x < width; x++, src = src + 2 ) {
+			std::uint32_t	c = readUInt16( src );
+			dst[x] = packRGBA( ( ( c >> 8 ) & 15 ) * 17, ( ( c >> 4 ) & 15 ) * 17, ( c & 15 ) * 17, ( c >> 12 ) * 17 );
+		}
+		break;
+	}
+}
+
+void TextureDecoder::decodeBlockRows(
+	std::uint32_t * dst, int dstWidth, const unsigned char * src, std::uint32_t fmt, int width, int blockRows )
+{
+	unsigned int	blockBytes = 0;
+	unsigned int	blockSize = 1;
+	(void) TextureInfo::dxgiBlockInfo( fmt, blockBytes, blockSize );
+	if ( blockSize == 1 ) {
+		for ( int y = 0; y < blockRows; y++, src = src + ( size_t( width ) * blockBytes ) )
+			decodeRow( dst + ( size_t( y ) * size_t( dstWidth ) ), src, fmt, width );
+		return;
+	}
+
+	int	blocksX = ( width + 3 ) >> 2;
+	std::uint32_t	tmp[16];
+	for ( int y = 0; y < blockRows; y++ ) {
+		for ( int x = 0; x < blocksX; x++, src = src + blockBytes ) {
+			switch ( fmt ) {
+			case 71:
+			case 72:
+				decodeBlockBC1( tmp, src );
+				break;
+			case 74:
+			case 75:
+				decodeBlockBC2( tmp, src );
+				break;
+			case 77:
+			case 78:
+				decodeBlockBC3( tmp, src );
+				break;
+			case 80:
+			case 81:
+				decodeBlockBC4( tmp, src, fmt == 81 );
+				break;
+			case 83:
+			case 84:
+				decodeBlockBC5( tmp, src, fmt == 84 );
+				break;
+			case 95:
+			case 96:
+				decodeBlockBC6H( tmp, src, fmt == 96 );
+				break;
+			case 98:
+			case 99:
+				decodeBlockBC7( tmp, src );
+				break;
+			}
+			std::uint32_t *	p = dst + ( size_t( y ) * 4 * size_t( dstWidth ) ) + ( size_t( x ) * 4 );
+			for ( int i = 0; i < 4; i++, p = p + dstWidth )
+				std::memcpy( p, tmp + ( i * 4 ), sizeof( std::uint32_t ) * 4 );
+		}
+	}
+}
+
+bool TextureDecoder::decodeImage( std::uint32_t * dst, const unsigned char * src, size_t srcSize, std::uint32_t fmt,
+									int width, int height, int scaleLog2, int threadCount )
+{
+	unsigned int	blockBytes = 0;
+	unsigned int	blockSize = 1;
+	if ( !( isSupported( fmt ) && TextureInfo::dxgiBlockInfo( fmt, blockBytes, blockSize ) ) )
+		return false;
+	if ( width < 1 || height < 1 || scaleLog2 < 0 || scaleLog2 > 12 )
+		return false;
+	size_t	blocksX = ( size_t( width ) + blockSize - 1 ) / blockSize;
+	size_t	blocksY = ( size_t( height ) + blockSize - 1 ) / blockSize;
+	if ( srcSize < ( blocksX * blocksY * blockBytes ) )
+		return false;
+
+	// the image is decoded in bands of block rows, which are also a multiple of the downscaling factor in height
+	int	bandHeight = std::max< int >( int( blockSize ), 1 << scaleLog2 );
+	int	bandCount = ( height + bandHeight - 1 ) / bandHeight;
+	size_t	bandBytes = size_t( bandHeight / int( blockSize ) ) * blocksX * blockBytes;
+	int	tmpWidth = int( blocksX * blockSize );
+	int	dstWidth = getScaledSize( width, scaleLog2 );
+	std::atomic< int >	nextBand( 0 );
+
+	auto	decodeBands = [&]() {
+		std::vector< std::uint32_t >	tmp( size_t( tmpWidth ) * size_t( bandHeight ) );
+		int	b;
+		while ( ( b = nextBand.fetch_add( 1 ) ) < bandCount ) {
+			int	y0 = b * bandHeight;
+			int	rows = std::min< int >( bandHeight, height - y0 );
+			int	blockRows = ( rows + int( blockSize ) - 1 ) / int( blockSize );
+			decodeBlockRows( tmp.data(), tmpWidth, src + ( size_t( b ) * bandBytes ), fmt, width, blockRows );
+
+			if ( !scaleLog2 ) {
+				for ( int y = 0; y < rows; y++ ) {
+					std::memcpy( dst + ( size_t( y0 + y ) * size_t( dstWidth ) ), tmp.data() + ( size_t( y ) * size_t( tmpWidth ) ),
+									sizeof( std::uint32_t ) * size_t( width ) );
+				}
+				continue;
+			}
+
+			// box filter, averaging only the pixels that are inside the image at the right and bottom edges
+			int	scale = 1 << scaleLog2;
+			for ( int y = 0; y < rows; y += scale ) {
+				int	h = std::min< int >( scale, rows - y );
+				std::uint32_t *	dstPtr = dst + ( size_t( ( y0 + y ) >> scaleLog2 ) * size_t( dstWidth ) );
+				for ( int x = 0; x < dstWidth; x++ ) {
+					int	w = std::min< int >( scale, width - ( x << scaleLog2 ) );
+					std::uint64_t	sums[4] = { 0, 0, 0, 0 };
+					const std::uint32_t *	srcPtr = tmp.data() + ( size_t( y ) * size_t( tmpWidth ) ) + size_t( x << scaleLog2 );
+					for ( int yy = 0; yy < h; yy++, srcPtr = srcPtr + tmpWidth ) {
+						for ( int xx = 0; xx < w; xx++ ) {
+							std::uint32_t	c = srcPtr[xx];
+							sums[0] += c & 0xFF;
+							sums[1] += ( c >> 8 ) & 0xFF;
+							sums[2] += ( c >> 16 ) & 0xFF;
+							sums[3] += c >> 24;
+						}
+					}
+					std::uint64_t	n = std::uint64_t( w ) * std::uint64_t( h );
+					dstPtr[x] = packRGBA( std::uint32_t( ( sums[0] + ( n >> 1 ) ) / n ), std::uint32_t( ( sums[1] + ( n >> 1 ) ) / n ),
+											std::uint32_t( ( sums[2] + ( n >> 1 ) ) / n ), std::uint32_t( ( sums[3] + ( n >> 1 ) ) / n ) );
+				}
+			}
+		}
+	};
+
+	if ( threadCount <= 0 ) {
+		// use one thread per 64K pixels, up to the number of CPU cores
+		int	maxThreads = std::max< int >( int( std::thread::hardware_concurrency() ), 1 );
+		threadCount = int( std::min< size_t >( ( size_t( width ) * size_t( height ) ) >> 16, size_t( maxThreads ) ) );
+	}
+	threadCount = std::clamp< int >( threadCount, 1, std::min< int >( bandCount, 64 ) );
+
+	std::vector< std::thread >	threads;
+	for ( int i = 1; i < threadCount; i++ )
+		threads.emplace_back( decodeBands );
+	decodeBands();
+	for ( auto & t : threads )
+		t.join();
+
+	return true;
+}
+
+QImage TextureDecoder::decodeDDS( const void * data, size_t size, int maxSize, int face, QString * errorMessage )
+{
+	TextureInfo	info;
+	QString	err;
+	if ( !info.parseDDS( reinterpret_cast< const unsigned char * >( data ), size ) ) {
+		err = ( !info.errors.isEmpty() ? info.errors.first() : QString( "invalid DDS file" ) );
+	} else if ( !isSupported( info.dxgiFormat ) ) {
+		err = QString( "unsupported format: %1" ).arg( info.pixelFormat );
+	} else if ( face < 0 || std::uint32_t( face ) >= ( info.faces * info.arraySize ) ) {
+		err = QString( "invalid face or array layer %1" ).arg( face );
+	} else {
+		unsigned int	blockBytes = 0;
+		unsigned int	blockSize = 1;
+		(void) TextureInfo::dxgiBlockInfo( info.dxgiFormat, blockBytes, blockSize );
+		auto	levelBytes = [&]( std::uint32_t l ) {
+			size_t	w = std::max< std::uint32_t >( info.width >> l, 1U );
+			size_t	h = std::max< std::uint32_t >( info.height >> l, 1U );
+			return ( ( w + blockSize - 1 ) / blockSize ) * ( ( h + blockSize - 1 ) / blockSize ) * blockBytes;
+		};
+
+		// select the smallest mip level that is not smaller than maxSize
+		std::uint32_t	level = 0;
+		while ( maxSize > 0 && ( level + 1 ) < info.mipLevels
+				&& std::max( info.width >> ( level + 1 ), info.height >> ( level + 1 ) ) >= std::uint32_t( maxSize ) ) {
+			level++;
+		}
+		size_t	offset = info.dataOffset;
+		size_t	chainBytes = 0;
+		for ( std::uint32_t l = 0; l < info.mipLevels; l++ ) {
+			if ( l < level )
+				offset += levelBytes( l );
+			chainBytes += levelBytes( l );
+		}
+		offset += chainBytes * size_t( face );
+
+		int	w = int( std::max< std::uint32_t >( info.width >> level, 1U ) );
+		int	h = int( std::max< std::uint32_t >( info.height >> level, 1U ) );
+		int	scaleLog2 = 0;
+		while ( maxSize > 0 && scaleLog2 < 12 && std::max( getScaledSize( w, scaleLog2 ), getScaledSize( h, scaleLog2 ) ) > maxSize )
+			scaleLog2++;
+
+		QImage	img( getScaledSize( w, scaleLog2 ), getScaledSize( h, scaleLog2 ), QImage::Format_RGBA8888 );
+		if ( img.isNull() ) {
+			err = QString( "failed to allocate image" );
+		} else if ( offset > size
+					|| !decodeImage( reinterpret_cast< std::uint32_t * >( img.bits() ),
+										reinterpret_cast< const unsigned char * >( data ) + offset, size - offset,
+										info.dxgiFormat, w, h, scaleLog2 ) ) {
+			err = QString( "unexpected EOF" );
+		} else {
+			return img;
+		}
+	}
+
+	if ( errorMessage )
+		*errorMessage = err;
+	return QImage();
+}
@@ -0,0 +1,62 @@
+#ifndef TEXTUREDECODER_H_INCLUDED
+#define TEXTUREDECODER_H_INCLUDED
+
+#include <QImage>
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+
+//! CPU decoder of DDS texture formats to 8-bit RGBA, for previews, exports and checks without an OpenGL context
+/*!
+ * Supports BC1 to BC7 and the common uncompressed formats. Images are decoded in horizontal bands of block rows,
+ * which are distributed between worker threads for large images, and can be downscaled with a box filter while
+ * decoding, so that a small preview of a large texture does not require a full size intermediate image.
+ *
+ * Decoded pixels are stored as 32-bit integers with R in the lowest byte (QImage::Format_RGBA8888 in memory).
+ * Float formats are clamped to the range 0.0 to 1.0, signed normalized formats are mapped to 0 to 255, and
+ * single channel formats other than A8 are decoded as grey. sRGB formats are not converted to linear.
+ */
+class TextureDecoder
+{
+public:
+	//! Returns true if images in DXGI format 'fmt' can be decoded
+	static bool isSupported( std::uint32_t fmt );
+
+	//! Decode a width x height image in DXGI format 'fmt' from 'src' to 'dst', downscaling it by 2^scaleLog2.
+	// 'dst' must have space for getScaledSize( width, scaleLog2 ) * getScaledSize( height, scaleLog2 ) pixels.
+	// If 'threadCount' is zero, it is chosen automatically from the image size and the number of CPU cores.
+	// Returns false if the format is not supported or 'srcSize' is too small for the image.
+	static bool decodeImage( std::uint32_t * dst, const unsigned char * src, size_t srcSize, std::uint32_t fmt,
+								int width, int height, int scaleLog2 = 0, int threadCount = 0 );
+
+	//! Decode a DDS file to a QImage. If 'maxSize' is greater than zero, the smallest mip level that is at least
+	// 'maxSize' pixels wide or high is used, and it is downscaled further while decoding if there is no such mip level.
+	// 'face' selects the cube map face or array layer. On failure, a null image is returned, and the reason is
+	// stored in 'errorMessage' if it is not nullptr.
+	static QImage decodeDDS( const void * data, size_t size, int maxSize = 0, int face = 0,
+								QString * errorMessage = nullptr );
+
+	static inline int getScaledSize( int n, int scaleLog2 )
+	{
+		return ( n + ( 1 << scaleLog2 ) - 1 ) >> scaleLog2;
+	}
+
+	// Decode a single 4x4 block of a BCn format to 16 pixels in row major order. If 'isBC1' is false, the color
+	// block of BC2 or BC3 is decoded, which always uses four colors and has no transparent mode.
+	static void decodeBlockBC1( std::uint32_t * dst, const unsigned char * src, bool isBC1 = true );
+	static void decodeBlockBC2( std::uint32_t * dst, const unsigned char * src );
+	static void decodeBlockBC3( std::uint32_t * dst, const unsigned char * src );
+	static void decodeBlockBC4( std::uint32_t * dst, const unsigned char * src, bool isSigned = false );
+	static void decodeBlockBC5( std::uint32_t * dst, const unsigned char * src, bool isSigned = false );
+	static void decodeBlockBC6H( std::uint32_t * dst, const unsigned char * src, bool isSigned = false );
+	static void decodeBlockBC7( std::uint32_t * dst, const unsigned char * src );
+
+protected:
+	//! Decode 'blockRows' rows of blocks (pixel rows for uncompressed formats) starting at 'src' to 'dst',
+	// which is 'dstWidth' pixels wide and has space for 'blockRows' rows of blocks
+	static void decodeBlockRows( std::uint32_t * dst, int dstWidth, const unsigned char * src, std::uint32_t fmt,
+									int width, int blockRows );
+};
+
+#endif
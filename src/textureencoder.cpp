@@ -0,0 +1,737 @@
+#include "textureencoder.h"
+
+#include "texturedecoder.h"
+#include "textureinfo.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+
+static inline void writeUInt16( unsigned char * p, std::uint32_t n )
+{
+	qToLittleEndian< quint16 >( quint16( n ), p );
+}
+
+static inline void writeUInt32( unsigned char * p, std::uint32_t n )
+{
+	qToLittleEndian< quint32 >( quint32( n ), p );
+}
+
+static inline std::uint32_t packRGBA( std::uint32_t r, std::uint32_t g, std::uint32_t b, std::uint32_t a = 255 )
+{
+	return ( r | ( g << 8 ) | ( b << 16 ) | ( a << 24 ) );
+}
+
+static inline int getChannel( std::uint32_t c, int channel )
+{
+	return int( ( c >> ( channel << 3 ) ) & 0xFF );
+}
+
+static inline void rgb565ToRGB( int * dst, std::uint32_t c )
+{
+	int	r = int( ( c >> 11 ) & 0x1F );
+	int	g = int( ( c >> 5 ) & 0x3F );
+	int	b = int( c & 0x1F );
+	dst[0] = ( r << 3 ) | ( r >> 2 );
+	dst[1] = ( g << 2 ) | ( g >> 4 );
+	dst[2] = ( b << 3 ) | ( b >> 2 );
+}
+
+static inline std::uint32_t rgbToRGB565( const float * c )
+{
+	std::uint32_t	r = std::uint32_t( std::clamp< float >( c[0] * ( 31.0f / 255.0f ) + 0.5f, 0.0f, 31.0f ) );
+	std::uint32_t	g = std::uint32_t( std::clamp< float >( c[1] * ( 63.0f / 255.0f ) + 0.5f, 0.0f, 63.0f ) );
+	std::uint32_t	b = std::uint32_t( std::clamp< float >( c[2] * ( 31.0f / 255.0f ) + 0.5f, 0.0f, 31.0f ) );
+	return ( ( r << 11 ) | ( g << 5 ) | b );
+}
+
+// finds the nearest palette color for each pixel of a BC1 block, and returns the sum of squared errors
+// pixels in 'transparentMask' use index 3, which requires the three color mode
+static std::uint32_t findBC1Indices( std::uint32_t & indices, const std::uint32_t * src, std::uint32_t transparentMask,
+										std::uint32_t c0, std::uint32_t c1, bool fourColors )
+{
+	int	palette[4][3];
+	rgb565ToRGB( palette[0], c0 );
+	rgb565ToRGB( palette[1], c1 );
+	int	colorCnt = 3;
+	for ( int j = 0; j < 3; j++ ) {
+		if ( fourColors ) {
+			palette[2][j] = ( palette[0][j] * 2 + palette[1][j] ) / 3;
+			palette[3][j] = ( palette[0][j] + palette[1][j] * 2 ) / 3;
+		} else {
+			palette[2][j] = ( palette[0][j] + palette[1][j] ) >> 1;
+		}
+	}
+	if ( fourColors )
+		colorCnt = 4;
+
+	std::uint32_t	err = 0;
+	indices = 0;
+	for ( int i = 0; i < 16; i++ ) {
+		std::uint32_t	n = 3;
+		if ( !( transparentMask & ( 1U << i ) ) ) {
+			std::uint32_t	bestErr = 0xFFFFFFFFU;
+			for ( int k = 0; k < colorCnt; k++ ) {
+				std::uint32_t	d = 0;
+				for ( int j = 0; j < 3; j++ ) {
+					int	tmp = getChannel( src[i], j ) - palette[k][j];
+					d += std::uint32_t( tmp * tmp );
+				}
+				if ( d < bestErr ) {
+					bestErr = d;
+					n = std::uint32_t( k );
+				}
+			}
+			err += bestErr;
+		}
+		indices |= n << ( i << 1 );
+	}
+	return err;
+}
+
+void TextureEncoder::encodeBlockBC1( unsigned char * dst, const std::uint32_t * src, bool isBC1 )
+{
+	std::uint32_t	transparentMask = 0;
+	float	mean[3] = { 0.0f, 0.0f, 0.0f };
+	float	minColor[3] = { 255.0f, 255.0f, 255.0f };
+	float	maxColor[3] = { 0.0f, 0.0f, 0.0f };
+	int	n = 0;
+	for ( int i = 0; i < 16; i++ ) {
+		if ( isBC1 && ( src[i] >> 24 ) < 128 ) {
+			transparentMask |= 1U << i;
+			continue;
+		}
+		for ( int j = 0; j < 3; j++ ) {
+			float	c = float( getChannel( src[i], j ) );
+			mean[j] += c;
+			minColor[j] = std::min( minColor[j], c );
+			maxColor[j] = std::max( maxColor[j], c );
+		}
+		n++;
+	}
+	if ( !n ) {
+		// all pixels are transparent
+		writeUInt16( dst, 0 );
+		writeUInt16( dst + 2, 0 );
+		writeUInt32( dst + 4, 0xFFFFFFFFU );
+		return;
+	}
+	for ( int j = 0; j < 3; j++ )
+		mean[j] /= float( n );
+
+	// covariance matrix of the opaque pixels
+	float	cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for ( int i = 0; i < 16; i++ ) {
+		if ( transparentMask & ( 1U << i ) )
+			continue;
+		float	r = float( getChannel( src[i], 0 ) ) - mean[0];
+		float	g = float( getChannel( src[i], 1 ) ) - mean[1];
+		float	b = float( getChannel( src[i], 2 ) ) - mean[2];
+		cov[0] += r * r;
+		cov[1] += r * g;
+		cov[2] += r * b;
+		cov[3] += g * g;
+		cov[4] += g * b;
+		cov[5] += b * b;
+	}
+
+	// principal axis by power iteration, starting from the diagonal of the bounding box
+	float	axis[3];
+	for ( int j = 0; j < 3; j++ )
+		axis[j] = maxColor[j] - minColor[j] + 0.001f;
+	for ( int k = 0; k < 8; k++ ) {
+		float	v[3];
+		v[0] = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		v[1] = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		v[2] = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float	m = std::max( std::max( std::fabs( v[0] ), std::fabs( v[1] ) ), std::fabs( v[2] ) );
+		if ( !( m > 1.0e-6f ) )
+			break;
+		for ( int j = 0; j < 3; j++ )
+			axis[j] = v[j] / m;
+	}
+	float	axisLen = std::sqrt( axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] );
+	for ( int j = 0; j < 3; j++ )
+		axis[j] = ( axisLen > 1.0e-6f ? axis[j] / axisLen : 0.57735f );
+
+	float	tMin = 1.0e9f;
+	float	tMax = -1.0e9f;
+	for ( int i = 0; i < 16; i++ ) {
+		if ( transparentMask & ( 1U << i ) )
+			continue;
+		float	t = 0.0f;
+		for ( int j = 0; j < 3; j++ )
+			t += ( float( getChannel( src[i], j ) ) - mean[j] ) * axis[j];
+		tMin = std::min( tMin, t );
+		tMax = std::max( tMax, t );
+	}
+	// inset the endpoints slightly, the extreme colors are usually outliers that do not need to be exact
+	float	inset = ( tMax - tMin ) * ( 1.0f / 32.0f );
+	tMin += inset;
+	tMax -= inset;
+
+	float	e0[3];
+	float	e1[3];
+	for ( int j = 0; j < 3; j++ ) {
+		e0[j] = mean[j] + axis[j] * tMax;
+		e1[j] = mean[j] + axis[j] * tMin;
+	}
+
+	bool	fourColors = !transparentMask;
+	auto	quantizeEndpoints = [&]( std::uint32_t & c0, std::uint32_t & c1 ) {
+		c0 = rgbToRGB565( e0 );
+		c1 = rgbToRGB565( e1 );
+		// BC1 selects the four color mode with c0 > c1, and the three color mode otherwise
+		if ( isBC1 && ( fourColors ? c0 < c1 : c0 > c1 ) )
+			std::swap( c0, c1 );
+	};
+
+	std::uint32_t	c0, c1, indices;
+	quantizeEndpoints( c0, c1 );
+	if ( c0 == c1 && fourColors && isBC1 ) {
+		// solid color, c0 == c1 would select the three color mode, but index 0 is the same in both modes
+		writeUInt16( dst, c0 );
+		writeUInt16( dst + 2, c1 );
+		writeUInt32( dst + 4, 0 );
+		return;
+	}
+	std::uint32_t	err = findBC1Indices( indices, src, transparentMask, c0, c1, fourColors || !isBC1 );
+
+	// refine the endpoints with a least squares fit to the selected palette weights
+	if ( err ) {
+		static const float	weights4[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		static const float	weights3[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+		const float *	weights = ( fourColors || !isBC1 ? weights4 : weights3 );
+		float	a = 0.0f, b = 0.0f, c = 0.0f;
+		float	x0[3] = { 0.0f, 0.0f, 0.0f };
+		float	x1[3] = { 0.0f, 0.0f, 0.0f };
+		for ( int i = 0; i < 16; i++ ) {
+			if ( transparentMask & ( 1U << i ) )
+				continue;
+			float	w = weights[( indices >> ( i << 1 ) ) & 3];
+			a += w * w;
+			b += w * ( 1.0f - w );
+			c += ( 1.0f - w ) * ( 1.0f - w );
+			for ( int j = 0; j < 3; j++ ) {
+				float	x = float( getChannel( src[i], j ) );
+				x0[j] += w * x;
+				x1[j] += ( 1.0f - w ) * x;
+			}
+		}
+		float	det = a * c - b * b;
+		if ( std::fabs( det ) > 1.0e-4f ) {
+			for ( int j = 0; j < 3; j++ ) {
+				e0[j] = ( c * x0[j] - b * x1[j] ) / det;
+				e1[j] = ( a * x1[j] - b * x0[j] ) / det;
+			}
+			std::uint32_t	c0b, c1b, indicesB;
+			quantizeEndpoints( c0b, c1b );
+			if ( !( c0b == c1b && fourColors && isBC1 ) ) {
+				std::uint32_t	errB = findBC1Indices( indicesB, src, transparentMask, c0b, c1b, fourColors || !isBC1 );
+				if ( errB < err ) {
+					c0 = c0b;
+					c1 = c1b;
+					indices = indicesB;
+				}
+			}
+		}
+	}
+
+	writeUInt16( dst, c0 );
+	writeUInt16( dst + 2, c1 );
+	writeUInt32( dst + 4, indices );
+}
+
+// encodes 16 values in the range -127 to 127 (signed) or 0 to 255 as a BC4 block, using the 8 value mode
+static void encodeBC4Values( unsigned char * dst, const int * v )
+{
+	int	a0 = *( std::max_element( v, v + 16 ) );
+	int	a1 = *( std::min_element( v, v + 16 ) );
+	dst[0] = (unsigned char) ( a0 & 0xFF );
+	dst[1] = (unsigned char) ( a1 & 0xFF );
+
+	std::uint64_t	indices = 0;
+	if ( a0 > a1 ) {
+		// same palette as decodeBC4Palette() in texturedecoder.cpp, before the conversion of signed values
+		int	palette[8];
+		palette[0] = a0;
+		palette[1] = a1;
+		for ( int i = 1; i < 7; i++ )
+			palette[i + 1] = ( ( 7 - i ) * a0 + i * a1 ) / 7;
+		for ( int i = 0; i < 16; i++ ) {
+			int	bestErr = 0x7FFFFFFF;
+			std::uint64_t	n = 0;
+			for ( int k = 0; k < 8; k++ ) {
+				int	d = std::abs( v[i] - palette[k] );
+				if ( d < bestErr ) {
+					bestErr = d;
+					n = std::uint64_t( k );
+				}
+			}
+			indices |= n << ( i * 3 );
+		}
+	}
+	writeUInt16( dst + 2, std::uint32_t( indices & 0xFFFF ) );
+	writeUInt32( dst + 4, std::uint32_t( indices >> 16 ) );
+}
+
+void TextureEncoder::encodeBlockBC4( unsigned char * dst, const std::uint32_t * src, int channel, bool isSigned )
+{
+	int	v[16];
+	for ( int i = 0; i < 16; i++ ) {
+		int	c = getChannel( src[i], channel );
+		// inverse of sNorm8ToUNorm8() in texturedecoder.cpp
+		v[i] = ( !isSigned ? c : ( ( c * 254 + 127 ) / 255 - 127 ) );
+	}
+	encodeBC4Values( dst, v );
+}
+
+void TextureEncoder::encodeBlockBC3( unsigned char * dst, const std::uint32_t * src )
+{
+	encodeBlockBC4( dst, src, 3, false );
+	encodeBlockBC1( dst + 8, src, false );
+}
+
+void TextureEncoder::encodeBlockBC5( unsigned char * dst, const std::uint32_t * src, bool isSigned )
+{
+	encodeBlockBC4( dst, src, 0, isSigned );
+	encodeBlockBC4( dst + 8, src, 1, isSigned );
+}
+
+bool TextureEncoder::isSupported( std::uint32_t fmt )
+{
+	switch ( fmt ) {
+	case 28:	// R8G8B8A8_UNORM
+	case 29:	// R8G8B8A8_UNORM_SRGB
+	case 71:	// BC1_UNORM
+	case 72:	// BC1_UNORM_SRGB
+	case 77:	// BC3_UNORM
+	case 78:	// BC3_UNORM_SRGB
+	case 80:	// BC4_UNORM
+	case 81:	// BC4_SNORM
+	case 83:	// BC5_UNORM
+	case 84:	// BC5_SNORM
+	case 87:	// B8G8R8A8_UNORM
+	case 91:	// B8G8R8A8_UNORM_SRGB
+		return true;
+	}
+	return false;
+}
+
+std::uint32_t TextureEncoder::getFallbackFormat( std::uint32_t fmt )
+{
+	if ( isSupported( fmt ) )
+		return fmt;
+	switch ( fmt ) {
+	case 49:	// R8G8_UNORM
+	case 61:	// R8_UNORM
+	case 65:	// A8_UNORM
+	case 85:	// B5G6R5_UNORM
+	case 86:	// B5G5R5A1_UNORM
+	case 115:	// B4G4R4A4_UNORM
+		return 28;
+	case 88:	// B8G8R8X8_UNORM
+		return 87;
+	case 93:	// B8G8R8X8_UNORM_SRGB
+		return 91;
+	}
+	// BC2 and BC7 would be downgraded to BC3, and signed, 10 and 16-bit and float formats would lose range
+	// or precision
+	return 0;
+}
+
+static inline bool isSRGBFormat( std::uint32_t fmt )
+{
+	return ( fmt == 29 || fmt == 72 || fmt == 78 || fmt == 91 || fmt == 93 || fmt == 99 );
+}
+
+// channels stored by the output formats (1 = R, 2 = G, 4 = B, 8 = A)
+static std::uint32_t formatChannelMask( std::uint32_t fmt )
+{
+	switch ( fmt ) {
+	case 71:
+	case 72:
+		return 7;
+	case 80:
+	case 81:
+		return 1;
+	case 83:
+	case 84:
+		return 3;
+	}
+	return 15;
+}
+
+bool TextureEncoder::encodeImage( unsigned char * dst, const std::uint32_t * src, std::uint32_t fmt,
+									int width, int height, int threadCount )
+{
+	unsigned int	blockBytes = 0;
+	unsigned int	blockSize = 1;
+	if ( !( isSupported( fmt ) && TextureInfo::dxgiBlockInfo( fmt, blockBytes, blockSize ) ) )
+		return false;
+	if ( width < 1 || height < 1 )
+		return false;
+	int	blocksX = ( width + int( blockSize ) - 1 ) / int( blockSize );
+	int	blocksY = ( height + int( blockSize ) - 1 ) / int( blockSize );
+	size_t	rowBytes = size_t( blocksX ) * blockBytes;
+	std::atomic< int >	nextRow( 0 );
+
+	auto	encodeRows = [&]() {
+		std::uint32_t	tmp[16];
+		int	by;
+		while ( ( by = nextRow.fetch_add( 1 ) ) < blocksY ) {
+			unsigned char *	p = dst + ( size_t( by ) * rowBytes );
+			if ( blockSize == 1 ) {
+				const std::uint32_t *	s = src + ( size_t( by ) * size_t( width ) );
+				bool	isBGRA = ( fmt == 87 || fmt == 91 );
+				for ( int x = 0; x < width; x++, p = p + 4 ) {
+					std::uint32_t	c = s[x];
+					if ( isBGRA )
+						c = ( c & 0xFF00FF00U ) | ( ( c >> 16 ) & 0xFF ) | ( ( c & 0xFF ) << 16 );
+					writeUInt32( p, c );
+				}
+				continue;
+			}
+			for ( int bx = 0; bx < blocksX; bx++, p = p + blockBytes ) {
+				// pixels outside the image at the right and bottom edges are copied from the last column or row
+				for ( int i = 0; i < 16; i++ ) {
+					int	x = std::min< int >( ( bx << 2 ) + ( i & 3 ), width - 1 );
+					int	y = std::min< int >( ( by << 2 ) + ( i >> 2 ), height - 1 );
+					tmp[i] = src[size_t( y ) * size_t( width ) + size_t( x )];
+				}
+				switch ( fmt ) {
+				case 71:
+				case 72:
+					encodeBlockBC1( p, tmp, true );
+					break;
+				case 77:
+				case 78:
+					encodeBlockBC3( p, tmp );
+					break;
+				case 80:
+				case 81:
+					encodeBlockBC4( p, tmp, 0, ( fmt == 81 ) );
+					break;
+				default:
+					encodeBlockBC5( p, tmp, ( fmt == 84 ) );
+					break;
+				}
+			}
+		}
+	};
+
+	if ( threadCount <= 0 ) {
+		// encoding is slower than decoding, use one thread per 16K pixels, up to the number of CPU cores
+		int	maxThreads = std::max< int >( int( std::thread::hardware_concurrency() ), 1 );
+		threadCount = int( std::min< size_t >( ( size_t( width ) * size_t( height ) ) >> 14, size_t( maxThreads ) ) );
+	}
+	threadCount = std::clamp< int >( threadCount, 1, std::min< int >( blocksY, 64 ) );
+
+	std::vector< std::thread >	threads;
+	for ( int i = 1; i < threadCount; i++ )
+		threads.emplace_back( encodeRows );
+	encodeRows();
+	for ( auto & t : threads )
+		t.join();
+
+	return true;
+}
+
+void TextureEncoder::downsampleImage( std::uint32_t * dst, const std::uint32_t * src, int width, int height, bool isSRGB )
+{
+	static const std::vector< float >	srgbToLinearTable = []() {
+		std::vector< float >	t( 256 );
+		for ( int i = 0; i < 256; i++ ) {
+			float	c = float( i ) / 255.0f;
+			t[i] = ( c <= 0.04045f ? c / 12.92f : std::pow( ( c + 0.055f ) / 1.055f, 2.4f ) );
+		}
+		return t;
+	}();
+
+	int	w2 = std::max< int >( width >> 1, 1 );
+	int	h2 = std::max< int >( height >> 1, 1 );
+	int	dx = ( width > 1 ? 1 : 0 );
+	int	dy = ( height > 1 ? width : 0 );
+	for ( int y = 0; y < h2; y++ ) {
+		const std::uint32_t *	s = src + ( size_t( y << ( height > 1 ? 1 : 0 ) ) * size_t( width ) );
+		for ( int x = 0; x < w2; x++, dst++ ) {
+			const std::uint32_t *	p = s + ( x << ( width > 1 ? 1 : 0 ) );
+			std::uint32_t	c[4] = { p[0], p[dx], p[dy], p[dx + dy] };
+			std::uint32_t	a = ( getChannel( c[0], 3 ) + getChannel( c[1], 3 ) + getChannel( c[2], 3 ) + getChannel( c[3], 3 ) + 2 ) >> 2;
+			std::uint32_t	rgb[3];
+			for ( int j = 0; j < 3; j++ ) {
+				if ( !isSRGB ) {
+					rgb[j] = std::uint32_t( getChannel( c[0], j ) + getChannel( c[1], j ) + getChannel( c[2], j )
+											+ getChannel( c[3], j ) + 2 ) >> 2;
+					continue;
+				}
+				float	l = ( srgbToLinearTable[getChannel( c[0], j )] + srgbToLinearTable[getChannel( c[1], j )]
+							+ srgbToLinearTable[getChannel( c[2], j )] + srgbToLinearTable[getChannel( c[3], j )] ) * 0.25f;
+				l = ( l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow( l, 1.0f / 2.4f ) - 0.055f );
+				rgb[j] = std::uint32_t( std::clamp< float >( l * 255.0f + 0.5f, 0.0f, 255.0f ) );
+			}
+			*dst = packRGBA( rgb[0], rgb[1], rgb[2], a );
+		}
+	}
+}
+
+double TextureEncoder::calculatePSNR( const std::uint32_t * a, const std::uint32_t * b, size_t pixelCount,
+										std::uint32_t channelMask )
+{
+	std::uint64_t	err = 0;
+	std::uint64_t	n = 0;
+	for ( int j = 0; j < 4; j++ ) {
+		if ( !( channelMask & ( 1U << j ) ) )
+			continue;
+		for ( size_t i = 0; i < pixelCount; i++ ) {
+			int	d = getChannel( a[i], j ) - getChannel( b[i], j );
+			err += std::uint64_t( d * d );
+		}
+		n += pixelCount;
+	}
+	if ( !err || !n )
+		return 999.0;
+	double	mse = double( err ) / double( n );
+	return 10.0 * std::log10( 255.0 * 255.0 / mse );
+}
+
+QByteArray TextureEncoder::createDDSHeader( std::uint32_t fmt, std::uint32_t width, std::uint32_t height,
+											std::uint32_t mipLevels, bool isCubeMap )
+{
+	unsigned int	blockBytes = 0;
+	unsigned int	blockSize = 1;
+	if ( !TextureInfo::dxgiBlockInfo( fmt, blockBytes, blockSize ) )
+		return QByteArray();
+
+	std::uint32_t	fourCC = 0;
+	std::uint32_t	pfFlags = 0x04;		// DDPF_FOURCC
+	std::uint32_t	masks[4] = { 0, 0, 0, 0 };
+	switch ( fmt ) {
+	case 28:
+		pfFlags = 0x41;		// DDPF_RGB | DDPF_ALPHAPIXELS
+		masks[0] = 0x000000FFU;
+		masks[1] = 0x0000FF00U;
+		masks[2] = 0x00FF0000U;
+		masks[3] = 0xFF000000U;
+		break;
+	case 71:
+		fourCC = 0x31545844;	// "DXT1"
+		break;
+	case 77:
+		fourCC = 0x35545844;	// "DXT5"
+		break;
+	case 80:
+		fourCC = 0x31495441;	// "ATI1"
+		break;
+	case 83:
+		fourCC = 0x32495441;	// "ATI2"
+		break;
+	case 87:
+		pfFlags = 0x41;
+		masks[0] = 0x00FF0000U;
+		masks[1] = 0x0000FF00U;
+		masks[2] = 0x000000FFU;
+		masks[3] = 0xFF000000U;
+		break;
+	default:
+		fourCC = 0x30315844;	// "DX10"
+		break;
+	}
+	bool	isDX10 = ( fourCC == 0x30315844 );
+
+	QByteArray	buf( isDX10 ? 148 : 128, '\0' );
+	unsigned char *	p = reinterpret_cast< unsigned char * >( buf.data() );
+	bool	isCompressed = ( blockSize > 1 );
+	std::uint32_t	blocksX = ( width + blockSize - 1 ) / blockSize;
+	std::uint32_t	blocksY = ( height + blockSize - 1 ) / blockSize;
+	// DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT, and DDSD_LINEARSIZE or DDSD_PITCH, DDSD_MIPMAPCOUNT
+	std::uint32_t	flags = 0x1007 | ( isCompressed ? 0x80000 : 0x08 ) | ( mipLevels > 1 ? 0x20000 : 0 );
+	writeUInt32( p, 0x20534444 );	// "DDS "
+	writeUInt32( p + 4, 124 );
+	writeUInt32( p + 8, flags );
+	writeUInt32( p + 12, height );
+	writeUInt32( p + 16, width );
+	writeUInt32( p + 20, isCompressed ? blocksX * blocksY * blockBytes : blocksX * blockBytes );
+	writeUInt32( p + 28, mipLevels );
+	writeUInt32( p + 76, 32 );
+	writeUInt32( p + 80, pfFlags );
+	writeUInt32( p + 84, fourCC );
+	if ( pfFlags & 0x40 ) {
+		writeUInt32( p + 88, 32 );
+		for ( int i = 0; i < 4; i++ )
+			writeUInt32( p + 92 + ( i * 4 ), masks[i] );
+	}
+	// DDSCAPS_TEXTURE, DDSCAPS_COMPLEX | DDSCAPS_MIPMAP, DDSCAPS_COMPLEX
+	writeUInt32( p + 108, 0x1000 | ( mipLevels > 1 ? 0x400008 : 0 ) | ( isCubeMap ? 0x08 : 0 ) );
+	writeUInt32( p + 112, isCubeMap ? 0xFE00 : 0 );		// DDSCAPS2_CUBEMAP and all faces
+	if ( isDX10 ) {
+		writeUInt32( p + 128, fmt );
+		writeUInt32( p + 132, 3 );		// D3D10_RESOURCE_DIMENSION_TEXTURE2D
+		writeUInt32( p + 136, isCubeMap ? 4 : 0 );		// D3D10_RESOURCE_MISC_TEXTURECUBE
+		writeUInt32( p + 140, 1 );
+	}
+	return buf;
+}
+
+QByteArray TextureEncoder::convertDDS( const void * data, size_t size, const Options & options,
+										QString * errorMessage, double * psnr )
+{
+	TextureInfo	info;
+	QString	err;
+	const unsigned char *	src = reinterpret_cast< const unsigned char * >( data );
+	std::uint32_t	fmt = 0;
+	if ( !info.parseDDS( src, size ) ) {
+		err = ( !info.errors.isEmpty() ? info.errors.first() : QString( "invalid DDS file" ) );
+	} else if ( info.depth > 1 || info.arraySize > 1 ) {
+		err = QString( "volume textures and texture arrays are not supported" );
+	} else {
+		fmt = ( options.dxgiFormat ? options.dxgiFormat : getFallbackFormat( info.dxgiFormat ) );
+		// formats that cannot be encoded without loss are kept, and can only be copied
+		if ( !fmt )
+			fmt = info.dxgiFormat;
+		else if ( !isSupported( fmt ) )
+			err = QString( "cannot encode %1" ).arg( TextureInfo::dxgiFormatName( fmt ) );
+	}
+	if ( !err.isEmpty() ) {
+		if ( errorMessage )
+			*errorMessage = err;
+		return QByteArray();
+	}
+
+	unsigned int	blockBytes = 0;
+	unsigned int	blockSize = 1;
+	(void) TextureInfo::dxgiBlockInfo( info.dxgiFormat, blockBytes, blockSize );
+	auto	levelBytes = [&]( std::uint32_t l ) {
+		size_t	w = std::max< std::uint32_t >( info.width >> l, 1U );
+		size_t	h = std::max< std::uint32_t >( info.height >> l, 1U );
+		return ( ( w + blockSize - 1 ) / blockSize ) * ( ( h + blockSize - 1 ) / blockSize ) * blockBytes;
+	};
+
+	// downscale by skipping mip levels of the input where possible, and with the box filter of the decoder otherwise
+	std::uint32_t	maxSize = options.maxSize;
+	std::uint32_t	level = 0;
+	while ( maxSize && ( level + 1 ) < info.mipLevels
+			&& std::max( info.width >> level, info.height >> level ) > maxSize ) {
+		level++;
+	}
+	size_t	levelOffset = 0;
+	size_t	chainBytes = 0;
+	for ( std::uint32_t l = 0; l < info.mipLevels; l++ ) {
+		if ( l < level )
+			levelOffset += levelBytes( l );
+		chainBytes += levelBytes( l );
+	}
+	int	w = int( std::max< std::uint32_t >( info.width >> level, 1U ) );
+	int	h = int( std::max< std::uint32_t >( info.height >> level, 1U ) );
+	int	scaleLog2 = 0;
+	while ( maxSize && scaleLog2 < 12
+			&& std::uint32_t( std::max( TextureDecoder::getScaledSize( w, scaleLog2 ),
+										TextureDecoder::getScaledSize( h, scaleLog2 ) ) ) > maxSize ) {
+		scaleLog2++;
+	}
+	int	outWidth = TextureDecoder::getScaledSize( w, scaleLog2 );
+	int	outHeight = TextureDecoder::getScaledSize( h, scaleLog2 );
+
+	std::uint32_t	mipLevels = 1;
+	while ( ( outWidth >> mipLevels ) > 0 || ( outHeight >> mipLevels ) > 0 )
+		mipLevels++;
+	if ( !options.generateMips )
+		mipLevels = std::clamp< std::uint32_t >( info.mipLevels - level, 1U, mipLevels );
+
+	if ( fmt == info.dxgiFormat && !scaleLog2 && ( info.mipLevels - level ) >= mipLevels ) {
+		// copy the mip levels unchanged, re-encoding to the same format would only lose quality
+		if ( psnr )
+			*psnr = 999.0;
+		if ( !level && mipLevels == info.mipLevels )
+			return QByteArray( reinterpret_cast< const char * >( data ), qsizetype( size ) );
+		QByteArray	out = createDDSHeader( fmt, std::uint32_t( w ), std::uint32_t( h ), mipLevels, info.isCubeMap() );
+		size_t	copyBytes = 0;
+		for ( std::uint32_t l = level; l < ( level + mipLevels ); l++ )
+			copyBytes += levelBytes( l );
+		for ( std::uint32_t face = 0; !out.isEmpty() && face < info.faces; face++ ) {
+			size_t	offset = size_t( info.dataOffset ) + ( chainBytes * face ) + levelOffset;
+			if ( offset > size || ( size - offset ) < copyBytes )
+				out.clear();
+			else
+				out.append( reinterpret_cast< const char * >( src + offset ), qsizetype( copyBytes ) );
+		}
+		if ( out.isEmpty() && errorMessage )
+			*errorMessage = QString( "unexpected EOF" );
+		return out;
+	}
+	if ( !isSupported( fmt ) || !TextureDecoder::isSupported( info.dxgiFormat ) ) {
+		if ( errorMessage ) {
+			if ( !TextureDecoder::isSupported( info.dxgiFormat ) )
+				*errorMessage = QString( "unsupported format: %1" ).arg( info.pixelFormat );
+			else
+				*errorMessage = QString( "%1 cannot be resized or have mip maps generated without loss, select an output format" )
+								.arg( info.pixelFormat );
+		}
+		return QByteArray();
+	}
+
+	unsigned int	outBlockBytes = 0;
+	unsigned int	outBlockSize = 1;
+	(void) TextureInfo::dxgiBlockInfo( fmt, outBlockBytes, outBlockSize );
+	auto	outLevelBytes = [&]( int lw, int lh ) {
+		return ( size_t( lw + int( outBlockSize ) - 1 ) / outBlockSize ) * ( size_t( lh + int( outBlockSize ) - 1 ) / outBlockSize )
+				* outBlockBytes;
+	};
+
+	QByteArray	out = createDDSHeader( fmt, std::uint32_t( outWidth ), std::uint32_t( outHeight ), mipLevels, info.isCubeMap() );
+	bool	isSRGB = isSRGBFormat( fmt );
+	double	minPSNR = 999.0;
+	std::vector< std::uint32_t >	img;
+	std::vector< std::uint32_t >	tmp;
+	for ( std::uint32_t face = 0; face < info.faces; face++ ) {
+		size_t	offset = size_t( info.dataOffset ) + ( chainBytes * face ) + levelOffset;
+		img.resize( size_t( outWidth ) * size_t( outHeight ) );
+		if ( offset > size
+			|| !TextureDecoder::decodeImage( img.data(), src + offset, size - offset, info.dxgiFormat, w, h, scaleLog2,
+												options.threadCount ) ) {
+			if ( errorMessage )
+				*errorMessage = QString( "unexpected EOF" );
+			return QByteArray();
+		}
+
+		int	lw = outWidth;
+		int	lh = outHeight;
+		for ( std::uint32_t m = 0; m < mipLevels; m++ ) {
+			if ( m > 0 ) {
+				tmp.resize( size_t( std::max< int >( lw >> 1, 1 ) ) * size_t( std::max< int >( lh >> 1, 1 ) ) );
+				downsampleImage( tmp.data(), img.data(), lw, lh, isSRGB );
+				img.swap( tmp );
+				lw = std::max< int >( lw >> 1, 1 );
+				lh = std::max< int >( lh >> 1, 1 );
+			}
+			qsizetype	pos = out.size();
+			size_t	n = outLevelBytes( lw, lh );
+			out.resize( pos + qsizetype( n ) );
+			unsigned char *	dst = reinterpret_cast< unsigned char * >( out.data() ) + pos;
+			(void) encodeImage( dst, img.data(), fmt, lw, lh, options.threadCount );
+
+			if ( psnr && !m ) {
+				tmp.resize( img.size() );
+				(void) TextureDecoder::decodeImage( tmp.data(), dst, n, fmt, lw, lh, 0, options.threadCount );
+				if ( fmt == 71 || fmt == 72 ) {
+					// the color of pixels that BC1 makes transparent is not compared
+					for ( size_t i = 0; i < img.size(); i++ ) {
+						if ( ( img[i] >> 24 ) < 128 )
+							tmp[i] = img[i] & 0x00FFFFFFU;
+					}
+				}
+				minPSNR = std::min( minPSNR, calculatePSNR( img.data(), tmp.data(), img.size(), formatChannelMask( fmt ) ) );
+			}
+		}
+	}
+
+	if ( psnr )
+		*psnr = minPSNR;
+	return out;
+}
@@ -0,0 +1,86 @@
+#ifndef TEXTUREENCODER_H_INCLUDED
+#define TEXTUREENCODER_H_INCLUDED
+
+#include <QByteArray>
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+
+//! CPU encoder of 8-bit RGBA images to BC1, BC3, BC4, BC5 and 32-bit uncompressed DDS formats
+/*!
+ * This is the counterpart of TextureDecoder, and uses the same pixel layout (R in the lowest byte). Besides encoding
+ * single images, it can convert complete DDS files: the texture is decoded, optionally downscaled to a maximum size,
+ * its mip chain is regenerated with a box filter (in linear color space for sRGB formats), and all levels are encoded
+ * to the output format. Nothing here uses OpenGL or the Qt GUI, so conversions can run on any thread.
+ *
+ * The block encoders fit the endpoints to the principal axis of the block colors, and refine them once with a
+ * least squares fit. This is fast, but lower quality than dedicated texture compression tools.
+ */
+class TextureEncoder
+{
+public:
+	//! Parameters of convertDDS()
+	struct Options
+	{
+		//! DXGI format of the output, or 0 to keep the format of the input. Input formats with 8 bits or less per
+		// channel that cannot be encoded are converted to R8G8B8A8 (or B8G8R8A8), preserving sRGB. Other formats
+		// (BC2, BC6H, BC7, signed, 10 and 16-bit and float) are never converted to a lower precision implicitly,
+		// their mip levels are copied unchanged, which is only possible if the image does not need to be resized.
+		std::uint32_t	dxgiFormat = 0;
+		//! Images larger than this in width or height are downscaled by powers of two, 0 = no limit
+		std::uint32_t	maxSize = 0;
+		//! Create a complete mip chain down to 1x1, otherwise the number of mip levels of the input is kept
+		bool	generateMips = true;
+		//! Number of threads used for decoding and encoding, 0 = automatic
+		int	threadCount = 0;
+	};
+
+	//! Returns true if images can be encoded to DXGI format 'fmt'
+	static bool isSupported( std::uint32_t fmt );
+	//! Returns the format that convertDDS() encodes to for input format 'fmt' if the format is to be kept,
+	// or 0 if the input cannot be encoded without loss, and can only be copied
+	static std::uint32_t getFallbackFormat( std::uint32_t fmt );
+
+	//! Encode a width x height image from 'src' to DXGI format 'fmt'. 'dst' must have space for the full image,
+	// with the width and height rounded up to a multiple of 4 for compressed formats. Returns false if the format
+	// is not supported. If 'threadCount' is zero, it is chosen automatically from the image size.
+	static bool encodeImage( unsigned char * dst, const std::uint32_t * src, std::uint32_t fmt,
+								int width, int height, int threadCount = 0 );
+
+	//! Downscale an image to half its size (rounded down, at least 1) with a 2x2 box filter.
+	// If 'isSRGB' is true, the color channels are averaged in linear color space.
+	static void downsampleImage( std::uint32_t * dst, const std::uint32_t * src, int width, int height, bool isSRGB );
+
+	/*! Convert a DDS file as described for Options. Cube maps are supported, volume textures and arrays are not.
+	 *
+	 * If the output format is the same as the input, and the image is not resized, and no missing mip levels need
+	 * to be generated, the mip levels are copied without decoding and encoding them again.
+	 *
+	 * On failure, an empty array is returned, and the reason is stored in 'errorMessage' if it is not nullptr.
+	 * If 'psnr' is not nullptr, the largest mip level of the output is decoded again and compared to the image
+	 * it was encoded from, and the peak signal to noise ratio in dB over all channels is stored in 'psnr'.
+	 */
+	static QByteArray convertDDS( const void * data, size_t size, const Options & options,
+									QString * errorMessage = nullptr, double * psnr = nullptr );
+
+	//! Returns a DDS file header for the image. Legacy FourCC or bit mask headers are used where possible,
+	// the DX10 extension only for sRGB and signed formats.
+	static QByteArray createDDSHeader( std::uint32_t fmt, std::uint32_t width, std::uint32_t height,
+										std::uint32_t mipLevels, bool isCubeMap = false );
+
+	//! Peak signal to noise ratio in dB of two images of 'pixelCount' pixels, or 999.0 if they are identical.
+	// Only the channels set in 'channelMask' (1 = R, 2 = G, 4 = B, 8 = A) are compared.
+	static double calculatePSNR( const std::uint32_t * a, const std::uint32_t * b, size_t pixelCount,
+									std::uint32_t channelMask = 15 );
+
+	// Encode 16 pixels in row major order to a single 4x4 block of a BCn format. If 'isBC1' is false, the color block
+	// of BC3 is encoded, which always uses four colors. Otherwise, pixels with alpha below 128 are made transparent.
+	static void encodeBlockBC1( unsigned char * dst, const std::uint32_t * src, bool isBC1 = true );
+	static void encodeBlockBC3( unsigned char * dst, const std::uint32_t * src );
+	// 'channel' is 0 to 3 for R, G, B or A
+	static void encodeBlockBC4( unsigned char * dst, const std::uint32_t * src, int channel = 0, bool isSigned = false );
+	static void encodeBlockBC5( unsigned char * dst, const std::uint32_t * src, bool isSigned = false );
+};
+
+#endif
@@ -0,0 +1,573 @@
+#include "textureinfo.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+
+static inline std::uint32_t readUInt16( const unsigned char * p )
+{
+	return qFromLittleEndian< quint16 >( p );
+}
+
+static inline std::uint32_t readUInt32( const unsigned char * p )
+{
+	return qFromLittleEndian< quint32 >( p );
+}
+
+static inline bool isPowerOfTwo( std::uint32_t n )
+{
+	return ( n && !( n & ( n - 1U ) ) );
+}
+
+std::uint32_t TextureInfo::fullMipCount() const
+{
+	std::uint32_t	n = std::max( width, height );
+	std::uint32_t	levels = 1;
+	for ( ; n > 1; n = n >> 1 )
+		levels++;
+	return levels;
+}
+
+void TextureInfo::clear()
+{
+	*this = TextureInfo();
+}
+
+bool TextureInfo::parse( const void * data, size_t size, const QString & fileName )
+{
+	clear();
+	const unsigned char *	p = reinterpret_cast< const unsigned char * >( data );
+	if ( size >= 4 && readUInt32( p ) == 0x20534444 )	// "DDS "
+		return parseDDS( p, size );
+	if ( size >= 2 && p[0] == 'B' && p[1] == 'M' )
+		return parseBMP( p, size );
+	if ( fileName.endsWith( ".tga", Qt::CaseInsensitive ) )
+		return parseTGA( p, size );
+
+	errors.append( QString( "unknown file format" ) );
+	return false;
+}
+
+QString TextureInfo::dxgiFormatName( std::uint32_t fmt )
+{
+	switch ( fmt ) {
+	case 2:
+		return "R32G32B32A32_FLOAT";
+	case 6:
+		return "R32G32B32_FLOAT";
+	case 10:
+		return "R16G16B16A16_FLOAT";
+	case 11:
+		return "R16G16B16A16_UNORM";
+	case 13:
+		return "R16G16B16A16_SNORM";
+	case 16:
+		return "R32G32_FLOAT";
+	case 24:
+		return "R10G10B10A2_UNORM";
+	case 26:
+		return "R11G11B10_FLOAT";
+	case 28:
+		return "R8G8B8A8_UNORM";
+	case 29:
+		return "R8G8B8A8_UNORM_SRGB";
+	case 31:
+		return "R8G8B8A8_SNORM";
+	case 34:
+		return "R16G16_FLOAT";
+	case 35:
+		return "R16G16_UNORM";
+	case 37:
+		return "R16G16_SNORM";
+	case 41:
+		return "R32_FLOAT";
+	case 49:
+		return "R8G8_UNORM";
+	case 51:
+		return "R8G8_SNORM";
+	case 54:
+		return "R16_FLOAT";
+	case 56:
+		return "R16_UNORM";
+	case 61:
+		return "R8_UNORM";
+	case 63:
+		return "R8_SNORM";
+	case 65:
+		return "A8_UNORM";
+	case 67:
+		return "R9G9B9E5_SHAREDEXP";
+	case 71:
+		return "BC1_UNORM";
+	case 72:
+		return "BC1_UNORM_SRGB";
+	case 74:
+		return "BC2_UNORM";
+	case 75:
+		return "BC2_UNORM_SRGB";
+	case 77:
+		return "BC3_UNORM";
+	case 78:
+		return "BC3_UNORM_SRGB";
+	case 80:
+		return "BC4_UNORM";
+	case 81:
+		return "BC4_SNORM";
+	case 83:
+		return "BC5_UNORM";
+	case 84:
+		return "BC5_SNORM";
+	case 85:
+		return "B5G6R5_UNORM";
+	case 86:
+		return "B5G5R5A1_UNORM";
+	case 87:
+		return "B8G8R8A8_UNORM";
+	case 88:
+		return "B8G8R8X8_UNORM";
+	case 91:
+		return "B8G8R8A8_UNORM_SRGB";
+	case 93:
+		return "B8G8R8X8_UNORM_SRGB";
+	case 95:
+		return "BC6H_UF16";
+	case 96:
+		return "BC6H_SF16";
+	case 98:
+		return "BC7_UNORM";
+	case 99:
+		return "BC7_UNORM_SRGB";
+	case 115:
+		return "B4G4R4A4_UNORM";
+	}
+	return QString();
+}
+
+bool TextureInfo::dxgiBlockInfo( std::uint32_t fmt, unsigned int & blockBytes, unsigned int & blockSize )
+{
+	blockSize = 1;
+	if ( fmt >= 1 && fmt <= 4 )
+		blockBytes = 16;
+	else if ( fmt >= 5 && fmt <= 8 )
+		blockBytes = 12;
+	else if ( fmt >= 9 && fmt <= 22 )
+		blockBytes = 8;
+	else if ( ( fmt >= 23 && fmt <= 47 ) || fmt == 67 || ( fmt >= 87 && fmt <= 93 ) )
+		blockBytes = 4;
+	else if ( ( fmt >= 48 && fmt <= 59 ) || fmt == 85 || fmt == 86 || fmt == 115 )
+		blockBytes = 2;
+	else if ( fmt >= 60 && fmt <= 65 )
+		blockBytes = 1;
+	else if ( ( fmt >= 70 && fmt <= 72 ) || ( fmt >= 79 && fmt <= 81 ) )
+		blockBytes = 8, blockSize = 4;
+	else if ( ( fmt >= 73 && fmt <= 78 ) || ( fmt >= 82 && fmt <= 84 ) || ( fmt >= 94 && fmt <= 99 ) )
+		blockBytes = 16, blockSize = 4;
+	else
+		return false;
+	return true;
+}
+
+void TextureInfo::setMipChainInfo( unsigned int blockBytes, unsigned int blockSize, unsigned int gpuBytesPerPixel, bool generatesMips )
+{
+	std::uint32_t	fullCount = fullMipCount();
+	if ( mipLevels > fullCount ) {
+		errors.append( QString( "mip count %1 exceeds the maximum of %2 for a %3x%4 image" )
+						.arg( mipLevels ).arg( fullCount ).arg( width ).arg( height ) );
+		mipLevels = fullCount;
+	} else if ( mipLevels < fullCount && !generatesMips ) {
+		warnings.append( QString( "incomplete mip chain: %1 of %2 levels" ).arg( mipLevels ).arg( fullCount ) );
+	}
+
+	std::uint64_t	images = std::uint64_t( faces ) * arraySize * depth;
+	dataSize = 0;
+	gpuBytes = 0;
+	for ( std::uint32_t i = 0; i < std::max( mipLevels, ( generatesMips ? fullCount : 0U ) ); i++ ) {
+		std::uint64_t	w = std::max< std::uint32_t >( width >> i, 1U );
+		std::uint64_t	h = std::max< std::uint32_t >( height >> i, 1U );
+		std::uint64_t	levelBytes = ( ( w + blockSize - 1 ) / blockSize ) * ( ( h + blockSize - 1 ) / blockSize ) * blockBytes;
+		if ( i < mipLevels )
+			dataSize += levelBytes * images;
+		gpuBytes += ( !gpuBytesPerPixel ? levelBytes : w * h * gpuBytesPerPixel ) * images;
+	}
+}
+
+void TextureInfo::checkDimensions( bool requirePowerOfTwo )
+{
+	if ( !( width && height ) ) {
+		errors.append( QString( "invalid image dimensions %1x%2" ).arg( width ).arg( height ) );
+	} else if ( !( isPowerOfTwo( width ) && isPowerOfTwo( height ) ) ) {
+		if ( requirePowerOfTwo )
+			errors.append( QString( "image dimensions must be power of two (%1x%2)" ).arg( width ).arg( height ) );
+		else
+			warnings.append( QString( "image dimensions are not power of two (%1x%2)" ).arg( width ).arg( height ) );
+	}
+}
+
+bool TextureInfo::parseDDS( const unsigned char * data, size_t size )
+{
+	clear();
+	fileFormat = FileDDS;
+	if ( size < 128 || readUInt32( data ) != 0x20534444 || readUInt32( data + 4 ) != 124 ) {
+		errors.append( QString( "invalid DDS header" ) );
+		return false;
+	}
+
+	std::uint32_t	flags = readUInt32( data + 8 );
+	height = readUInt32( data + 12 );
+	width = readUInt32( data + 16 );
+	mipLevels = ( ( flags & 0x00020000 ) ? std::max< std::uint32_t >( readUInt32( data + 28 ), 1U ) : 1U );
+	std::uint32_t	pfFlags = readUInt32( data + 80 );
+	std::uint32_t	fourCC = readUInt32( data + 84 );
+	std::uint32_t	bitCount = readUInt32( data + 88 );
+	std::uint32_t	masks[4] = { readUInt32( data + 92 ), readUInt32( data + 96 ), readUInt32( data + 100 ), readUInt32( data + 104 ) };
+	std::uint32_t	caps2 = readUInt32( data + 112 );
+	size_t	headerSize = 128;
+
+	if ( caps2 & 0x00200000 ) {	// DDSCAPS2_VOLUME
+		depth = std::max< std::uint32_t >( readUInt32( data + 24 ), 1U );
+		warnings.append( QString( "volume textures are not supported" ) );
+	}
+	if ( caps2 & 0x00000200 ) {	// DDSCAPS2_CUBEMAP
+		faces = 0;
+		for ( std::uint32_t m = ( caps2 & 0x0000FC00 ); m; m = m & ( m - 1U ) )
+			faces++;
+		if ( faces != 6 )
+			errors.append( QString( "cube map has %1 faces instead of 6" ).arg( faces ) );
+	}
+
+	unsigned int	blockBytes = 0;
+	unsigned int	blockSize = 1;
+	unsigned int	gpuBytesPerPixel = 0;
+	if ( ( pfFlags & 0x04 ) && fourCC == 0x30315844 ) {	// "DX10"
+		if ( size < 148 ) {
+			errors.append( QString( "invalid DDS header" ) );
+			return false;
+		}
+		headerSize = 148;
+		dxgiFormat = readUInt32( data + 128 );
+		std::uint32_t	dimension = readUInt32( data + 132 );
+		std::uint32_t	miscFlag = readUInt32( data + 136 );
+		arraySize = std::max< std::uint32_t >( readUInt32( data + 140 ), 1U );
+		if ( dimension != 3 )	// D3D10_RESOURCE_DIMENSION_TEXTURE2D
+			warnings.append( QString( "resource dimension %1 is not supported" ).arg( dimension ) );
+		if ( miscFlag & 0x04 ) {	// D3D10_RESOURCE_MISC_TEXTURECUBE
+			if ( !( caps2 & 0x00000200 ) )
+				warnings.append( QString( "cube map flag is not set in the legacy DDS header" ) );
+			faces = 6;
+		}
+		if ( arraySize > 1 )
+			warnings.append( QString( "texture arrays are not supported" ) );
+		pixelFormat = dxgiFormatName( dxgiFormat );
+		if ( pixelFormat.isEmpty() )
+			pixelFormat = QString( "DXGI format %1" ).arg( dxgiFormat );
+		if ( !dxgiBlockInfo( dxgiFormat, blockBytes, blockSize ) ) {
+			errors.append( QString( "unsupported format: %1" ).arg( pixelFormat ) );
+			return false;
+		}
+	} else if ( pfFlags & 0x04 ) {	// DDPF_FOURCC
+		switch ( fourCC ) {
+		case 0x31545844:	// "DXT1"
+			dxgiFormat = 71;
+			break;
+		case 0x32545844:	// "DXT2"
+		case 0x33545844:	// "DXT3"
+			dxgiFormat = 74;
+			break;
+		case 0x34545844:	// "DXT4"
+		case 0x35545844:	// "DXT5"
+			dxgiFormat = 77;
+			break;
+		case 0x31495441:	// "ATI1"
+		case 0x55344342:	// "BC4U"
+			dxgiFormat = 80;
+			break;
+		case 0x53344342:	// "BC4S"
+			dxgiFormat = 81;
+			break;
+		case 0x32495441:	// "ATI2"
+		case 0x55354342:	// "BC5U"
+			dxgiFormat = 83;
+			break;
+		case 0x53354342:	// "BC5S"
+			dxgiFormat = 84;
+			break;
+		case 36:	// D3DFMT_A16B16G16R16
+			dxgiFormat = 11;
+			break;
+		case 111:	// D3DFMT_R16F
+			dxgiFormat = 54;
+			break;
+		case 112:	// D3DFMT_G16R16F
+			dxgiFormat = 34;
+			break;
+		case 113:	// D3DFMT_A16B16G16R16F
+			dxgiFormat = 10;
+			break;
+		case 114:	// D3DFMT_R32F
+			dxgiFormat = 41;
+			break;
+		case 115:	// D3DFMT_G32R32F
+			dxgiFormat = 16;
+			break;
+		case 116:	// D3DFMT_A32B32G32R32F
+			dxgiFormat = 2;
+			break;
+		default:
+			{
+				char	tmp[5];
+				std::memcpy( tmp, data + 84, 4 );
+				tmp[4] = '\0';
+				errors.append( QString( "unsupported FourCC code: %1" ).arg( QString::fromLatin1( tmp ) ) );
+			}
+			return false;
+		}
+		pixelFormat = dxgiFormatName( dxgiFormat );
+		(void) dxgiBlockInfo( dxgiFormat, blockBytes, blockSize );
+	} else if ( bitCount >= 8 && bitCount <= 32 && !( bitCount & 7 ) ) {
+		// uncompressed format described by bit masks
+		blockBytes = bitCount >> 3;
+		bool	isSigned = bool( pfFlags & 0x00080000 );	// DDPF_BUMPDUDV
+		if ( bitCount == 32 && masks[0] == 0xFF && masks[1] == 0xFF00 && masks[2] == 0xFF0000 )
+			dxgiFormat = ( isSigned ? 31 : 28 );
+		else if ( bitCount == 32 && masks[0] == 0xFF0000 && masks[1] == 0xFF00 && masks[2] == 0xFF )
+			dxgiFormat = ( masks[3] ? 87 : 88 );
+		else if ( bitCount == 16 && masks[0] == 0xF800 && masks[1] == 0x07E0 && masks[2] == 0x001F )
+			dxgiFormat = 85;
+		else if ( bitCount == 16 && masks[0] == 0x7C00 && masks[1] == 0x03E0 && masks[2] == 0x001F )
+			dxgiFormat = 86;
+		else if ( bitCount == 16 && masks[0] == 0x0F00 && masks[1] == 0x00F0 && masks[2] == 0x000F )
+			dxgiFormat = 115;
+		else if ( bitCount == 8 && ( pfFlags & 0x02 ) && !( pfFlags & 0x00020040 ) )
+			dxgiFormat = 65;	// DDPF_ALPHA only
+		if ( dxgiFormat ) {
+			pixelFormat = dxgiFormatName( dxgiFormat );
+		} else if ( pfFlags & 0x00020000 ) {	// DDPF_LUMINANCE
+			pixelFormat = ( bitCount == 8 ? "L8" : ( bitCount == 16 && masks[3] ? "L8A8" : QString( "L%1" ).arg( bitCount ) ) );
+		} else {
+			pixelFormat = QString( "RGB%1 (masks %2 %3 %4 %5)" ).arg( bitCount )
+							.arg( masks[0], 8, 16, QChar( '0' ) ).arg( masks[1], 8, 16, QChar( '0' ) )
+							.arg( masks[2], 8, 16, QChar( '0' ) ).arg( masks[3], 8, 16, QChar( '0' ) );
+		}
+		// 24-bit formats are expanded to 32 bits per pixel by the driver
+		if ( bitCount == 24 )
+			gpuBytesPerPixel = 4;
+	} else {
+		errors.append( QString( "unsupported pixel format (flags %1, %2 bits per pixel)" ).arg( pfFlags, 0, 16 ).arg( bitCount ) );
+		return false;
+	}
+
+	isCompressed = ( blockSize > 1 );
+	checkDimensions( false );
+	if ( isCubeMap() && width != height )
+		errors.append( QString( "cube map faces are not square (%1x%2)" ).arg( width ).arg( height ) );
+	if ( isCompressed && ( ( width | height ) & ( blockSize - 1 ) ) && mipLevels > 0 )
+		warnings.append( QString( "dimensions of block compressed image are not a multiple of %1" ).arg( blockSize ) );
+	if ( !errors.isEmpty() )
+		return false;
+
+	setMipChainInfo( blockBytes, blockSize, gpuBytesPerPixel, false );
+
+	dataOffset = std::uint32_t( headerSize );
+	std::uint64_t	available = size - headerSize;
+	if ( dataSize > available )
+		errors.append( QString( "file is truncated, %1 bytes of image data are missing" ).arg( dataSize - available ) );
+	else if ( dataSize < available )
+		warnings.append( QString( "%1 bytes of extra data at the end of the file" ).arg( available - dataSize ) );
+
+	return errors.isEmpty();
+}
+
+bool TextureInfo::parseTGA( const unsigned char * data, size_t size )
+{
+	clear();
+	fileFormat = FileTGA;
+	if ( size < 18 ) {
+		errors.append( QString( "unexpected EOF" ) );
+		return false;
+	}
+
+	unsigned int	colorMapType = data[1];
+	unsigned int	imageType = data[2];
+	unsigned int	colorMapLength = readUInt16( data + 5 );
+	unsigned int	colorMapBits = data[7];
+	width = readUInt16( data + 12 );
+	height = readUInt16( data + 14 );
+	unsigned int	bitsPerPixel = data[16];
+	mipLevels = 1;
+
+	bool	isRLE = ( imageType & 8 );
+	switch ( imageType & ~8U ) {
+	case 1:	// color mapped
+		if ( bitsPerPixel == 8 && colorMapType && ( colorMapBits == 24 || colorMapBits == 32 ) )
+			pixelFormat = "PAL8";
+		break;
+	case 2:	// true color
+		if ( bitsPerPixel == 24 || bitsPerPixel == 32 )
+			pixelFormat = ( bitsPerPixel == 24 ? "RGB8" : "RGBA8" );
+		break;
+	case 3:	// greyscale
+		if ( bitsPerPixel == 8 || bitsPerPixel == 16 )
+			pixelFormat = ( bitsPerPixel == 8 ? "L8" : "L8A8" );
+		break;
+	}
+	if ( pixelFormat.isEmpty() ) {
+		errors.append( QString( "image sub format not supported (type %1, %2 bits per pixel)" ).arg( imageType ).arg( bitsPerPixel ) );
+		return false;
+	}
+	if ( isRLE )
+		pixelFormat.append( " (RLE)" );
+
+	checkDimensions( true );
+	if ( !errors.isEmpty() )
+		return false;
+
+	// the image is converted to RGBA and the mip levels are generated when loading
+	setMipChainInfo( ( bitsPerPixel + 7 ) >> 3, 1, 4, true );
+
+	std::uint64_t	headerSize = 18 + std::uint64_t( data[0] );
+	if ( colorMapType )
+		headerSize += std::uint64_t( colorMapLength ) * ( ( colorMapBits + 7 ) >> 3 );
+	dataOffset = std::uint32_t( std::min< std::uint64_t >( headerSize, size ) );
+	if ( headerSize > size )
+		errors.append( QString( "unexpected EOF" ) );
+	else if ( !isRLE && dataSize > ( size - headerSize ) )
+		errors.append( QString( "file is truncated, %1 bytes of image data are missing" ).arg( dataSize - ( size - headerSize ) ) );
+
+	return errors.isEmpty();
+}
+
+bool TextureInfo::parseBMP( const unsigned char * data, size_t size )
+{
+	clear();
+	fileFormat = FileBMP;
+	if ( size < 54 || data[0] != 'B' || data[1] != 'M' ) {
+		errors.append( QString( "not a BMP file" ) );
+		return false;
+	}
+
+	std::uint32_t	offset = readUInt32( data + 10 );
+	width = readUInt32( data + 18 );
+	height = readUInt32( data + 22 );
+	unsigned int	bitsPerPixel = readUInt16( data + 28 );
+	std::uint32_t	compression = readUInt32( data + 30 );
+	mipLevels = 1;
+
+	if ( compression != 0 || bitsPerPixel != 24 ) {
+		errors.append( QString( "unknown image sub format (compression %1, %2 bits per pixel)" ).arg( compression ).arg( bitsPerPixel ) );
+		return false;
+	}
+	pixelFormat = "RGB8";
+
+	checkDimensions( true );
+	if ( !errors.isEmpty() )
+		return false;
+
+	setMipChainInfo( 3, 1, 4, true );
+
+	dataOffset = offset;
+	if ( offset > size || dataSize > ( size - offset ) )
+		errors.append( QString( "file is truncated" ) );
+
+	return errors.isEmpty();
+}
+
+bool TextureInfo::parsePixelData( const PixelDataHeader & h )
+{
+	clear();
+	fileFormat = FileNIF;
+
+	mipLevels = h.mipLevels;
+	if ( mipLevels > 0 ) {
+		width = h.width;
+		height = h.height;
+	}
+	if ( h.faces > 1 )
+		faces = h.faces;
+
+	unsigned int	bitsPerPixel = h.bitsPerPixel;
+	unsigned int	bytesPerPixel = h.bytesPerPixel;
+	unsigned int	format = h.pixelFormat;
+
+	unsigned int	blockBytes = 0;
+	unsigned int	blockSize = 1;
+	unsigned int	gpuBytesPerPixel = 0;
+	bool	generatesMips = false;
+	switch ( format ) {
+	case 0:	// PX_FMT_RGB8
+	case 1:	// PX_FMT_RGBA8
+	case 2:	// PX_FMT_PAL8
+		pixelFormat = ( format == 0 ? "RGB8" : ( format == 1 ? "RGBA8" : "PAL8" ) );
+		if ( !bytesPerPixel )
+			bytesPerPixel = bitsPerPixel >> 3;
+		if ( !bytesPerPixel || bytesPerPixel > 4 || ( format == 2 && bytesPerPixel != 1 ) ) {
+			errors.append( QString( "unsupported image depth %1 / %2" ).arg( bitsPerPixel ).arg( bytesPerPixel ) );
+			return false;
+		}
+		if ( format == 2 && !h.hasPalette )
+			errors.append( QString( "palette is missing" ) );
+		blockBytes = bytesPerPixel;
+		gpuBytesPerPixel = 4;
+		generatesMips = true;
+		break;
+	case 4:	// PX_FMT_DXT1
+		dxgiFormat = 71;
+		break;
+	case 5:	// PX_FMT_DXT3
+		dxgiFormat = 74;
+		break;
+	case 6:	// PX_FMT_DXT5
+		dxgiFormat = 77;
+		break;
+	default:
+		errors.append( QString( "unsupported pixel format %1" ).arg( format ) );
+		return false;
+	}
+	if ( dxgiFormat ) {
+		pixelFormat = dxgiFormatName( dxgiFormat );
+		(void) dxgiBlockInfo( dxgiFormat, blockBytes, blockSize );
+		isCompressed = true;
+	}
+
+	checkDimensions( false );
+	if ( !errors.isEmpty() )
+		return false;
+
+	setMipChainInfo( blockBytes, blockSize, gpuBytesPerPixel, generatesMips );
+
+	if ( h.pixelDataSize >= 0 ) {
+		std::uint64_t	available = std::uint64_t( h.pixelDataSize );
+		if ( dataSize > available )
+			errors.append( QString( "pixel data is truncated, %1 bytes are missing" ).arg( dataSize - available ) );
+	}
+
+	return errors.isEmpty();
+}
+
+QString TextureInfo::toString() const
+{
+	static const char *	fileFormatNames[5] = { "Unknown", "BMP", "DDS", "NIF", "TGA" };
+
+	QString	s = QString( "Format: %1" ).arg( fileFormatNames[std::min< unsigned int >( fileFormat, 4 )] );
+	if ( !pixelFormat.isEmpty() )
+		s += QString( " (%1)" ).arg( pixelFormat );
+	if ( width || height ) {
+		s += QString( "\nDimensions: %1x%2" ).arg( width ).arg( height );
+		if ( depth > 1 )
+			s += QString( "x%1" ).arg( depth );
+		if ( isCubeMap() )
+			s += QString( ", cube map" );
+		if ( arraySize > 1 )
+			s += QString( ", array of %1" ).arg( arraySize );
+		s += QString( "\nMip levels: %1 of %2" ).arg( mipLevels ).arg( fullMipCount() );
+		s += QString( "\nData size: %1 bytes" ).arg( dataSize );
+		s += QString( "\nEstimated GPU memory: %1 bytes" ).arg( gpuBytes );
+	}
+	for ( const auto & e : errors )
+		s += QString( "\nError: %1" ).arg( e );
+	for ( const auto & w : warnings )
+		s += QString( "\nWarning: %1" ).arg( w );
+
+	return s;
+}
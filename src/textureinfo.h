@@ -0,0 +1,109 @@
+#ifndef TEXTUREINFO_H_INCLUDED
+#define TEXTUREINFO_H_INCLUDED
+
+#include <QString>
+#include <QStringList>
+
+#include <cstddef>
+#include <cstdint>
+
+//! Texture metadata parsed from the file headers, without decoding the image data or using OpenGL
+/*!
+ * Supports DDS (including DX10 headers), TGA and BMP files, and NiPixelData blocks. Besides describing the
+ * texture, parsing also validates it: problems that prevent the texture from loading are added to 'errors',
+ * and problems that only affect quality or efficiency (e.g. an incomplete mip chain) to 'warnings'.
+ */
+struct TextureInfo
+{
+	//! Container format, the values are the same as TexCache::TexFmt::imageFormat
+	enum FileFormat : unsigned char
+	{
+		FileUnknown = 0,
+		FileBMP = 1,
+		FileDDS = 2,
+		FileNIF = 3,
+		FileTGA = 4
+	};
+
+	FileFormat	fileFormat = FileUnknown;
+	//! Pixel format name, e.g. "BC7_UNORM_SRGB" or "B8G8R8"
+	QString	pixelFormat;
+	//! DXGI format of DDS files and compressed NiPixelData (converted from legacy headers), 0 if not applicable
+	std::uint32_t	dxgiFormat = 0;
+	std::uint32_t	width = 0;
+	std::uint32_t	height = 0;
+	std::uint32_t	depth = 1;
+	//! Number of mip levels stored in the file
+	std::uint32_t	mipLevels = 0;
+	//! 6 for cube maps, 1 otherwise
+	std::uint32_t	faces = 1;
+	std::uint32_t	arraySize = 1;
+	bool	isCompressed = false;
+	//! Size in bytes of the image data as described by the header
+	std::uint64_t	dataSize = 0;
+	//! Offset of the image data from the beginning of the file
+	std::uint32_t	dataOffset = 0;
+	//! Estimated video memory used by the texture once loaded, including any generated mip levels
+	std::uint64_t	gpuBytes = 0;
+	QStringList	errors;
+	QStringList	warnings;
+
+	inline bool isValid() const
+	{
+		return ( fileFormat != FileUnknown && errors.isEmpty() );
+	}
+	inline bool isCubeMap() const
+	{
+		return ( faces == 6 );
+	}
+	//! Number of mip levels in a complete chain down to 1x1
+	std::uint32_t fullMipCount() const;
+	inline bool hasCompleteMipChain() const
+	{
+		return ( mipLevels >= fullMipCount() );
+	}
+
+	void clear();
+	//! Parse texture file data, the format is detected from the signature, or from the extension of 'fileName' for TGA.
+	// Returns false if the format is not recognized or errors were found.
+	bool parse( const void * data, size_t size, const QString & fileName = QString() );
+	bool parseDDS( const unsigned char * data, size_t size );
+	bool parseTGA( const unsigned char * data, size_t size );
+	bool parseBMP( const unsigned char * data, size_t size );
+
+	//! Fields of an NiPixelData block that describe the image
+	struct PixelDataHeader
+	{
+		//! PX_FMT_RGB8, PX_FMT_RGBA8, PX_FMT_PAL8, PX_FMT_DXT1, PX_FMT_DXT3 or PX_FMT_DXT5
+		unsigned int	pixelFormat = 0;
+		unsigned int	bitsPerPixel = 0;
+		unsigned int	bytesPerPixel = 0;
+		//! Dimensions of the first mip level
+		std::uint32_t	width = 0;
+		std::uint32_t	height = 0;
+		std::uint32_t	mipLevels = 0;
+		std::uint32_t	faces = 1;
+		bool	hasPalette = false;
+		//! Size of the pixel data in bytes, negative if the block has no pixel data array
+		std::int64_t	pixelDataSize = -1;
+	};
+	//! Parse an NiPixelData block, the fields are read from the NIF by the caller
+	bool parsePixelData( const PixelDataHeader & h );
+
+	//! Returns a multi-line description of the texture, including errors and warnings
+	QString toString() const;
+
+	//! Returns the name of a DXGI format without the DXGI_FORMAT_ prefix, or an empty string if it is not known
+	static QString dxgiFormatName( std::uint32_t fmt );
+	//! Get the size in bytes of a block, and the width and height of the block in pixels (1 for uncompressed formats).
+	// Returns false for unknown and unsupported formats, including packed 4:2:2 and 1-bit formats.
+	static bool dxgiBlockInfo( std::uint32_t fmt, unsigned int & blockBytes, unsigned int & blockSize );
+
+protected:
+	//! Calculate dataSize and gpuBytes, and check the mip chain. If 'gpuBytesPerPixel' is non-zero, the image is
+	// converted to an uncompressed format when loading, and if 'generatesMips' is true, missing mip levels are created.
+	void setMipChainInfo( unsigned int blockBytes, unsigned int blockSize, unsigned int gpuBytesPerPixel, bool generatesMips );
+	void checkDimensions( bool requirePowerOfTwo );
+};
+
+#endif
@@ -30,6 +30,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 ***** END LICENCE BLOCK *****/
 
+#include <algorithm>
 #include <cstdlib>
 
 #include "filebrowser.h"
@@ -65,13 +66,29 @@ void FileBrowserWidget::updateTreeWidget()
 	filesShown.clear();
 	std::string	filterString( filter->text().trimmed().toStdString() );
 	int	curFileIndex = -1;
-	for ( const auto & i : fileSet ) {
-		if ( currentFile && i == *currentFile ) {
-			curFileIndex = int( filesShown.size() );
-		} else if ( !filterString.empty() && i.find( filterString ) == std::string_view::npos ) {
-			continue;
+	std::vector< std::uint32_t >	matches;
+	if ( !filterString.empty() ) {
+		pathIndex.find( matches, filterString );
+	} else {
+		matches.resize( pathIndex.size() );
+		for ( size_t i = 0; i < matches.size(); i++ )
+			matches[i] = std::uint32_t( i );
+	}
+	const std::vector< std::string_view > &	paths = pathIndex.getPaths();
+	if ( currentFile ) {
+		// the currently selected file is always shown
+		auto	i = std::lower_bound( paths.begin(), paths.end(), *currentFile );
+		if ( i != paths.end() && *i == *currentFile ) {
+			std::uint32_t	n = std::uint32_t( i - paths.begin() );
+			auto	j = std::lower_bound( matches.begin(), matches.end(), n );
+			if ( j == matches.end() || *j != n )
+				matches.insert( j, n );
 		}
-		filesShown.push_back( &i );
+	}
+	for ( std::uint32_t i : matches ) {
+		if ( currentFile && paths[i] == *currentFile )
+			curFileIndex = int( filesShown.size() );
+		filesShown.push_back( &( paths[i] ) );
 	}
 
 	std::map< std::string_view, QTreeWidgetItem * >	dirMap;
@@ -108,7 +125,24 @@ void FileBrowserWidget::checkItemActivated()
 }
 
 FileBrowserWidget::FileBrowserWidget( int w, int h, const char * titleString, const std::set< std::string_view > & files, const std::string_view & fileSelected )
-	: fileSet( files ), currentFile( nullptr )
+	: currentFile( nullptr )
+{
+	for ( const auto & i : files )
+		pathIndex.addPath( i );
+	pathIndex.build( true );
+	init( w, h, titleString, fileSelected );
+}
+
+FileBrowserWidget::FileBrowserWidget( int w, int h, const char * titleString, const std::vector< std::string_view > & files, const std::string_view & fileSelected )
+	: currentFile( nullptr )
+{
+	for ( const auto & i : files )
+		pathIndex.addPath( i );
+	pathIndex.build( true );
+	init( w, h, titleString, fileSelected );
+}
+
+void FileBrowserWidget::init( int w, int h, const char * titleString, const std::string_view & fileSelected )
 {
 	layout = new QGridLayout( &dlg );
 	layout->setColumnMinimumWidth( 0, w );
@@ -126,7 +160,7 @@ FileBrowserWidget::FileBrowserWidget( int w, int h, const char * titleString, co
 	filter = new QLineEdit( &dlg );
 	layout2->addWidget( filter, 0, 0 );
 	filterTitle = new QLabel( &dlg );
-	filterTitle->setText( "Path Filter" );
+	filterTitle->setText( "Path Filter (* and ? wildcards)" );
 	layout2->addWidget( filterTitle, 0, 1 );
 
 	if ( !fileSelected.empty() )
@@ -38,6 +38,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <set>
 #include <map>
 
+#include "pathindex.h"
+
 #include <QDialog>
 #include <QLabel>
 #include <QLayout>
@@ -54,14 +56,17 @@ protected:
 	QGridLayout *	layout2;
 	QLineEdit *	filter;
 	QLabel *	filterTitle;
-	const std::set< std::string_view > &	fileSet;
+	FilePathIndex	pathIndex;
 	const std::string_view *	currentFile;
 	std::vector< const std::string_view * >	filesShown;
 	QTreeWidgetItem *	findDirectory( std::map< std::string_view, QTreeWidgetItem * > & dirMap, const std::string_view & d );
+	void init( int w, int h, const char * titleString, const std::string_view & fileSelected );
 	void updateTreeWidget();
 	void checkItemActivated();
 public:
 	FileBrowserWidget( int w, int h, const char * titleString, const std::set< std::string_view > & files, const std::string_view & fileSelected );
+	// 'files' is expected to be sorted, as returned by GameManager::list_files()
+	FileBrowserWidget( int w, int h, const char * titleString, const std::vector< std::string_view > & files, const std::string_view & fileSelected );
 	~FileBrowserWidget();
 	int exec()
 	{
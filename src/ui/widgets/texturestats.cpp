@@ -0,0 +1,231 @@
+#include "texturestats.h"
+
+#include <QFile>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSettings>
+#include <QTextStream>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+
+//! Table row that sorts numeric columns by value instead of by the displayed text
+class TextureStatsItem final : public QTreeWidgetItem
+{
+public:
+	TextureStatsItem( QTreeWidget * parent ) : QTreeWidgetItem( parent ) {}
+
+	bool operator<( const QTreeWidgetItem & other ) const override final
+	{
+		int	col = treeWidget()->sortColumn();
+		QVariant	a = data( col, Qt::UserRole );
+		QVariant	b = other.data( col, Qt::UserRole );
+		if ( a.isValid() && b.isValid() )
+			return ( a.toULongLong() < b.toULongLong() );
+		return ( text( col ).compare( other.text( col ), Qt::CaseInsensitive ) < 0 );
+	}
+};
+
+static QString formatBytes( std::uint64_t n )
+{
+	if ( n < 1024 )
+		return QString::number( n ) + " B";
+	if ( n < ( 1024 * 1024 ) )
+		return QString::number( double( n ) / 1024.0, 'f', 1 ) + " KB";
+	return QString::number( double( n ) / ( 1024.0 * 1024.0 ), 'f', 2 ) + " MB";
+}
+
+static QString formatTime( std::uint64_t t )
+{
+	return QString::number( double( t ) * 0.001, 'f', 2 );
+}
+
+static QString csvField( const QString & s )
+{
+	if ( !( s.contains( QChar(',') ) || s.contains( QChar('"') ) || s.contains( QChar('\n') ) ) )
+		return s;
+	QString	tmp( s );
+	tmp.replace( QChar('"'), QString( "\"\"" ) );
+	return QChar('"') + tmp + QChar('"');
+}
+
+TextureStatsView::TextureStatsView( QWidget * parent )
+	: QWidget( parent )
+{
+	table = new QTreeWidget( this );
+	table->setRootIsDecorated( false );
+	table->setUniformRowHeights( true );
+	table->setAlternatingRowColors( true );
+	table->setSelectionMode( QAbstractItemView::ExtendedSelection );
+	table->setColumnCount( NumColumns );
+	table->setHeaderLabels( {
+		tr( "Texture" ), tr( "Source" ), tr( "Status" ), tr( "File Size" ), tr( "Data Size" ),
+		tr( "Read (ms)" ), tr( "Decode (ms)" ), tr( "Upload (ms)" ), tr( "GPU Memory" ), tr( "Binds" ), tr( "Loads" )
+	} );
+	table->setSortingEnabled( true );
+	table->sortByColumn( ReadTimeCol, Qt::DescendingOrder );
+	table->header()->setSectionResizeMode( QHeaderView::Interactive );
+
+	summary = new QLabel( this );
+
+	QPushButton *	btnRefresh = new QPushButton( tr( "Refresh" ), this );
+	QPushButton *	btnExport = new QPushButton( tr( "Export..." ), this );
+	connect( btnRefresh, &QPushButton::clicked, this, &TextureStatsView::refresh );
+	connect( btnExport, &QPushButton::clicked, this, &TextureStatsView::exportRecords );
+
+	QHBoxLayout *	buttons = new QHBoxLayout;
+	buttons->addWidget( summary, 1 );
+	buttons->addWidget( btnRefresh );
+	buttons->addWidget( btnExport );
+
+	QVBoxLayout *	layout = new QVBoxLayout( this );
+	layout->setContentsMargins( 5, 4, 5, 0 );
+	layout->setSpacing( 3 );
+	layout->addWidget( table );
+	layout->addLayout( buttons );
+}
+
+void TextureStatsView::setTexCache( const TexCache * cache )
+{
+	textures = cache;
+	refresh();
+}
+
+QString TextureStatsView::recordStatus( const TexCache::LoadRecord & r )
+{
+	if ( !r.info.aliasOf.isEmpty() )
+		return QString( "Same as %1" ).arg( r.info.aliasOf );
+	if ( !r.info.status.isEmpty() )
+		return r.info.status;
+	if ( r.isPreview )
+		return QString( "Preview" );
+	if ( r.isPending )
+		return QString( "Pending" );
+	if ( r.isLoaded )
+		return QString( "Loaded" );
+	return QString( r.info.loadCount ? "Evicted" : "Not loaded" );
+}
+
+void TextureStatsView::refresh()
+{
+	records.clear();
+	if ( textures )
+		records = textures->getLoadRecords();
+
+	// sorting is disabled while adding the items, which would otherwise be sorted one at a time
+	table->setSortingEnabled( false );
+	table->clear();
+
+	std::uint64_t	readTime = 0;
+	std::uint64_t	decodeTime = 0;
+	std::uint64_t	uploadTime = 0;
+	std::uint64_t	gpuBytes = 0;
+	for ( const auto & r : records ) {
+		const TexCache::Tex::ImageInfo &	i = r.info;
+		TextureStatsItem *	item = new TextureStatsItem( table );
+		item->setText( NameCol, i.filename );
+		item->setToolTip( NameCol, i.filepath );
+		item->setText( SourceCol, i.source );
+		item->setText( StatusCol, recordStatus( r ) );
+
+		const std::uint64_t	values[8] = {
+			i.fileBytes, i.dataBytes, i.readTime, i.decodeTime, i.uploadTime, r.gpuBytes, r.bindCount, i.loadCount
+		};
+		for ( int c = FileBytesCol; c < NumColumns; c++ ) {
+			std::uint64_t	n = values[c - FileBytesCol];
+			item->setData( c, Qt::UserRole, QVariant( qulonglong( n ) ) );
+			if ( c == FileBytesCol || c == DataBytesCol || c == GPUBytesCol )
+				item->setText( c, formatBytes( n ) );
+			else if ( c >= ReadTimeCol && c <= UploadTimeCol )
+				item->setText( c, formatTime( n ) );
+			else
+				item->setText( c, QString::number( n ) );
+			item->setTextAlignment( c, Qt::AlignRight | Qt::AlignVCenter );
+		}
+
+		readTime += i.readTime;
+		decodeTime += i.decodeTime;
+		uploadTime += i.uploadTime;
+		gpuBytes += r.gpuBytes;
+	}
+
+	table->setSortingEnabled( true );
+	summary->setText( tr( "%1 textures, read %2 ms, decode %3 ms, upload %4 ms, %5 resident" )
+						.arg( records.size() ).arg( formatTime( readTime ), formatTime( decodeTime ), formatTime( uploadTime ),
+								formatBytes( gpuBytes ) ) );
+}
+
+bool TextureStatsView::saveRecords( const QString & fileName, bool isJSON ) const
+{
+	QFile	f( fileName );
+	if ( !f.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+		return false;
+
+	if ( isJSON ) {
+		QJsonArray	a;
+		for ( const auto & r : records ) {
+			const TexCache::Tex::ImageInfo &	i = r.info;
+			QJsonObject	o;
+			o.insert( "texture", i.filename );
+			o.insert( "path", i.filepath );
+			o.insert( "source", i.source );
+			o.insert( "status", recordStatus( r ) );
+			o.insert( "fileBytes", qint64( i.fileBytes ) );
+			o.insert( "dataBytes", qint64( i.dataBytes ) );
+			o.insert( "readTimeUs", qint64( i.readTime ) );
+			o.insert( "decodeTimeUs", qint64( i.decodeTime ) );
+			o.insert( "uploadTimeUs", qint64( i.uploadTime ) );
+			o.insert( "gpuBytes", qint64( r.gpuBytes ) );
+			o.insert( "bindCount", qint64( r.bindCount ) );
+			o.insert( "loadCount", qint64( i.loadCount ) );
+			o.insert( "width", qint64( i.width ) );
+			o.insert( "height", qint64( i.height ) );
+			o.insert( "mipmaps", qint64( i.mipmaps ) );
+			a.append( o );
+		}
+		return ( f.write( QJsonDocument( a ).toJson() ) >= 0 );
+	}
+
+	QTextStream	s( &f );
+	s << "Texture,Path,Source,Status,File Bytes,Data Bytes,Read Time (us),Decode Time (us),Upload Time (us),"
+		"GPU Bytes,Bind Count,Load Count,Width,Height,Mipmaps\n";
+	for ( const auto & r : records ) {
+		const TexCache::Tex::ImageInfo &	i = r.info;
+		s << csvField( i.filename ) << ',' << csvField( i.filepath ) << ',' << csvField( i.source ) << ','
+			<< csvField( recordStatus( r ) ) << ',' << i.fileBytes << ',' << i.dataBytes << ',' << i.readTime << ','
+			<< i.decodeTime << ',' << i.uploadTime << ',' << r.gpuBytes << ',' << r.bindCount << ',' << i.loadCount << ','
+			<< i.width << ',' << i.height << ',' << i.mipmaps << '\n';
+	}
+	s.flush();
+	return ( s.status() == QTextStream::Ok );
+}
+
+void TextureStatsView::exportRecords()
+{
+	QSettings	settings;
+	QString	path = settings.value( "File/Texture Statistics Path", QString( "texture_stats.csv" ) ).toString();
+	QString	selectedFilter;
+	QString	fileName = QFileDialog::getSaveFileName( this, tr( "Export Texture Statistics" ), path,
+														tr( "CSV files (*.csv);;JSON files (*.json)" ), &selectedFilter );
+	if ( fileName.isEmpty() )
+		return;
+	settings.setValue( "File/Texture Statistics Path", fileName );
+
+	bool	isJSON = ( fileName.endsWith( ".json", Qt::CaseInsensitive )
+						|| ( !fileName.endsWith( ".csv", Qt::CaseInsensitive ) && selectedFilter.contains( "json" ) ) );
+	if ( !saveRecords( fileName, isJSON ) )
+		QMessageBox::critical( this, "NifSkope error", tr( "Could not write '%1'" ).arg( fileName ) );
+}
+
+void TextureStatsView::showEvent( QShowEvent * e )
+{
+	refresh();
+	QWidget::showEvent( e );
+}
@@ -0,0 +1,54 @@
+#ifndef TEXTURESTATS_H_INCLUDED
+#define TEXTURESTATS_H_INCLUDED
+
+#include <QWidget> // Inherited
+
+#include "gl/gltex.h"
+
+#include <vector>
+
+class QLabel;
+class QTreeWidget;
+
+//! Sortable table of the loading statistics of the textures in a TexCache
+/*!
+ * Each row shows where a texture file was read from, its size in the archive and after decompression,
+ * the time spent reading, decoding and uploading it, its current video memory usage and the number of
+ * times it has been bound. The table is updated when it is shown, or with the Refresh button, and it
+ * can be exported to a CSV or JSON file.
+ */
+class TextureStatsView final : public QWidget
+{
+	Q_OBJECT
+
+public:
+	TextureStatsView( QWidget * parent = nullptr );
+
+	void setTexCache( const TexCache * cache );
+
+	//! Write the current records as CSV, or JSON if 'isJSON' is true
+	bool saveRecords( const QString & fileName, bool isJSON ) const;
+
+public slots:
+	void refresh();
+	void exportRecords();
+
+protected:
+	void showEvent( QShowEvent * e ) override final;
+
+	enum Column
+	{
+		NameCol = 0, SourceCol, StatusCol, FileBytesCol, DataBytesCol,
+		ReadTimeCol, DecodeTimeCol, UploadTimeCol, GPUBytesCol, BindCountCol, LoadCountCol,
+		NumColumns
+	};
+
+	static QString recordStatus( const TexCache::LoadRecord & r );
+
+	const TexCache * textures = nullptr;
+	std::vector< TexCache::LoadRecord >	records;
+	QTreeWidget * table;
+	QLabel * summary;
+};
+
+#endif
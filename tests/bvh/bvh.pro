@@ -0,0 +1,9 @@
+include(../tests.pri)
+
+TARGET = tst_bvh
+
+HEADERS += ../../src/gl/bvh.h
+
+SOURCES += \
+	tst_bvh.cpp \
+	../../src/gl/bvh.cpp
@@ -0,0 +1,230 @@
+#include "gl/bvh.h"
+
+#include <QTest>
+
+#include <random>
+
+
+//! Tests ray casting with TriangleBVH
+class TestBVH : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void closestOverlappingHit();
+	void backSideHit();
+	void nearestVertex();
+	void rayParallelToBoxFace();
+	void miss();
+	void compareWithAllTriangles();
+
+private:
+	//! Append two triangles forming the square from (x0, y0) to (x1, y1) at height z
+	static void addSquare( QVector<Vector3> & verts, QVector<Triangle> & tris,
+							float x0, float y0, float x1, float y1, float z );
+};
+
+
+void TestBVH::addSquare( QVector<Vector3> & verts, QVector<Triangle> & tris,
+							float x0, float y0, float x1, float y1, float z )
+{
+	quint16	n = quint16( verts.size() );
+	verts << Vector3( x0, y0, z ) << Vector3( x1, y0, z ) << Vector3( x1, y1, z ) << Vector3( x0, y1, z );
+	tris << Triangle( n, n + 1, n + 2 ) << Triangle( n, n + 2, n + 3 );
+}
+
+void TestBVH::closestOverlappingHit()
+{
+	// squares stacked at different heights, in an order that is not sorted by height, so that there are
+	// several leaf nodes with overlapping bounds
+	QVector<Vector3>	verts;
+	QVector<Triangle>	tris;
+	const int	heights[] = { 3, 7, 1, 9, 4, 0, 8, 2, 6, 5 };
+	for ( int z : heights )
+		addSquare( verts, tris, -1.0f - z * 0.1f, -1.0f, 1.0f + z * 0.1f, 1.0f, float( z ) );
+
+	TriangleBVH	bvh;
+	bvh.build( verts.constData(), verts.size(), tris.constData(), tris.size() );
+	QVERIFY( !bvh.isEmpty() );
+
+	TriangleBVH::Hit	hit;
+	QVERIFY( bvh.intersect( Vector3( 0.25f, 0.5f, 20.0f ), Vector3( 0.0f, 0.0f, -1.0f ), hit ) );
+	QCOMPARE( hit.distance, 11.0f );
+	// the square at height 9 is the fourth one
+	QVERIFY( hit.triangle == 6 || hit.triangle == 7 );
+
+	// from below, the closest square is the one at height 0
+	hit = TriangleBVH::Hit();
+	QVERIFY( bvh.intersect( Vector3( 0.25f, 0.5f, -10.0f ), Vector3( 0.0f, 0.0f, 2.0f ), hit ) );
+	QCOMPARE( hit.distance, 5.0f );
+	QVERIFY( hit.triangle == 10 || hit.triangle == 11 );
+
+	// a hit passed in from another mesh that is closer is not replaced
+	TriangleBVH::Hit	closer;
+	closer.distance = 1.0f;
+	closer.triangle = 1234;
+	QVERIFY( !bvh.intersect( Vector3( 0.25f, 0.5f, 20.0f ), Vector3( 0.0f, 0.0f, -1.0f ), closer ) );
+	QCOMPARE( closer.distance, 1.0f );
+	QCOMPARE( closer.triangle, qsizetype( 1234 ) );
+}
+
+void TestBVH::backSideHit()
+{
+	QVector<Vector3>	verts;
+	QVector<Triangle>	tris;
+	// counter-clockwise when viewed from +Z
+	addSquare( verts, tris, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f );
+
+	TriangleBVH	bvh;
+	bvh.build( verts.constData(), verts.size(), tris.constData(), tris.size() );
+
+	TriangleBVH::Hit	front;
+	QVERIFY( bvh.intersect( Vector3( 0.75f, 0.25f, 1.0f ), Vector3( 0.0f, 0.0f, -1.0f ), front ) );
+	TriangleBVH::Hit	back;
+	QVERIFY( bvh.intersect( Vector3( 0.75f, 0.25f, -1.0f ), Vector3( 0.0f, 0.0f, 1.0f ), back ) );
+	QCOMPARE( back.distance, 1.0f );
+	QCOMPARE( back.triangle, front.triangle );
+	QCOMPARE( back.triangle, qsizetype( 0 ) );
+}
+
+void TestBVH::nearestVertex()
+{
+	QVector<Vector3>	verts;
+	QVector<Triangle>	tris;
+	addSquare( verts, tris, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f );
+
+	TriangleBVH	bvh;
+	bvh.build( verts.constData(), verts.size(), tris.constData(), tris.size() );
+
+	const Vector3	points[4] = { { 0.1f, 0.1f, 0.0f }, { 0.8f, 0.15f, 0.0f }, { 0.9f, 0.95f, 0.0f }, { 0.1f, 0.7f, 0.0f } };
+	for ( int i = 0; i < 4; i++ ) {
+		TriangleBVH::Hit	hit;
+		Vector3	origin( points[i] + Vector3( 0.0f, 0.0f, 2.0f ) );
+		QVERIFY( bvh.intersect( origin, Vector3( 0.0f, 0.0f, -1.0f ), hit ) );
+		QCOMPARE( hit.vertex, i );
+
+		// the barycentric coordinates are relative to the triangle that was hit
+		const Triangle &	t = tris[hit.triangle];
+		Vector3	p( verts[t[0]] * ( 1.0f - hit.u - hit.v ) + verts[t[1]] * hit.u + verts[t[2]] * hit.v );
+		QVERIFY( ( p - points[i] ).length() < 1.0e-5f );
+	}
+}
+
+void TestBVH::rayParallelToBoxFace()
+{
+	// a wall at x = 5, the bounding box has no extent on the X axis
+	QVector<Vector3>	verts;
+	verts << Vector3( 5.0f, 0.0f, 0.0f ) << Vector3( 5.0f, 1.0f, 0.0f )
+			<< Vector3( 5.0f, 1.0f, 1.0f ) << Vector3( 5.0f, 0.0f, 1.0f );
+	QVector<Triangle>	tris;
+	tris << Triangle( 0, 1, 3 ) << Triangle( 1, 2, 3 );
+
+	TriangleBVH	bvh;
+	bvh.build( verts.constData(), verts.size(), tris.constData(), tris.size() );
+
+	// the Y and Z components of the direction are zero
+	TriangleBVH::Hit	hit;
+	QVERIFY( bvh.intersect( Vector3( 0.0f, 0.5f, 0.25f ), Vector3( 1.0f, 0.0f, 0.0f ), hit ) );
+	QCOMPARE( hit.distance, 5.0f );
+
+	// in the plane of the Y = 0 face of the bounding box, hitting the edge of the first triangle
+	hit = TriangleBVH::Hit();
+	QVERIFY( bvh.intersect( Vector3( 0.0f, 0.0f, 0.25f ), Vector3( 1.0f, 0.0f, 0.0f ), hit ) );
+	QCOMPARE( hit.distance, 5.0f );
+	QCOMPARE( hit.triangle, qsizetype( 0 ) );
+
+	// in the plane of the wall
+	hit = TriangleBVH::Hit();
+	QVERIFY( !bvh.intersect( Vector3( 5.0f, -1.0f, 0.5f ), Vector3( 0.0f, 1.0f, 0.0f ), hit ) );
+	QCOMPARE( hit.triangle, qsizetype( -1 ) );
+}
+
+void TestBVH::miss()
+{
+	QVector<Vector3>	verts;
+	QVector<Triangle>	tris;
+	for ( int i = 0; i < 8; i++ )
+		addSquare( verts, tris, float( i ), 0.0f, float( i ) + 0.9f, 1.0f, 0.0f );
+
+	TriangleBVH	bvh;
+	bvh.build( verts.constData(), verts.size(), tris.constData(), tris.size() );
+
+	TriangleBVH::Hit	hit;
+	// pointing away from the triangles
+	QVERIFY( !bvh.intersect( Vector3( 0.5f, 0.5f, 1.0f ), Vector3( 0.0f, 0.0f, 1.0f ), hit ) );
+	// through the gap between two squares
+	QVERIFY( !bvh.intersect( Vector3( 3.95f, 0.5f, 1.0f ), Vector3( 0.0f, 0.0f, -1.0f ), hit ) );
+	// outside the bounds
+	QVERIFY( !bvh.intersect( Vector3( 0.5f, 2.0f, 1.0f ), Vector3( 0.0f, 0.0f, -1.0f ), hit ) );
+	// beyond the maximum distance
+	hit.distance = 0.5f;
+	QVERIFY( !bvh.intersect( Vector3( 0.5f, 0.5f, 1.0f ), Vector3( 0.0f, 0.0f, -1.0f ), hit ) );
+	QCOMPARE( hit.distance, 0.5f );
+	QCOMPARE( hit.triangle, qsizetype( -1 ) );
+	QCOMPARE( hit.vertex, -1 );
+
+	// no valid triangles
+	tris.clear();
+	tris << Triangle( 0, 1, quint16( verts.size() ) );
+	bvh.build( verts.constData(), verts.size(), tris.constData(), tris.size() );
+	QVERIFY( bvh.isEmpty() );
+	hit = TriangleBVH::Hit();
+	QVERIFY( !bvh.intersect( Vector3( 0.5f, 0.5f, 1.0f ), Vector3( 0.0f, 0.0f, -1.0f ), hit ) );
+}
+
+void TestBVH::compareWithAllTriangles()
+{
+	std::mt19937	rng( 1 );
+	std::uniform_real_distribution< float >	pos( -10.0f, 10.0f );
+	std::uniform_real_distribution< float >	offset( -1.0f, 1.0f );
+
+	QVector<Vector3>	verts;
+	QVector<Triangle>	tris;
+	for ( int i = 0; i < 2000; i++ ) {
+		Vector3	p( pos( rng ), pos( rng ), pos( rng ) );
+		quint16	n = quint16( verts.size() );
+		verts << p << p + Vector3( offset( rng ), offset( rng ), offset( rng ) )
+				<< p + Vector3( offset( rng ), offset( rng ), offset( rng ) );
+		tris << Triangle( n, n + 1, n + 2 );
+	}
+
+	TriangleBVH	bvh;
+	bvh.build( verts.constData(), verts.size(), tris.constData(), tris.size() );
+	// a hierarchy for each triangle, with only the vertices of the triangle
+	QVector<TriangleBVH>	single( tris.size() );
+	for ( qsizetype i = 0; i < tris.size(); i++ ) {
+		const Triangle	t( 0, 1, 2 );
+		single[i].build( verts.constData() + i * 3, 3, &t, 1 );
+	}
+
+	int	hitCnt = 0;
+	for ( int r = 0; r < 500; r++ ) {
+		Vector3	origin( pos( rng ), pos( rng ), 15.0f );
+		Vector3	dir( offset( rng ) * 0.5f, offset( rng ) * 0.5f, -1.0f );
+
+		TriangleBVH::Hit	hit;
+		bool	found = bvh.intersect( origin, dir, hit );
+
+		float	closest = std::numeric_limits< float >::max();
+		qsizetype	closestTriangle = -1;
+		for ( qsizetype i = 0; i < tris.size(); i++ ) {
+			TriangleBVH::Hit	h;
+			if ( single[i].intersect( origin, dir, h ) && h.distance < closest ) {
+				closest = h.distance;
+				closestTriangle = i;
+			}
+		}
+
+		QCOMPARE( found, ( closestTriangle >= 0 ) );
+		if ( found ) {
+			QCOMPARE( hit.distance, closest );
+			QCOMPARE( hit.triangle, closestTriangle );
+			hitCnt++;
+		}
+	}
+	QVERIFY( hitCnt > 0 );
+}
+
+QTEST_APPLESS_MAIN( TestBVH )
+
+#include "tst_bvh.moc"
@@ -0,0 +1,10 @@
+include(../tests.pri)
+include(../libfo76utils.pri)
+
+TARGET = tst_cubemap
+
+HEADERS += ../../src/gl/cubemapfilter.h
+
+SOURCES += \
+	tst_cubemap.cpp \
+	../../src/gl/cubemapfilter.cpp
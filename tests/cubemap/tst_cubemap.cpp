@@ -0,0 +1,153 @@
+#include "gl/cubemapfilter.h"
+
+#include <QTest>
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+
+//! Compares filtering cube maps on several threads with filtering them one at a time
+class TestCubeMap : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void filterOutput();
+	void reuseFilter();
+	void compareWithSingleThread_data();
+	void compareWithSingleThread();
+
+private:
+	//! An RGBA8 DDS cube map with a gradient and a bright spot on each face
+	static QByteArray createCubeMap( int width );
+	static std::uint32_t readUInt32( const QByteArray & data, qsizetype offset );
+
+	CubeMapFilterSettings	settings;
+	QByteArray	input;
+	QByteArray	refSpecular;
+	QByteArray	refDiffuse;
+};
+
+
+QByteArray TestCubeMap::createCubeMap( int width )
+{
+	QByteArray	data( 148 + qsizetype( width ) * width * 4 * 6, '\0' );
+	unsigned char *	p = reinterpret_cast< unsigned char * >( data.data() );
+	auto	write32 = [p]( size_t offset, std::uint32_t n ) {
+		for ( size_t i = 0; i < 4; i++ )
+			p[offset + i] = (unsigned char) ( n >> ( i * 8 ) );
+	};
+
+	std::memcpy( p, "DDS ", 4 );
+	write32( 4, 124 );
+	write32( 8, 0x0000100F );	// CAPS, HEIGHT, WIDTH, PITCH, PIXELFORMAT
+	write32( 12, std::uint32_t( width ) );
+	write32( 16, std::uint32_t( width ) );
+	write32( 20, std::uint32_t( width ) * 4 );
+	write32( 28, 1 );
+	write32( 76, 32 );
+	write32( 80, 0x00000004 );	// DDPF_FOURCC
+	std::memcpy( p + 84, "DX10", 4 );
+	write32( 108, 0x00001008 );	// DDSCAPS_COMPLEX, DDSCAPS_TEXTURE
+	write32( 112, 0x0000FE00 );	// DDSCAPS2_CUBEMAP with all faces
+	write32( 128, 28 );	// DXGI_FORMAT_R8G8B8A8_UNORM
+	write32( 132, 3 );	// D3D10_RESOURCE_DIMENSION_TEXTURE2D
+	write32( 136, 4 );	// D3D10_RESOURCE_MISC_TEXTURECUBE
+	write32( 140, 1 );
+
+	unsigned char *	q = p + 148;
+	for ( int face = 0; face < 6; face++ ) {
+		for ( int y = 0; y < width; y++ ) {
+			for ( int x = 0; x < width; x++, q = q + 4 ) {
+				float	dx = float( x - width / 3 );
+				float	dy = float( y - width / 2 );
+				bool	spot = ( face == 2 && ( dx * dx + dy * dy ) < float( width * width / 64 ) );
+				q[0] = (unsigned char) ( spot ? 255 : ( x * 255 / width ) );
+				q[1] = (unsigned char) ( spot ? 255 : ( y * 255 / width ) );
+				q[2] = (unsigned char) ( spot ? 255 : ( face * 40 + 20 ) );
+				q[3] = 255;
+			}
+		}
+	}
+
+	return data;
+}
+
+std::uint32_t TestCubeMap::readUInt32( const QByteArray & data, qsizetype offset )
+{
+	const unsigned char *	p = reinterpret_cast< const unsigned char * >( data.constData() ) + offset;
+	return std::uint32_t( p[0] ) | ( std::uint32_t( p[1] ) << 8 ) | ( std::uint32_t( p[2] ) << 16 )
+			| ( std::uint32_t( p[3] ) << 24 );
+}
+
+void TestCubeMap::initTestCase()
+{
+	// small enough that the tests run quickly
+	settings.resolution = 64;
+	settings.importanceSamples = 64;
+	input = createCubeMap( 64 );
+
+	QVERIFY( filterPBRCubeMap( refSpecular, refDiffuse, input, settings ) );
+}
+
+void TestCubeMap::filterOutput()
+{
+	QVERIFY( refSpecular.size() > 148 );
+	QVERIFY( refDiffuse.size() > 148 );
+	QCOMPARE( readUInt32( refSpecular, 0 ), 0x20534444U );	// "DDS "
+	QCOMPARE( readUInt32( refDiffuse, 0 ), 0x20534444U );
+	QCOMPARE( readUInt32( refSpecular, 16 ), std::uint32_t( settings.resolution ) );
+	QCOMPARE( readUInt32( refDiffuse, 16 ), 32U );
+	QVERIFY( refSpecular != input );
+}
+
+void TestCubeMap::reuseFilter()
+{
+	// filter other data first, so that anything left over in the pooled filter would change the result
+	QByteArray	specular, diffuse;
+	CubeMapFilterSettings	s = settings;
+	s.resolution = 32;
+	QVERIFY( filterPBRCubeMap( specular, diffuse, createCubeMap( 32 ), s ) );
+
+	QVERIFY( filterPBRCubeMap( specular, diffuse, input, settings ) );
+	QCOMPARE( specular, refSpecular );
+	QCOMPARE( diffuse, refDiffuse );
+}
+
+void TestCubeMap::compareWithSingleThread_data()
+{
+	QTest::addColumn<int>( "threadCount" );
+
+	QTest::newRow( "pool size" ) << maxCubeMapFilters;
+	QTest::newRow( "more threads than filters" ) << maxCubeMapFilters * 3;
+}
+
+void TestCubeMap::compareWithSingleThread()
+{
+	QFETCH( int, threadCount );
+
+	std::vector< QByteArray >	specular( size_t( threadCount ) );
+	std::vector< QByteArray >	diffuse( size_t( threadCount ) );
+	std::vector< char >	results( size_t( threadCount ), 0 );
+	std::vector< std::thread >	threads;
+	for ( size_t i = 0; i < size_t( threadCount ); i++ ) {
+		threads.emplace_back( [&, i]() {
+			results[i] = char( filterPBRCubeMap( specular[i], diffuse[i], input, settings ) );
+		} );
+	}
+	for ( std::thread & t : threads )
+		t.join();
+
+	for ( size_t i = 0; i < size_t( threadCount ); i++ ) {
+		QVERIFY( results[i] );
+		QCOMPARE( specular[i], refSpecular );
+		QCOMPARE( diffuse[i], refDiffuse );
+	}
+}
+
+QTEST_APPLESS_MAIN( TestCubeMap )
+
+#include "tst_cubemap.moc"
@@ -0,0 +1,11 @@
+include(../tests.pri)
+
+TARGET = tst_gpuskinning
+
+DEFINES += SHADER_DIR=\\\"$$PWD/../../res/shaders\\\"
+
+HEADERS += ../../src/gl/skinning.h
+
+SOURCES += \
+	tst_gpuskinning.cpp \
+	../../src/gl/skinning.cpp
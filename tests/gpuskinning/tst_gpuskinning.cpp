@@ -0,0 +1,342 @@
+#include "gl/skinning.h"
+
+#include <QFile>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QTest>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+
+//! Compares the skinning in the vertex shaders with SkinningKernel
+/*!
+ * The vertex shaders are compiled in an offscreen OpenGL context, and the skinned positions and normals are read back
+ * with transform feedback. The bone transforms and the bone index and weight arrays are passed in the same way as by
+ * Renderer::setupSkinning() and Shape::addGPUSkinWeight(). The test is skipped if no compatibility profile context
+ * with transform feedback can be created.
+ *
+ * The shaders blend the complete bone matrices, including the scale, and normalize the normals afterwards, while
+ * SkinningKernel blends the rotations only. The normals are therefore the same only if the bones of a vertex have
+ * the same scale, which is the case for the bones in the rows of the test.
+ */
+class TestGPUSkinning : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+	void compareWithSkinningKernel_data();
+	void compareWithSkinningKernel();
+
+private:
+	//! Renderer::maxGPUSkinningBones, the size of boneTransforms in the shaders
+	static constexpr int	maxBones = 100;
+
+	typedef void ( QOPENGLF_APIENTRYP ClientStateProc )( GLenum array );
+	typedef void ( QOPENGLF_APIENTRYP ClientActiveTextureProc )( GLenum texture );
+	typedef void ( QOPENGLF_APIENTRYP VertexPointerProc )( GLint size, GLenum type, GLsizei stride, const void * p );
+	typedef void ( QOPENGLF_APIENTRYP NormalPointerProc )( GLenum type, GLsizei stride, const void * p );
+
+	std::unique_ptr< QOffscreenSurface >	surface;
+	std::unique_ptr< QOpenGLContext >	context;
+	QOpenGLExtraFunctions *	f = nullptr;
+	// the fixed function vertex array functions are not in QOpenGLFunctions, they are resolved as in gltex.cpp
+	ClientStateProc	glEnableClientState = nullptr;
+	ClientStateProc	glDisableClientState = nullptr;
+	ClientActiveTextureProc	glClientActiveTexture = nullptr;
+	VertexPointerProc	glVertexPointer = nullptr;
+	NormalPointerProc	glNormalPointer = nullptr;
+	VertexPointerProc	glTexCoordPointer = nullptr;
+	GLuint	framebuffer = 0;
+	GLuint	renderbuffer = 0;
+
+	static Transform randomTransform( std::mt19937 & rng, float scale );
+	//! Returns a linked program with only the vertex shader, or 0 and the error in 'err'
+	GLuint loadProgram( const QString & fileName, const QByteArrayList & varyings, QString & err );
+};
+
+
+Transform TestGPUSkinning::randomTransform( std::mt19937 & rng, float scale )
+{
+	std::uniform_real_distribution< float >	angle( -0.3f, 0.3f );
+	std::uniform_real_distribution< float >	offset( -10.0f, 10.0f );
+
+	float	x = angle( rng );
+	float	y = angle( rng );
+	float	z = angle( rng );
+	Matrix	rx, ry, rz;
+	rx( 1, 1 ) = std::cos( x );
+	rx( 1, 2 ) = -std::sin( x );
+	rx( 2, 1 ) = std::sin( x );
+	rx( 2, 2 ) = std::cos( x );
+	ry( 0, 0 ) = std::cos( y );
+	ry( 0, 2 ) = std::sin( y );
+	ry( 2, 0 ) = -std::sin( y );
+	ry( 2, 2 ) = std::cos( y );
+	rz( 0, 0 ) = std::cos( z );
+	rz( 0, 1 ) = -std::sin( z );
+	rz( 1, 0 ) = std::sin( z );
+	rz( 1, 1 ) = std::cos( z );
+
+	Transform	t;
+	t.rotation = rz * ry * rx;
+	t.translation = Vector3( offset( rng ), offset( rng ), offset( rng ) );
+	t.scale = scale;
+	return t;
+}
+
+void TestGPUSkinning::initTestCase()
+{
+	QSurfaceFormat	fmt;
+	fmt.setVersion( 4, 0 );
+	fmt.setProfile( QSurfaceFormat::CompatibilityProfile );
+
+	context = std::make_unique< QOpenGLContext >();
+	context->setFormat( fmt );
+	surface = std::make_unique< QOffscreenSurface >();
+	surface->setFormat( fmt );
+	surface->create();
+	if ( !( surface->isValid() && context->create() && context->makeCurrent( surface.get() ) ) )
+		QSKIP( "OpenGL is not available" );
+	if ( context->isOpenGLES() || context->format().profile() == QSurfaceFormat::CoreProfile
+		|| context->format().version() < qMakePair( 3, 0 ) ) {
+		QSKIP( "a compatibility profile context with transform feedback is not available" );
+	}
+
+	f = context->extraFunctions();
+	glEnableClientState = (ClientStateProc) context->getProcAddress( "glEnableClientState" );
+	glDisableClientState = (ClientStateProc) context->getProcAddress( "glDisableClientState" );
+	glClientActiveTexture = (ClientActiveTextureProc) context->getProcAddress( "glClientActiveTexture" );
+	glVertexPointer = (VertexPointerProc) context->getProcAddress( "glVertexPointer" );
+	glNormalPointer = (NormalPointerProc) context->getProcAddress( "glNormalPointer" );
+	glTexCoordPointer = (VertexPointerProc) context->getProcAddress( "glTexCoordPointer" );
+	QVERIFY( glEnableClientState && glDisableClientState && glClientActiveTexture );
+	QVERIFY( glVertexPointer && glNormalPointer && glTexCoordPointer );
+
+	// an offscreen surface may not have a default framebuffer to draw to
+	f->glGenFramebuffers( 1, &framebuffer );
+	f->glBindFramebuffer( GL_FRAMEBUFFER, framebuffer );
+	f->glGenRenderbuffers( 1, &renderbuffer );
+	f->glBindRenderbuffer( GL_RENDERBUFFER, renderbuffer );
+	f->glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, 1, 1 );
+	f->glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer );
+	QCOMPARE( f->glCheckFramebufferStatus( GL_FRAMEBUFFER ), GLenum( GL_FRAMEBUFFER_COMPLETE ) );
+}
+
+void TestGPUSkinning::cleanupTestCase()
+{
+	if ( f ) {
+		f->glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+		f->glDeleteRenderbuffers( 1, &renderbuffer );
+		f->glDeleteFramebuffers( 1, &framebuffer );
+		context->doneCurrent();
+	}
+}
+
+GLuint TestGPUSkinning::loadProgram( const QString & fileName, const QByteArrayList & varyings, QString & err )
+{
+	QFile	file( QString( SHADER_DIR "/" ) + fileName );
+	if ( !file.open( QIODevice::ReadOnly ) ) {
+		err = QString( "couldn't open %1 for read access" ).arg( file.fileName() );
+		return 0;
+	}
+	QByteArray	data = file.readAll();
+	const char *	src = data.constData();
+
+	GLuint	shader = f->glCreateShader( GL_VERTEX_SHADER );
+	f->glShaderSource( shader, 1, &src, nullptr );
+	f->glCompileShader( shader );
+	GLint	result = GL_FALSE;
+	f->glGetShaderiv( shader, GL_COMPILE_STATUS, &result );
+	if ( result != GL_TRUE ) {
+		char	log[4096];
+		f->glGetShaderInfoLog( shader, sizeof( log ), nullptr, log );
+		err = QString( log );
+		f->glDeleteShader( shader );
+		return 0;
+	}
+
+	GLuint	prog = f->glCreateProgram();
+	f->glAttachShader( prog, shader );
+	std::vector< const char * >	names;
+	for ( const QByteArray & v : varyings )
+		names.push_back( v.constData() );
+	f->glTransformFeedbackVaryings( prog, GLsizei( names.size() ), names.data(), GL_INTERLEAVED_ATTRIBS );
+	f->glLinkProgram( prog );
+	f->glDeleteShader( shader );
+	f->glGetProgramiv( prog, GL_LINK_STATUS, &result );
+	if ( result != GL_TRUE ) {
+		char	log[4096];
+		f->glGetProgramInfoLog( prog, sizeof( log ), nullptr, log );
+		err = QString( log );
+		f->glDeleteProgram( prog );
+		return 0;
+	}
+	return prog;
+}
+
+void TestGPUSkinning::compareWithSkinningKernel_data()
+{
+	QTest::addColumn<QString>( "shader" );
+	QTest::addColumn<QByteArrayList>( "varyings" );
+	// offsets of the normal, tangent and bitangent in the captured floats after gl_Position
+	QTest::addColumn<QList<int>>( "offsets" );
+	QTest::addColumn<float>( "scale" );
+
+	static const struct {
+		const char *	shader;
+		QByteArrayList	varyings;
+		QList<int>	offsets;
+	} shaders[] = {
+		// btnMatrix and tbnMatrix are ( bitangent, tangent, normal )
+		{ "sk_default.vert", { "gl_Position", "tbnMatrix" }, { 6, 3, 0 } },
+		{ "sk_effectshader.vert", { "gl_Position", "N", "t", "b" }, { 0, 3, 6 } },
+		{ "fo4_default.vert", { "gl_Position", "btnMatrix" }, { 6, 3, 0 } },
+		{ "f76_default.vert", { "gl_Position", "btnMatrix" }, { 6, 3, 0 } },
+		{ "stf_default.vert", { "gl_Position", "btnMatrix" }, { 6, 3, 0 } }
+	};
+	for ( const auto & s : shaders ) {
+		QTest::addRow( "%s", s.shader ) << QString( s.shader ) << s.varyings << s.offsets << 1.0f;
+		QTest::addRow( "%s, scaled bones", s.shader ) << QString( s.shader ) << s.varyings << s.offsets << 1.5f;
+	}
+}
+
+void TestGPUSkinning::compareWithSkinningKernel()
+{
+	QFETCH( QString, shader );
+	QFETCH( QByteArrayList, varyings );
+	QFETCH( QList<int>, offsets );
+	QFETCH( float, scale );
+
+	QString	err;
+	GLuint	prog = loadProgram( shader, varyings, err );
+	QVERIFY2( prog, qPrintable( err ) );
+
+	constexpr int	vertexCount = 1000;
+	std::mt19937	rng( 0x5EED0500U );
+	std::uniform_real_distribution< float >	coord( -10.0f, 10.0f );
+	std::uniform_real_distribution< float >	unit( 0.0f, 1.0f );
+
+	QVector<Transform>	bones;
+	Matrix4	boneMatrices[maxBones];
+	for ( int b = 0; b < maxBones; b++ ) {
+		bones.append( randomTransform( rng, scale ) );
+		boneMatrices[b] = bones.last().toMatrix4();
+	}
+
+	QVector<Vector3>	in[4];
+	for ( int v = 0; v < vertexCount; v++ ) {
+		in[0].append( Vector3( coord( rng ), coord( rng ), coord( rng ) ) );
+		for ( int j = 1; j < 4; j++ ) {
+			Vector3	n( coord( rng ), coord( rng ), coord( rng ) );
+			in[j].append( n.normalize() );
+		}
+	}
+
+	// up to 4 influences per vertex, in the first unused slots as added by Shape::addGPUSkinWeight()
+	SkinningKernel	kernel;
+	kernel.clear( vertexCount );
+	QVector<Vector4>	boneIndices( vertexCount, Vector4( 0.0f, 0.0f, 0.0f, 0.0f ) );
+	QVector<Vector4>	boneWeights( vertexCount, Vector4( 0.0f, 0.0f, 0.0f, 0.0f ) );
+	for ( int v = 0; v < vertexCount; v++ ) {
+		int	n = ( v == 0 ? 4 : 1 + int( rng() % 4U ) );
+		for ( int i = 0; i < n; i++ ) {
+			int	b = int( rng() % std::uint32_t( maxBones ) );
+			float	w = 0.05f + unit( rng );
+			boneIndices[v][i] = float( b );
+			boneWeights[v][i] = w;
+			kernel.addInfluence( v, b, w );
+		}
+	}
+	kernel.finalize();
+	kernel.setBoneTransforms( bones.constData(), bones.size() );
+
+	QVector<Vector3>	expected[4];
+	kernel.skin( expected[0], expected[1], expected[2], expected[3], in[0], in[1], in[2], in[3] );
+
+	// the shaders use the fixed function model view and projection matrices, which are identity matrices here
+	f->glUseProgram( prog );
+	for ( const char * name : { "isSkinned", "isGPUSkinned" } ) {
+		GLint	loc = f->glGetUniformLocation( prog, name );
+		if ( loc >= 0 )
+			f->glUniform1i( loc, 1 );
+	}
+	GLint	loc = f->glGetUniformLocation( prog, "boneTransforms" );
+	QVERIFY( loc >= 0 );
+	f->glUniformMatrix4fv( loc, maxBones, 0, boneMatrices[0].data() );
+
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, 0, in[0].constData() );
+	glEnableClientState( GL_NORMAL_ARRAY );
+	glNormalPointer( GL_FLOAT, 0, in[1].constData() );
+	// texture coordinate sets as in the .prog files: 1 = tangents, 2 = bitangents, 3 = bone indices, 4 = weights
+	const void *	texCoords[4] = { in[2].constData(), in[3].constData(), boneIndices.constData(), boneWeights.constData() };
+	for ( int i = 0; i < 4; i++ ) {
+		glClientActiveTexture( GL_TEXTURE1 + GLenum( i ) );
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glTexCoordPointer( ( i < 2 ? 3 : 4 ), GL_FLOAT, 0, texCoords[i] );
+	}
+
+	// gl_Position and three vectors per vertex
+	constexpr int	floatsPerVertex = 4 + 9;
+	GLuint	buffer = 0;
+	f->glGenBuffers( 1, &buffer );
+	f->glBindBuffer( GL_TRANSFORM_FEEDBACK_BUFFER, buffer );
+	f->glBufferData( GL_TRANSFORM_FEEDBACK_BUFFER, vertexCount * floatsPerVertex * sizeof( float ), nullptr, GL_STATIC_READ );
+	f->glBindBufferBase( GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffer );
+	f->glEnable( GL_RASTERIZER_DISCARD );
+	f->glBeginTransformFeedback( GL_POINTS );
+	f->glDrawArrays( GL_POINTS, 0, vertexCount );
+	f->glEndTransformFeedback();
+	f->glDisable( GL_RASTERIZER_DISCARD );
+
+	for ( int i = 3; i >= 0; i-- ) {
+		glClientActiveTexture( GL_TEXTURE1 + GLenum( i ) );
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+	}
+	glClientActiveTexture( GL_TEXTURE0 );
+	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
+	f->glUseProgram( 0 );
+	f->glDeleteProgram( prog );
+
+	const float *	out = static_cast< const float * >(
+		f->glMapBufferRange( GL_TRANSFORM_FEEDBACK_BUFFER, 0, vertexCount * floatsPerVertex * sizeof( float ), GL_MAP_READ_BIT ) );
+	QVERIFY( out );
+	QVector<Vector3>	result[4];
+	for ( int v = 0; v < vertexCount; v++, out = out + floatsPerVertex ) {
+		result[0].append( Vector3( out[0], out[1], out[2] ) );
+		// tbnMatrix of the Skyrim shader is not normalized
+		for ( int j = 1; j < 4; j++ ) {
+			const float *	p = out + 4 + offsets.at( j - 1 );
+			result[j].append( Vector3( p[0], p[1], p[2] ).normalize() );
+		}
+	}
+	f->glUnmapBuffer( GL_TRANSFORM_FEEDBACK_BUFFER );
+	f->glBindBuffer( GL_TRANSFORM_FEEDBACK_BUFFER, 0 );
+	f->glDeleteBuffers( 1, &buffer );
+	QCOMPARE( f->glGetError(), GLenum( GL_NO_ERROR ) );
+
+	for ( int j = 0; j < 4; j++ ) {
+		// positions are up to about 300 units from the origin, normals are unit vectors
+		float	tolerance = ( j == 0 ? 1.0e-3f : 1.0e-4f );
+		for ( int v = 0; v < vertexCount; v++ ) {
+			float	d = ( result[j][v] - expected[j][v] ).length();
+			if ( !( d <= tolerance ) ) {
+				QFAIL( qPrintable( QString( "array %1, vertex %2: (%3, %4, %5), expected (%6, %7, %8)" )
+									.arg( j ).arg( v )
+									.arg( result[j][v][0] ).arg( result[j][v][1] ).arg( result[j][v][2] )
+									.arg( expected[j][v][0] ).arg( expected[j][v][1] ).arg( expected[j][v][2] ) ) );
+			}
+		}
+	}
+}
+
+QTEST_MAIN( TestGPUSkinning )
+
+#include "tst_gpuskinning.moc"
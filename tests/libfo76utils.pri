@@ -0,0 +1,12 @@
+# The parts of libfo76utils used for decoding and filtering textures, include after tests.pri
+
+HEADERS += $$files($$PWD/../lib/libfo76utils/src/*.hpp, false)
+SOURCES += $$PWD/../lib/libfo76utils/src/bits.c
+SOURCES += $$PWD/../lib/libfo76utils/src/bptc-tables.c
+SOURCES += $$PWD/../lib/libfo76utils/src/decompress-bptc.c
+SOURCES += $$PWD/../lib/libfo76utils/src/decompress-bptc-float.c
+SOURCES += $$PWD/../lib/libfo76utils/src/common.cpp
+SOURCES += $$PWD/../lib/libfo76utils/src/ddstxt16.cpp
+SOURCES += $$PWD/../lib/libfo76utils/src/filebuf.cpp
+SOURCES += $$PWD/../lib/libfo76utils/src/sfcube2.cpp
+SOURCES += $$PWD/../lib/libfo76utils/src/zlib.cpp
@@ -0,0 +1,9 @@
+include(../tests.pri)
+
+TARGET = tst_skinning
+
+HEADERS += ../../src/gl/skinning.h
+
+SOURCES += \
+	tst_skinning.cpp \
+	../../src/gl/skinning.cpp
@@ -0,0 +1,196 @@
+#include "gl/skinning.h"
+
+#include <QTest>
+
+#include <cmath>
+#include <random>
+
+
+//! Compares SkinningKernel with accumulating Transform * Vector3 * weight per bone
+class TestSkinning : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void compareWithPerBoneLoop_data();
+	void compareWithPerBoneLoop();
+
+private:
+	struct VertexWeight
+	{
+		int	vertex;
+		float	weight;
+	};
+
+	static Transform randomTransform( std::mt19937 & rng );
+	//! The loop that was used before SkinningKernel, bones with a scale of zero are skipped like missing bones
+	static void skinPerBone( QVector<Vector3> out[4], const QVector<Vector3> in[4],
+								const QVector<Transform> & bones, const QVector<QVector<VertexWeight>> & weights );
+};
+
+
+Transform TestSkinning::randomTransform( std::mt19937 & rng )
+{
+	std::uniform_real_distribution< float >	angle( -0.3f, 0.3f );
+	std::uniform_real_distribution< float >	offset( -10.0f, 10.0f );
+	std::uniform_real_distribution< float >	scale( 0.5f, 2.0f );
+
+	// rotations are limited so that the blended normals cannot cancel out
+	float	x = angle( rng );
+	float	y = angle( rng );
+	float	z = angle( rng );
+	Matrix	rx, ry, rz;
+	rx( 1, 1 ) = std::cos( x );
+	rx( 1, 2 ) = -std::sin( x );
+	rx( 2, 1 ) = std::sin( x );
+	rx( 2, 2 ) = std::cos( x );
+	ry( 0, 0 ) = std::cos( y );
+	ry( 0, 2 ) = std::sin( y );
+	ry( 2, 0 ) = -std::sin( y );
+	ry( 2, 2 ) = std::cos( y );
+	rz( 0, 0 ) = std::cos( z );
+	rz( 0, 1 ) = -std::sin( z );
+	rz( 1, 0 ) = std::sin( z );
+	rz( 1, 1 ) = std::cos( z );
+
+	Transform	t;
+	t.rotation = rz * ry * rx;
+	t.translation = Vector3( offset( rng ), offset( rng ), offset( rng ) );
+	t.scale = scale( rng );
+	return t;
+}
+
+void TestSkinning::skinPerBone( QVector<Vector3> out[4], const QVector<Vector3> in[4],
+								const QVector<Transform> & bones, const QVector<QVector<VertexWeight>> & weights )
+{
+	for ( int j = 0; j < 4; j++ )
+		out[j].fill( Vector3(), in[j].size() );
+
+	for ( int b = 0; b < bones.size(); b++ ) {
+		const Transform &	t = bones[b];
+		if ( t.scale == 0.0f )
+			continue;
+		for ( const VertexWeight & w : weights[b] ) {
+			if ( w.vertex < in[0].size() )
+				out[0][w.vertex] += t * in[0][w.vertex] * w.weight;
+			for ( int j = 1; j < 4; j++ ) {
+				if ( w.vertex < in[j].size() )
+					out[j][w.vertex] += t.rotation * in[j][w.vertex] * w.weight;
+			}
+		}
+	}
+
+	for ( int j = 1; j < 4; j++ ) {
+		for ( Vector3 & v : out[j] )
+			v.normalize();
+	}
+}
+
+void TestSkinning::compareWithPerBoneLoop_data()
+{
+	QTest::addColumn<int>( "vertexCount" );
+	QTest::addColumn<int>( "maxInfluences" );
+	QTest::addColumn<float>( "zeroWeightRatio" );
+	QTest::addColumn<bool>( "disabledBone" );
+	QTest::addColumn<bool>( "tangents" );
+
+	QTest::newRow( "small mesh" ) << 1000 << 4 << 0.0f << false << true;
+	QTest::newRow( "zero weights" ) << 1000 << 4 << 0.5f << false << true;
+	QTest::newRow( "more than 4 influences" ) << 1000 << 12 << 0.0f << false << true;
+	QTest::newRow( "disabled bone" ) << 1000 << 4 << 0.0f << true << true;
+	QTest::newRow( "no tangents" ) << 1000 << 4 << 0.0f << false << false;
+	// large enough to be skinned on multiple threads, with a partial last chunk
+	QTest::newRow( "multithreaded, partial chunk" )
+		<< int( SkinningKernel::minVerticesPerThread + SkinningKernel::chunkSize * 3 + 123 ) << 8 << 0.25f << true << true;
+	QTest::newRow( "multithreaded, one vertex over a chunk" )
+		<< int( SkinningKernel::minVerticesPerThread + 1 ) << 4 << 0.0f << false << true;
+}
+
+void TestSkinning::compareWithPerBoneLoop()
+{
+	QFETCH( int, vertexCount );
+	QFETCH( int, maxInfluences );
+	QFETCH( float, zeroWeightRatio );
+	QFETCH( bool, disabledBone );
+	QFETCH( bool, tangents );
+
+	std::mt19937	rng( std::uint32_t( vertexCount * 31 + maxInfluences ) );
+	std::uniform_real_distribution< float >	coord( -10.0f, 10.0f );
+	std::uniform_real_distribution< float >	unit( 0.0f, 1.0f );
+
+	constexpr int	boneCount = 24;
+	QVector<Transform>	bones;
+	for ( int b = 0; b < boneCount; b++ )
+		bones.append( randomTransform( rng ) );
+	if ( disabledBone )
+		bones[boneCount / 2].scale = 0.0f;
+
+	QVector<Vector3>	in[4];
+	for ( int v = 0; v < vertexCount; v++ ) {
+		in[0].append( Vector3( coord( rng ), coord( rng ), coord( rng ) ) );
+		for ( int j = 1; j < ( tangents ? 4 : 2 ); j++ ) {
+			Vector3	n( coord( rng ), coord( rng ), coord( rng ) );
+			in[j].append( n.normalize() );
+		}
+	}
+
+	// the influences are stored per bone, as in NiSkinData and BSSkin::BoneData
+	QVector<QVector<VertexWeight>>	weights( boneCount );
+	int	influenceCnt = 0;
+	for ( int v = 0; v < vertexCount; v++ ) {
+		int	n = 1 + int( rng() % std::uint32_t( maxInfluences ) );
+		if ( v == 0 )
+			n = maxInfluences;
+		for ( int i = 0; i < n; i++ ) {
+			int	b = int( rng() % std::uint32_t( boneCount ) );
+			float	w = ( unit( rng ) < zeroWeightRatio ? 0.0f : 0.05f + unit( rng ) );
+			weights[b].append( VertexWeight{ v, w } );
+			influenceCnt += int( w != 0.0f );
+		}
+	}
+
+	SkinningKernel	kernel;
+	kernel.clear( vertexCount );
+	for ( int b = 0; b < boneCount; b++ ) {
+		for ( const VertexWeight & w : weights[b] )
+			kernel.addInfluence( w.vertex, b, w.weight );
+	}
+	kernel.finalize();
+	kernel.setBoneTransforms( bones.constData(), bones.size() );
+
+	QCOMPARE( kernel.vertexCount(), qsizetype( vertexCount ) );
+	int	totalInfluences = 0;
+	for ( qsizetype v = 0; v < kernel.vertexCount(); v++ ) {
+		QVERIFY( kernel.influenceCount( v ) <= kernel.maxInfluences() );
+		for ( int i = 0; i < kernel.influenceCount( v ); i++ )
+			QVERIFY( kernel.influenceWeights( v )[i] != 0.0f );
+		totalInfluences += kernel.influenceCount( v );
+	}
+	QCOMPARE( totalInfluences, influenceCnt );
+	if ( zeroWeightRatio == 0.0f )
+		QCOMPARE( kernel.maxInfluences(), maxInfluences );
+
+	QVector<Vector3>	expected[4];
+	skinPerBone( expected, in, bones, weights );
+	QVector<Vector3>	out[4];
+	kernel.skin( out[0], out[1], out[2], out[3], in[0], in[1], in[2], in[3] );
+
+	for ( int j = 0; j < 4; j++ ) {
+		QCOMPARE( out[j].size(), expected[j].size() );
+		// positions are up to about 300 units from the origin, normals are unit vectors
+		float	tolerance = ( j == 0 ? 1.0e-3f : 1.0e-4f );
+		for ( qsizetype v = 0; v < out[j].size(); v++ ) {
+			float	d = ( out[j][v] - expected[j][v] ).length();
+			if ( !( d <= tolerance ) ) {
+				QFAIL( qPrintable( QString( "array %1, vertex %2: (%3, %4, %5), expected (%6, %7, %8)" )
+									.arg( j ).arg( v )
+									.arg( out[j][v][0] ).arg( out[j][v][1] ).arg( out[j][v][2] )
+									.arg( expected[j][v][0] ).arg( expected[j][v][1] ).arg( expected[j][v][2] ) ) );
+			}
+		}
+	}
+}
+
+QTEST_APPLESS_MAIN( TestSkinning )
+
+#include "tst_skinning.moc"
@@ -0,0 +1,44 @@
+###############################
+## UNIT TEST OPTIONS
+###############################
+
+# The tests only build the sources they test, and do not depend on NifSkope.pro
+
+TEMPLATE = app
+
+QT += testlib gui
+CONFIG += c++20 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD $$PWD/../src $$PWD/../lib
+
+DEFINES += \
+	_USE_MATH_DEFINES \ # Define M_PI, etc. in cmath
+	QT_NO_CAST_FROM_BYTEARRAY \ # QByteArray deprecations
+	QT_NO_URL_CAST_FROM_STRING # QUrl deprecations
+
+!*msvc*:QMAKE_CXXFLAGS += -I$$PWD/../lib/libfo76utils/src
+else:INCLUDEPATH += $$PWD/../lib/libfo76utils/src
+
+HEADERS += $$PWD/../src/data/niftypes.h
+SOURCES += $$PWD/testtypes.cpp
+
+*msvc* {
+	QMAKE_CXXFLAGS += /permissive- /std:c++20
+}
+
+# The same instruction set as NifSkope, so that the FloatVector4 code paths under test are the ones used
+*-g++|*-clang {
+	QMAKE_CXXFLAGS *= -std=c++20
+	contains(QMAKE_HOST.arch, x86_64) {
+		contains(noavx, 1) {
+		} else:contains(nof16c, 1) {
+			QMAKE_CXXFLAGS *= -march=sandybridge
+		} else:contains(noavx2, 1) {
+			QMAKE_CXXFLAGS *= -march=sandybridge -mf16c
+		} else {
+			QMAKE_CXXFLAGS *= -march=haswell
+		}
+		QMAKE_CXXFLAGS *= -mtune=generic
+	}
+}
@@ -0,0 +1,16 @@
+###############################
+## UNIT TESTS
+###############################
+
+# Build with qmake tests/tests.pro, and run with make check
+TEMPLATE = subdirs
+
+SUBDIRS += \
+	bvh \
+	cubemap \
+	gpuskinning \
+	skinning \
+	texloaders \
+	texturedecoder \
+	textureencoder \
+	textureinfo
@@ -0,0 +1,10 @@
+#include "data/niftypes.h"
+
+// niftypes.cpp depends on NifModel, the tests only need the static members used by the inline code of niftypes.h
+
+const float Quat::identity[4] = {
+	1.0, 0.0, 0.0, 0.0
+};
+const float Matrix::identity[9] = {
+	1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0
+};
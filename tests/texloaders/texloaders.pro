@@ -0,0 +1,9 @@
+include(../tests.pri)
+
+TARGET = tst_texloaders
+
+HEADERS += ../../src/gl/texconvert.h
+
+SOURCES += \
+	tst_texloaders.cpp \
+	../../src/gl/texconvert.cpp
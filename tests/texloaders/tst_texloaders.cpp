@@ -0,0 +1,430 @@
+#include "gl/texconvert.h"
+
+#include <QBuffer>
+#include <QTest>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <vector>
+
+
+//! Compares the TGA, BMP and NiPixelData pixel decoders with the per-pixel code they replaced
+class TestTexLoaders : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void convertToRGBA_data();
+	void convertToRGBA();
+	void convertPalToRGBA_data();
+	void convertPalToRGBA();
+	void uncompressRLE_data();
+	void uncompressRLE();
+	void uncompressRLETruncated();
+	void mipMaps_data();
+	void mipMaps();
+
+private:
+	//! Pixel layout of a TGA, BMP or NiPixelData image
+	struct PixelFormat
+	{
+		const char *	name;
+		int	bytespp;
+		quint32	mask[4];
+	};
+	static const PixelFormat	pixelFormats[];
+
+	static std::vector< quint8 > randomBytes( size_t n, std::mt19937 & rng );
+	//! Pixels with runs of identical values, so that RLE encoding uses both packet types
+	static std::vector< quint8 > pixelsWithRuns( int w, int h, int bytespp, std::mt19937 & rng );
+	//! PackBits encoding as written by TGA encoders, optionally with a last run that is longer than the image
+	static QByteArray encodeRLE( const std::vector< quint8 > & pixels, int bytespp, bool overlongLastRun );
+
+	//! convertToRGBA() before the row decoders, with horizontal flips mirroring each row
+	static void refConvertToRGBA( const quint8 * data, int w, int h, int bytespp, const quint32 mask[],
+									bool flipV, bool flipH, quint8 * pixl );
+	//! uncompressRLE() before runs were copied as a whole
+	static bool refUncompressRLE( const QByteArray & data, int w, int h, int bytespp, quint8 * pixel );
+	//! The in place box filter of generateMipMaps() before mip maps were generated from the uploaded data
+	static std::vector< std::vector< quint8 > > refMipMaps( std::vector< quint8 > data, int w, int h );
+};
+
+const TestTexLoaders::PixelFormat	TestTexLoaders::pixelFormats[] = {
+	{ "TGA L8", 1, { TGA_L_MASK[0], TGA_L_MASK[1], TGA_L_MASK[2], TGA_L_MASK[3] } },
+	{ "TGA LA8", 2, { TGA_LA_MASK[0], TGA_LA_MASK[1], TGA_LA_MASK[2], TGA_LA_MASK[3] } },
+	{ "TGA RGB8", 3, { TGA_RGB_MASK[0], TGA_RGB_MASK[1], TGA_RGB_MASK[2], TGA_RGB_MASK[3] } },
+	{ "TGA RGBA8", 4, { TGA_RGBA_MASK[0], TGA_RGBA_MASK[1], TGA_RGBA_MASK[2], TGA_RGBA_MASK[3] } },
+	{ "BMP RGB8", 3, { BMP_RGBA_MASK[0], BMP_RGBA_MASK[1], BMP_RGBA_MASK[2], BMP_RGBA_MASK[3] } },
+	{ "NiPixelData RGB8", 3, { 0x000000FF, 0x0000FF00, 0x00FF0000, 0x00000000 } },
+	{ "NiPixelData RGBA8", 4, { 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 } },
+	{ "NiPixelData RGBA4", 2, { 0x000F, 0x00F0, 0x0F00, 0xF000 } },
+	{ "NiPixelData RGB565", 2, { 0xF800, 0x07E0, 0x001F, 0x0000 } },
+};
+
+
+std::vector< quint8 > TestTexLoaders::randomBytes( size_t n, std::mt19937 & rng )
+{
+	std::uniform_int_distribution< int >	byte( 0, 255 );
+	std::vector< quint8 >	v( n );
+	for ( quint8 & b : v )
+		b = quint8( byte( rng ) );
+	return v;
+}
+
+std::vector< quint8 > TestTexLoaders::pixelsWithRuns( int w, int h, int bytespp, std::mt19937 & rng )
+{
+	std::vector< quint8 >	palette = randomBytes( size_t( bytespp ) * 4, rng );
+	std::uniform_int_distribution< int >	color( 0, 3 );
+	std::uniform_int_distribution< int >	runLength( 1, 200 );
+
+	std::vector< quint8 >	v;
+	size_t	n = size_t( w ) * size_t( h );
+	for ( size_t i = 0; i < n; ) {
+		int	c = color( rng );
+		// runs longer than 128 pixels are split into several packets
+		for ( int l = runLength( rng ) / ( c == 0 ? 1 : 20 ) + 1; l > 0 && i < n; l--, i++ )
+			v.insert( v.end(), palette.begin() + c * bytespp, palette.begin() + ( c + 1 ) * bytespp );
+	}
+	return v;
+}
+
+QByteArray TestTexLoaders::encodeRLE( const std::vector< quint8 > & pixels, int bytespp, bool overlongLastRun )
+{
+	size_t	n = pixels.size() / size_t( bytespp );
+	auto	samePixel = [&]( size_t i, size_t j ) {
+		return std::equal( pixels.begin() + i * bytespp, pixels.begin() + ( i + 1 ) * bytespp, pixels.begin() + j * bytespp );
+	};
+
+	QByteArray	data;
+	qsizetype	lastRun = -1;
+	for ( size_t i = 0; i < n; ) {
+		size_t	l = 1;
+		while ( i + l < n && l < 128 && samePixel( i, i + l ) )
+			l++;
+		if ( l >= 2 ) {
+			lastRun = data.size();
+			data.append( char( 0x80 | ( l - 1 ) ) );
+			data.append( reinterpret_cast< const char * >( pixels.data() + i * bytespp ), bytespp );
+		} else {
+			// raw packet up to the start of the next run
+			while ( i + l < n && l < 128 && !( i + l + 1 < n && samePixel( i + l, i + l + 1 ) ) )
+				l++;
+			lastRun = -1;
+			data.append( char( l - 1 ) );
+			data.append( reinterpret_cast< const char * >( pixels.data() + i * bytespp ), qsizetype( l ) * bytespp );
+		}
+		i += l;
+	}
+	if ( overlongLastRun && lastRun >= 0 )
+		data[lastRun] = char( 0xFF );
+
+	// the footer of a TGA file follows the image data
+	data.append( "\0\0\0\0\0\0\0\0TRUEVISION-XFILE.", 26 );
+	return data;
+}
+
+void TestTexLoaders::refConvertToRGBA( const quint8 * data, int w, int h, int bytespp, const quint32 mask[],
+										bool flipV, bool flipH, quint8 * pixl )
+{
+	static const int	rgbashift[4] = { 0, 8, 16, 24 };
+
+	std::memset( pixl, 0, size_t( w ) * size_t( h ) * 4 );
+	quint32 *	out = reinterpret_cast< quint32 * >( pixl );
+
+	for ( int a = 0; a < 4; a++ ) {
+		if ( mask[a] ) {
+			quint32 msk = mask[ a ];
+			int rshift  = 0;
+
+			while ( msk != 0 && ( msk & 0xffffff00 ) ) {
+				msk = msk >> 1; rshift++;
+			}
+
+			int lshift = rgbashift[ a ];
+
+			while ( msk != 0 && ( ( msk & 0x80 ) == 0 ) ) {
+				msk = msk << 1; lshift++;
+			}
+
+			msk = mask[ a ];
+
+			// the input is padded, so that a 32-bit word can be read at each pixel
+			const quint8 * src = data;
+
+			for ( int y = 0; y < h; y++ ) {
+				quint32 * dst = out + size_t( w ) * size_t( flipV ? h - y - 1 : y );
+
+				for ( int x = 0; x < w; x++, src += bytespp ) {
+					quint32	p = quint32( src[0] ) | ( quint32( src[1] ) << 8 ) | ( quint32( src[2] ) << 16 )
+								| ( quint32( src[3] ) << 24 );
+					if ( rshift == lshift )
+						dst[flipH ? w - x - 1 : x] |= p & msk;
+					else
+						dst[flipH ? w - x - 1 : x] |= ( p & msk ) >> rshift << lshift;
+				}
+			}
+		} else if ( a == 3 ) {
+			for ( size_t i = 0; i < size_t( w ) * size_t( h ); i++ )
+				out[i] |= quint32( 0xff ) << rgbashift[ a ];
+		}
+	}
+}
+
+bool TestTexLoaders::refUncompressRLE( const QByteArray & data, int w, int h, int bytespp, quint8 * pixel )
+{
+	int c = 0; // total pixel count
+	int o = 0; // data offset
+
+	quint8 rl; // runlength - 1
+
+	while ( c < w * h ) {
+		rl = quint8( data.at( o++ ) );
+
+		if ( rl & 0x80 ) {
+			// if RLE packet
+			quint8 px[8] = {}; // pixel data in this packet (assume bytespp < 8)
+
+			for ( int b = 0; b < bytespp; b++ )
+				px[b] = quint8( data.at( o++ ) );
+
+			rl &= 0x7f; // strip RLE bit
+
+			do {
+				for ( int b = 0; b < bytespp; b++ )
+					*pixel++ = px[b]; // expand pixel data (rl+1) times
+			} while ( ++c < w * h && rl-- > 0 );
+		} else {
+			do {
+				for ( int b = 0; b < bytespp; b++ )
+					*pixel++ = quint8( data.at( o++ ) ); // write (rl+1) raw pixels
+			} while ( ++c < w * h && rl-- > 0 );
+		}
+
+		if ( o >= data.size() )
+			return false;
+	}
+
+	return true;
+}
+
+std::vector< std::vector< quint8 > > TestTexLoaders::refMipMaps( std::vector< quint8 > data, int w, int h )
+{
+	std::vector< std::vector< quint8 > >	levels;
+
+	while ( w > 1 || h > 1 ) {
+		// the buffer overwrites itself to save memory
+		const quint8 * src = data.data();
+		quint8 * dst = data.data();
+
+		quint32 xo = ( w > 1 ? 1 * 4 : 0 );
+		quint32 yo = ( h > 1 ? w * 4 : 0 );
+
+		w /= 2;
+		h /= 2;
+
+		if ( w == 0 )
+			w = 1;
+
+		if ( h == 0 )
+			h = 1;
+
+		for ( int y = 0; y < h; y++ ) {
+			for ( int x = 0; x < w; x++ ) {
+				for ( int b = 0; b < 4; b++ ) {
+					*dst++ = ( *(src + xo) + *(src + yo) + *(src + xo + yo) + *src) / 4;
+					src++;
+				}
+
+				src += xo;
+			}
+
+			src += yo;
+		}
+
+		levels.emplace_back( data.begin(), data.begin() + size_t( w ) * size_t( h ) * 4 );
+	}
+
+	return levels;
+}
+
+void TestTexLoaders::convertToRGBA_data()
+{
+	QTest::addColumn<int>( "format" );
+	QTest::addColumn<int>( "width" );
+	QTest::addColumn<int>( "height" );
+	QTest::addColumn<bool>( "flipV" );
+	QTest::addColumn<bool>( "flipH" );
+
+	static const int	sizes[3][2] = { { 1, 1 }, { 16, 4 }, { 3, 5 } };
+	for ( int i = 0; i < int( std::size( pixelFormats ) ); i++ ) {
+		for ( const auto & s : sizes ) {
+			for ( int flip = 0; flip < 4; flip++ ) {
+				QTest::addRow( "%s %dx%d%s%s", pixelFormats[i].name, s[0], s[1],
+								( flip & 1 ? " flipV" : "" ), ( flip & 2 ? " flipH" : "" ) )
+					<< i << s[0] << s[1] << bool( flip & 1 ) << bool( flip & 2 );
+			}
+		}
+	}
+}
+
+void TestTexLoaders::convertToRGBA()
+{
+	QFETCH( int, format );
+	QFETCH( int, width );
+	QFETCH( int, height );
+	QFETCH( bool, flipV );
+	QFETCH( bool, flipH );
+
+	const PixelFormat &	f = pixelFormats[format];
+	std::mt19937	rng( 0x5EED0000U + std::uint32_t( format ) );
+	size_t	n = size_t( width ) * size_t( height );
+	std::vector< quint8 >	data = randomBytes( n * size_t( f.bytespp ) + 3, rng );
+
+	std::vector< quint8 >	pixl( n * 4 );
+	std::vector< quint8 >	ref( n * 4 );
+	::convertToRGBA( data.data(), width, height, f.bytespp, f.mask, flipV, flipH, pixl.data() );
+	refConvertToRGBA( data.data(), width, height, f.bytespp, f.mask, flipV, flipH, ref.data() );
+
+	QVERIFY( pixl == ref );
+}
+
+void TestTexLoaders::convertPalToRGBA_data()
+{
+	QTest::addColumn<int>( "width" );
+	QTest::addColumn<int>( "height" );
+	QTest::addColumn<bool>( "flipV" );
+	QTest::addColumn<bool>( "flipH" );
+
+	for ( int flip = 0; flip < 4; flip++ ) {
+		QTest::addRow( "TGA PAL8 32x8%s%s", ( flip & 1 ? " flipV" : "" ), ( flip & 2 ? " flipH" : "" ) )
+			<< 32 << 8 << bool( flip & 1 ) << bool( flip & 2 );
+		QTest::addRow( "NiPixelData PAL8 1x16%s%s", ( flip & 1 ? " flipV" : "" ), ( flip & 2 ? " flipH" : "" ) )
+			<< 1 << 16 << bool( flip & 1 ) << bool( flip & 2 );
+	}
+}
+
+void TestTexLoaders::convertPalToRGBA()
+{
+	QFETCH( int, width );
+	QFETCH( int, height );
+	QFETCH( bool, flipV );
+	QFETCH( bool, flipH );
+
+	std::mt19937	rng( 0x5EED0100U );
+	std::vector< quint8 >	palette = randomBytes( 256 * 4, rng );
+	const quint32 *	colormap = reinterpret_cast< const quint32 * >( palette.data() );
+	size_t	n = size_t( width ) * size_t( height );
+	std::vector< quint8 >	data = randomBytes( n, rng );
+
+	std::vector< quint8 >	pixl( n * 4 );
+	::convertPalToRGBA( data.data(), width, height, colormap, flipV, flipH, pixl.data() );
+
+	// the loop of texLoadPal(), which did not flip horizontally correctly
+	const quint32 *	out = reinterpret_cast< const quint32 * >( pixl.data() );
+	for ( int y = 0; y < height; y++ ) {
+		for ( int x = 0; x < width; x++ ) {
+			quint32	c = out[size_t( flipV ? height - y - 1 : y ) * size_t( width ) + size_t( flipH ? width - x - 1 : x )];
+			QCOMPARE( c, colormap[data[size_t( y ) * size_t( width ) + size_t( x )]] );
+		}
+	}
+}
+
+void TestTexLoaders::uncompressRLE_data()
+{
+	QTest::addColumn<int>( "bytespp" );
+	QTest::addColumn<int>( "width" );
+	QTest::addColumn<int>( "height" );
+	QTest::addColumn<bool>( "overlongLastRun" );
+
+	for ( int bytespp = 1; bytespp <= 4; bytespp++ ) {
+		QTest::addRow( "%d bytes 64x32", bytespp ) << bytespp << 64 << 32 << false;
+		QTest::addRow( "%d bytes 1x1", bytespp ) << bytespp << 1 << 1 << false;
+		QTest::addRow( "%d bytes 16x16 overlong run", bytespp ) << bytespp << 16 << 16 << true;
+	}
+}
+
+void TestTexLoaders::uncompressRLE()
+{
+	QFETCH( int, bytespp );
+	QFETCH( int, width );
+	QFETCH( int, height );
+	QFETCH( bool, overlongLastRun );
+
+	std::mt19937	rng( 0x5EED0200U + std::uint32_t( bytespp ) );
+	std::vector< quint8 >	pixels = pixelsWithRuns( width, height, bytespp, rng );
+	if ( overlongLastRun ) {
+		// end the image with a run
+		for ( size_t i = pixels.size() - size_t( bytespp ) * 3; i < pixels.size(); i++ )
+			pixels[i] = pixels[i - size_t( bytespp )];
+	}
+	QByteArray	data = encodeRLE( pixels, bytespp, overlongLastRun );
+
+	std::vector< quint8 >	out( pixels.size() );
+	QBuffer	buf( &data );
+	QVERIFY( buf.open( QIODevice::ReadOnly ) );
+	QVERIFY( ::uncompressRLE( buf, width, height, bytespp, out.data() ) );
+	QVERIFY( out == pixels );
+
+	std::vector< quint8 >	ref( pixels.size() );
+	QVERIFY( refUncompressRLE( data, width, height, bytespp, ref.data() ) );
+	QVERIFY( out == ref );
+}
+
+void TestTexLoaders::uncompressRLETruncated()
+{
+	std::mt19937	rng( 0x5EED0300U );
+	std::vector< quint8 >	pixels = pixelsWithRuns( 32, 32, 3, rng );
+	QByteArray	data = encodeRLE( pixels, 3, false );
+	// remove the footer and the last pixel
+	data.chop( 26 + 1 );
+
+	std::vector< quint8 >	out( pixels.size() );
+	QBuffer	buf( &data );
+	QVERIFY( buf.open( QIODevice::ReadOnly ) );
+	QVERIFY( !::uncompressRLE( buf, 32, 32, 3, out.data() ) );
+}
+
+void TestTexLoaders::mipMaps_data()
+{
+	QTest::addColumn<int>( "width" );
+	QTest::addColumn<int>( "height" );
+
+	QTest::newRow( "16x16" ) << 16 << 16;
+	QTest::newRow( "64x4" ) << 64 << 4;
+	QTest::newRow( "2x32" ) << 2 << 32;
+	QTest::newRow( "1x8" ) << 1 << 8;
+	QTest::newRow( "8x1" ) << 8 << 1;
+}
+
+void TestTexLoaders::mipMaps()
+{
+	QFETCH( int, width );
+	QFETCH( int, height );
+
+	// only power of two sizes, odd sizes were filtered with misaligned rows
+	std::mt19937	rng( 0x5EED0400U );
+	std::vector< quint8 >	data = randomBytes( size_t( width ) * size_t( height ) * 4, rng );
+	std::vector< std::vector< quint8 > >	ref = refMipMaps( data, width, height );
+
+	// the loop of uploadMipMaps()
+	std::vector< quint8 >	src = data;
+	size_t	level = 0;
+	for ( int w = width, h = height; w > 1 || h > 1; level++ ) {
+		int	w2 = std::max< int >( w >> 1, 1 );
+		int	h2 = std::max< int >( h >> 1, 1 );
+		std::vector< quint8 >	dst( size_t( w2 ) * size_t( h2 ) * 4 );
+		::downsampleRGBA( dst.data(), src.data(), w, h );
+		QVERIFY( level < ref.size() );
+		QVERIFY( dst == ref[level] );
+		src = std::move( dst );
+		w = w2;
+		h = h2;
+	}
+	QCOMPARE( level, ref.size() );
+}
+
+QTEST_APPLESS_MAIN( TestTexLoaders )
+
+#include "tst_texloaders.moc"
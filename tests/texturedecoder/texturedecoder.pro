@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+TARGET = tst_texturedecoder
+
+HEADERS += \
+	../../src/texturedecoder.h \
+	../../src/textureinfo.h
+
+SOURCES += \
+	tst_texturedecoder.cpp \
+	../../src/texturedecoder.cpp \
+	../../src/textureinfo.cpp
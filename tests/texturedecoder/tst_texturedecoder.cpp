@@ -0,0 +1,332 @@
+#include "texturedecoder.h"
+
+#include <QTest>
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+
+//! Tests the CPU texture decoder against known blocks, and the threaded and downscaled image decoding against single blocks
+/*!
+ * The expected pixels of the block tests were decoded with the BPTC, RGTC and S3TC decoders of Mesa, and converted to
+ * 8 bits per channel in the same way as TextureDecoder does for float and signed formats. Channels may differ by one,
+ * because of the different rounding of the interpolated values.
+ */
+class TestTextureDecoder : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void decodeBlock_data();
+	void decodeBlock();
+	void decodeImage_data();
+	void decodeImage();
+	void decodeImageTooSmall();
+
+private:
+	//! Random image data in DXGI format 'fmt', 'width' x 'height' pixels
+	static std::vector< unsigned char > randomImage( std::uint32_t fmt, int width, int height, std::mt19937 & rng );
+	//! Box filter of an image decoded at full size, averaging only the pixels inside the image
+	static std::vector< std::uint32_t > refDownscale( const std::vector< std::uint32_t > & img, int width, int height,
+														int scaleLog2 );
+};
+
+
+std::vector< unsigned char > TestTextureDecoder::randomImage( std::uint32_t fmt, int width, int height,
+																std::mt19937 & rng )
+{
+	size_t	blockBytes = 4;
+	size_t	blockSize = 1;
+	switch ( fmt ) {
+	case 71:
+	case 80:
+		blockBytes = 8;
+		blockSize = 4;
+		break;
+	case 74:
+	case 77:
+	case 83:
+	case 95:
+	case 98:
+		blockBytes = 16;
+		blockSize = 4;
+		break;
+	}
+
+	std::uniform_int_distribution< int >	byte( 0, 255 );
+	size_t	n = ( ( size_t( width ) + blockSize - 1 ) / blockSize ) * ( ( size_t( height ) + blockSize - 1 ) / blockSize );
+	std::vector< unsigned char >	v( n * blockBytes );
+	for ( unsigned char & b : v )
+		b = (unsigned char) byte( rng );
+	return v;
+}
+
+std::vector< std::uint32_t > TestTextureDecoder::refDownscale( const std::vector< std::uint32_t > & img, int width,
+																int height, int scaleLog2 )
+{
+	int	scale = 1 << scaleLog2;
+	int	w = TextureDecoder::getScaledSize( width, scaleLog2 );
+	int	h = TextureDecoder::getScaledSize( height, scaleLog2 );
+	std::vector< std::uint32_t >	v( size_t( w ) * size_t( h ) );
+	for ( int y = 0; y < h; y++ ) {
+		for ( int x = 0; x < w; x++ ) {
+			std::uint32_t	sums[4] = { 0, 0, 0, 0 };
+			std::uint32_t	n = 0;
+			for ( int yy = y * scale; yy < ( y + 1 ) * scale && yy < height; yy++ ) {
+				for ( int xx = x * scale; xx < ( x + 1 ) * scale && xx < width; xx++, n++ ) {
+					for ( int c = 0; c < 4; c++ )
+						sums[c] += ( img[size_t( yy ) * size_t( width ) + size_t( xx )] >> ( c * 8 ) ) & 0xFF;
+				}
+			}
+			std::uint32_t	p = 0;
+			for ( int c = 0; c < 4; c++ )
+				p |= ( ( sums[c] + ( n >> 1 ) ) / n ) << ( c * 8 );
+			v[size_t( y ) * size_t( w ) + size_t( x )] = p;
+		}
+	}
+	return v;
+}
+
+void TestTextureDecoder::decodeBlock_data()
+{
+	QTest::addColumn<quint32>( "format" );
+	QTest::addColumn<QByteArray>( "block" );
+	QTest::addColumn<QByteArray>( "expected" );
+
+	// BC6H modes are numbered as in the specification, BC7 modes from 0
+	QTest::newRow( "BC1" ) << 71U << QByteArray::fromHex( "4b6cd21db2d5ee3f" )
+		<< QByteArray::fromHex( "4f996dff6b8a5aff33a980ff4f996dff18ba94ff18ba94ff18ba94ff33a980ff"
+								"4f996dff33a980ff4f996dff33a980ff33a980ff33a980ff33a980ff6b8a5aff" );
+	QTest::newRow( "BC1 transparent" ) << 71U << QByteArray::fromHex( "1557efb436ffdf66" )
+		<< QByteArray::fromHex( "84c194ffb59e7bff0000000052e3adff00000000000000000000000000000000"
+								"0000000000000000b59e7bff0000000084c194ffb59e7bff84c194ffb59e7bff" );
+	QTest::newRow( "BC2" ) << 74U << QByteArray::fromHex( "afb95ad1c0628d4af670b946f1f290be" )
+		<< QByteArray::fromHex( "42d7ceff731cb5aa5298c5995298c5bb625abdaa731cb5555298c5115298c5dd"
+								"731cb500731cb5cc42d7ce22625abd66625abddd5298c5885298c5aa625abd44" );
+	QTest::newRow( "BC3" ) << 77U << QByteArray::fromHex( "8a3cc368784f3f0dc75902ed24bb7ed1" )
+		<< QByteArray::fromHex( "5a383974efa2108a8b5b2b745a383968bc7e1d528b5b2b8abc7e1d528b5b2b74"
+								"8b5b2b47bc7e1d3cbc7e1d5defa21047efa210745a38397fefa21074bc7e1d8a" );
+	QTest::newRow( "BC4 UNORM" ) << 80U << QByteArray::fromHex( "714167ae597353fc" )
+		<< QByteArray::fromHex( "484848ff5c5c5cff414141ff484848ff6a6a6aff636363ff4e4e4eff6a6a6aff"
+								"636363ff4e4e4eff555555ff414141ff555555ff717171ff484848ff484848ff" );
+	QTest::newRow( "BC4 SNORM 6 values" ) << 81U << QByteArray::fromHex( "3be41be379398f4e" )
+		<< QByteArray::fromHex( "a2a2a2ffa2a2a2ff959595ff636363ff7c7c7cffa2a2a2ff7c7c7cffa2a2a2ff"
+								"636363ff6f6f6fff959595ff6f6f6fffbbbbbbff898989ffa2a2a2ffaeaeaeff" );
+	QTest::newRow( "BC4 SNORM 4 values" ) << 81U << QByteArray::fromHex( "0a4bede3897c40d6" )
+		<< QByteArray::fromHex( "bdbdbdffbdbdbdffffffffffcbcbcbff000000ffa3a3a3ff969696ffb0b0b0ff"
+								"b0b0b0ffffffffffcbcbcbff8a8a8affb0b0b0ffb0b0b0ffbdbdbdff000000ff" );
+	QTest::newRow( "BC5 UNORM" ) << 83U << QByteArray::fromHex( "d421fadb2bf1d710edadbeb3d7c024d6" )
+		<< QByteArray::fromHex( "babf00ff3bb600ff3bbf00ff6ead00ff6edb00ff3bb600ffbac800ff21bf00ff"
+								"21ed00ff54ed00ff3bdb00ffa1e400ff6ee400ff21d100ff87c800ffd4bf00ff" );
+	QTest::newRow( "BC5 SNORM 6 values" ) << 84U << QByteArray::fromHex( "66097962e361ad60672aea0821d7e13e" )
+		<< QByteArray::fromHex( "89de80ff96c480ff89d580ff89cd80ffa3e780ffa3de80ffe6e780ff96aa80ff"
+								"89b380ffbede80ffb1b380ffa3e780ffd8bb80ff89c480ffe6b380ffcbaa80ff" );
+	QTest::newRow( "BC5 SNORM 4 values" ) << 84U << QByteArray::fromHex( "244e9eca3dc72a70d251d3f1e2a1c137" )
+		<< QByteArray::fromHex( "008480ffb46a80ffacff80ffc55180ffbdff80ffb4b780ffff5180ffceff80ff"
+								"ffd180ffa49d80ffb40080ffc55180ffac9d80ffa4ff80ffbdb780ffb4d180ff" );
+	QTest::newRow( "BC6H UF16 mode 1" ) << 95U << QByteArray::fromHex( "54b7d1c20b6ae47dfd102bd727991b82" )
+		<< QByteArray::fromHex( "5a37c3ff5a37c3ff5732e6ff5835e0ff5a38bbff5b39b6ff5937c6ff562fedff"
+								"5937c6ff5a37c1ff5b39b8ff593bd2ff5937c6ff5a38beff5936c9ff5a38beff" );
+	QTest::newRow( "BC6H UF16 mode 2" ) << 95U << QByteArray::fromHex( "ad515779dfeeabf9a12717aab04f7721" )
+		<< QByteArray::fromHex( "002a9aff002a9aff01ff3aff005871ff01a657ff0014d3ff04ff1fff04ff1fff"
+								"012573ff002a9aff02ff2cff01b654ff01ff3eff011280ff0014d3ff002a9aff" );
+	QTest::newRow( "BC6H UF16 mode 3" ) << 95U << QByteArray::fromHex( "a266b061996651fdfd4013c8f4206599" )
+		<< QByteArray::fromHex( "2e45ffff2d47ffff2d48ffff2a42ffff2a42ffff2d47ffff2e42ffff2740ffff"
+								"2e45ffff2e43ffff2e43ffff2c44ffff2841ffff2d46ffff2e41ffff2a42ffff" );
+	QTest::newRow( "BC6H UF16 mode 4" ) << 95U << QByteArray::fromHex( "a6e883595f86bb22676fb3acd8c19a05" )
+		<< QByteArray::fromHex( "351c9eff341ba2ff371993ff351da4ff351ba0ff371993ff351da4ff331ba6ff"
+								"351c9fff371990ff361b9aff341ba4ff371993ff361b9aff351c9fff351c9eff" );
+	QTest::newRow( "BC6H UF16 mode 5" ) << 95U << QByteArray::fromHex( "ea6c99bd764c9d6d247671e6f1ef72d3" )
+		<< QByteArray::fromHex( "4c2c43ff4a293fff4b2b40ff4c2c43ff4a293fff4c2c43ff4a2a3fff4a293fff"
+								"4a293fff4a2a3fff4b2a40ff4b2e4bff4b2b41ff4b2f49ff4c2f48ff4b2f49ff" );
+	QTest::newRow( "BC6H UF16 mode 6" ) << 95U << QByteArray::fromHex( "ae186ee97b739054c8ee7c0feaf20713" )
+		<< QByteArray::fromHex( "2b5bffff3b62ffff3760ffff2b5bffff1f56ffff2759ffff335effff2138ffff"
+								"2358ffff3b62ffff1c30ffff243bffff1f56ffff2138ffff223affff263dffff" );
+	QTest::newRow( "BC6H UF16 mode 7" ) << 95U << QByteArray::fromHex( "320db0d7507b1a6893c66be43c4b3e99" )
+		<< QByteArray::fromHex( "21142fffa31f67ff7715acff80188eff0c0b16ff2d1738ff090911ff7b179dff"
+								"881a7fff2d1738ff2d1738ff090911ff881a7fff80188effa31f67ff140e1eff" );
+	QTest::newRow( "BC6H UF16 mode 8" ) << 95U << QByteArray::fromHex( "96c634d7acc431e571ce08735f13be11" )
+		<< QByteArray::fromHex( "005057ff013941ff009d87ff008e24ff005f61ff00bc9dff00ab2bff007a1fff"
+								"01414cff00df36ff008e24ff006019ff007a1fff00df36ff00c530ff00f93cff" );
+	QTest::newRow( "BC6H UF16 mode 9" ) << 95U << QByteArray::fromHex( "facbbae4be18fa39e167c8c5f5700ba5" )
+		<< QByteArray::fromHex( "146b5bff0f473eff125a4dff09ff3eff0d3230ff0e3b37ff3bff30ff13ff38ff"
+								"199d77ff0c2929ff3bff30ff0dff3bff199d77ff2aff32ff1dff35ff0dff3bff" );
+	QTest::newRow( "BC6H UF16 mode 10" ) << 95U << QByteArray::fromHex( "be4b2a10db987b0b581db177a16993e2" )
+		<< QByteArray::fromHex( "a40800ff781901ff54730fff663704ff781901ff930c00ff6e2502ff5d5008ff"
+								"6e2502ff5d5008ff5d5008ffffffdaff6e2502ff821001ffffffdaffffff3cff" );
+	QTest::newRow( "BC6H UF16 mode 11" ) << 95U << QByteArray::fromHex( "e3cfbf22d30aa6ed6e7ca38b2febbd8a" )
+		<< QByteArray::fromHex( "ff0c4dffff0d44ff29077cffff0c4dffff1233ff59086aff3b0773ffd20b56ff"
+								"0c05b2ffff142fff3b0773ff1105a0ff1c068aff3b0773ff59086affd20b56ff" );
+	QTest::newRow( "BC6H UF16 mode 12" ) << 95U << QByteArray::fromHex( "e776c189b5c907288212137e2a6eed85" )
+		<< QByteArray::fromHex( "9a6a0eff398c16ff7e6e0fff9a6a0eff727210ff9a6a0eff18bd1eff3f8515ff"
+								"2b9d18ff7e6e0fff18bd1eff4a7e13ff1cb31cff18bd1eff597a12ff398c16ff" );
+	QTest::newRow( "BC6H UF16 mode 13" ) << 95U << QByteArray::fromHex( "6b2adc43be935005a170082810d33bf5" )
+		<< QByteArray::fromHex( "0bfa74ff0fa977ff0bfa74ff0ec276ff0eba76ff0bfa74ff0eba76ff0ce974ff"
+								"0bfa74ff0bf274ff0ce175ff119378ff10a277ff0ce175ff0dd275ff138279ff" );
+	QTest::newRow( "BC6H UF16 mode 14" ) << 95U << QByteArray::fromHex( "cf46d5cf23afb5767f823692a5592d38" )
+		<< QByteArray::fromHex( "e512a3ffe512a3ffe512a3ffe512a3ffe512a3ffe512a3ffe512a3ffe512a3ff"
+								"e512a3ffe512a3ffe512a3ffe512a3ffe511a3ffe512a3ffe512a3ffe512a3ff" );
+	QTest::newRow( "BC6H SF16 mode 1" ) << 96U << QByteArray::fromHex( "e41eda6f018a5afead50d9fd8f10f71e" )
+		<< QByteArray::fromHex( "fd0011fffd000ffffd0010fffd000ffffd000ffffd000ffffd0011ffc8001fff"
+								"fd0012ffbc001ffff9001cffed001dffff001bfff9001cffd4001effb00020ff" );
+	QTest::newRow( "BC6H SF16 mode 2" ) << 96U << QByteArray::fromHex( "6127cc3c6b27a8fe8b465b0947809716" )
+		<< QByteArray::fromHex( "ff20aeff008201ff006601ffff257bffff1ee2ff009301ff005d01ffff20aeff"
+								"ff1ee2ff005401ff009301ffff2294ffff1fc8ff008201ff008201ffff1ee2ff" );
+	QTest::newRow( "BC6H SF16 mode 3" ) << 96U << QByteArray::fromHex( "82b5f4608f06fdbe0a1312ecd440a104" )
+		<< QByteArray::fromHex( "3fe800ff3de300ff3fe800ff39db00ff4ae400ff37d600ff3bdf00ff39db00ff"
+								"48f300ff49ea00ff48ef00ff3fe800ff49e800ff49ea00ff48f300ff48f300ff" );
+	QTest::newRow( "BC6H SF16 mode 4" ) << 96U << QByteArray::fromHex( "46bae0fc2eac7990bef56a17bd9ea77c" )
+		<< QByteArray::fromHex( "956effff7f82ffff7f82ffff807fffff8f66ffff9d79ffff7e87ffff8777ffff"
+								"a280ffff926affff7e87ffff8975ffff9d79ffff9a75ffffa280ffff8975ffff" );
+	QTest::newRow( "BC6H SF16 mode 5" ) << 96U << QByteArray::fromHex( "0a2e4487630e6044930ac2192bccf726" )
+		<< QByteArray::fromHex( "12ff6aff11ff73ff12ff71ff11ff78ff0fff7eff12ff71ff11ff75ff12ff6aff"
+								"14ff52ff12ff61ff15ff4bff11ff75ff15ff4bff14ff52ff12ff61ff0fff7eff" );
+	QTest::newRow( "BC6H SF16 mode 6" ) << 96U << QByteArray::fromHex( "2e0d50c8c844d874974716f4370d56ac" )
+		<< QByteArray::fromHex( "35ff2aff35ff2aff39ff25ff25ff3eff1fff50ff1fff50ff21ff47ff29ff39ff"
+								"9fff4cff35ff2aff39ff25ff2dff34ffbaff37ff8dff60ffa7ff42ff25ff3eff" );
+	QTest::newRow( "BC6H SF16 mode 7" ) << 96U << QByteArray::fromHex( "f20f176d10d6026d16e0ce9d6b3d4f07" )
+		<< QByteArray::fromHex( "000a33ff000e60ff000c67ffff144cff00072bff000a33ff9a0f59ff9a0f59ff"
+								"00051fff000a33ffff1153ff000c67ff640d39ff00041cffff144cff00087bff" );
+	QTest::newRow( "BC6H SF16 mode 8" ) << 96U << QByteArray::fromHex( "36c69b69efff742eb165fbf4c1419351" )
+		<< QByteArray::fromHex( "1c1c00ff140100ff0e4a00ff154800ff140100ff204600ff084c00ff160200ff"
+								"1e3300ff084c00ff574100ff1e3300ff0e4a00ff204600ff190800ff1c1c00ff" );
+	QTest::newRow( "BC6H SF16 mode 9" ) << 96U << QByteArray::fromHex( "da2659512e3a3bc1fbf2c39d8413b5e9" )
+		<< QByteArray::fromHex( "4c0007ff790009ff520019ff910007ff380035ff570007ff570007ff660010ff"
+								"520019ff620008ff790009ff410023ff520019ff520019ff620008ffb4000aff" );
+	QTest::newRow( "BC6H SF16 mode 10" ) << 96U << QByteArray::fromHex( "1e92a7ca708088cf3904eeab74214388" )
+		<< QByteArray::fromHex( "ff0c00ffa800ffff8500ffffff2000ff6b0002ffee0401ffa800ffffcb01e4ff"
+								"ff0085ffff0019ff100001ffffff00ffff0019ffff0085ffff003affff0019ff" );
+	QTest::newRow( "BC6H SF16 mode 11" ) << 96U << QByteArray::fromHex( "2325775ad7451c5ed8ed7aedca86df02" )
+		<< QByteArray::fromHex( "ff9f00ff277404ff277404ff1b700bff5f7c01ffed8c00ff277404ff1b700bff"
+								"5f7c01ff357702ffff9200ffb88600ff156d17ff277404ffffab00ffffb800ff" );
+	QTest::newRow( "BC6H SF16 mode 12" ) << 96U << QByteArray::fromHex( "47d5c0ce0ad63237e03eec16f707647a" )
+		<< QByteArray::fromHex( "001b0fff000380ff000380ff001019ff000462ff000380ff000b27ff001711ff"
+								"00092eff00039bff00092eff001b0fff000e1cff000b27ff000647ff00092eff" );
+	QTest::newRow( "BC6H SF16 mode 13" ) << 96U << QByteArray::fromHex( "8b786dcce6a4f923706976bc8f535274" )
+		<< QByteArray::fromHex( "cc004bff78006bff6c0074ff7f0067ff7f0067ff78006bff590084ff5f007dff"
+								"45009fff72006fffa50059ff8d0061ffb10055ff8d0061ff99005dff78006bff" );
+	QTest::newRow( "BC6H SF16 mode 14" ) << 96U << QByteArray::fromHex( "cf690b2969ce29d0046ab1cf639c0c73" )
+		<< QByteArray::fromHex( "ae0affffae0affffad09ffffae09ffffae0affffad09ffffad09ffffad09ffff"
+								"ae0affffae09ffffad09ffffad09ffffad09ffffae0affffae0affffae09ffff" );
+	QTest::newRow( "BC7 mode 0" ) << 98U << QByteArray::fromHex( "cf17f7e920f541bba67838396f3ee8ea" )
+		<< QByteArray::fromHex( "da4ac2ffe86bb4ff8b964dffb5a531ffd239c9ffbd08deffaea336ffa09e3fff"
+								"ab8f83ffab8f83ff849452ff929949ff4200c6ffc4b273ffa7a03aff999b44ff" );
+	QTest::newRow( "BC7 mode 1" ) << 98U << QByteArray::fromHex( "8a424834d875de5e5722f3aa82c1c7d9" )
+		<< QByteArray::fromHex( "0a627aff36df22ff645f77ff1cb176ff2ccd43ff2d6179ff129f97ff526078ff"
+								"1c6179ff129f97ff875e76ff21ba66ff27c453ff3f6078ff31d632ff755f77ff" );
+	QTest::newRow( "BC7 mode 2" ) << 98U << QByteArray::fromHex( "1cd285a818b554ae9fb3a9e7b322f3fe" )
+		<< QByteArray::fromHex( "4a52e7ff31ff7bff2ee486ff29ad9cff7055bcff4a52e7ff2cc891ff2ee486ff"
+								"7055bcff97578eff42ced6ff6e7bafffbd5a63ff42ced6ff42ced6ff6e7bafff" );
+	QTest::newRow( "BC7 mode 3" ) << 98U << QByteArray::fromHex( "78daec96f7870a8669aab4de8cdf2455" )
+		<< QByteArray::fromHex( "97625cff66a16eff6d3f35ffde607affde607affeda9abffa48074ff97625cff"
+								"a48074ff6d3f35ff66a16effc38684ffc38684ffa48074ffc38684ff2cc068ff" );
+	QTest::newRow( "BC7 mode 4" ) << 98U << QByteArray::fromHex( "904ea03c39c6c3790117f3abd2285762" )
+		<< QByteArray::fromHex( "6556a7611ebadc6110cee7c32ca7d2f35769b1612ca7d2f33a93c7f31ebadcc3"
+								"73429c612ca7d2613a93c761497dbcc32ca7d2f33a93c7c373429c61497dbcc3" );
+	QTest::newRow( "BC7 mode 5" ) << 98U << QByteArray::fromHex( "e089f84368833cb3b03f8446976f3090" )
+		<< QByteArray::fromHex( "121e9a6c9e639a3957409a53e3856120e3852c20e3852c2057406153121e9a6c"
+								"9e63cf39121ecf6c121e2c6c5740cf53e385cf20121ecf6c9e639a399e636139" );
+	QTest::newRow( "BC7 mode 6" ) << 98U << QByteArray::fromHex( "c0200141f59f74d922386be2570e4fad" )
+		<< QByteArray::fromHex( "7b1af2797226e47e4261a0956a30d98129807ca2514eb68e7226e47e109f59ae"
+								"4958ab925b43c489109f59ae8311fd7508a84eb26239cf85199367a93076879e" );
+	QTest::newRow( "BC7 mode 7" ) << 98U << QByteArray::fromHex( "806bd7252ef9ac7efc023f8b007fb26e" )
+		<< QByteArray::fromHex( "eb59d300eb59d3002879e39a2879e39a8ab2ba28d7967df78ab2ba28488cd675"
+								"6a9fc74d2879e39ad7967df76a9fc74d6a9fc74d8ab2ba28de8299a6e46db751" );
+}
+
+void TestTextureDecoder::decodeBlock()
+{
+	QFETCH( quint32, format );
+	QFETCH( QByteArray, block );
+	QFETCH( QByteArray, expected );
+
+	std::uint32_t	pixels[16];
+	QVERIFY( TextureDecoder::decodeImage( pixels, reinterpret_cast< const unsigned char * >( block.constData() ),
+											size_t( block.size() ), format, 4, 4, 0, 1 ) );
+
+	for ( int i = 0; i < 16; i++ ) {
+		for ( int c = 0; c < 4; c++ ) {
+			int	v = int( ( pixels[i] >> ( c * 8 ) ) & 0xFF );
+			int	e = int( quint8( expected.at( i * 4 + c ) ) );
+			if ( std::abs( v - e ) > 1 )
+				QFAIL( qPrintable( QString( "pixel %1, channel %2: %3 != %4" ).arg( i ).arg( c ).arg( v ).arg( e ) ) );
+		}
+	}
+}
+
+void TestTextureDecoder::decodeImage_data()
+{
+	QTest::addColumn<quint32>( "format" );
+	QTest::addColumn<int>( "width" );
+	QTest::addColumn<int>( "height" );
+	QTest::addColumn<int>( "scaleLog2" );
+
+	static const struct {
+		const char *	name;
+		quint32	format;
+	} formats[] = {
+		{ "BC1", 71 }, { "BC3", 77 }, { "BC4", 80 }, { "BC5", 83 }, { "BC6H", 95 }, { "BC7", 98 }, { "RGBA8", 28 }
+	};
+	static const int	sizes[3][2] = { { 256, 256 }, { 123, 301 }, { 2, 1 } };
+	for ( const auto & f : formats ) {
+		for ( const auto & s : sizes ) {
+			for ( int scaleLog2 = 0; scaleLog2 <= 3; scaleLog2++ ) {
+				QTest::addRow( "%s %dx%d scale 1/%d", f.name, s[0], s[1], 1 << scaleLog2 )
+					<< f.format << s[0] << s[1] << scaleLog2;
+			}
+		}
+	}
+}
+
+void TestTextureDecoder::decodeImage()
+{
+	QFETCH( quint32, format );
+	QFETCH( int, width );
+	QFETCH( int, height );
+	QFETCH( int, scaleLog2 );
+
+	std::mt19937	rng( 0x5EED0400U + format );
+	std::vector< unsigned char >	data = randomImage( format, width, height, rng );
+
+	// full size image decoded in one thread, which is compared with the blocks decoded one by one
+	std::vector< std::uint32_t >	full( size_t( width ) * size_t( height ) );
+	QVERIFY( TextureDecoder::decodeImage( full.data(), data.data(), data.size(), format, width, height, 0, 1 ) );
+	if ( format != 28 ) {
+		size_t	blockBytes = data.size() / ( size_t( ( width + 3 ) >> 2 ) * size_t( ( height + 3 ) >> 2 ) );
+		const unsigned char *	p = data.data();
+		for ( int y = 0; y < height; y += 4 ) {
+			for ( int x = 0; x < width; x += 4, p = p + blockBytes ) {
+				std::uint32_t	block[16];
+				QVERIFY( TextureDecoder::decodeImage( block, p, blockBytes, format, 4, 4, 0, 1 ) );
+				for ( int i = 0; i < 16; i++ ) {
+					if ( ( y + ( i >> 2 ) ) < height && ( x + ( i & 3 ) ) < width )
+						QCOMPARE( full[size_t( y + ( i >> 2 ) ) * size_t( width ) + size_t( x + ( i & 3 ) )], block[i] );
+				}
+			}
+		}
+	}
+
+	std::vector< std::uint32_t >	ref = refDownscale( full, width, height, scaleLog2 );
+	for ( int threadCount : { 1, 3, 8, 0 } ) {
+		std::vector< std::uint32_t >	img( ref.size(), 0xDEADBEEFU );
+		QVERIFY( TextureDecoder::decodeImage( img.data(), data.data(), data.size(), format, width, height, scaleLog2,
+												threadCount ) );
+		QVERIFY2( img == ref, qPrintable( QString( "%1 threads" ).arg( threadCount ) ) );
+	}
+}
+
+void TestTextureDecoder::decodeImageTooSmall()
+{
+	// 16 BC7 blocks are needed for 16x16 pixels, and 12 for 16x12
+	std::vector< unsigned char >	data( 16 * 16 - 1 );
+	std::vector< std::uint32_t >	img( 16 * 16 );
+	QVERIFY( !TextureDecoder::decodeImage( img.data(), data.data(), data.size(), 98, 16, 16 ) );
+	QVERIFY( TextureDecoder::decodeImage( img.data(), data.data(), data.size(), 98, 16, 12 ) );
+	QVERIFY( !TextureDecoder::decodeImage( img.data(), data.data(), data.size(), 98, 16, 16, 13 ) );
+	QVERIFY( !TextureDecoder::decodeImage( img.data(), data.data(), data.size(), 0, 16, 16 ) );
+}
+
+QTEST_APPLESS_MAIN( TestTextureDecoder )
+
+#include "tst_texturedecoder.moc"
@@ -0,0 +1,14 @@
+include(../tests.pri)
+
+TARGET = tst_textureencoder
+
+HEADERS += \
+	../../src/texturedecoder.h \
+	../../src/textureencoder.h \
+	../../src/textureinfo.h
+
+SOURCES += \
+	tst_textureencoder.cpp \
+	../../src/texturedecoder.cpp \
+	../../src/textureencoder.cpp \
+	../../src/textureinfo.cpp
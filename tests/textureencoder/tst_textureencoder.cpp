@@ -0,0 +1,201 @@
+#include "texturedecoder.h"
+#include "textureencoder.h"
+#include "textureinfo.h"
+
+#include <QTest>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+//! Converts synthetic DDS files with TextureEncoder, and checks the output with TextureInfo and TextureDecoder
+class TestTextureEncoder : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void convertDDS_data();
+	void convertDDS();
+	void convertDDSErrors();
+
+private:
+	//! Smooth gradients with a hard edge in the blue channel, the alpha channel is a radial gradient
+	static std::vector< std::uint32_t > syntheticImage( int width, int height, int face );
+	//! An uncompressed R8G8B8A8 DDS file with a single mip level
+	static QByteArray createDDS( int width, int height, int faces );
+};
+
+
+std::vector< std::uint32_t > TestTextureEncoder::syntheticImage( int width, int height, int face )
+{
+	std::vector< std::uint32_t >	img( size_t( width ) * size_t( height ) );
+	for ( int y = 0; y < height; y++ ) {
+		for ( int x = 0; x < width; x++ ) {
+			float	u = ( float( x ) + 0.5f ) / float( width );
+			float	v = ( float( y ) + 0.5f ) / float( height );
+			std::uint32_t	r = std::uint32_t( u * 255.0f );
+			std::uint32_t	g = std::uint32_t( ( 0.5f + 0.5f * std::sin( v * 3.0f + float( face ) ) ) * 255.0f );
+			std::uint32_t	b = ( u < 0.4f ? 64 : 192 ) + std::uint32_t( v * 48.0f );
+			float	d = std::sqrt( ( u - 0.5f ) * ( u - 0.5f ) + ( v - 0.5f ) * ( v - 0.5f ) );
+			std::uint32_t	a = std::uint32_t( std::clamp< float >( 1.25f - d * 1.5f, 0.0f, 1.0f ) * 255.0f );
+			img[size_t( y ) * size_t( width ) + size_t( x )] = r | ( g << 8 ) | ( b << 16 ) | ( a << 24 );
+		}
+	}
+	return img;
+}
+
+QByteArray TestTextureEncoder::createDDS( int width, int height, int faces )
+{
+	QByteArray	dds = TextureEncoder::createDDSHeader( 28, std::uint32_t( width ), std::uint32_t( height ), 1, ( faces == 6 ) );
+	for ( int face = 0; face < faces; face++ ) {
+		std::vector< std::uint32_t >	img = syntheticImage( width, height, face );
+		for ( std::uint32_t c : img ) {
+			for ( int i = 0; i < 4; i++ )
+				dds.append( char( ( c >> ( i * 8 ) ) & 0xFF ) );
+		}
+	}
+	return dds;
+}
+
+void TestTextureEncoder::convertDDS_data()
+{
+	QTest::addColumn<quint32>( "format" );
+	QTest::addColumn<int>( "width" );
+	QTest::addColumn<int>( "height" );
+	QTest::addColumn<int>( "faces" );
+	QTest::addColumn<quint32>( "maxSize" );
+	QTest::addColumn<double>( "minPSNR" );
+
+	static const struct {
+		const char *	name;
+		quint32	format;
+		double	minPSNR;
+	} formats[] = {
+		{ "BC1", 71, 27.0 }, { "BC3", 77, 27.0 }, { "BC4", 80, 40.0 }, { "BC4 SNORM", 81, 40.0 },
+		{ "BC5", 83, 40.0 }, { "BC5 SNORM", 84, 40.0 }, { "RGBA8", 28, 999.0 }, { "BGRA8", 87, 999.0 },
+		{ "BC1 sRGB", 72, 27.0 }, { "RGBA8 sRGB", 29, 999.0 }
+	};
+	for ( const auto & f : formats ) {
+		QTest::addRow( "%s 64x64", f.name ) << f.format << 64 << 64 << 1 << 0U << f.minPSNR;
+		QTest::addRow( "%s 40x12", f.name ) << f.format << 40 << 12 << 1 << 0U << f.minPSNR;
+		QTest::addRow( "%s 30x18", f.name ) << f.format << 30 << 18 << 1 << 0U << f.minPSNR;
+		QTest::addRow( "%s 128x64 max 32", f.name ) << f.format << 128 << 64 << 1 << 32U << f.minPSNR;
+		QTest::addRow( "%s 32x32 cube map", f.name ) << f.format << 32 << 32 << 6 << 0U << f.minPSNR;
+	}
+}
+
+void TestTextureEncoder::convertDDS()
+{
+	QFETCH( quint32, format );
+	QFETCH( int, width );
+	QFETCH( int, height );
+	QFETCH( int, faces );
+	QFETCH( quint32, maxSize );
+	QFETCH( double, minPSNR );
+
+	QByteArray	dds = createDDS( width, height, faces );
+	TextureEncoder::Options	options;
+	options.dxgiFormat = format;
+	options.maxSize = maxSize;
+	QString	err;
+	double	psnr = 0.0;
+	QByteArray	out = TextureEncoder::convertDDS( dds.constData(), size_t( dds.size() ), options, &err, &psnr );
+	QVERIFY2( !out.isEmpty(), qPrintable( err ) );
+
+	// the output has a complete mip chain, and no data after the last mip level
+	TextureInfo	info;
+	QVERIFY( info.parseDDS( reinterpret_cast< const unsigned char * >( out.constData() ), size_t( out.size() ) ) );
+	QVERIFY2( info.isValid(), qPrintable( info.errors.join( "; " ) ) );
+	QCOMPARE( info.dxgiFormat, format );
+	int	scaleLog2 = 0;
+	while ( maxSize && std::uint32_t( std::max( width >> scaleLog2, height >> scaleLog2 ) ) > maxSize )
+		scaleLog2++;
+	int	w = TextureDecoder::getScaledSize( width, scaleLog2 );
+	int	h = TextureDecoder::getScaledSize( height, scaleLog2 );
+	QCOMPARE( info.width, std::uint32_t( w ) );
+	QCOMPARE( info.height, std::uint32_t( h ) );
+	QCOMPARE( info.faces, std::uint32_t( faces ) );
+	QVERIFY( info.hasCompleteMipChain() );
+	QCOMPARE( info.mipLevels, info.fullMipCount() );
+	QCOMPARE( std::uint64_t( info.dataOffset ) + info.dataSize, std::uint64_t( out.size() ) );
+
+	unsigned int	blockBytes = 0;
+	unsigned int	blockSize = 1;
+	QVERIFY( TextureInfo::dxgiBlockInfo( format, blockBytes, blockSize ) );
+	std::uint32_t	channelMask = ( format == 80 || format == 81 ? 1 : format == 83 || format == 84 ? 3 : format == 71 || format == 72 ? 7 : 15 );
+	bool	isSRGB = ( format == 29 || format == 72 );
+
+	// each mip level is compared with the source image downscaled with the box filters of the decoder and encoder
+	const unsigned char *	srcData = reinterpret_cast< const unsigned char * >( dds.constData() ) + 128;
+	const unsigned char *	outData = reinterpret_cast< const unsigned char * >( out.constData() );
+	size_t	offset = info.dataOffset;
+	for ( int face = 0; face < faces; face++ ) {
+		std::vector< std::uint32_t >	ref( size_t( w ) * size_t( h ) );
+		size_t	faceBytes = size_t( width ) * size_t( height ) * 4;
+		QVERIFY( TextureDecoder::decodeImage( ref.data(), srcData + ( faceBytes * size_t( face ) ), faceBytes, 28,
+												width, height, scaleLog2 ) );
+		int	lw = w;
+		int	lh = h;
+		for ( std::uint32_t m = 0; m < info.mipLevels; m++ ) {
+			if ( m > 0 ) {
+				std::vector< std::uint32_t >	tmp( size_t( std::max( lw >> 1, 1 ) ) * size_t( std::max( lh >> 1, 1 ) ) );
+				TextureEncoder::downsampleImage( tmp.data(), ref.data(), lw, lh, isSRGB );
+				ref.swap( tmp );
+				lw = std::max( lw >> 1, 1 );
+				lh = std::max( lh >> 1, 1 );
+			}
+
+			size_t	n = ( ( size_t( lw ) + blockSize - 1 ) / blockSize ) * ( ( size_t( lh ) + blockSize - 1 ) / blockSize ) * blockBytes;
+			QVERIFY( ( offset + n ) <= size_t( out.size() ) );
+			std::vector< std::uint32_t >	img( ref.size() );
+			QVERIFY( TextureDecoder::decodeImage( img.data(), outData + offset, n, format, lw, lh ) );
+			offset += n;
+
+			if ( format == 71 || format == 72 ) {
+				// BC1 makes pixels with alpha below 128 transparent black
+				for ( size_t i = 0; i < img.size(); i++ ) {
+					QCOMPARE( img[i] >> 24, ( ref[i] >> 24 ) < 128 ? 0U : 255U );
+					if ( ( ref[i] >> 24 ) < 128 )
+						img[i] = ref[i];
+				}
+			}
+			// in mip levels smaller than 16x16, a few blocks cover the whole gradient, which BCn cannot approximate well,
+			// so these are only checked for broken blocks
+			double	levelPSNR = TextureEncoder::calculatePSNR( img.data(), ref.data(), img.size(), channelMask );
+			if ( levelPSNR < ( lw >= 16 && lh >= 16 ? minPSNR : std::min( minPSNR, 12.0 ) ) ) {
+				QFAIL( qPrintable( QString( "face %1, mip level %2: PSNR = %3 dB" ).arg( face ).arg( m ).arg( levelPSNR ) ) );
+			}
+		}
+	}
+	QCOMPARE( offset, size_t( out.size() ) );
+	QVERIFY( psnr >= minPSNR );
+}
+
+void TestTextureEncoder::convertDDSErrors()
+{
+	QByteArray	dds = createDDS( 16, 16, 1 );
+	TextureEncoder::Options	options;
+	QString	err;
+
+	// BC7 cannot be encoded
+	options.dxgiFormat = 98;
+	QVERIFY( TextureEncoder::convertDDS( dds.constData(), size_t( dds.size() ), options, &err ).isEmpty() );
+	QVERIFY( !err.isEmpty() );
+
+	err.clear();
+	options.dxgiFormat = 71;
+	QVERIFY( TextureEncoder::convertDDS( dds.constData(), size_t( dds.size() - 1 ), options, &err ).isEmpty() );
+	QVERIFY( !err.isEmpty() );
+
+	// the input is copied if the format is kept and there is nothing to do
+	options.dxgiFormat = 0;
+	options.generateMips = false;
+	double	psnr = 0.0;
+	QCOMPARE( TextureEncoder::convertDDS( dds.constData(), size_t( dds.size() ), options, nullptr, &psnr ), dds );
+	QCOMPARE( psnr, 999.0 );
+}
+
+QTEST_APPLESS_MAIN( TestTextureEncoder )
+
+#include "tst_textureencoder.moc"
@@ -0,0 +1,9 @@
+include(../tests.pri)
+
+TARGET = tst_textureinfo
+
+HEADERS += ../../src/textureinfo.h
+
+SOURCES += \
+	tst_textureinfo.cpp \
+	../../src/textureinfo.cpp
@@ -0,0 +1,312 @@
+#include "textureinfo.h"
+
+#include <QTest>
+
+#include <cstring>
+
+
+//! Checks the sizes, errors and warnings reported by TextureInfo for DDS, TGA, BMP and NiPixelData fixtures
+class TestTextureInfo : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void parseFile_data();
+	void parseFile();
+	void parsePixelData_data();
+	void parsePixelData();
+
+private:
+	//! Fields of the DDS header written by dds(), the pixel format is "DX10", FourCC or RGB masks in this order
+	struct DDSFile
+	{
+		std::uint32_t	width = 0;
+		std::uint32_t	height = 0;
+		std::uint32_t	mipLevels = 1;
+		std::uint32_t	caps2 = 0;
+		bool	dx10 = false;
+		std::uint32_t	dxgiFormat = 0;
+		std::uint32_t	miscFlag = 0;
+		std::uint32_t	arraySize = 1;
+		const char *	fourCC = nullptr;
+		std::uint32_t	bitCount = 0;
+		std::uint32_t	masks[4] = { 0, 0, 0, 0 };
+	};
+
+	static void write16( QByteArray & data, qsizetype offset, std::uint32_t n );
+	static void write32( QByteArray & data, qsizetype offset, std::uint32_t n );
+	//! A DDS file with 'dataSize' bytes of image data after the header
+	static QByteArray dds( const DDSFile & f, qsizetype dataSize );
+	//! A TGA file with an ID field of 'idLength' bytes, and a color map if 'colorMapLength' is not zero
+	static QByteArray tga( int imageType, int bitsPerPixel, int w, int h, qsizetype dataSize,
+							int idLength = 0, int colorMapLength = 0, int colorMapBits = 0 );
+	static QByteArray bmp( int bitsPerPixel, int w, int h, qsizetype dataSize );
+};
+
+
+void TestTextureInfo::write16( QByteArray & data, qsizetype offset, std::uint32_t n )
+{
+	data[offset] = char( n & 0xFF );
+	data[offset + 1] = char( ( n >> 8 ) & 0xFF );
+}
+
+void TestTextureInfo::write32( QByteArray & data, qsizetype offset, std::uint32_t n )
+{
+	write16( data, offset, n & 0xFFFF );
+	write16( data, offset + 2, n >> 16 );
+}
+
+QByteArray TestTextureInfo::dds( const DDSFile & f, qsizetype dataSize )
+{
+	qsizetype	headerSize = ( f.dx10 ? 148 : 128 );
+	QByteArray	data( headerSize + dataSize, '\0' );
+	std::memcpy( data.data(), "DDS ", 4 );
+	write32( data, 4, 124 );
+	write32( data, 8, 0x00021007 );	// CAPS, HEIGHT, WIDTH, PIXELFORMAT, MIPMAPCOUNT
+	write32( data, 12, f.height );
+	write32( data, 16, f.width );
+	write32( data, 28, f.mipLevels );
+	write32( data, 76, 32 );
+	if ( f.dx10 || f.fourCC ) {
+		write32( data, 80, 0x04 );	// DDPF_FOURCC
+		std::memcpy( data.data() + 84, ( f.dx10 ? "DX10" : f.fourCC ), 4 );
+	} else {
+		write32( data, 80, ( f.masks[3] ? 0x41 : 0x40 ) );	// DDPF_RGB, DDPF_ALPHAPIXELS
+		write32( data, 88, f.bitCount );
+		for ( int i = 0; i < 4; i++ )
+			write32( data, 92 + i * 4, f.masks[i] );
+	}
+	write32( data, 108, 0x00401008 );	// DDSCAPS_COMPLEX, DDSCAPS_TEXTURE, DDSCAPS_MIPMAP
+	write32( data, 112, f.caps2 );
+	if ( f.dx10 ) {
+		write32( data, 128, f.dxgiFormat );
+		write32( data, 132, 3 );	// D3D10_RESOURCE_DIMENSION_TEXTURE2D
+		write32( data, 136, f.miscFlag );
+		write32( data, 140, f.arraySize );
+	}
+	return data;
+}
+
+QByteArray TestTextureInfo::tga( int imageType, int bitsPerPixel, int w, int h, qsizetype dataSize,
+									int idLength, int colorMapLength, int colorMapBits )
+{
+	qsizetype	headerSize = 18 + idLength + qsizetype( colorMapLength ) * ( colorMapBits >> 3 );
+	QByteArray	data( headerSize + dataSize, '\0' );
+	data[0] = char( idLength );
+	data[1] = char( colorMapLength ? 1 : 0 );
+	data[2] = char( imageType );
+	write16( data, 5, std::uint32_t( colorMapLength ) );
+	data[7] = char( colorMapBits );
+	write16( data, 12, std::uint32_t( w ) );
+	write16( data, 14, std::uint32_t( h ) );
+	data[16] = char( bitsPerPixel );
+	data[17] = char( 0x20 );	// top-left origin
+	return data;
+}
+
+QByteArray TestTextureInfo::bmp( int bitsPerPixel, int w, int h, qsizetype dataSize )
+{
+	QByteArray	data( 54 + dataSize, '\0' );
+	data[0] = 'B';
+	data[1] = 'M';
+	write32( data, 2, std::uint32_t( data.size() ) );
+	write32( data, 10, 54 );
+	write32( data, 14, 40 );
+	write32( data, 18, std::uint32_t( w ) );
+	write32( data, 22, std::uint32_t( h ) );
+	write16( data, 26, 1 );
+	write16( data, 28, std::uint32_t( bitsPerPixel ) );
+	return data;
+}
+
+void TestTextureInfo::parseFile_data()
+{
+	QTest::addColumn<QByteArray>( "data" );
+	QTest::addColumn<QString>( "fileName" );
+	QTest::addColumn<QString>( "pixelFormat" );
+	QTest::addColumn<quint32>( "mipLevels" );
+	QTest::addColumn<quint32>( "faces" );
+	QTest::addColumn<quint64>( "dataSize" );
+	QTest::addColumn<quint64>( "gpuBytes" );
+	QTest::addColumn<QStringList>( "errors" );
+	QTest::addColumn<QStringList>( "warnings" );
+
+	// 256x256 BC1: 64x64 blocks of 8 bytes at the first level, then 32x32, 16x16, 8x8, 4x4, 2x2 and 3 levels of 1 block
+	const quint64	bc1Size = 32768 + 8192 + 2048 + 512 + 128 + 32 + 8 + 8 + 8;
+	DDSFile	bc1 { .width = 256, .height = 256, .mipLevels = 9, .fourCC = "DXT1" };
+	QTest::newRow( "DDS BC1" ) << dds( bc1, bc1Size ) << "a.dds" << "BC1_UNORM"
+		<< 9U << 1U << bc1Size << bc1Size << QStringList() << QStringList();
+	QTest::newRow( "DDS truncated image" ) << dds( bc1, bc1Size - 100 ) << "a.dds" << "BC1_UNORM"
+		<< 9U << 1U << bc1Size << bc1Size
+		<< QStringList{ "file is truncated, 100 bytes of image data are missing" } << QStringList();
+	QTest::newRow( "DDS extra data" ) << dds( bc1, bc1Size + 16 ) << "a.dds" << "BC1_UNORM"
+		<< 9U << 1U << bc1Size << bc1Size
+		<< QStringList() << QStringList{ "16 bytes of extra data at the end of the file" };
+	QTest::newRow( "DDS truncated header" ) << dds( bc1, 0 ).left( 100 ) << "a.dds" << QString()
+		<< 0U << 1U << quint64( 0 ) << quint64( 0 ) << QStringList{ "invalid DDS header" } << QStringList();
+	QTest::newRow( "DDS unsupported FourCC" ) << dds( { .width = 4, .height = 4, .fourCC = "ABCD" }, 16 ) << "a.dds" << QString()
+		<< 1U << 1U << quint64( 0 ) << quint64( 0 ) << QStringList{ "unsupported FourCC code: ABCD" } << QStringList();
+
+	// DX10 header, BC7 64x32 without mip maps: 16x8 blocks of 16 bytes
+	DDSFile	bc7 { .width = 64, .height = 32, .dx10 = true, .dxgiFormat = 98 };
+	QTest::newRow( "DDS DX10 BC7" ) << dds( bc7, 2048 ) << "a.dds" << "BC7_UNORM"
+		<< 1U << 1U << quint64( 2048 ) << quint64( 2048 )
+		<< QStringList() << QStringList{ "incomplete mip chain: 1 of 7 levels" };
+	QTest::newRow( "DDS truncated DX10 header" ) << dds( bc7, 0 ).left( 140 ) << "a.dds" << QString()
+		<< 1U << 1U << quint64( 0 ) << quint64( 0 ) << QStringList{ "invalid DDS header" } << QStringList();
+
+	// RGBA8 with masks, 3 of 5 levels: ( 16 * 16 + 8 * 8 + 4 * 4 ) * 4 bytes
+	DDSFile	rgba { .width = 16, .height = 16, .mipLevels = 3, .bitCount = 32,
+					.masks = { 0xFF, 0xFF00, 0xFF0000, 0xFF000000 } };
+	QTest::newRow( "DDS incomplete mip chain" ) << dds( rgba, 1344 ) << "a.dds" << "R8G8B8A8_UNORM"
+		<< 3U << 1U << quint64( 1344 ) << quint64( 1344 )
+		<< QStringList() << QStringList{ "incomplete mip chain: 3 of 5 levels" };
+	DDSFile	tooManyMips { .width = 4, .height = 4, .mipLevels = 5, .bitCount = 32,
+							.masks = { 0xFF, 0xFF00, 0xFF0000, 0xFF000000 } };
+	QTest::newRow( "DDS too many mip levels" ) << dds( tooManyMips, 84 ) << "a.dds" << "R8G8B8A8_UNORM"
+		<< 3U << 1U << quint64( 84 ) << quint64( 84 )
+		<< QStringList{ "mip count 5 exceeds the maximum of 3 for a 4x4 image" } << QStringList();
+
+	// R9G9B9E5 cube map with a complete mip chain: ( 8 * 8 + 4 * 4 + 2 * 2 + 1 ) * 4 bytes per face
+	DDSFile	cube { .width = 8, .height = 8, .mipLevels = 4, .caps2 = 0xFE00, .dx10 = true, .dxgiFormat = 67,
+					.miscFlag = 4 };
+	QTest::newRow( "DDS cube map" ) << dds( cube, 2040 ) << "a.dds" << "R9G9B9E5_SHAREDEXP"
+		<< 4U << 6U << quint64( 2040 ) << quint64( 2040 ) << QStringList() << QStringList();
+	DDSFile	fiveFaces { .width = 8, .height = 8, .mipLevels = 4, .caps2 = 0xBE00, .fourCC = "DXT5" };
+	QTest::newRow( "DDS cube map with 5 faces" ) << dds( fiveFaces, 2040 ) << "a.dds" << "BC3_UNORM"
+		<< 4U << 5U << quint64( 0 ) << quint64( 0 )
+		<< QStringList{ "cube map has 5 faces instead of 6" } << QStringList();
+	DDSFile	notSquare { .width = 32, .height = 16, .dx10 = true, .dxgiFormat = 28, .miscFlag = 4 };
+	QTest::newRow( "DDS cube map not square" ) << dds( notSquare, 12288 ) << "a.dds" << "R8G8B8A8_UNORM"
+		<< 1U << 6U << quint64( 0 ) << quint64( 0 )
+		<< QStringList{ "cube map faces are not square (32x16)" }
+		<< QStringList{ "cube map flag is not set in the legacy DDS header" };
+
+	// TGA and BMP are converted to RGBA and get a complete mip chain when loaded: ( 16 * 8 + 8 * 4 + 4 * 2 + 2 + 1 ) * 4
+	QTest::newRow( "TGA RGB8" ) << tga( 2, 24, 16, 8, 384 ) << "a.tga" << "RGB8"
+		<< 1U << 1U << quint64( 384 ) << quint64( 684 ) << QStringList() << QStringList();
+	QTest::newRow( "TGA RGBA8 RLE" ) << tga( 10, 32, 16, 8, 10, 5 ) << "a.TGA" << "RGBA8 (RLE)"
+		<< 1U << 1U << quint64( 512 ) << quint64( 684 ) << QStringList() << QStringList();
+	QTest::newRow( "TGA PAL8" ) << tga( 1, 8, 16, 8, 128, 0, 256, 24 ) << "a.tga" << "PAL8"
+		<< 1U << 1U << quint64( 128 ) << quint64( 684 ) << QStringList() << QStringList();
+	QTest::newRow( "TGA truncated" ) << tga( 3, 8, 16, 8, 100 ) << "a.tga" << "L8"
+		<< 1U << 1U << quint64( 128 ) << quint64( 684 )
+		<< QStringList{ "file is truncated, 28 bytes of image data are missing" } << QStringList();
+	QTest::newRow( "TGA truncated color map" ) << tga( 1, 8, 16, 8, 0, 0, 256, 32 ).left( 500 ) << "a.tga" << "PAL8"
+		<< 1U << 1U << quint64( 128 ) << quint64( 684 ) << QStringList{ "unexpected EOF" } << QStringList();
+	QTest::newRow( "TGA not power of two" ) << tga( 2, 24, 12, 8, 288 ) << "a.tga" << "RGB8"
+		<< 1U << 1U << quint64( 0 ) << quint64( 0 )
+		<< QStringList{ "image dimensions must be power of two (12x8)" } << QStringList();
+	QTest::newRow( "TGA 16-bit color" ) << tga( 2, 16, 16, 8, 256 ) << "a.tga" << QString()
+		<< 1U << 1U << quint64( 0 ) << quint64( 0 )
+		<< QStringList{ "image sub format not supported (type 2, 16 bits per pixel)" } << QStringList();
+	QTest::newRow( "unknown format" ) << tga( 2, 24, 16, 8, 384 ) << "a.png" << QString()
+		<< 0U << 1U << quint64( 0 ) << quint64( 0 ) << QStringList{ "unknown file format" } << QStringList();
+
+	QTest::newRow( "BMP RGB8" ) << bmp( 24, 16, 8, 384 ) << "a.bmp" << "RGB8"
+		<< 1U << 1U << quint64( 384 ) << quint64( 684 ) << QStringList() << QStringList();
+	QTest::newRow( "BMP truncated" ) << bmp( 24, 16, 8, 383 ) << "a.bmp" << "RGB8"
+		<< 1U << 1U << quint64( 384 ) << quint64( 684 ) << QStringList{ "file is truncated" } << QStringList();
+	QTest::newRow( "BMP 32-bit" ) << bmp( 32, 16, 8, 512 ) << "a.bmp" << QString()
+		<< 1U << 1U << quint64( 0 ) << quint64( 0 )
+		<< QStringList{ "unknown image sub format (compression 0, 32 bits per pixel)" } << QStringList();
+}
+
+void TestTextureInfo::parseFile()
+{
+	QFETCH( QByteArray, data );
+	QFETCH( QString, fileName );
+	QFETCH( QString, pixelFormat );
+	QFETCH( quint32, mipLevels );
+	QFETCH( quint32, faces );
+	QFETCH( quint64, dataSize );
+	QFETCH( quint64, gpuBytes );
+	QFETCH( QStringList, errors );
+	QFETCH( QStringList, warnings );
+
+	TextureInfo	info;
+	bool	r = info.parse( data.constData(), size_t( data.size() ), fileName );
+	QCOMPARE( r, errors.isEmpty() );
+	QCOMPARE( info.isValid(), errors.isEmpty() );
+	QCOMPARE( info.errors, errors );
+	QCOMPARE( info.warnings, warnings );
+	QCOMPARE( info.pixelFormat, pixelFormat );
+	QCOMPARE( info.mipLevels, mipLevels );
+	QCOMPARE( info.faces, faces );
+	QCOMPARE( info.dataSize, dataSize );
+	QCOMPARE( info.gpuBytes, gpuBytes );
+}
+
+void TestTextureInfo::parsePixelData_data()
+{
+	QTest::addColumn<uint>( "pixelFormat" );
+	QTest::addColumn<uint>( "bitsPerPixel" );
+	QTest::addColumn<uint>( "bytesPerPixel" );
+	QTest::addColumn<quint32>( "mipLevels" );
+	QTest::addColumn<bool>( "hasPalette" );
+	QTest::addColumn<qint64>( "pixelDataSize" );
+	QTest::addColumn<QString>( "format" );
+	QTest::addColumn<quint64>( "dataSize" );
+	QTest::addColumn<quint64>( "gpuBytes" );
+	QTest::addColumn<QStringList>( "errors" );
+
+	// the images are 64x64, with up to 7 mip levels of 4096, 1024, 256, 64, 16, 4 and 1 pixels
+	QTest::newRow( "RGB8" ) << 0U << 24U << 3U << 7U << false << qint64( 16383 ) << "RGB8"
+		<< quint64( 5461 * 3 ) << quint64( 5461 * 4 ) << QStringList();
+	QTest::newRow( "RGBA8 without mip maps" ) << 1U << 32U << 0U << 1U << false << qint64( 16384 ) << "RGBA8"
+		<< quint64( 16384 ) << quint64( 5461 * 4 ) << QStringList();
+	QTest::newRow( "PAL8" ) << 2U << 8U << 1U << 7U << true << qint64( 5461 ) << "PAL8"
+		<< quint64( 5461 ) << quint64( 5461 * 4 ) << QStringList();
+	QTest::newRow( "PAL8 without palette" ) << 2U << 8U << 1U << 7U << false << qint64( 5461 ) << "PAL8"
+		<< quint64( 0 ) << quint64( 0 ) << QStringList{ "palette is missing" };
+	// BC1 blocks: 256, 64, 16, 4, 1, 1, 1
+	QTest::newRow( "DXT1" ) << 4U << 0U << 0U << 7U << false << qint64( 343 * 8 ) << "BC1_UNORM"
+		<< quint64( 343 * 8 ) << quint64( 343 * 8 ) << QStringList();
+	QTest::newRow( "DXT5 truncated" ) << 6U << 0U << 0U << 7U << false << qint64( 343 * 16 - 1 ) << "BC3_UNORM"
+		<< quint64( 343 * 16 ) << quint64( 343 * 16 ) << QStringList{ "pixel data is truncated, 1 bytes are missing" };
+	QTest::newRow( "no pixel data array" ) << 5U << 0U << 0U << 1U << false << qint64( -1 ) << "BC2_UNORM"
+		<< quint64( 4096 ) << quint64( 4096 ) << QStringList();
+	QTest::newRow( "5 bytes per pixel" ) << 0U << 40U << 5U << 1U << false << qint64( 20480 ) << "RGB8"
+		<< quint64( 0 ) << quint64( 0 ) << QStringList{ "unsupported image depth 40 / 5" };
+	QTest::newRow( "unsupported format" ) << 3U << 16U << 2U << 1U << false << qint64( 8192 ) << QString()
+		<< quint64( 0 ) << quint64( 0 ) << QStringList{ "unsupported pixel format 3" };
+}
+
+void TestTextureInfo::parsePixelData()
+{
+	QFETCH( uint, pixelFormat );
+	QFETCH( uint, bitsPerPixel );
+	QFETCH( uint, bytesPerPixel );
+	QFETCH( quint32, mipLevels );
+	QFETCH( bool, hasPalette );
+	QFETCH( qint64, pixelDataSize );
+	QFETCH( QString, format );
+	QFETCH( quint64, dataSize );
+	QFETCH( quint64, gpuBytes );
+	QFETCH( QStringList, errors );
+
+	TextureInfo::PixelDataHeader	h;
+	h.pixelFormat = pixelFormat;
+	h.bitsPerPixel = bitsPerPixel;
+	h.bytesPerPixel = bytesPerPixel;
+	h.width = 64;
+	h.height = 64;
+	h.mipLevels = mipLevels;
+	h.hasPalette = hasPalette;
+	h.pixelDataSize = pixelDataSize;
+
+	TextureInfo	info;
+	QCOMPARE( info.parsePixelData( h ), errors.isEmpty() );
+	QCOMPARE( info.fileFormat, TextureInfo::FileNIF );
+	QCOMPARE( info.errors, errors );
+	QCOMPARE( info.pixelFormat, format );
+	QCOMPARE( info.width, 64U );
+	QCOMPARE( info.mipLevels, mipLevels );
+	QCOMPARE( info.dataSize, dataSize );
+	QCOMPARE( info.gpuBytes, gpuBytes );
+	QCOMPARE( info.isCompressed, pixelFormat >= 4 );
+}
+
+QTEST_APPLESS_MAIN( TestTextureInfo )
+
+#include "tst_textureinfo.moc"